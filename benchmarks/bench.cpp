@@ -0,0 +1,816 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../src/geargrafx.h"
+
+bool g_mcp_stdio_mode = true;
+
+// Reproducible speed measurements for the core. Every benchmark runs a
+// fixed amount of work several times and reports nanoseconds per unit of
+// work as JSON. The media are synthetic programs built here, so results
+// don't depend on any ROM being available.
+
+#define BENCH_CD_AUDIO_SECTORS 150
+#define BENCH_CD_DATA_SECTORS 600
+
+struct Bench_Result
+{
+    std::string name;
+    std::string unit;
+    u64 iterations;
+    std::vector<double> ns;
+};
+
+struct Bench_Options
+{
+    int frames;
+    int runs;
+    const char* filter;
+    const char* output;
+    const char* profile;
+    bool list;
+};
+
+class Benchmark
+{
+public:
+    static void Frames(const char* name, GeargrafxCore* core);
+    static void Cpu(GeargrafxCore* core);
+    static void Memory(GeargrafxCore* core);
+    static void Vdc(GeargrafxCore* core);
+    static void Psg();
+    static void Vce(const char* name, GeargrafxCore* core);
+    static void SaveState(const char* name, GeargrafxCore* core);
+};
+
+static Bench_Options options;
+static std::vector<Bench_Result> results;
+static std::vector<u8> frame_buffer(2048 * 512 * 4);
+static std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+static volatile u32 sink;
+
+static void print_usage(const char* name);
+static bool parse_options(int argc, char* argv[]);
+static bool selected(const char* name);
+template <typename F>
+static void measure(const char* name, const char* unit, u64 iterations, F run);
+static void write_json(FILE* file);
+static void emit(std::vector<u8>& p, u8 opcode);
+static void emit_imm(std::vector<u8>& p, u8 opcode, u8 value);
+static void emit_abs(std::vector<u8>& p, u8 opcode, u16 address);
+static void emit_branch(std::vector<u8>& p, u8 opcode, size_t target);
+static size_t emit_forward_branch(std::vector<u8>& p, u8 opcode);
+static void patch_forward_branch(std::vector<u8>& p, size_t branch);
+static void emit_vdc_setup(std::vector<u8>& p, u16 base);
+static void emit_psg_setup(std::vector<u8>& p);
+static void emit_scsi_read(std::vector<u8>& p);
+static std::vector<u8> build_bank(bool sgx, bool cdrom);
+static bool write_cdrom_image(const std::string& dir);
+static GeargrafxCore* create_core(void);
+static void run_frames(GeargrafxCore* core, int frames);
+
+int main(int argc, char* argv[])
+{
+    options.frames = 600;
+    options.runs = 5;
+    options.filter = NULL;
+    options.output = NULL;
+    options.profile = NULL;
+    options.list = false;
+
+    if (!parse_options(argc, argv))
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (IsValidPointer(options.profile))
+    {
+#if defined(GG_ENABLE_PROFILER)
+        Profiler::SetEnabled(true);
+#else
+        fprintf(stderr, "--profile needs a PROFILER=1 build\n");
+        return 1;
+#endif
+    }
+
+    std::vector<u8> hucard = build_bank(false, false);
+    std::vector<u8> sgx = build_bank(true, false);
+    std::vector<u8> bios(GG_BIOS_SYSCARD_SIZE, 0xFF);
+    std::vector<u8> bios_bank = build_bank(false, true);
+    memcpy(bios.data(), bios_bank.data(), bios_bank.size());
+
+    GeargrafxCore* hucard_core = create_core();
+    GeargrafxCore* sgx_core = create_core();
+    GeargrafxCore* cdrom_core = create_core();
+
+    if (!hucard_core->LoadHuCardFromBuffer(hucard.data(), (int)hucard.size(), "bench.pce") ||
+        !sgx_core->LoadHuCardFromBuffer(sgx.data(), (int)sgx.size(), "bench.sgx"))
+    {
+        fprintf(stderr, "Unable to load benchmark HuCards\n");
+        return 1;
+    }
+
+    const char* tmp = getenv("TMPDIR");
+    std::string dir = std::string(IsValidPointer(tmp) ? tmp : "/tmp") + "/geargrafx-bench-XXXXXX";
+    std::vector<char> dir_template(dir.begin(), dir.end());
+    dir_template.push_back(0);
+
+    if (!IsValidPointer(mkdtemp(dir_template.data())))
+    {
+        fprintf(stderr, "Unable to create a temporary directory\n");
+        return 1;
+    }
+
+    dir = dir_template.data();
+    std::string cue_path = dir + "/bench.cue";
+    std::string bin_path = dir + "/bench.bin";
+
+    if (!write_cdrom_image(dir) ||
+        !cdrom_core->LoadBiosFromBuffer(bios.data(), (int)bios.size(), true) ||
+        !cdrom_core->LoadMedia(cue_path.c_str()))
+    {
+        fprintf(stderr, "Unable to load benchmark CD-ROM\n");
+        remove(cue_path.c_str());
+        remove(bin_path.c_str());
+        rmdir(dir.c_str());
+        return 1;
+    }
+
+    // Warm up so VRAM, the SAT and the palette hold the program output
+    run_frames(hucard_core, 60);
+    run_frames(sgx_core, 60);
+    run_frames(cdrom_core, 60);
+
+    Benchmark::Frames("frames_hucard", hucard_core);
+    Benchmark::Frames("frames_sgx", sgx_core);
+    Benchmark::Frames("frames_cdrom", cdrom_core);
+    Benchmark::Cpu(hucard_core);
+    Benchmark::Memory(hucard_core);
+    Benchmark::Vdc(hucard_core);
+    Benchmark::Psg();
+    Benchmark::Vce("vce_render_frame", hucard_core);
+    Benchmark::Vce("vce_render_frame_sgx", sgx_core);
+    Benchmark::SaveState("savestate_hucard", hucard_core);
+    Benchmark::SaveState("savestate_cdrom", cdrom_core);
+
+    SafeDelete(hucard_core);
+    SafeDelete(sgx_core);
+    SafeDelete(cdrom_core);
+
+    remove(cue_path.c_str());
+    remove(bin_path.c_str());
+    rmdir(dir.c_str());
+
+    if (options.list)
+        return 0;
+
+    if (IsValidPointer(options.profile))
+    {
+        Profiler::SetEnabled(false);
+        if (!Profiler::ExportChromeTrace(options.profile))
+        {
+            fprintf(stderr, "Unable to write %s\n", options.profile);
+            return 1;
+        }
+    }
+
+    if (IsValidPointer(options.output))
+    {
+        FILE* file = fopen(options.output, "w");
+
+        if (!IsValidPointer(file))
+        {
+            fprintf(stderr, "Unable to write %s\n", options.output);
+            return 1;
+        }
+
+        write_json(file);
+        fclose(file);
+    }
+    else
+        write_json(stdout);
+
+    return 0;
+}
+
+// Runs whole frames the way frontends do, with rendering and audio
+void Benchmark::Frames(const char* name, GeargrafxCore* core)
+{
+    measure(name, "frame", options.frames, [core](u64 iterations) {
+        run_frames(core, (int)iterations);
+    });
+
+    // Only filled in PERF_COUNTERS=1 builds
+    GG_Perf_Counters perf;
+    if (selected(name) && !options.list && core->GetPerfCounters(perf))
+    {
+        fprintf(stderr, "%-28s %llu instr, %llu clock calls, %llu 3-cycle steps, %llu psg syncs, %llu cd reads, %llu/%llu cd cache hits/misses\n",
+            "  last frame", (unsigned long long)perf.instructions, (unsigned long long)perf.clock_hardware_calls,
+            (unsigned long long)perf.clock_hardware_slow_steps, (unsigned long long)perf.psg_sync_calls,
+            (unsigned long long)perf.cd_sector_reads, (unsigned long long)perf.cd_cache_hits, (unsigned long long)perf.cd_cache_misses);
+    }
+}
+
+// A tight ALU and RAM loop placed at $F000 by build_bank()
+void Benchmark::Cpu(GeargrafxCore* core)
+{
+    if (!selected("cpu_run_instruction"))
+        return;
+
+    size_t size = core->GetSaveStateSize();
+    std::vector<u8> state(size);
+    core->SaveState(state.data(), size);
+
+    HuC6280* cpu = core->GetHuC6280();
+    cpu->GetState()->PC->SetValue(0xF000);
+
+    measure("cpu_run_instruction", "instruction", 2000000, [cpu](u64 iterations) {
+        u32 cycles = 0;
+        for (u64 i = 0; i < iterations; i++)
+            cycles += cpu->RunInstruction();
+        sink = cycles;
+    });
+
+    core->LoadState(state.data(), size);
+}
+
+// Reads from the RAM and ROM pages, the common case for CPU fetches
+void Benchmark::Memory(GeargrafxCore* core)
+{
+    ::Memory* memory = core->GetMemory();
+
+    measure("memory_read", "read", 10000000, [memory](u64 iterations) {
+        u32 sum = 0;
+        for (u64 i = 0; i < iterations; i++)
+        {
+            u16 address = (u16)(i & 0x1FFF);
+            address |= (i & 0x2000) ? 0xE000 : 0x2000;
+            sum += memory->Read(address);
+        }
+        sink = sum;
+    });
+}
+
+// One 256 pixel line of background, then sprites over it. The SAT is
+// filled with a sprite per column group, so every line hits the 16
+// sprite limit.
+void Benchmark::Vdc(GeargrafxCore* core)
+{
+    HuC6270* vdc = core->GetHuC6270_1();
+    const int width = 256;
+
+    vdc->m_latched_cr |= 0xC0;
+    vdc->m_latched_mwr = 0x10;
+    vdc->m_latched_hdw = (width >> 3) - 1;
+
+    measure("vdc_render_background", "line", 200000, [vdc, width](u64 iterations) {
+        for (u64 i = 0; i < iterations; i++)
+        {
+            vdc->m_bg_offset_y = (s32)(i & 0xFF);
+            vdc->m_latched_bxr = (u16)(i & 0x1FF);
+            vdc->RenderBackground(width);
+        }
+        sink = vdc->m_line_buffer[0];
+    });
+
+    for (int i = 0; i < HUC6270_SPRITES; i++)
+    {
+        vdc->m_sat[(i * 4) + 0] = 64;
+        vdc->m_sat[(i * 4) + 1] = (u16)(0x20 + ((i * 17) & 0xFF));
+        vdc->m_sat[(i * 4) + 2] = (u16)(i * 4);
+        vdc->m_sat[(i * 4) + 3] = (u16)((i & 0x0F) | ((i & 1) << 8) | ((i & 2) ? 0x80 : 0) | ((i & 4) ? 0x800 : 0));
+    }
+
+    vdc->m_raster_line = 8;
+    vdc->FetchSprites();
+
+    measure("vdc_render_sprites", "line", 200000, [vdc, width](u64 iterations) {
+        for (u64 i = 0; i < iterations; i++)
+            vdc->RenderSprites(width);
+        sink = vdc->m_line_buffer[0];
+    });
+}
+
+// All six channels playing, two of them noise, synced once per output
+// sample as Audio does at 44.1 KHz
+void Benchmark::Psg()
+{
+    if (!selected("psg_sync"))
+        return;
+
+    HuC6280PSG* psg = new HuC6280PSG();
+    psg->Init();
+    psg->Reset();
+    psg->Write(0x0801, 0xFF);
+
+    for (int c = 0; c < 6; c++)
+    {
+        psg->Write(0x0800, (u8)c);
+        psg->Write(0x0804, 0x00);
+        for (int i = 0; i < 32; i++)
+            psg->Write(0x0806, (u8)((i * (c + 3)) & 0x1F));
+        psg->Write(0x0802, (u8)(0x40 + (c * 0x21)));
+        psg->Write(0x0803, 0x01);
+        psg->Write(0x0805, 0xFF);
+        psg->Write(0x0807, (c >= 4) ? 0x85 : 0x00);
+        psg->Write(0x0804, 0x9F);
+    }
+
+    const u32 psg_cycles_per_sample = (GG_MASTER_CLOCK_RATE / GG_AUDIO_SAMPLE_RATE) / 6;
+
+    measure("psg_sync", "sample", 500000, [psg, psg_cycles_per_sample](u64 iterations) {
+        for (u64 i = 0; i < iterations; i++)
+        {
+            psg->Clock(psg_cycles_per_sample);
+            psg->Sample();
+
+            if ((i % 735) == 734)
+                psg->EndFrame(sample_buffer.data());
+        }
+        psg->EndFrame(sample_buffer.data());
+    });
+
+    SafeDelete(psg);
+}
+
+// Converts the last frame the VDCs produced to RGBA
+void Benchmark::Vce(const char* name, GeargrafxCore* core)
+{
+    HuC6260* vce = core->GetHuC6260();
+    bool sgx = core->GetMedia()->IsSGX();
+    s32 pixel_index = vce->m_pixel_index;
+
+    run_frames(core, 1);
+    vce->m_pixel_index = vce->m_frame_pixel_count;
+
+    measure(name, "frame", 2000, [vce, sgx](u64 iterations) {
+        for (u64 i = 0; i < iterations; i++)
+        {
+            if (sgx)
+                vce->RenderFrameTemplate<true, 4>();
+            else
+                vce->RenderFrameTemplate<false, 4>();
+        }
+    });
+
+    vce->m_pixel_index = pixel_index;
+}
+
+void Benchmark::SaveState(const char* name, GeargrafxCore* core)
+{
+    size_t size = core->GetSaveStateSize();
+    std::vector<u8> state(size);
+    std::string save_name = std::string(name) + "_save";
+    std::string load_name = std::string(name) + "_load";
+    std::string hash_name = std::string(name) + "_hash";
+
+    measure(save_name.c_str(), "state", 2000, [core, &state](u64 iterations) {
+        for (u64 i = 0; i < iterations; i++)
+        {
+            size_t size = state.size();
+            core->SaveState(state.data(), size);
+        }
+    });
+
+    size = state.size();
+    core->SaveState(state.data(), size);
+
+    measure(load_name.c_str(), "state", 2000, [core, &state, size](u64 iterations) {
+        for (u64 i = 0; i < iterations; i++)
+            core->LoadState(state.data(), size);
+    });
+
+    measure(hash_name.c_str(), "state", 2000, [core](u64 iterations) {
+        for (u64 i = 0; i < iterations; i++)
+            sink = (u32)core->HashState();
+    });
+}
+
+static void print_usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [options]\n", name);
+    fprintf(stderr, "  --frames <n>     frames per end-to-end run (default: 600)\n");
+    fprintf(stderr, "  --runs <n>       runs per benchmark (default: 5)\n");
+    fprintf(stderr, "  --filter <text>  only run benchmarks whose name contains text\n");
+    fprintf(stderr, "  --output <file>  write JSON to file instead of stdout\n");
+    fprintf(stderr, "  --profile <file> record profiling zones to a Chrome trace (PROFILER=1 builds)\n");
+    fprintf(stderr, "  --list           list benchmark names and exit\n");
+    fprintf(stderr, "  --verbose        show core log output\n");
+}
+
+static bool parse_options(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool has_value = (i + 1) < argc;
+
+        if ((arg == "--frames") && has_value)
+            options.frames = atoi(argv[++i]);
+        else if ((arg == "--runs") && has_value)
+            options.runs = atoi(argv[++i]);
+        else if ((arg == "--filter") && has_value)
+            options.filter = argv[++i];
+        else if ((arg == "--output") && has_value)
+            options.output = argv[++i];
+        else if ((arg == "--profile") && has_value)
+            options.profile = argv[++i];
+        else if (arg == "--list")
+            options.list = true;
+        else if (arg == "--verbose")
+            g_mcp_stdio_mode = false;
+        else
+            return false;
+    }
+
+    return (options.frames > 0) && (options.runs > 0);
+}
+
+static bool selected(const char* name)
+{
+    return !IsValidPointer(options.filter) || IsValidPointer(strstr(name, options.filter));
+}
+
+template <typename F>
+static void measure(const char* name, const char* unit, u64 iterations, F run)
+{
+    if (!selected(name))
+        return;
+
+    if (options.list)
+    {
+        printf("%s\n", name);
+        return;
+    }
+
+    Bench_Result result;
+    result.name = name;
+    result.unit = unit;
+    result.iterations = iterations;
+
+    for (int r = 0; r < options.runs; r++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        run(iterations);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        result.ns.push_back(ns / (double)iterations);
+    }
+
+    std::vector<double> sorted = result.ns;
+    std::sort(sorted.begin(), sorted.end());
+    fprintf(stderr, "%-28s %12.1f ns/%s\n", name, sorted[sorted.size() / 2], unit);
+
+    results.push_back(result);
+}
+
+static void write_json(FILE* file)
+{
+    fprintf(file, "{\n");
+    fprintf(file, "  \"emulator\": \"%s\",\n", GG_TITLE);
+    fprintf(file, "  \"version\": \"%s\",\n", GG_VERSION);
+#if defined(__VERSION__)
+    fprintf(file, "  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+#if defined(GG_DISABLE_DISASSEMBLER)
+    fprintf(file, "  \"disassembler\": false,\n");
+#else
+    fprintf(file, "  \"disassembler\": true,\n");
+#endif
+    fprintf(file, "  \"frames\": %d,\n", options.frames);
+    fprintf(file, "  \"runs\": %d,\n", options.runs);
+    fprintf(file, "  \"results\": [\n");
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Bench_Result& r = results[i];
+        std::vector<double> sorted = r.ns;
+        std::sort(sorted.begin(), sorted.end());
+
+        double mean = 0.0;
+        for (size_t s = 0; s < sorted.size(); s++)
+            mean += sorted[s];
+        mean /= (double)sorted.size();
+
+        double median = sorted[sorted.size() / 2];
+
+        fprintf(file, "    {\"name\": \"%s\", \"unit\": \"%s\", \"iterations\": %llu, ", r.name.c_str(), r.unit.c_str(), (unsigned long long)r.iterations);
+        fprintf(file, "\"min_ns\": %.3f, \"median_ns\": %.3f, \"mean_ns\": %.3f, \"max_ns\": %.3f, ", sorted.front(), median, mean, sorted.back());
+        fprintf(file, "\"per_second\": %.1f}%s\n", 1000000000.0 / median, (i + 1) < results.size() ? "," : "");
+    }
+
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+}
+
+static void emit(std::vector<u8>& p, u8 opcode)
+{
+    p.push_back(opcode);
+}
+
+static void emit_imm(std::vector<u8>& p, u8 opcode, u8 value)
+{
+    p.push_back(opcode);
+    p.push_back(value);
+}
+
+static void emit_abs(std::vector<u8>& p, u8 opcode, u16 address)
+{
+    p.push_back(opcode);
+    p.push_back(address & 0xFF);
+    p.push_back(address >> 8);
+}
+
+static void emit_branch(std::vector<u8>& p, u8 opcode, size_t target)
+{
+    p.push_back(opcode);
+    p.push_back((u8)(s8)((int)target - (int)(p.size() + 1)));
+}
+
+static size_t emit_forward_branch(std::vector<u8>& p, u8 opcode)
+{
+    p.push_back(opcode);
+    p.push_back(0);
+    return p.size() - 1;
+}
+
+static void patch_forward_branch(std::vector<u8>& p, size_t branch)
+{
+    p[branch] = (u8)(p.size() - (branch + 1));
+}
+
+// CR: background and sprites on. MWR: 64x32 map. DCR: SAT DMA every
+// frame from $7F00. Leaves VRAM writes selected at address 0.
+static void emit_vdc_setup(std::vector<u8>& p, u16 base)
+{
+    static const u8 k_registers[][3] = {
+        { 0x05, 0xC0, 0x00 },
+        { 0x09, 0x10, 0x00 },
+        { 0x0F, 0x10, 0x00 },
+        { 0x13, 0x00, 0x7F },
+        { 0x00, 0x00, 0x00 }
+    };
+
+    for (int i = 0; i < 5; i++)
+    {
+        emit_imm(p, 0xA9, k_registers[i][0]);   // LDA #reg
+        emit_abs(p, 0x8D, base);                // STA AR
+        emit_imm(p, 0xA9, k_registers[i][1]);   // LDA #lsb
+        emit_abs(p, 0x8D, base + 2);            // STA data low
+        emit_imm(p, 0xA9, k_registers[i][2]);   // LDA #msb
+        emit_abs(p, 0x8D, base + 3);            // STA data high
+    }
+
+    emit_imm(p, 0xA9, 0x02);                    // LDA #$02
+    emit_abs(p, 0x8D, base);                    // STA AR
+}
+
+// Channel 0 plays a ramp, channel 5 plays noise
+static void emit_psg_setup(std::vector<u8>& p)
+{
+    emit_abs(p, 0x9C, 0x0800);                  // STZ $0800
+    emit_imm(p, 0xA9, 0xFF);                    // LDA #$FF
+    emit_abs(p, 0x8D, 0x0801);                  // STA $0801
+    emit_abs(p, 0x8D, 0x0805);                  // STA $0805
+    emit_abs(p, 0x9C, 0x0804);                  // STZ $0804
+    emit_imm(p, 0xA2, 0x20);                    // LDX #$20
+    size_t wave = p.size();
+    emit(p, 0x8A);                              // TXA
+    emit_imm(p, 0x29, 0x1F);                    // AND #$1F
+    emit_abs(p, 0x8D, 0x0806);                  // STA $0806
+    emit(p, 0xCA);                              // DEX
+    emit_branch(p, 0xD0, wave);                 // BNE wave
+    emit_imm(p, 0xA9, 0x9F);                    // LDA #$9F
+    emit_abs(p, 0x8D, 0x0804);                  // STA $0804
+
+    emit_imm(p, 0xA9, 0x05);                    // LDA #$05
+    emit_abs(p, 0x8D, 0x0800);                  // STA $0800
+    emit_imm(p, 0xA9, 0xFF);                    // LDA #$FF
+    emit_abs(p, 0x8D, 0x0805);                  // STA $0805
+    emit_imm(p, 0xA9, 0x8F);                    // LDA #$8F
+    emit_abs(p, 0x8D, 0x0807);                  // STA $0807
+    emit_imm(p, 0xA9, 0x9F);                    // LDA #$9F
+    emit_abs(p, 0x8D, 0x0804);                  // STA $0804
+    emit_abs(p, 0x9C, 0x0800);                  // STZ $0800
+}
+
+// SCSI READ(6) of 4 sectors at LBA $0100 + [$2001], handshaking every
+// command, data, status and message byte through $1800-$1802 until the
+// drive releases the bus. Reads are sequential so most skip the seek.
+static void emit_scsi_read(std::vector<u8>& p)
+{
+    emit_abs(p, 0x8D, 0x1800);                  // STA $1800 (select)
+    size_t selection = p.size();
+    emit_abs(p, 0xAD, 0x1800);                  // LDA $1800
+    emit_imm(p, 0xC9, 0xD0);                    // CMP #$D0 (BSY|REQ|CD)
+    emit_branch(p, 0xD0, selection);            // BNE selection
+
+    static const int k_command[6] = { 0x08, 0x00, 0x01, -1, 0x04, 0x00 };
+
+    for (int i = 0; i < 6; i++)
+    {
+        size_t req = p.size();
+        emit_abs(p, 0xAD, 0x1800);              // LDA $1800
+        emit_imm(p, 0x29, 0x40);                // AND #$40 (REQ)
+        emit_branch(p, 0xF0, req);              // BEQ req
+        if (k_command[i] < 0)
+            emit_abs(p, 0xAD, 0x2001);          // LDA $2001
+        else
+            emit_imm(p, 0xA9, (u8)k_command[i]);// LDA #byte
+        emit_abs(p, 0x8D, 0x1801);              // STA $1801
+        emit_imm(p, 0xA9, 0x80);                // LDA #$80
+        emit_abs(p, 0x8D, 0x1802);              // STA $1802 (ACK)
+        size_t ack = p.size();
+        emit_abs(p, 0xAD, 0x1800);              // LDA $1800
+        emit_imm(p, 0x29, 0x40);                // AND #$40
+        emit_branch(p, 0xD0, ack);              // BNE ack
+        emit_abs(p, 0x9C, 0x1802);              // STZ $1802
+    }
+
+    size_t response = p.size();
+    emit_abs(p, 0xAD, 0x1800);                  // LDA $1800
+    size_t done = emit_forward_branch(p, 0x10); // BPL done (bus free)
+    emit_imm(p, 0x29, 0x48);                    // AND #$48
+    emit_imm(p, 0xC9, 0x48);                    // CMP #$48 (REQ|IO)
+    emit_branch(p, 0xD0, response);             // BNE response
+    emit_abs(p, 0xAD, 0x1801);                  // LDA $1801
+    emit_imm(p, 0xA9, 0x80);                    // LDA #$80
+    emit_abs(p, 0x8D, 0x1802);                  // STA $1802 (ACK)
+    size_t ack = p.size();
+    emit_abs(p, 0xAD, 0x1800);                  // LDA $1800
+    emit_imm(p, 0x29, 0x40);                    // AND #$40
+    emit_branch(p, 0xD0, ack);                  // BNE ack
+    emit_abs(p, 0x9C, 0x1802);                  // STZ $1802
+    emit_branch(p, 0x80, response);             // BRA response
+    patch_forward_branch(p, done);
+    emit_abs(p, 0xAD, 0x2001);                  // LDA $2001
+    emit(p, 0x18);                              // CLC
+    emit_imm(p, 0x69, 0x04);                    // ADC #$04
+    emit_abs(p, 0x8D, 0x2001);                  // STA $2001
+}
+
+// First 8 KB bank of the benchmark media, mapped at $E000. The main loop
+// keeps the PSG, VRAM and the palette busy, and on CD-ROM also reads
+// sectors. A separate ALU loop at $F000 is used by the CPU benchmark.
+static std::vector<u8> build_bank(bool sgx, bool cdrom)
+{
+    std::vector<u8> p;
+
+    emit(p, 0x78);                              // SEI
+    emit(p, 0xD4);                              // CSH
+    emit_imm(p, 0xA9, 0xFF);                    // LDA #$FF
+    emit_imm(p, 0x53, 0x01);                    // TAM #$01
+    emit_imm(p, 0xA9, 0xF8);                    // LDA #$F8
+    emit_imm(p, 0x53, 0x02);                    // TAM #$02
+
+    emit_vdc_setup(p, 0x0000);
+    if (sgx)
+        emit_vdc_setup(p, 0x0010);
+    emit_psg_setup(p);
+
+    size_t loop = p.size();
+    emit_abs(p, 0xEE, 0x2000);                  // INC $2000
+    emit_abs(p, 0xAD, 0x2000);                  // LDA $2000
+    emit_abs(p, 0x8D, 0x0802);                  // STA $0802
+    emit_abs(p, 0x8D, 0x0002);                  // STA $0002
+    emit_abs(p, 0x8D, 0x0003);                  // STA $0003
+    if (sgx)
+    {
+        emit_abs(p, 0x8D, 0x0012);              // STA $0012
+        emit_abs(p, 0x8D, 0x0013);              // STA $0013
+    }
+    emit_abs(p, 0x8D, 0x0404);                  // STA $0404
+    emit_abs(p, 0x8D, 0x0405);                  // STA $0405
+    if (cdrom)
+        emit_scsi_read(p);
+    emit_abs(p, 0x4C, (u16)(0xE000 + loop));    // JMP loop
+
+    p.resize(0x1000, 0xFF);
+
+    emit(p, 0x82);                              // CLX
+    size_t alu = p.size();
+    emit_abs(p, 0xBD, 0x2200);                  // LDA $2200,X
+    emit(p, 0x18);                              // CLC
+    emit_imm(p, 0x69, 0x13);                    // ADC #$13
+    emit(p, 0x0A);                              // ASL A
+    emit_abs(p, 0x9D, 0x2200);                  // STA $2200,X
+    emit_abs(p, 0x4D, 0x2000);                  // EOR $2000
+    emit_abs(p, 0x8D, 0x2000);                  // STA $2000
+    emit(p, 0xE8);                              // INX
+    emit_branch(p, 0xD0, alu);                  // BNE alu
+    emit_abs(p, 0xEE, 0x2001);                  // INC $2001
+    emit_branch(p, 0x80, alu);                  // BRA alu
+
+    p.resize(0x2000, 0xFF);
+
+    // All vectors point to $E000
+    for (int i = 0x1FF6; i < 0x2000; i += 2)
+    {
+        p[i] = 0x00;
+        p[i + 1] = 0xE0;
+    }
+
+    return p;
+}
+
+// An audio track followed by a MODE1/2352 data track in a single BIN
+static bool write_cdrom_image(const std::string& dir)
+{
+    std::string cue_path = dir + "/bench.cue";
+    std::string bin_path = dir + "/bench.bin";
+
+    FILE* cue = fopen(cue_path.c_str(), "w");
+    if (!IsValidPointer(cue))
+        return false;
+
+    int data_start = BENCH_CD_AUDIO_SECTORS;
+    fprintf(cue, "FILE \"bench.bin\" BINARY\n");
+    fprintf(cue, "  TRACK 01 AUDIO\n");
+    fprintf(cue, "    INDEX 01 00:00:00\n");
+    fprintf(cue, "  TRACK 02 MODE1/2352\n");
+    fprintf(cue, "    INDEX 01 %02d:%02d:%02d\n", data_start / (75 * 60), (data_start / 75) % 60, data_start % 75);
+    fclose(cue);
+
+    FILE* bin = fopen(bin_path.c_str(), "wb");
+    if (!IsValidPointer(bin))
+        return false;
+
+    u8 sector[2352];
+    u32 seed = 0x12345678;
+
+    for (int s = 0; s < BENCH_CD_AUDIO_SECTORS + BENCH_CD_DATA_SECTORS; s++)
+    {
+        for (int i = 0; i < 2352; i++)
+        {
+            seed = (seed * 1103515245) + 12345;
+            sector[i] = (u8)(seed >> 16);
+        }
+
+        if (s >= data_start)
+        {
+            int lba = s + 150;
+            memset(sector, 0xFF, 12);
+            sector[0] = 0x00;
+            sector[11] = 0x00;
+            sector[12] = (u8)((((lba / (75 * 60)) / 10) << 4) | ((lba / (75 * 60)) % 10));
+            sector[13] = (u8)(((((lba / 75) % 60) / 10) << 4) | (((lba / 75) % 60) % 10));
+            sector[14] = (u8)((((lba % 75) / 10) << 4) | ((lba % 75) % 10));
+            sector[15] = 0x01;
+        }
+
+        if (fwrite(sector, 1, sizeof(sector), bin) != sizeof(sector))
+        {
+            fclose(bin);
+            return false;
+        }
+    }
+
+    fclose(bin);
+    return true;
+}
+
+// Fixed reset values so every run starts from the same state
+static GeargrafxCore* create_core(void)
+{
+    GeargrafxCore* core = new GeargrafxCore();
+    core->Init(NULL);
+    core->GetMemory()->SetResetValues(0, 0, 0, 0);
+    core->GetHuC6280()->SetResetValue(0);
+    core->GetHuC6260()->SetResetValue(0);
+    return core;
+}
+
+static void run_frames(GeargrafxCore* core, int frames)
+{
+    for (int i = 0; i < frames; i++)
+    {
+        int sample_count = 0;
+        core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+    }
+}
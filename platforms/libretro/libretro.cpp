@@ -1382,6 +1382,15 @@ static void check_variables(void)
         core->GetMedia()->PreloadCdRom(preload_cdrom);
     }
 
+    var.key = "geargrafx_cdrom_chd_decode";
+    var.value = NULL;
+
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+    {
+        bool precache_chd_decode = (strcmp(var.value, "Enabled") == 0);
+        core->GetMedia()->PrecacheChdDecode(precache_chd_decode);
+    }
+
     var.key = "geargrafx_psg_huc6280a";
     var.value = NULL;
 
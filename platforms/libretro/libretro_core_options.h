@@ -553,6 +553,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
         },
         "Disabled"
     },
+    {
+        "geargrafx_cdrom_chd_decode",
+        "Decode CHD on Preload (restart)",
+        NULL,
+        "When preloading a CHD image, also decompress all its hunks. Uses as much memory as the uncompressed disc, but avoids decoding while playing.",
+        NULL,
+        "cdrom",
+        {
+            { "Disabled", NULL },
+            { "Enabled",  NULL },
+            { NULL, NULL },
+        },
+        "Disabled"
+    },
 
     /* Input */
 
@@ -0,0 +1,292 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "batch_runner.h"
+#include "headless_core.h"
+#include "geargrafx.h"
+#include "config.h"
+#include "utils.h"
+#include "wav_writer.h"
+#include "stb_image_write.h"
+
+#define BATCH_DEFAULT_FRAMES 3600
+
+struct Batch_Stats
+{
+    int frames;
+    double elapsed;
+    double frame_min;
+    double frame_max;
+};
+
+static bool parse_frame_list(const char* list, std::vector<int>& frames);
+static bool save_png(GeargrafxCore* core, const u8* frame_buffer, const char* dir, int frame);
+static void log_stats(const Batch_Stats& stats);
+static bool write_stats(const char* file_path, const BatchRunParams& params, const Batch_Stats& stats);
+
+// Runs a game flat out with no window, audio device or MCP client, and
+// writes whatever outputs were requested: per-frame hashes, screenshots
+// of selected frames, the audio mix and timing stats
+int batch_run(const BatchRunParams& params)
+{
+    Log("\n%s", GG_TITLE_ASCII);
+    Log("%s %s Batch Mode", GG_TITLE, GG_VERSION);
+
+    if (!IsValidPointer(params.rom_file) || (strlen(params.rom_file) == 0))
+    {
+        Error("Batch mode requires a game file");
+        return 1;
+    }
+
+    std::vector<int> png_frames;
+
+    if (IsValidPointer(params.png_frames) && !parse_frame_list(params.png_frames, png_frames))
+    {
+        Error("Invalid frame list: %s", params.png_frames);
+        return 1;
+    }
+
+    if (IsValidPointer(params.png_dir) && !create_directory_if_not_exists(params.png_dir))
+    {
+        Error("Unable to create output directory %s", params.png_dir);
+        return 1;
+    }
+
+    InputMovie movie;
+    bool use_movie = IsValidPointer(params.movie_file);
+
+    if (use_movie && !movie.Load(params.movie_file))
+        return 1;
+
+    int total_frames = params.frames;
+
+    if (total_frames <= 0)
+        total_frames = use_movie ? movie.GetFrameCount() : BATCH_DEFAULT_FRAMES;
+
+    // Without a frame list only the last frame is saved
+    if (IsValidPointer(params.png_dir) && png_frames.empty())
+        png_frames.push_back(total_frames - 1);
+
+    GeargrafxCore* core = headless_create_core();
+    core->SetRandomSeed(params.seed);
+
+    if (!core->LoadMedia(params.rom_file))
+    {
+        Error("Failed to load %s", params.rom_file);
+        headless_destroy_core(core);
+        return 2;
+    }
+
+    if (use_movie && !movie.StartPlayback(core))
+    {
+        headless_destroy_core(core);
+        return 3;
+    }
+
+    FILE* hash_file = NULL;
+    WavWriter wav;
+    bool ok = true;
+
+    if (IsValidPointer(params.hash_file))
+    {
+        hash_file = fopen_utf8(params.hash_file, "w");
+
+        if (IsValidPointer(hash_file))
+            fprintf(hash_file, "# frame video audio ram state\n");
+        else
+        {
+            Error("Unable to open %s", params.hash_file);
+            ok = false;
+        }
+    }
+
+    if (ok && IsValidPointer(params.wav_file))
+        ok = wav.Open(&params.wav_file, 1, GG_AUDIO_SAMPLE_RATE, 2);
+
+    if (!ok)
+    {
+        if (IsValidPointer(hash_file))
+            fclose(hash_file);
+        headless_destroy_core(core);
+        return 3;
+    }
+
+    // Rendering is the most expensive part of a frame, skip it unless the
+    // picture is hashed or saved
+    bool render = IsValidPointer(hash_file) || !png_frames.empty();
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE);
+    size_t next_png = 0;
+    Batch_Stats stats;
+    stats.frames = 0;
+    stats.elapsed = 0.0;
+    stats.frame_min = 0.0;
+    stats.frame_max = 0.0;
+
+    Log("Running %d frames from %s%s...", total_frames, params.rom_file, use_movie ? " with an input movie" : "");
+
+    for (int frame = 0; frame < total_frames; frame++)
+    {
+        if (use_movie)
+            movie.Update();
+
+        int sample_count = 0;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        core->RunToVBlank(render ? frame_buffer.data() : NULL, sample_buffer.data(), &sample_count, NULL, render);
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        double frame_time = std::chrono::duration<double>(end - start).count();
+        stats.elapsed += frame_time;
+        stats.frame_min = (stats.frames == 0) ? frame_time : MIN(stats.frame_min, frame_time);
+        stats.frame_max = MAX(stats.frame_max, frame_time);
+        stats.frames++;
+
+        if (wav.IsOpen())
+            wav.Write(0, sample_buffer.data(), sample_count);
+
+        if (IsValidPointer(hash_file))
+        {
+            InputMovie::Frame_Hash hash;
+            InputMovie::HashFrame(core, frame_buffer.data(), sample_buffer.data(), sample_count, hash);
+            fprintf(hash_file, "%d %016llx %016llx %016llx %016llx\n", frame,
+                    (unsigned long long)hash.video, (unsigned long long)hash.audio,
+                    (unsigned long long)hash.ram, (unsigned long long)core->HashState());
+        }
+
+        while ((next_png < png_frames.size()) && (png_frames[next_png] < frame))
+            next_png++;
+
+        if ((next_png < png_frames.size()) && (png_frames[next_png] == frame))
+        {
+            ok = save_png(core, frame_buffer.data(), params.png_dir, frame) && ok;
+            next_png++;
+        }
+    }
+
+    if (use_movie)
+        movie.Stop();
+
+    if (IsValidPointer(hash_file))
+    {
+        ok = (fclose(hash_file) == 0) && ok;
+        Log("Frame hashes written to %s", params.hash_file);
+    }
+
+    if (wav.IsOpen())
+    {
+        ok = wav.Close() && ok;
+        Log("Audio written to %s", params.wav_file);
+    }
+
+    log_stats(stats);
+
+    if (IsValidPointer(params.stats_file))
+        ok = write_stats(params.stats_file, params, stats) && ok;
+
+    headless_destroy_core(core);
+
+    return ok ? 0 : 4;
+}
+
+// Comma separated frame numbers, counted from 0 like the hash file
+static bool parse_frame_list(const char* list, std::vector<int>& frames)
+{
+    const char* p = list;
+
+    while (*p)
+    {
+        char* end = NULL;
+        long value = strtol(p, &end, 10);
+
+        if ((end == p) || (value < 0) || (value > 0x7FFFFFFF) || ((*end != ',') && (*end != 0)))
+            return false;
+
+        frames.push_back((int)value);
+        p = (*end == ',') ? end + 1 : end;
+    }
+
+    std::sort(frames.begin(), frames.end());
+
+    return !frames.empty();
+}
+
+static bool save_png(GeargrafxCore* core, const u8* frame_buffer, const char* dir, int frame)
+{
+    GG_Runtime_Info runtime;
+    core->GetRuntimeInfo(runtime);
+
+    char file_name[32];
+    snprintf(file_name, sizeof(file_name), "frame_%06d.png", frame);
+
+    std::string path = dir;
+    append_path_component(path, file_name);
+
+    if (!stbi_write_png(path.c_str(), runtime.screen_width, runtime.screen_height, 4, frame_buffer, runtime.screen_width * 4))
+    {
+        Error("Unable to write %s", path.c_str());
+        return false;
+    }
+
+    Log("Screenshot saved to %s", path.c_str());
+    return true;
+}
+
+static void log_stats(const Batch_Stats& stats)
+{
+    double fps = (stats.elapsed > 0.0) ? (double)stats.frames / stats.elapsed : 0.0;
+    double average = (stats.frames > 0) ? stats.elapsed / (double)stats.frames : 0.0;
+
+    Log("Ran %d frames in %.3f s (%.1f fps, %.1fx real time)", stats.frames, stats.elapsed, fps, fps / 60.0);
+    Log("Frame time: min %.3f ms, avg %.3f ms, max %.3f ms",
+        stats.frame_min * 1000.0, average * 1000.0, stats.frame_max * 1000.0);
+}
+
+static bool write_stats(const char* file_path, const BatchRunParams& params, const Batch_Stats& stats)
+{
+    FILE* file = fopen_utf8(file_path, "w");
+
+    if (!IsValidPointer(file))
+    {
+        Error("Unable to open %s", file_path);
+        return false;
+    }
+
+    double average = (stats.frames > 0) ? stats.elapsed / (double)stats.frames : 0.0;
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"emulator\": \"%s\",\n", GG_TITLE);
+    fprintf(file, "  \"version\": \"%s\",\n", GG_VERSION);
+    fprintf(file, "  \"seed\": %u,\n", params.seed);
+    fprintf(file, "  \"frames\": %d,\n", stats.frames);
+    fprintf(file, "  \"elapsed_s\": %.6f,\n", stats.elapsed);
+    fprintf(file, "  \"fps\": %.3f,\n", (stats.elapsed > 0.0) ? (double)stats.frames / stats.elapsed : 0.0);
+    fprintf(file, "  \"frame_min_ms\": %.6f,\n", stats.frame_min * 1000.0);
+    fprintf(file, "  \"frame_avg_ms\": %.6f,\n", average * 1000.0);
+    fprintf(file, "  \"frame_max_ms\": %.6f\n", stats.frame_max * 1000.0);
+    fprintf(file, "}\n");
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+struct BatchRunParams
+{
+    const char* rom_file = NULL;
+    const char* movie_file = NULL;
+    const char* hash_file = NULL;
+    const char* png_dir = NULL;
+    const char* png_frames = NULL;
+    const char* wav_file = NULL;
+    const char* stats_file = NULL;
+    int frames = 0;
+    unsigned int seed = 1;
+};
+
+int batch_run(const BatchRunParams& params);
+
+#endif /* BATCH_RUNNER_H */
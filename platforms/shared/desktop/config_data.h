@@ -63,6 +63,7 @@ struct config_Emulator
     bool ffwd;
     int ffwd_speed;
     int runahead;
+    bool runahead_second_instance;
     bool show_info;
     std::string recent_roms[config_max_recent_roms];
     int savefiles_dir_option;
@@ -87,6 +88,7 @@ struct config_Emulator
     int console_type;
     int cdrom_type;
     bool preload_cdrom;
+    bool precache_chd_decode;
     int mcp_tcp_port;
     std::string mcp_http_address;
     bool capture_mouse;
@@ -126,13 +128,14 @@ struct config_Audio
     float psg_volume;
     float cdrom_volume;
     float adpcm_volume;
-    int buffer_count;
+    int latency;
 };
 
 struct config_Rewind
 {
     bool enabled;
     int buffer_seconds;
+    int memory_mb;
     int frames_per_snapshot;
     float speed;
 };
@@ -260,6 +263,7 @@ struct config_Debug
     bool show_arcade_card;
     bool show_trace_logger;
     bool show_rewind;
+    bool show_perf;
     bool trace_counter;
     bool trace_cycles;
     bool trace_bank;
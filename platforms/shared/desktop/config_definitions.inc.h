@@ -56,6 +56,7 @@ static inline void process(config_Operation operation)
     CONFIG_BOOL("Debug", "ArcadeCard", config_debug.show_arcade_card, false);
     CONFIG_BOOL("Debug", "TraceLogger", config_debug.show_trace_logger, false);
     CONFIG_BOOL("Debug", "Rewind", config_debug.show_rewind, false);
+    CONFIG_BOOL("Debug", "Perf", config_debug.show_perf, false);
 
     // Trace logger
     CONFIG_BOOL("Debug", "TraceCounter", config_debug.trace_counter, true);
@@ -151,6 +152,7 @@ static inline void process(config_Operation operation)
     // Emulation
     CONFIG_INT("Emulator", "FFWD", config_emulator.ffwd_speed, 1);
     CONFIG_INT_RANGE("Emulator", "RunAhead", config_emulator.runahead, 0, 0, 3);
+    CONFIG_BOOL("Emulator", "RunAheadSecondInstance", config_emulator.runahead_second_instance, false);
     CONFIG_INT_RANGE("Emulator", "SaveSlot", config_emulator.save_slot, 0, 0, 4);
     CONFIG_BOOL("Emulator", "StartPaused", config_emulator.start_paused, false);
     CONFIG_BOOL("Emulator", "PauseWhenInactive", config_emulator.pause_when_inactive, true);
@@ -158,6 +160,7 @@ static inline void process(config_Operation operation)
     CONFIG_INT("Emulator", "ConsoleType", config_emulator.console_type, 0);
     CONFIG_INT("Emulator", "CDROMType", config_emulator.cdrom_type, 0);
     CONFIG_BOOL("Emulator", "PreloadCDROM", config_emulator.preload_cdrom, false);
+    CONFIG_BOOL("Emulator", "PrecacheCHDDecode", config_emulator.precache_chd_decode, false);
 
     // Files and paths
     CONFIG_INT("Emulator", "SaveFilesDirOption", config_emulator.savefiles_dir_option, 0);
@@ -243,14 +246,15 @@ static inline void process(config_Operation operation)
     CONFIG_FLOAT("Audio", "PSGVolume", config_audio.psg_volume, 1.0f);
     CONFIG_FLOAT("Audio", "CDROMVolume", config_audio.cdrom_volume, 1.0f);
     CONFIG_FLOAT("Audio", "ADPCMVolume", config_audio.adpcm_volume, 1.0f);
-    CONFIG_INT("Audio", "BufferCount", config_audio.buffer_count, 3);
+    CONFIG_INT_RANGE("Audio", "Latency", config_audio.latency, 40, 20, 80);
 
     //**************************************
     // Rewind
     //**************************************
 
     CONFIG_BOOL("Rewind", "Enabled", config_rewind.enabled, true);
-    CONFIG_INT_RANGE("Rewind", "BufferSeconds", config_rewind.buffer_seconds, 10, 1, 10);
+    CONFIG_INT_RANGE("Rewind", "BufferSeconds", config_rewind.buffer_seconds, 60, 1, 600);
+    CONFIG_INT_RANGE("Rewind", "MemoryMB", config_rewind.memory_mb, 128, 16, 2048);
     CONFIG_INT_MIN("Rewind", "FramesPerSnapshot", config_rewind.frames_per_snapshot, 1, 1);
     CONFIG_FLOAT_RANGE("Rewind", "Speed", config_rewind.speed, 2.0f, 1.0f, 8.0f);
 
@@ -440,6 +444,14 @@ static void normalize(void)
     if (config_video.sync_mode == config_VideoSync_VRR)
         config_video.sync_mode = config_VideoSync_Fixed;
 #endif
+
+    // The Latency menu only offers 20, 40 and 80 ms
+    if (config_audio.latency < 30)
+        config_audio.latency = 20;
+    else if (config_audio.latency < 60)
+        config_audio.latency = 40;
+    else
+        config_audio.latency = 80;
 }
 
 static void migrate(int file_version)
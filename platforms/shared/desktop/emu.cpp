@@ -27,6 +27,7 @@
 #include "config.h"
 #include "rewind.h"
 #include "runahead.h"
+#include "save_writer.h"
 #include "events.h"
 #include "gui_debug_trace_logger.h"
 #include "mcp/mcp_manager.h"
@@ -44,8 +45,12 @@ static GeargrafxCore* geargrafx;
 static s16* audio_buffer;
 static bool audio_enabled;
 static McpManager* mcp_manager;
+static InputMovie* input_movie;
+static std::string input_movie_path;
 static Uint64 rewind_last_counter = 0;
 static double rewind_pop_accumulator = 0.0;
+static u32 mb128_write_id = 0;
+static std::vector<u8> mb128_write_data;
 
 enum Loading_State
 {
@@ -70,7 +75,9 @@ static Loading_Request_Type loading_request_type;
 static void save_ram(void);
 static void load_ram(void);
 static void save_mb128(void);
+static void finish_mb128_write(bool block);
 static void load_mb128(void);
+static u32 queue_state(const std::string& path, int slot, bool screenshot = true, bool wait = false);
 static void reset_buffers(void);
 static const char* get_configurated_dir(int option, const char* path); 
 static void init_debug(void);
@@ -81,6 +88,7 @@ static void update_debug_sprites(void);
 static void update_debug_tiles(void);
 static void reset_rewind_timing(void);
 static int get_rewind_pop_budget(void);
+static void update_movie(void);
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
 static bool unload_physical_cdrom(char* device_id, size_t device_id_size);
 static void stop_physical_cdrom_after_error(void);
@@ -115,8 +123,11 @@ bool emu_init(GG_Input_Pump_Fn input_pump_fn)
     mcp_manager = new McpManager();
     mcp_manager->Init(geargrafx);
 
+    input_movie = new InputMovie();
+
     rewind_init();
     runahead_init();
+    save_writer_init();
 
     return true;
 }
@@ -130,8 +141,11 @@ void emu_destroy(void)
     }
     loading_state.store(Loading_State_None);
 
+    emu_stop_movie();
+    SafeDelete(input_movie);
     save_ram();
     save_mb128();
+    save_writer_destroy();
     rewind_destroy();
     runahead_destroy();
     SafeDelete(mcp_manager);
@@ -166,6 +180,7 @@ void emu_load_media_async(const char* file_path)
     if (loading_state.load() != Loading_State_None)
         return;
 
+    emu_stop_movie();
     gui_debug_trace_logger_reset();
     emu_debug_command = Debug_Command_None;
     reset_buffers();
@@ -268,6 +283,7 @@ void emu_update(void)
         return;
 
     emu_mcp_pump_commands();
+    finish_mb128_write(false);
 
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
     if (geargrafx->GetMedia()->HasPhysicalCdRomError())
@@ -304,6 +320,13 @@ void emu_update(void)
 
     if (config_debug.debug)
     {
+        // Debugger runs can stop mid-frame, which a movie can't represent
+        if (emu_is_movie_recording() || emu_is_movie_playing())
+        {
+            Log("Movie stopped by the debugger");
+            emu_stop_movie();
+        }
+
         bool breakpoint_hit = false;
         GeargrafxCore::GG_Debug_Run debug_run;
         debug_run.step_debugger = (emu_debug_command == Debug_Command_Step);
@@ -354,6 +377,7 @@ void emu_update(void)
         if (!geargrafx->IsPaused())
         {
             rewind_commit_seek();
+            update_movie();
 
             int runahead = runahead_get_frames();
             if (runahead > 0)
@@ -513,6 +537,7 @@ bool emu_is_empty(void)
 
 void emu_reset(void)
 {
+    emu_stop_movie();
     gui_debug_trace_logger_reset();
     emu_debug_command = Debug_Command_None;
     emu_debug_step_frames_pending = 0;
@@ -598,7 +623,7 @@ void emu_audio_cdrom_volume(float volume)
 void emu_audio_reset(void)
 {
     sound_queue_stop();
-    sound_queue_start(GG_AUDIO_SAMPLE_RATE, 2, GG_AUDIO_QUEUE_SIZE, config_audio.buffer_count);
+    sound_queue_start(GG_AUDIO_SAMPLE_RATE, 2, config_audio.latency);
 }
 
 bool emu_is_audio_enabled(void)
@@ -613,8 +638,12 @@ bool emu_is_audio_open(void)
 
 void emu_save_ram(const char* file_path)
 {
-    if (!emu_is_empty())
-        geargrafx->SaveRam(file_path, true);
+    if (!emu_is_empty() && geargrafx->GetMemory()->IsBackupRamUsed())
+    {
+        Memory* memory = geargrafx->GetMemory();
+        std::vector<u8> data(memory->GetBackupRAM(), memory->GetBackupRAM() + memory->GetBackupRAMSize());
+        save_writer_queue(Save_Writer_Ram, geargrafx->GetRamPath(file_path, true), data, 0);
+    }
 }
 
 void emu_load_ram(const char* file_path)
@@ -622,6 +651,7 @@ void emu_load_ram(const char* file_path)
     if (!emu_is_empty())
     {
         save_ram();
+        save_writer_flush();
         gui_debug_trace_logger_reset();
         geargrafx->ResetMedia(false);
         geargrafx->LoadRam(file_path, true);
@@ -629,20 +659,21 @@ void emu_load_ram(const char* file_path)
     }
 }
 
-void emu_save_state_slot(int index)
+u32 emu_save_state_slot(int index, bool wait)
 {
-    if (!emu_is_empty())
-    {
-        const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
-        geargrafx->SaveState(dir, index, true);
-        update_savestates_data();
-    }
+    if (emu_is_empty())
+        return 0;
+
+    const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
+    return queue_state(geargrafx->GetSaveStatePath(dir, index), index, true, wait);
 }
 
 void emu_load_state_slot(int index)
 {
     if (!emu_is_empty())
     {
+        emu_stop_movie();
+        save_writer_flush();
         const char* dir = get_configurated_dir(config_emulator.savestates_dir_option, config_emulator.savestates_path.c_str());
         if (geargrafx->LoadState(dir, index))
         {
@@ -652,16 +683,20 @@ void emu_load_state_slot(int index)
     }
 }
 
-void emu_save_state_file(const char* file_path)
+u32 emu_save_state_file(const char* file_path, bool screenshot, bool wait)
 {
-    if (!emu_is_empty())
-        geargrafx->SaveState(file_path, -1, true);
+    if (emu_is_empty())
+        return 0;
+
+    return queue_state(geargrafx->GetSaveStatePath(file_path, -1), -1, screenshot, wait);
 }
 
 void emu_load_state_file(const char* file_path)
 {
     if (!emu_is_empty())
     {
+        emu_stop_movie();
+        save_writer_flush();
         if (geargrafx->LoadState(file_path))
         {
             events_sync_input();
@@ -886,6 +921,11 @@ void emu_set_preload_cdrom(bool enabled)
     geargrafx->GetMedia()->PreloadCdRom(enabled);
 }
 
+void emu_set_precache_chd_decode(bool enabled)
+{
+    geargrafx->GetMedia()->PrecacheChdDecode(enabled);
+}
+
 void emu_set_backup_ram(bool enabled)
 {
     geargrafx->GetMedia()->ForceBackupRAM(enabled);
@@ -1033,31 +1073,89 @@ bool emu_load_bios(const char* file_path, bool syscard)
 
 static void save_ram(void)
 {
+    Memory* memory = geargrafx->GetMemory();
+
+    if (!geargrafx->GetMedia()->IsReady() || !memory->IsBackupRamUsed())
+        return;
+
     const char* dir = get_configurated_dir(config_emulator.backup_ram_dir_option, config_emulator.backup_ram_path.c_str());
-    geargrafx->SaveRam(dir);
+    std::vector<u8> data(memory->GetBackupRAM(), memory->GetBackupRAM() + memory->GetBackupRAMSize());
+    save_writer_queue(Save_Writer_Ram, geargrafx->GetRamPath(dir), data, 0);
 }
 
 static void load_ram(void)
 {
+    save_writer_flush();
     const char* dir = get_configurated_dir(config_emulator.backup_ram_dir_option, config_emulator.backup_ram_path.c_str());
     geargrafx->LoadRam(dir);
 }
 
 static void save_mb128(void)
 {
-    if (geargrafx->GetInput()->GetMB128()->IsDirty())
+    MB128* mb128 = geargrafx->GetInput()->GetMB128();
+
+    // One write at a time, so the dirty flag always refers to the newest one
+    finish_mb128_write(true);
+
+    if (mb128->IsConnected() && mb128->IsDirty())
     {
         const char* dir = (config_emulator.mb128_dir_option == 0) ? config_root_path : config_emulator.mb128_path.c_str();
-        geargrafx->SaveMB128(dir);
+        mb128_write_data.assign(mb128->GetRAM(), mb128->GetRAM() + mb128->GetRAMSize());
+        std::vector<u8> data(mb128_write_data);
+        mb128_write_id = save_writer_queue(Save_Writer_MB128, geargrafx->GetMB128Path(dir), data, 0, true);
     }
 }
 
+// The MB128 stays dirty until its data is on disk, and it is still dirty
+// if the game wrote to it while the file was being written
+static void finish_mb128_write(bool block)
+{
+    if (mb128_write_id == 0)
+        return;
+
+    Save_Writer_Result result;
+
+    if (block)
+        save_writer_wait(mb128_write_id, &result);
+    else if (!save_writer_try_wait(mb128_write_id, &result))
+        return;
+
+    MB128* mb128 = geargrafx->GetInput()->GetMB128();
+
+    if (result.success && (mb128->GetRAMSize() == mb128_write_data.size()) &&
+            (memcmp(mb128->GetRAM(), mb128_write_data.data(), mb128_write_data.size()) == 0))
+        mb128->ClearDirty();
+
+    mb128_write_id = 0;
+    mb128_write_data.clear();
+}
+
 static void load_mb128(void)
 {
+    save_writer_flush();
+    finish_mb128_write(true);
     const char* dir = (config_emulator.mb128_dir_option == 0) ? config_root_path : config_emulator.mb128_path.c_str();
     geargrafx->LoadMB128(dir);
 }
 
+static u32 queue_state(const std::string& path, int slot, bool screenshot, bool wait)
+{
+    size_t size = geargrafx->GetSaveStateSize(screenshot);
+    std::vector<u8> data(size);
+    u32 chunk_sizes[GG_SAVESTATE_CHUNK_COUNT];
+
+    if (!geargrafx->SaveState(data.data(), size, screenshot, chunk_sizes))
+    {
+        Error("Failed to save state to file: %s", path.c_str());
+        return 0;
+    }
+
+    data.resize(size);
+    Log("Saving state to %s...", path.c_str());
+
+    return save_writer_queue_state(path, data, chunk_sizes, slot, wait);
+}
+
 static void reset_buffers(void)
 {
     emu_debug_background_buffer_width[0] = 32;
@@ -1418,6 +1516,98 @@ bool emu_is_vgm_recording(void)
     return geargrafx->GetAudio()->IsVgmRecording();
 }
 
+bool emu_start_movie_recording(const char* file_path, bool from_state)
+{
+    if (emu_is_empty())
+        return false;
+
+    emu_stop_movie();
+    save_writer_flush();
+
+    if (!from_state)
+    {
+        save_ram();
+        save_mb128();
+    }
+
+    if (!input_movie->StartRecording(geargrafx, from_state ? InputMovie::START_SAVESTATE : InputMovie::START_POWER_ON))
+        return false;
+
+    input_movie_path = file_path;
+    emu_frame_counter = 0;
+    reset_buffers();
+    reset_rewind_timing();
+    emu_audio_reset();
+    events_sync_input();
+    rewind_reset();
+
+    Log("Movie recording started: %s", file_path);
+
+    return true;
+}
+
+bool emu_play_movie(const char* file_path)
+{
+    if (emu_is_empty())
+        return false;
+
+    emu_stop_movie();
+    save_writer_flush();
+    save_ram();
+    save_mb128();
+
+    if (!input_movie->Load(file_path) || !input_movie->StartPlayback(geargrafx))
+        return false;
+
+    emu_frame_counter = 0;
+    reset_buffers();
+    reset_rewind_timing();
+    emu_audio_reset();
+    rewind_reset();
+
+    return true;
+}
+
+void emu_stop_movie(void)
+{
+    if (!IsValidPointer(input_movie))
+        return;
+
+    bool recording = input_movie->IsRecording();
+
+    if (!recording && !input_movie->IsPlaying())
+        return;
+
+    input_movie->Stop();
+
+    if (recording)
+    {
+        if (input_movie->Save(input_movie_path.c_str()))
+            Log("Movie saved: %s (%d frames)", input_movie_path.c_str(), input_movie->GetFrameCount());
+        else
+            Log("ERROR: Unable to save movie %s", input_movie_path.c_str());
+    }
+
+    events_sync_input();
+}
+
+bool emu_is_movie_recording(void)
+{
+    return IsValidPointer(input_movie) && input_movie->IsRecording();
+}
+
+bool emu_is_movie_playing(void)
+{
+    return IsValidPointer(input_movie) && input_movie->IsPlaying();
+}
+
+// Called right before each frame, the movie latches the input of the frame
+static void update_movie(void)
+{
+    if (input_movie->IsRecording() || input_movie->IsPlaying())
+        input_movie->Update();
+}
+
 void emu_mcp_set_transport(int mode, int tcp_port, const char* tcp_address)
 {
     if (mcp_manager)
@@ -91,9 +91,9 @@ EXTERN bool emu_is_audio_enabled(void);
 EXTERN bool emu_is_audio_open(void);
 EXTERN void emu_save_ram(const char* file_path);
 EXTERN void emu_load_ram(const char* file_path);
-EXTERN void emu_save_state_slot(int index);
+EXTERN u32 emu_save_state_slot(int index, bool wait = false);
 EXTERN void emu_load_state_slot(int index);
-EXTERN void emu_save_state_file(const char* file_path);
+EXTERN u32 emu_save_state_file(const char* file_path, bool screenshot = true, bool wait = false);
 EXTERN void emu_load_state_file(const char* file_path);
 EXTERN void update_savestates_data(void);
 EXTERN void emu_get_runtime(GG_Runtime_Info& runtime);
@@ -120,6 +120,7 @@ EXTERN void emu_set_huc6280_registers_reset_value(int value);
 EXTERN void emu_set_console_type(GG_Console_Type console_type);
 EXTERN void emu_set_cdrom_type(GG_CDROM_Type cdrom_type);
 EXTERN void emu_set_preload_cdrom(bool enabled);
+EXTERN void emu_set_precache_chd_decode(bool enabled);
 EXTERN void emu_set_backup_ram(bool enabled);
 EXTERN void emu_set_turbo_tap(bool enabled);
 EXTERN void emu_set_mb128_mode(GG_MB128_Mode mode);
@@ -138,6 +139,11 @@ EXTERN bool emu_load_bios(const char* file_path, bool syscard);
 EXTERN void emu_start_vgm_recording(const char* file_path);
 EXTERN void emu_stop_vgm_recording(void);
 EXTERN bool emu_is_vgm_recording(void);
+EXTERN bool emu_start_movie_recording(const char* file_path, bool from_state);
+EXTERN bool emu_play_movie(const char* file_path);
+EXTERN void emu_stop_movie(void);
+EXTERN bool emu_is_movie_recording(void);
+EXTERN bool emu_is_movie_playing(void);
 EXTERN void emu_mcp_set_transport(int mode, int tcp_port, const char* tcp_address);
 EXTERN void emu_mcp_start(void);
 EXTERN void emu_mcp_stop(void);
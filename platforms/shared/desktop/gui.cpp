@@ -29,6 +29,7 @@
 #include "ogl_renderer.h"
 #include "utils.h"
 #include "geargrafx.h"
+#include "save_writer.h"
 
 #define GUI_IMPORT
 #include "gui.h"
@@ -53,6 +54,7 @@ static char loading_symbol_path[4096] = "";
 static bool loading_physical_cdrom = false;
 static void main_window(void);
 static void show_status_message(void);
+static void update_save_results(void);
 static void show_error_window(void);
 static void show_loading_popup(void);
 static bool finish_loading_rom(void);
@@ -136,6 +138,7 @@ bool gui_init(void)
     emu_set_console_type((GG_Console_Type)config_emulator.console_type);
     emu_set_cdrom_type((GG_CDROM_Type)config_emulator.cdrom_type);
     emu_set_preload_cdrom(config_emulator.preload_cdrom);
+    emu_set_precache_chd_decode(config_emulator.precache_chd_decode);
     emu_set_backup_ram(config_emulator.backup_ram);
     emu_set_mb128_mode((GG_MB128_Mode)config_emulator.mb128_mode);
     emu_set_disassembler_syntax(config_debug.dis_syntax);
@@ -212,6 +215,7 @@ void gui_render(void)
         gui_show_info();
 
     show_loading_popup();
+    update_save_results();
     show_status_message();
     show_error_window();
 
@@ -791,6 +795,52 @@ static void show_status_message(void)
     }
 }
 
+static void update_save_results(void)
+{
+    Save_Writer_Result result;
+
+    while (save_writer_poll(&result))
+    {
+        if (result.kind == Save_Writer_State)
+        {
+            if (result.success)
+            {
+                std::string message;
+                if (result.slot > 0)
+                {
+                    message = "State saved to slot ";
+                    message += std::to_string(result.slot);
+                    update_savestates_data();
+                }
+                else
+                {
+                    message = "State saved to ";
+                    message += result.path;
+                }
+                gui_set_status_message(message.c_str(), 3000);
+            }
+            else
+            {
+                std::string message("Failed to save state to ");
+                message += result.path;
+                gui_set_error_message(message.c_str());
+            }
+        }
+        else if (result.success)
+        {
+            std::string message((result.kind == Save_Writer_MB128) ? "MB128 saved to " : "Backup RAM saved to ");
+            message += result.path;
+            gui_set_status_message(message.c_str(), 3000);
+        }
+        else
+        {
+            std::string message((result.kind == Save_Writer_MB128) ? "Failed to save MB128 to " : "Failed to save backup RAM to ");
+            message += result.path;
+            gui_set_error_message(message.c_str());
+        }
+    }
+}
+
 static void show_loading_popup(void)
 {
     if (!loading_rom_active)
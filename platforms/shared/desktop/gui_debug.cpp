@@ -38,6 +38,7 @@
 #include "gui_debug_adpcm.h"
 #include "gui_debug_trace_logger.h"
 #include "gui_debug_rewind.h"
+#include "gui_debug_perf.h"
 #include "emu.h"
 #include "config.h"
 
@@ -146,6 +147,8 @@ void gui_debug_windows(void)
             gui_debug_window_trace_logger();
         if (config_debug.show_rewind)
             gui_debug_window_rewind();
+        if (config_debug.show_perf)
+            gui_debug_window_perf();
 
         gui_debug_memory_watches_window();
         gui_debug_memory_search_window();
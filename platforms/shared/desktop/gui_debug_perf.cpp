@@ -0,0 +1,101 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#define GUI_DEBUG_PERF_IMPORT
+#include "gui_debug_perf.h"
+
+#include "imgui.h"
+#include "geargrafx.h"
+#include "gui.h"
+#include "gui_debug_constants.h"
+#include "config.h"
+#include "emu.h"
+
+static void draw_counter(const char* name, u64 value);
+static void draw_host_time(const char* name, u64 ns, u64 frame_ns);
+
+void gui_debug_window_perf(void)
+{
+    ImGui::PushStyleVar(ImGuiStyleVar_WindowRounding, 8.0f);
+    ImGui::SetNextWindowPos(ImVec2(180, 45), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(0, 0), ImGuiCond_FirstUseEver);
+    ImGui::Begin("Performance Counters", &config_debug.show_perf, ImGuiWindowFlags_AlwaysAutoResize);
+
+    ImGui::PushFont(gui_default_font);
+
+    GG_Perf_Counters perf;
+
+    if (!emu_get_core()->GetPerfCounters(perf))
+    {
+        ImGui::TextColored(gray, "Disabled in this build.");
+        ImGui::TextColored(gray, "Rebuild with PERF_COUNTERS=1.");
+    }
+    else
+    {
+        ImGui::TextColored(violet, "FRAME          "); ImGui::SameLine();
+        ImGui::TextColored(white, "%u", perf.frame);
+
+        ImGui::Separator();
+
+        draw_counter("INSTRUCTIONS   ", perf.instructions);
+        draw_counter("MASTER CYCLES  ", perf.master_cycles);
+        draw_counter("CLOCK HW CALLS ", perf.clock_hardware_calls);
+        ImGui::TextColored(violet, "CYCLES / CALL  "); ImGui::SameLine();
+        ImGui::TextColored(white, "%.2f", perf.clock_hardware_calls > 0 ? (double)perf.master_cycles / (double)perf.clock_hardware_calls : 0.0);
+        draw_counter("3-CYCLE STEPS  ", perf.clock_hardware_slow_steps);
+        draw_counter("VRAM DMA WORDS ", perf.vram_dma_words);
+        draw_counter("SATB DMA WORDS ", perf.satb_dma_words);
+        draw_counter("PSG SYNCS      ", perf.psg_sync_calls);
+        ImGui::TextColored(violet, "CYCLES / SYNC  "); ImGui::SameLine();
+        ImGui::TextColored(white, "%.2f", perf.psg_sync_calls > 0 ? (double)perf.psg_sync_cycles / (double)perf.psg_sync_calls : 0.0);
+        draw_counter("CD SECTORS     ", perf.cd_sector_reads);
+        draw_counter("CD CACHE HITS  ", perf.cd_cache_hits);
+        draw_counter("CD CACHE MISSES", perf.cd_cache_misses);
+
+        ImGui::Separator();
+
+        ImGui::TextColored(violet, "HOST FRAME     "); ImGui::SameLine();
+        ImGui::TextColored(white, "%.3f ms", (double)perf.frame_host_ns / 1000000.0);
+        draw_host_time("CPU            ", perf.host_ns[GG_PERF_CPU], perf.frame_host_ns);
+        draw_host_time("VIDEO          ", perf.host_ns[GG_PERF_VIDEO], perf.frame_host_ns);
+        draw_host_time("AUDIO          ", perf.host_ns[GG_PERF_AUDIO], perf.frame_host_ns);
+        draw_host_time("CD-ROM         ", perf.host_ns[GG_PERF_CDROM], perf.frame_host_ns);
+    }
+
+    ImGui::PopFont();
+
+    ImGui::End();
+    ImGui::PopStyleVar();
+}
+
+static void draw_counter(const char* name, u64 value)
+{
+    ImGui::TextColored(violet, "%s", name); ImGui::SameLine();
+    ImGui::TextColored(value > 0 ? white : gray, "%llu", (unsigned long long)value);
+}
+
+static void draw_host_time(const char* name, u64 ns, u64 frame_ns)
+{
+    float fraction = frame_ns > 0 ? (float)((double)ns / (double)frame_ns) : 0.0f;
+    char overlay[32];
+    snprintf(overlay, sizeof(overlay), "%.3f ms", (double)ns / 1000000.0);
+
+    ImGui::TextColored(violet, "%s", name); ImGui::SameLine();
+    ImGui::ProgressBar(fraction, ImVec2(160, 0), overlay);
+}
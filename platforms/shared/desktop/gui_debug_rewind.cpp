@@ -49,6 +49,10 @@ void gui_debug_window_rewind(void)
     draw_timeline();
     ImGui::Spacing();
 
+    ImGui::TextColored(gray, "Memory:");
+    ImGui::SameLine();
+    ImGui::Text("%.1f / %d MB", (double)rewind_get_memory_used() / (1024.0 * 1024.0), config_rewind.memory_mb);
+
     ImGui::End();
     ImGui::PopStyleVar();
 }
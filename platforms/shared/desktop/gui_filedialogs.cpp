@@ -53,6 +53,8 @@ enum FileDialogID
     FileDialog_LoadSymbols,
     FileDialog_SaveScreenshot,
     FileDialog_SaveVGM,
+    FileDialog_RecordMovie,
+    FileDialog_PlayMovie,
     FileDialog_SaveSprite,
     FileDialog_SaveAllSprites,
     FileDialog_SaveBackground,
@@ -64,7 +66,8 @@ enum FileDialogID
     FileDialog_SaveLog,
     FileDialog_SaveDebugSettings,
     FileDialog_LoadDebugSettings,
-    FileDialog_LoadPalette
+    FileDialog_LoadPalette,
+    FileDialog_SaveProfile
 };
 
 static FileDialogID pending_dialog_id = FileDialog_None;
@@ -225,10 +228,30 @@ void gui_file_dialog_save_vgm(void)
     if (!begin_dialog())
         return;
 
-    SDL_DialogFileFilter filters[] = { { "VGM Files", "vgm" } };
+    SDL_DialogFileFilter filters[] = { { "VGM Files", "vgm;vgz" } };
     SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_SaveVGM, application_sdl_window, filters, 1, NULL);
 }
 
+void gui_file_dialog_record_movie(bool from_state)
+{
+    if (!begin_dialog())
+        return;
+
+    pending_dialog_int_param1 = from_state ? 1 : 0;
+    SDL_DialogFileFilter filters[] = { { "Input Movie Files", "ggm" } };
+    SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_RecordMovie, application_sdl_window, filters, 1, NULL);
+}
+
+void gui_file_dialog_play_movie(void)
+{
+    if (!begin_dialog())
+        return;
+
+    SDL_DialogFileFilter filters[] = { { "Input Movie Files", "ggm" } };
+    const char* default_path = config_emulator.last_open_path.empty() ? NULL : config_emulator.last_open_path.c_str();
+    SDL_ShowOpenFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_PlayMovie, application_sdl_window, filters, 1, default_path, false);
+}
+
 void gui_file_dialog_save_sprite(int vdc, int index)
 {
     if (!begin_dialog())
@@ -298,6 +321,17 @@ void gui_file_dialog_save_log(void)
     SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_SaveLog, application_sdl_window, filters, 1, NULL);
 }
 
+#if defined(GG_ENABLE_PROFILER)
+void gui_file_dialog_save_profile(void)
+{
+    if (!begin_dialog())
+        return;
+
+    SDL_DialogFileFilter filters[] = { { "Chrome Trace Files", "json" } };
+    SDL_ShowSaveFileDialog(file_dialog_callback, (void*)(intptr_t)FileDialog_SaveProfile, application_sdl_window, filters, 1, NULL);
+}
+#endif
+
 void gui_file_dialog_save_debug_settings(void)
 {
     if (!begin_dialog())
@@ -475,6 +509,22 @@ static void process_dialog_result(FileDialogID id, const char* path)
             gui_set_status_message("VGM recording started", 3000);
             break;
         }
+        case FileDialog_RecordMovie:
+        {
+            if (emu_start_movie_recording(path, pending_dialog_int_param1 != 0))
+                gui_set_status_message("Movie recording started", 3000);
+            else
+                gui_set_status_message("Failed to start movie recording", 3000);
+            break;
+        }
+        case FileDialog_PlayMovie:
+        {
+            if (emu_play_movie(path))
+                gui_set_status_message("Movie playback started", 3000);
+            else
+                gui_set_status_message("Failed to play movie", 3000);
+            break;
+        }
         case FileDialog_SaveSprite:
         {
             gui_action_save_sprite(path, pending_dialog_int_param1, pending_dialog_int_param2);
@@ -520,6 +570,15 @@ static void process_dialog_result(FileDialogID id, const char* path)
             gui_debug_save_log(path);
             break;
         }
+        case FileDialog_SaveProfile:
+        {
+            Profiler::SetEnabled(false);
+            if (Profiler::ExportChromeTrace(path))
+                gui_set_status_message("Profile trace saved", 3000);
+            else
+                gui_set_status_message("Failed to save profile trace", 3000);
+            break;
+        }
         case FileDialog_SaveDebugSettings:
         {
             gui_debug_save_settings(path);
@@ -40,6 +40,8 @@ EXTERN void gui_file_dialog_load_bios(bool syscard);
 EXTERN void gui_file_dialog_load_symbols(void);
 EXTERN void gui_file_dialog_save_screenshot(void);
 EXTERN void gui_file_dialog_save_vgm(void);
+EXTERN void gui_file_dialog_record_movie(bool from_state);
+EXTERN void gui_file_dialog_play_movie(void);
 EXTERN void gui_file_dialog_save_sprite(int vdc, int index);
 EXTERN void gui_file_dialog_save_all_sprites(int vdc);
 EXTERN void gui_file_dialog_save_background(int vdc);
@@ -47,6 +49,9 @@ EXTERN void gui_file_dialog_save_memory_dump(bool binary);
 EXTERN void gui_file_dialog_load_memory_dump(void);
 EXTERN void gui_file_dialog_save_disassembler(bool full);
 EXTERN void gui_file_dialog_save_log(void);
+#if defined(GG_ENABLE_PROFILER)
+EXTERN void gui_file_dialog_save_profile(void);
+#endif
 EXTERN void gui_file_dialog_save_debug_settings(void);
 EXTERN void gui_file_dialog_load_debug_settings(void);
 EXTERN void gui_file_dialog_load_palette(void);
@@ -29,6 +29,7 @@
 #include "display.h"
 #include "gamepad.h"
 #include "emu.h"
+#include "sound_queue.h"
 #include "ogl_renderer.h"
 #include "ogl_shader_chain.h"
 #include "shader_preset.h"
@@ -45,6 +46,9 @@ static bool open_about = false;
 static bool open_load_defaults = false;
 static bool save_screenshot = false;
 static bool save_vgm = false;
+static bool record_movie_power_on = false;
+static bool record_movie_state = false;
+static bool play_movie = false;
 static bool choose_savestates_path = false;
 static bool choose_screenshots_path = false;
 static bool choose_backup_ram_path = false;
@@ -56,6 +60,9 @@ static bool load_debug_settings = false;
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
 static bool open_physical_cdrom = false;
 #endif
+#if defined(GG_ENABLE_PROFILER)
+static bool save_profile = false;
+#endif
 static ShaderPresetInfo shader_presets[SHADER_PRESET_MAX_DISCOVERED];
 static int shader_preset_count = 0;
 
@@ -99,6 +106,9 @@ void gui_main_menu(void)
     open_load_defaults = false;
     save_screenshot = false;
     save_vgm = false;
+    record_movie_power_on = false;
+    record_movie_state = false;
+    play_movie = false;
     choose_savestates_path = false;
     choose_screenshots_path = false;
     gui_main_menu_hovered = false;
@@ -108,6 +118,9 @@ void gui_main_menu(void)
     open_gameexpress_bios = false;
     save_debug_settings = false;
     load_debug_settings = false;
+#if defined(GG_ENABLE_PROFILER)
+    save_profile = false;
+#endif
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
     open_physical_cdrom = false;
 #endif
@@ -236,6 +249,17 @@ static void menu_geargrafx(void)
                 ImGui::EndTooltip();
             }
 
+            ImGui::MenuItem("Use Second Instance", "", &config_emulator.runahead_second_instance);
+
+            if (ImGui::IsItemHovered())
+            {
+                ImGui::BeginTooltip();
+                ImGui::Text("Keeps a second emulator running ahead of the real one instead of");
+                ImGui::Text("saving and loading state every frame. Much faster while the input");
+                ImGui::Text("does not change, at the cost of loading the game twice in memory.");
+                ImGui::EndTooltip();
+            }
+
             ImGui::EndMenu();
         }
 
@@ -315,6 +339,38 @@ static void menu_geargrafx(void)
 
         ImGui::Separator();
 
+        if (ImGui::BeginMenu("Input Movie", media_actions_enabled))
+        {
+            bool movie_active = emu_is_movie_recording() || emu_is_movie_playing();
+
+            if (ImGui::MenuItem("Record From Power On...", "", false, !movie_active))
+            {
+                record_movie_power_on = true;
+            }
+
+            if (ImGui::MenuItem("Record From Current State...", "", false, !movie_active))
+            {
+                record_movie_state = true;
+            }
+
+            if (ImGui::MenuItem("Play...", "", false, !movie_active))
+            {
+                play_movie = true;
+            }
+
+            ImGui::Separator();
+
+            if (ImGui::MenuItem("Stop", "", false, movie_active))
+            {
+                emu_stop_movie();
+                gui_set_status_message("Movie stopped", 3000);
+            }
+
+            ImGui::EndMenu();
+        }
+
+        ImGui::Separator();
+
         if (ImGui::MenuItem("Load Default Settings"))
         {
             open_load_defaults = true;
@@ -616,6 +672,19 @@ static void menu_emulator(void)
             ImGui::EndTooltip();
         }
 
+        if (ImGui::MenuItem("Decode CHD on Preload", "", &config_emulator.precache_chd_decode, config_emulator.preload_cdrom))
+        {
+            emu_set_precache_chd_decode(config_emulator.precache_chd_decode);
+        }
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+        {
+            ImGui::BeginTooltip();
+            ImGui::Text("When preloading a CHD image, this option will also decompress all its hunks.");
+            ImGui::Text("It uses as much RAM as the uncompressed disc, but no decoding is needed while playing.");
+            ImGui::Text("Load a new CD-ROM image to apply changes.");
+            ImGui::EndTooltip();
+        }
+
         if (ImGui::MenuItem("Force Backup RAM", "", &config_emulator.backup_ram))
         {
             emu_set_backup_ram(config_emulator.backup_ram);
@@ -1606,24 +1675,35 @@ static void menu_audio(void)
 
         ImGui::Separator();
 
-        if (ImGui::BeginMenu("Buffer Size", config_audio.enable))
+        if (ImGui::BeginMenu("Latency", config_audio.enable))
         {
-            ImGui::PushItemWidth(150.0f);
-            if (ImGui::SliderInt("##buffer_count", &config_audio.buffer_count, 2, 5, "Buffers = %d"))
+            const int latencies[3] = { 20, 40, 80 };
+            const char* latency_names[3] = { "Low (20 ms)", "Medium (40 ms)", "High (80 ms)" };
+
+            for (int i = 0; i < 3; i++)
             {
-                emu_audio_reset();
+                if (ImGui::MenuItem(latency_names[i], "", config_audio.latency == latencies[i]))
+                {
+                    config_audio.latency = latencies[i];
+                    emu_audio_reset();
+                }
             }
-            ImGui::PopItemWidth();
+
             if (ImGui::IsItemHovered())
             {
-                float latency_ms = (config_audio.buffer_count * GG_AUDIO_QUEUE_SIZE) / (float)(GG_AUDIO_SAMPLE_RATE * 2) * 1000.0f;
                 ImGui::BeginTooltip();
                 ImGui::Text("Lower values reduce audio latency.");
                 ImGui::Text("Higher values prevent audio underruns.");
-                ImGui::Text("Enabling VSync may force higher buffer counts.");
-                ImGui::Text("Current audio latency: %.0f ms", latency_ms);
+                ImGui::Text("Playback rate is adjusted slightly to keep latency steady.");
                 ImGui::EndTooltip();
             }
+
+            if (emu_is_audio_open())
+            {
+                ImGui::Separator();
+                ImGui::TextDisabled("Current: %d ms, rate %.4f", sound_queue_get_latency_ms(), sound_queue_get_rate_ratio());
+                ImGui::TextDisabled("Overruns: %u", sound_queue_get_overrun_count());
+            }
             ImGui::EndMenu();
         }
 
@@ -1856,6 +1936,23 @@ static void menu_debug(void)
         ImGui::MenuItem("Show Memory Editor", "", &config_debug.show_memory, config_debug.debug);
         ImGui::MenuItem("Show Trace Logger", "", &config_debug.show_trace_logger, config_debug.debug);
 
+#if defined(GG_ENABLE_PROFILER)
+        ImGui::Separator();
+
+        bool profiling = Profiler::IsEnabled();
+        if (ImGui::MenuItem("Record Profile", "", &profiling))
+        {
+            if (profiling)
+                Profiler::Clear();
+            Profiler::SetEnabled(profiling);
+        }
+
+        if (ImGui::MenuItem("Save Profile Trace..."))
+        {
+            save_profile = true;
+        }
+#endif
+
         ImGui::Separator();
 
         if (ImGui::BeginMenu("HuC6280", config_debug.debug))
@@ -1934,6 +2031,7 @@ static void menu_debug(void)
         ImGui::Separator();
 
         ImGui::MenuItem("Show Rewind", "", &config_debug.show_rewind, config_debug.debug);
+        ImGui::MenuItem("Show Performance Counters", "", &config_debug.show_perf, config_debug.debug);
 
 #if defined(__APPLE__) || defined(_WIN32)
         ImGui::Separator();
@@ -2037,6 +2135,12 @@ static void file_dialogs(void)
         gui_file_dialog_save_screenshot();
     if (save_vgm)
         gui_file_dialog_save_vgm();
+    if (record_movie_power_on)
+        gui_file_dialog_record_movie(false);
+    if (record_movie_state)
+        gui_file_dialog_record_movie(true);
+    if (play_movie)
+        gui_file_dialog_play_movie();
     if (choose_savestates_path)
         gui_file_dialog_choose_savestate_path();
     if (choose_screenshots_path)
@@ -2053,6 +2157,10 @@ static void file_dialogs(void)
         gui_file_dialog_save_debug_settings();
     if (load_debug_settings)
         gui_file_dialog_load_debug_settings();
+#if defined(GG_ENABLE_PROFILER)
+    if (save_profile)
+        gui_file_dialog_save_profile();
+#endif
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
     if (open_physical_cdrom)
     {
@@ -0,0 +1,53 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "headless_core.h"
+#include "geargrafx.h"
+#include "config.h"
+#include "utils.h"
+
+// Creates a core for the modes that run without a window (batch, offline
+// render, movie replay and lockstep), set up from the loaded config the
+// same way the emulator sets up its own core
+GeargrafxCore* headless_create_core(void)
+{
+    GeargrafxCore* core = new GeargrafxCore();
+    core->Init(NULL);
+    core->GetMedia()->SetTempPath(config_temp_path);
+    core->GetMedia()->SetConsoleType((GG_Console_Type)config_emulator.console_type);
+    core->GetMedia()->SetCDROMType((GG_CDROM_Type)config_emulator.cdrom_type);
+    core->GetMedia()->PreloadCdRom(config_emulator.preload_cdrom);
+    core->GetMedia()->PrecacheChdDecode(config_emulator.precache_chd_decode);
+    core->GetAudio()->GetPSG()->EnableHuC6280A(config_audio.huc6280a);
+    core->EnableMB128((GG_MB128_Mode)config_emulator.mb128_mode);
+
+    if (!config_emulator.syscard_bios_path.empty())
+        core->LoadBios(config_emulator.syscard_bios_path.c_str(), true);
+
+    if (!config_emulator.gameexpress_bios_path.empty())
+        core->LoadBios(config_emulator.gameexpress_bios_path.c_str(), false);
+
+    return core;
+}
+
+void headless_destroy_core(GeargrafxCore* core)
+{
+    SafeDelete(core);
+    remove_directory_and_contents(config_temp_path);
+}
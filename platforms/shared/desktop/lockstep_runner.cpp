@@ -0,0 +1,256 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <chrono>
+#include <vector>
+#include "lockstep_runner.h"
+#include "headless_core.h"
+#include "geargrafx.h"
+#include "config.h"
+#include "utils.h"
+
+struct Lockstep_Side
+{
+    GeargrafxCore* core;
+    InputMovie movie;
+    std::vector<u8> frame_buffer;
+    std::vector<s16> sample_buffer;
+    int sample_count;
+    GG_State_Hash state_hash;
+};
+
+struct Lockstep_Random
+{
+    u32 state;
+    int hold_frames;
+    GG_Input_Frame held;
+};
+
+static u32 random_next(Lockstep_Random& rng);
+static void random_input(Lockstep_Random& rng, GG_Input_Frame& input);
+static bool compare_frame(int frame, Lockstep_Side& optimized, Lockstep_Side& reference, bool video);
+
+// Runs a core with every fast path enabled next to one in reference mode,
+// feeding both the same input, and stops at the first frame where the
+// picture, the audio or any state component differs.
+// With speculative set both cores run speculative frames, rendering every
+// other one. The reference core runs them the plain way, so the audio and
+// render skips are checked against it. Neither core returns samples then,
+// but the whole state, audio included, must still match.
+int lockstep_run(const LockstepParams& params)
+{
+    Log("\n%s", GG_TITLE_ASCII);
+    Log("%s %s Lockstep Mode", GG_TITLE, GG_VERSION);
+
+    if (!IsValidPointer(params.rom_file) || (strlen(params.rom_file) == 0))
+    {
+        Error("Lockstep mode requires a game file");
+        return 1;
+    }
+
+    Lockstep_Side reference;
+    Lockstep_Side optimized;
+    bool use_movie = IsValidPointer(params.movie_file);
+
+    if (use_movie && (!reference.movie.Load(params.movie_file) || !optimized.movie.Load(params.movie_file)))
+        return 1;
+
+    // Seeding before loading makes the power-on RAM the same on every run,
+    // and the fork below inherits it
+    reference.core = headless_create_core();
+    reference.core->SetReferenceMode(true);
+    reference.core->SetRandomSeed(params.seed);
+
+    if (!reference.core->LoadMedia(params.rom_file))
+    {
+        Error("Failed to load %s", params.rom_file);
+        headless_destroy_core(reference.core);
+        return 2;
+    }
+
+    // The optimized core is a fork so the shared media and state transfer
+    // paths are covered too
+    optimized.core = reference.core->Fork();
+
+    if (!IsValidPointer(optimized.core))
+    {
+        headless_destroy_core(reference.core);
+        return 2;
+    }
+
+    optimized.core->SetReferenceMode(false);
+
+    Lockstep_Side* sides[2] = { &optimized, &reference };
+    int total_frames = params.frames;
+
+    for (int i = 0; i < 2; i++)
+    {
+        sides[i]->frame_buffer.resize(2048 * 512 * 4);
+        sides[i]->sample_buffer.resize(GG_AUDIO_BUFFER_SIZE);
+        sides[i]->sample_count = 0;
+
+        if (use_movie && !sides[i]->movie.StartPlayback(sides[i]->core))
+        {
+            SafeDelete(optimized.core);
+            headless_destroy_core(reference.core);
+            return 3;
+        }
+    }
+
+    if (use_movie)
+    {
+        total_frames = reference.movie.GetFrameCount();
+        Log("Comparing %d frames from %s...", total_frames, params.movie_file);
+    }
+    else
+        Log("Comparing %d frames of random input with seed %u...", total_frames, params.seed);
+
+    if (params.speculative)
+        Log("Running speculative frames");
+
+    Lockstep_Random rng;
+    memset(&rng, 0, sizeof(rng));
+    rng.state = (params.seed != 0) ? params.seed : 1;
+    int frame = 0;
+    bool diverged = false;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (; frame < total_frames; frame++)
+    {
+        GG_Input_Frame input;
+        bool render = !params.speculative || (frame & 1);
+
+        if (!use_movie)
+            random_input(rng, input);
+
+        for (int i = 0; i < 2; i++)
+        {
+            Lockstep_Side* side = sides[i];
+
+            if (use_movie)
+                side->movie.Update();
+            else
+                side->core->GetInput()->ApplyFrameInput(input);
+
+            side->sample_count = 0;
+
+            if (params.speculative)
+                side->core->RunToVBlankSpeculative(render ? side->frame_buffer.data() : NULL);
+            else
+                side->core->RunToVBlank(side->frame_buffer.data(), side->sample_buffer.data(), &side->sample_count);
+
+            side->core->HashState(&side->state_hash);
+        }
+
+        if (!compare_frame(frame, optimized, reference, render))
+        {
+            diverged = true;
+            break;
+        }
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    double fps = (elapsed > 0.0) ? (double)frame / elapsed : 0.0;
+
+    Log("Compared %d frames in %.3f s (%.1f fps per core)", frame, elapsed, fps);
+
+    if (!diverged)
+        Log("All %d frames match", total_frames);
+
+    optimized.movie.Stop();
+    reference.movie.Stop();
+
+    // The fork shares the reference media, so it goes first
+    SafeDelete(optimized.core);
+    headless_destroy_core(reference.core);
+
+    return diverged ? 5 : 0;
+}
+
+static u32 random_next(Lockstep_Random& rng)
+{
+    rng.state ^= rng.state << 13;
+    rng.state ^= rng.state >> 17;
+    rng.state ^= rng.state << 5;
+    return rng.state;
+}
+
+// Buttons are held for a few frames at a time, like a player would, so
+// games get past menus and into gameplay
+static void random_input(Lockstep_Random& rng, GG_Input_Frame& input)
+{
+    if (rng.hold_frames <= 0)
+    {
+        for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+            rng.held.keys[i] = (u16)(random_next(rng) & 0x0FFF);
+
+        rng.hold_frames = 1 + (int)(random_next(rng) % 30);
+    }
+
+    rng.hold_frames--;
+    input = rng.held;
+}
+
+static bool compare_frame(int frame, Lockstep_Side& optimized, Lockstep_Side& reference, bool video)
+{
+    GG_Runtime_Info optimized_info;
+    GG_Runtime_Info reference_info;
+    optimized.core->GetRuntimeInfo(optimized_info);
+    reference.core->GetRuntimeInfo(reference_info);
+
+    bool same_size = (optimized_info.screen_width == reference_info.screen_width) &&
+                     (optimized_info.screen_height == reference_info.screen_height);
+    size_t frame_size = (size_t)reference_info.screen_width * reference_info.screen_height * 4;
+    bool state = true;
+
+    video = !video || (same_size && (memcmp(optimized.frame_buffer.data(), reference.frame_buffer.data(), frame_size) == 0));
+    bool audio = (optimized.sample_count == reference.sample_count) &&
+                 (memcmp(optimized.sample_buffer.data(), reference.sample_buffer.data(), reference.sample_count * sizeof(s16)) == 0);
+
+    for (int i = 0; i < GG_SAVESTATE_CHUNK_COUNT; i++)
+    {
+        if (optimized.state_hash.components[i] != reference.state_hash.components[i])
+            state = false;
+    }
+
+    if (video && audio && state)
+        return true;
+
+    Log("DIVERGED at frame %d:%s%s%s", frame, video ? "" : " video", audio ? "" : " audio", state ? "" : " state");
+
+    if (!same_size)
+        Log("  Screen size: %dx%d (optimized) vs %dx%d (reference)",
+            optimized_info.screen_width, optimized_info.screen_height,
+            reference_info.screen_width, reference_info.screen_height);
+
+    if (!audio)
+        Log("  Samples: %d (optimized) vs %d (reference)", optimized.sample_count, reference.sample_count);
+
+    for (int i = 0; i < GG_SAVESTATE_CHUNK_COUNT; i++)
+    {
+        if (optimized.state_hash.components[i] != reference.state_hash.components[i])
+            Log("  %s: %016llX (optimized) vs %016llX (reference)", GeargrafxCore::GetStateComponentName(i),
+                (unsigned long long)optimized.state_hash.components[i],
+                (unsigned long long)reference.state_hash.components[i]);
+    }
+
+    return false;
+}
@@ -0,0 +1,34 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef LOCKSTEP_RUNNER_H
+#define LOCKSTEP_RUNNER_H
+
+struct LockstepParams
+{
+    const char* rom_file = NULL;
+    const char* movie_file = NULL;
+    int frames = 3600;
+    unsigned int seed = 1;
+    bool speculative = false;
+};
+
+int lockstep_run(const LockstepParams& params);
+
+#endif /* LOCKSTEP_RUNNER_H */
@@ -0,0 +1,198 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdlib.h>
+#include "loop_detector.h"
+
+#define LOOP_DETECTOR_HASH_BASIS 0xCBF29CE484222325ULL
+#define LOOP_DETECTOR_HASH_PRIME 0x100000001B3ULL
+
+static inline u64 hash_byte(u64 hash, u8 value)
+{
+    return (hash ^ value) * LOOP_DETECTOR_HASH_PRIME;
+}
+
+LoopDetector::LoopDetector(int window_frames, int silence_frames)
+{
+    m_window_frames = MAX(window_frames, 1);
+    m_silence_frames = MAX(silence_frames, 1);
+    m_window_factor = 1;
+
+    // Weight of the frame leaving the window, prime^window
+    for (int i = 0; i < m_window_frames; i++)
+        m_window_factor *= LOOP_DETECTOR_HASH_PRIME;
+
+    Reset();
+}
+
+void LoopDetector::Reset()
+{
+    m_frame_hashes.clear();
+    m_windows.clear();
+    m_window_hash = 0;
+    m_loop_start = -1;
+    m_loop_length = 0;
+    m_silence_start = -1;
+    m_silent_count = 0;
+    m_heard_audio = false;
+    m_result = RESULT_NONE;
+}
+
+LoopDetector::Result LoopDetector::Update(HuC6280PSG* psg, const s16* samples, int sample_count)
+{
+    if (m_result != RESULT_NONE)
+        return m_result;
+
+    if (UpdateSilence(samples, sample_count))
+        m_result = RESULT_SILENCE;
+    else if (UpdateLoop(HashPSG(psg)))
+        m_result = RESULT_LOOP;
+
+    return m_result;
+}
+
+int LoopDetector::GetLoopStart()
+{
+    return m_loop_start;
+}
+
+int LoopDetector::GetLoopLength()
+{
+    return m_loop_length;
+}
+
+int LoopDetector::GetSilenceStart()
+{
+    return m_silence_start;
+}
+
+int LoopDetector::GetEndFrame(int loops, int max_frames)
+{
+    switch (m_result)
+    {
+        case RESULT_LOOP:
+            return CLAMP(m_loop_start + (m_loop_length * MAX(loops, 1)), 0, max_frames);
+        case RESULT_SILENCE:
+            return CLAMP(m_silence_start, 0, max_frames);
+        default:
+            return max_frames;
+    }
+}
+
+// Only the values written by the sound driver are hashed. Internal counters
+// and the output buffers never repeat, so they are left out.
+u64 LoopDetector::HashPSG(HuC6280PSG* psg)
+{
+    HuC6280PSG::HuC6280PSG_State* state = psg->GetState();
+    u64 hash = LOOP_DETECTOR_HASH_BASIS;
+
+    hash = hash_byte(hash, *state->MAIN_AMPLITUDE);
+    hash = hash_byte(hash, *state->LFO_FREQUENCY & 0xFF);
+    hash = hash_byte(hash, *state->LFO_FREQUENCY >> 8);
+    hash = hash_byte(hash, *state->LFO_CONTROL);
+
+    for (int i = 0; i < 6; i++)
+    {
+        HuC6280PSG::HuC6280PSG_Channel* channel = &state->CHANNELS[i];
+
+        hash = hash_byte(hash, channel->frequency & 0xFF);
+        hash = hash_byte(hash, channel->frequency >> 8);
+        hash = hash_byte(hash, channel->control);
+        hash = hash_byte(hash, channel->amplitude);
+        hash = hash_byte(hash, channel->noise_control);
+
+        for (int j = 0; j < 32; j++)
+            hash = hash_byte(hash, channel->wave_data[j]);
+    }
+
+    return hash;
+}
+
+bool LoopDetector::IsSilent(const s16* samples, int sample_count)
+{
+    for (int i = 0; i < sample_count; i++)
+    {
+        if (abs(samples[i]) > LOOP_DETECTOR_SILENCE_THRESHOLD)
+            return false;
+    }
+
+    return true;
+}
+
+bool LoopDetector::UpdateLoop(u64 frame_hash)
+{
+    int frame = (int)m_frame_hashes.size();
+    m_frame_hashes.push_back(frame_hash);
+
+    m_window_hash = (m_window_hash * LOOP_DETECTOR_HASH_PRIME) + frame_hash;
+
+    if (frame >= m_window_frames)
+        m_window_hash -= m_frame_hashes[frame - m_window_frames] * m_window_factor;
+
+    if (frame < m_window_frames - 1)
+        return false;
+
+    std::unordered_map<u64, int>::iterator it = m_windows.find(m_window_hash);
+
+    if (it == m_windows.end())
+    {
+        m_windows[m_window_hash] = frame;
+        return false;
+    }
+
+    int first = it->second;
+    int length = frame - first;
+
+    if (length < m_window_frames)
+        return false;
+
+    // Rule out hash collisions, this only runs once per match
+    for (int i = 0; i < m_window_frames; i++)
+    {
+        if (m_frame_hashes[first - i] != m_frame_hashes[frame - i])
+            return false;
+    }
+
+    m_loop_length = length;
+    m_loop_start = first - m_window_frames + 1;
+
+    return true;
+}
+
+bool LoopDetector::UpdateSilence(const s16* samples, int sample_count)
+{
+    int frame = (int)m_frame_hashes.size();
+
+    if (!IsSilent(samples, sample_count))
+    {
+        m_heard_audio = true;
+        m_silent_count = 0;
+        return false;
+    }
+
+    if (!m_heard_audio)
+        return false;
+
+    if (m_silent_count == 0)
+        m_silence_start = frame;
+
+    m_silent_count++;
+
+    return m_silent_count >= m_silence_frames;
+}
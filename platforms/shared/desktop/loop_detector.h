@@ -0,0 +1,77 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef LOOP_DETECTOR_H
+#define LOOP_DETECTOR_H
+
+#include <vector>
+#include <unordered_map>
+#include "geargrafx.h"
+
+#define LOOP_DETECTOR_DEFAULT_WINDOW 600
+#define LOOP_DETECTOR_DEFAULT_SILENCE 300
+#define LOOP_DETECTOR_SILENCE_THRESHOLD 16
+
+// Finds where a song loops by hashing the PSG registers once per frame.
+// A loop is found when the last window of frame hashes has already been
+// seen at least one window earlier. Windows are hashed with a rolling
+// polynomial hash and looked up in a hash map, so each frame is O(1).
+// A song that ends in silence is stopped separately, once audio has been
+// heard and then stayed silent for the given number of frames.
+class LoopDetector
+{
+public:
+    enum Result
+    {
+        RESULT_NONE,
+        RESULT_LOOP,
+        RESULT_SILENCE
+    };
+
+public:
+    LoopDetector(int window_frames = LOOP_DETECTOR_DEFAULT_WINDOW, int silence_frames = LOOP_DETECTOR_DEFAULT_SILENCE);
+    void Reset();
+    Result Update(HuC6280PSG* psg, const s16* samples, int sample_count);
+    int GetLoopStart();
+    int GetLoopLength();
+    int GetSilenceStart();
+    int GetEndFrame(int loops, int max_frames);
+
+private:
+    u64 HashPSG(HuC6280PSG* psg);
+    bool IsSilent(const s16* samples, int sample_count);
+    bool UpdateLoop(u64 frame_hash);
+    bool UpdateSilence(const s16* samples, int sample_count);
+
+private:
+    std::vector<u64> m_frame_hashes;
+    std::unordered_map<u64, int> m_windows;
+    u64 m_window_hash;
+    u64 m_window_factor;
+    int m_window_frames;
+    int m_silence_frames;
+    int m_loop_start;
+    int m_loop_length;
+    int m_silence_start;
+    int m_silent_count;
+    bool m_heard_audio;
+    Result m_result;
+};
+
+#endif /* LOOP_DETECTOR_H */
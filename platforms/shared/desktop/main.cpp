@@ -22,6 +22,10 @@
 #include "geargrafx.h"
 #include "application.h"
 #include "application_headless.h"
+#include "offline_render.h"
+#include "movie_replay.h"
+#include "lockstep_runner.h"
+#include "batch_runner.h"
 #include "config.h"
 #include "console_utils.h"
 
@@ -39,6 +43,12 @@ int main(int argc, char* argv[])
     bool mcp_http_set = false;
     bool headless = false;
     bool portable = false;
+    OfflineRenderParams render_params;
+    MovieReplayParams movie_params;
+    LockstepParams lockstep_params;
+    bool lockstep = false;
+    BatchRunParams batch_params;
+    bool batch = false;
 
     for (int i = 1; i < argc; i++)
     {
@@ -117,6 +127,160 @@ int main(int argc, char* argv[])
                 app_params.mcp_http_address = argv[++i];
                 app_params.mcp_http_address_set = true;
             }
+            else if ((strcmp(argv[i], "--render-stems") == 0) || (strcmp(argv[i], "--render-wav") == 0) ||
+                     (strcmp(argv[i], "--render-vgm") == 0))
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    return -1;
+                }
+
+                if (strcmp(argv[i], "--render-stems") == 0)
+                    render_params.stems_dir = argv[i + 1];
+                else if (strcmp(argv[i], "--render-wav") == 0)
+                    render_params.wav_file = argv[i + 1];
+                else
+                    render_params.vgm_file = argv[i + 1];
+                i++;
+            }
+            else if ((strcmp(argv[i], "--render-frames") == 0) || (strcmp(argv[i], "--render-track") == 0) ||
+                     (strcmp(argv[i], "--render-loops") == 0))
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    return -1;
+                }
+
+                char* end = NULL;
+                long value = strtol(argv[i + 1], &end, 10);
+                bool is_frames = (strcmp(argv[i], "--render-frames") == 0);
+                if (!end || *end != '\0' || value < (is_frames ? 1 : 0) || value > 0x7FFFFFFF)
+                {
+                    fprintf(stderr, "Invalid value for %s: %s\n", argv[i], argv[i + 1]);
+                    return -1;
+                }
+
+                if (is_frames)
+                    render_params.frames = (int)value;
+                else if (strcmp(argv[i], "--render-track") == 0)
+                    render_params.track = (int)value;
+                else
+                    render_params.loops = (int)value;
+                i++;
+            }
+            else if (strcmp(argv[i], "--play-movie") == 0)
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    return -1;
+                }
+
+                movie_params.movie_file = argv[++i];
+            }
+            else if (strcmp(argv[i], "--movie-write-hashes") == 0)
+            {
+                movie_params.write_hashes = true;
+            }
+            else if (strcmp(argv[i], "--lockstep") == 0)
+            {
+                lockstep = true;
+            }
+            else if (strcmp(argv[i], "--lockstep-speculative") == 0)
+            {
+                lockstep_params.speculative = true;
+                lockstep = true;
+            }
+            else if (strcmp(argv[i], "--lockstep-movie") == 0)
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    return -1;
+                }
+
+                lockstep_params.movie_file = argv[++i];
+                lockstep = true;
+            }
+            else if ((strcmp(argv[i], "--lockstep-frames") == 0) || (strcmp(argv[i], "--lockstep-seed") == 0))
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    return -1;
+                }
+
+                char* end = NULL;
+                long long value = strtoll(argv[i + 1], &end, 0);
+                bool is_frames = (strcmp(argv[i], "--lockstep-frames") == 0);
+                if (!end || *end != '\0' || value < (is_frames ? 1 : 0) || value > (is_frames ? 0x7FFFFFFF : 0xFFFFFFFFLL))
+                {
+                    fprintf(stderr, "Invalid value for %s: %s\n", argv[i], argv[i + 1]);
+                    return -1;
+                }
+
+                if (is_frames)
+                    lockstep_params.frames = (int)value;
+                else
+                    lockstep_params.seed = (unsigned int)value;
+                lockstep = true;
+                i++;
+            }
+            else if (strcmp(argv[i], "--batch") == 0)
+            {
+                batch = true;
+            }
+            else if ((strcmp(argv[i], "--batch-movie") == 0) || (strcmp(argv[i], "--batch-hashes") == 0) ||
+                     (strcmp(argv[i], "--batch-png") == 0) || (strcmp(argv[i], "--batch-png-frames") == 0) ||
+                     (strcmp(argv[i], "--batch-wav") == 0) || (strcmp(argv[i], "--batch-stats") == 0))
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    return -1;
+                }
+
+                if (strcmp(argv[i], "--batch-movie") == 0)
+                    batch_params.movie_file = argv[i + 1];
+                else if (strcmp(argv[i], "--batch-hashes") == 0)
+                    batch_params.hash_file = argv[i + 1];
+                else if (strcmp(argv[i], "--batch-png") == 0)
+                    batch_params.png_dir = argv[i + 1];
+                else if (strcmp(argv[i], "--batch-png-frames") == 0)
+                    batch_params.png_frames = argv[i + 1];
+                else if (strcmp(argv[i], "--batch-wav") == 0)
+                    batch_params.wav_file = argv[i + 1];
+                else
+                    batch_params.stats_file = argv[i + 1];
+                batch = true;
+                i++;
+            }
+            else if ((strcmp(argv[i], "--batch-frames") == 0) || (strcmp(argv[i], "--batch-seed") == 0))
+            {
+                if (i + 1 >= argc || argv[i + 1][0] == '-')
+                {
+                    fprintf(stderr, "Missing value for %s\n", argv[i]);
+                    return -1;
+                }
+
+                char* end = NULL;
+                long long value = strtoll(argv[i + 1], &end, 0);
+                bool is_frames = (strcmp(argv[i], "--batch-frames") == 0);
+                if (!end || *end != '\0' || value < (is_frames ? 1 : 0) || value > (is_frames ? 0x7FFFFFFF : 0xFFFFFFFFLL))
+                {
+                    fprintf(stderr, "Invalid value for %s: %s\n", argv[i], argv[i + 1]);
+                    return -1;
+                }
+
+                if (is_frames)
+                    batch_params.frames = (int)value;
+                else
+                    batch_params.seed = (unsigned int)value;
+                batch = true;
+                i++;
+            }
             else
             {
                 printf("Unknown option: %s\n", argv[i]);
@@ -129,7 +293,10 @@ int main(int argc, char* argv[])
     int non_option_count = 0;
     for (int i = 1; i < argc; i++)
     {
-        if ((strcmp(argv[i], "--mcp-http-port") == 0) || (strcmp(argv[i], "--mcp-http-address") == 0))
+        if ((strcmp(argv[i], "--mcp-http-port") == 0) || (strcmp(argv[i], "--mcp-http-address") == 0) ||
+            (strncmp(argv[i], "--render-", 9) == 0) || (strcmp(argv[i], "--play-movie") == 0) ||
+            ((strncmp(argv[i], "--lockstep-", 11) == 0) && (strcmp(argv[i], "--lockstep-speculative") != 0)) ||
+            (strncmp(argv[i], "--batch-", 8) == 0))
         {
             if (i + 1 < argc)
                 i++;
@@ -175,6 +342,28 @@ int main(int argc, char* argv[])
         printf("      --mcp-http-address A    HTTP bind address (default: 127.0.0.1)\n");
         printf("      --mcp-http-port N       HTTP port for MCP server (default: 7777)\n");
         printf("      --headless              Run without GUI (requires --mcp-stdio or --mcp-http)\n");
+        printf("      --render-wav FILE       Render game audio offline to a WAV file and exit\n");
+        printf("      --render-vgm FILE       Render game audio offline to a VGM (.vgm or .vgz) file and exit\n");
+        printf("      --render-stems DIR      Render game audio offline to per-channel WAV files in DIR and exit\n");
+        printf("      --render-frames N       Maximum number of frames to render offline (default: 3600)\n");
+        printf("      --render-track N        Select HES track N before rendering (default: 0)\n");
+        printf("      --render-loops N        Stop after the music loop plays N times, or when the song ends in silence (default: off)\n");
+        printf("      --play-movie FILE       Replay an input movie headless at full speed and exit\n");
+        printf("      --movie-write-hashes    Store the frame hashes of the replay in the movie file\n");
+        printf("      --lockstep              Run an optimized core against a reference core and report the first divergence\n");
+        printf("      --lockstep-movie FILE   Drive the lockstep cores with an input movie instead of random input\n");
+        printf("      --lockstep-frames N     Number of frames of random input to compare (default: 3600)\n");
+        printf("      --lockstep-seed N       Seed for the random input and the cores (default: 1)\n");
+        printf("      --lockstep-speculative  Run speculative frames (as run-ahead does) on both lockstep cores\n");
+        printf("      --batch                 Run the game flat out with no window, audio or MCP, write the outputs below and exit\n");
+        printf("      --batch-frames N        Number of frames to run (default: movie length or 3600)\n");
+        printf("      --batch-seed N          Seed for the core random generator (default: 1)\n");
+        printf("      --batch-movie FILE      Drive the game with an input movie\n");
+        printf("      --batch-hashes FILE     Write the video, audio, RAM and state hashes of every frame\n");
+        printf("      --batch-png DIR         Save screenshots of the selected frames to DIR (default: last frame)\n");
+        printf("      --batch-png-frames L    Comma separated frames to save, counted from 0\n");
+        printf("      --batch-wav FILE        Write the audio to a WAV file\n");
+        printf("      --batch-stats FILE      Write timing stats to a JSON file\n");
         printf("      --portable              Store configuration and user data beside the application\n");
         printf("  -v, --version               Display version information\n");
         printf("  -h, --help                  Display this help message\n");
@@ -197,6 +386,46 @@ int main(int argc, char* argv[])
     else
         app_params.mcp_http_address = config_emulator.mcp_http_address;
 
+    if (IsValidPointer(render_params.stems_dir) || IsValidPointer(render_params.wav_file) || IsValidPointer(render_params.vgm_file))
+    {
+        render_params.rom_file = app_params.rom_file;
+        ret = offline_render_run(render_params);
+
+        config_destroy();
+
+        return ret;
+    }
+
+    if (batch)
+    {
+        batch_params.rom_file = app_params.rom_file;
+        ret = batch_run(batch_params);
+
+        config_destroy();
+
+        return ret;
+    }
+
+    if (lockstep)
+    {
+        lockstep_params.rom_file = app_params.rom_file;
+        ret = lockstep_run(lockstep_params);
+
+        config_destroy();
+
+        return ret;
+    }
+
+    if (IsValidPointer(movie_params.movie_file))
+    {
+        movie_params.rom_file = app_params.rom_file;
+        ret = movie_replay_run(movie_params);
+
+        config_destroy();
+
+        return ret;
+    }
+
     if (headless)
     {
         ret = application_headless_init(app_params);
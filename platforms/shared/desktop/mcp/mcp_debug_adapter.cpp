@@ -33,6 +33,7 @@
 #include "../config.h"
 #include "../events.h"
 #include "../rewind.h"
+#include "../save_writer.h"
 #include <cstring>
 #include <sstream>
 #include <iomanip>
@@ -702,6 +703,7 @@ json DebugAdapter::GetMediaInfo()
 
     info["backup_ram_forced"] = media->IsBackupRAMForced();
     info["preload_cdrom"] = media->IsPreloadCdRomEnabled();
+    info["precache_chd_decode"] = media->IsPrecacheChdDecodeEnabled();
 
     return info;
 }
@@ -1726,10 +1728,19 @@ json DebugAdapter::SaveState()
     }
 
     int slot = config_emulator.save_slot + 1;
-    emu_save_state_slot(slot);
+    Save_Writer_Result write_result;
+    u32 id = emu_save_state_slot(slot, true);
+
+    if ((id == 0) || !save_writer_wait(id, &write_result))
+    {
+        result["error"] = "Failed to save state";
+        Log("[MCP] SaveState failed: Slot %d", slot);
+        return result;
+    }
 
     result["success"] = true;
     result["slot"] = slot;
+    result["file_path"] = write_result.path;
     result["rom_name"] = m_core->GetMedia()->GetFileName();
 
     return result;
@@ -1783,7 +1794,9 @@ json DebugAdapter::SaveStateFile(const std::string& file_path)
         return result;
     }
 
-    if (!m_core->SaveState(file_path.c_str(), -1, false))
+    u32 id = emu_save_state_file(file_path.c_str(), false, true);
+
+    if ((id == 0) || !save_writer_wait(id, NULL))
     {
         result["error"] = "Failed to save state file";
         Log("[MCP] SaveStateFile failed: %s", file_path.c_str());
@@ -3305,6 +3318,8 @@ json DebugAdapter::GetRewindStatus()
     int fps = rewind_get_frames_per_snapshot();
     if (fps < 1) fps = 1;
     result["buffered_seconds"] = (double)(rewind_get_snapshot_count() * fps) / 60.0;
+    result["memory_budget_mb"] = config_rewind.memory_mb;
+    result["memory_used_bytes"] = rewind_get_memory_used();
 
     return result;
 }
@@ -3344,3 +3359,41 @@ json DebugAdapter::RewindSeek(int snapshot)
     result["pc"] = ss.str();
     return result;
 }
+
+json DebugAdapter::GetPerfCounters()
+{
+    GG_Perf_Counters perf;
+
+    json result;
+    result["enabled"] = m_core->GetPerfCounters(perf);
+
+    if (!result["enabled"])
+    {
+        result["message"] = "Performance counters are disabled in this build, rebuild with PERF_COUNTERS=1";
+        return result;
+    }
+
+    result["frame"] = perf.frame;
+    result["instructions"] = perf.instructions;
+    result["master_cycles"] = perf.master_cycles;
+    result["clock_hardware_calls"] = perf.clock_hardware_calls;
+    result["cycles_per_clock_call"] = perf.clock_hardware_calls > 0 ? (double)perf.master_cycles / (double)perf.clock_hardware_calls : 0.0;
+    result["clock_hardware_slow_steps"] = perf.clock_hardware_slow_steps;
+    result["vram_dma_words"] = perf.vram_dma_words;
+    result["satb_dma_words"] = perf.satb_dma_words;
+    result["psg_sync_calls"] = perf.psg_sync_calls;
+    result["cycles_per_psg_sync"] = perf.psg_sync_calls > 0 ? (double)perf.psg_sync_cycles / (double)perf.psg_sync_calls : 0.0;
+    result["cd_sector_reads"] = perf.cd_sector_reads;
+    result["cd_cache_hits"] = perf.cd_cache_hits;
+    result["cd_cache_misses"] = perf.cd_cache_misses;
+
+    json host;
+    host["frame_ns"] = perf.frame_host_ns;
+    host["cpu_ns"] = perf.host_ns[GG_PERF_CPU];
+    host["video_ns"] = perf.host_ns[GG_PERF_VIDEO];
+    host["audio_ns"] = perf.host_ns[GG_PERF_AUDIO];
+    host["cdrom_ns"] = perf.host_ns[GG_PERF_CDROM];
+    result["host"] = host;
+
+    return result;
+}
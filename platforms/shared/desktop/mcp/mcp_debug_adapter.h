@@ -196,6 +196,7 @@ public:
     // Rewind
     json GetRewindStatus();
     json RewindSeek(int snapshot);
+    json GetPerfCounters();
 
     // Core access
     GeargrafxCore* GetCore() { return m_core; }
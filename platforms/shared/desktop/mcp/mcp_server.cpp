@@ -1104,6 +1104,17 @@ json McpServer::BuildToolList()
         }}
     });
 
+    tools.push_back({
+        {"name", "get_perf_counters"},
+        {"title", "Get Performance Counters"},
+        {"description", "Read last frame hot-path counters: instructions, clock calls, 3-cycle steps, DMA words, PSG syncs, CD reads/cache hits, host ns per subsystem. Needs a PERF_COUNTERS=1 build."},
+        {"annotations", {{"readOnlyHint", true}, {"destructiveHint", false}, {"idempotentHint", true}, {"openWorldHint", false}}},
+        {"inputSchema", {
+            {"type", "object"},
+            {"additionalProperties", false}
+        }}
+    });
+
     // Controller input tools
     tools.push_back({
         {"name", "controller_button"},
@@ -2835,6 +2846,10 @@ json McpServer::ExecuteCommand(const std::string& toolName, const json& argument
         int snapshot = arguments["snapshot"];
         return m_debugAdapter.RewindSeek(snapshot);
     }
+    else if (normalizedTool == "get_perf_counters")
+    {
+        return m_debugAdapter.GetPerfCounters();
+    }
     else if (normalizedTool == "controller_button")
     {
         int player = arguments["player"];
@@ -212,6 +212,7 @@ static const McpToolCategory kMcpToolCategories[] =
     {"rewind", "Rewind", "Inspect rewind buffer status and seek to rewind snapshots for time-travel debugging."},
     {"input", "Input", "Inspect or control gamepad, mouse, controller type, and TurboTap state."},
     {"trace", "Trace", "Read trace log entries and configure CPU, interrupt, video, audio, memory, CD-ROM, and debug-message tracing."},
+    {"perf", "Performance", "Read per-frame emulation hot-path counters and host time per subsystem."},
     {"tools", "Other Tools", "Additional emulator/debugger tools that do not fit another category."}
 };
 
@@ -301,6 +302,11 @@ static const char* const kMcpTraceTools[] =
     "get_trace_log", "set_trace_log"
 };
 
+static const char* const kMcpPerfTools[] =
+{
+    "get_perf_counters"
+};
+
 static const McpToolCategoryTools kMcpToolCategoryTools[] =
 {
     {"execution", kMcpExecutionTools, MCP_ARRAY_COUNT(kMcpExecutionTools)},
@@ -317,7 +323,8 @@ static const McpToolCategoryTools kMcpToolCategoryTools[] =
     {"state", kMcpStateTools, MCP_ARRAY_COUNT(kMcpStateTools)},
     {"rewind", kMcpRewindTools, MCP_ARRAY_COUNT(kMcpRewindTools)},
     {"input", kMcpInputTools, MCP_ARRAY_COUNT(kMcpInputTools)},
-    {"trace", kMcpTraceTools, MCP_ARRAY_COUNT(kMcpTraceTools)}
+    {"trace", kMcpTraceTools, MCP_ARRAY_COUNT(kMcpTraceTools)},
+    {"perf", kMcpPerfTools, MCP_ARRAY_COUNT(kMcpPerfTools)}
 };
 
 const size_t kMcpSearchToolLimit = 20;
@@ -0,0 +1,139 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <chrono>
+#include <vector>
+#include "movie_replay.h"
+#include "headless_core.h"
+#include "geargrafx.h"
+#include "config.h"
+#include "utils.h"
+
+static void log_desync(int frame, const InputMovie::Frame_Hash& expected, const InputMovie::Frame_Hash& actual);
+
+int movie_replay_run(const MovieReplayParams& params)
+{
+    Log("\n%s", GG_TITLE_ASCII);
+    Log("%s %s Movie Replay Mode", GG_TITLE, GG_VERSION);
+
+    if (!IsValidPointer(params.rom_file) || (strlen(params.rom_file) == 0))
+    {
+        Error("Movie replay requires a game file");
+        return 1;
+    }
+
+    InputMovie movie;
+
+    if (!movie.Load(params.movie_file))
+        return 1;
+
+    GeargrafxCore* core = headless_create_core();
+
+    if (!core->LoadMedia(params.rom_file))
+    {
+        Error("Failed to load %s", params.rom_file);
+        headless_destroy_core(core);
+        return 2;
+    }
+
+    if (!movie.StartPlayback(core))
+    {
+        headless_destroy_core(core);
+        return 3;
+    }
+
+    // Rendering is the most expensive part of a frame, skip it unless the
+    // picture has to be hashed
+    bool verify = movie.HasHashes() && !params.write_hashes;
+    bool hash = verify || params.write_hashes;
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE);
+    int total_frames = movie.GetFrameCount();
+    int desync_frames = 0;
+
+    Log("Replaying %d frames from %s%s...", total_frames, params.movie_file,
+        verify ? ", verifying hashes" : (params.write_hashes ? ", writing hashes" : ""));
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    while (movie.Update())
+    {
+        int frame = movie.GetCurrentFrame() - 1;
+        int sample_count = 0;
+        core->RunToVBlank(hash ? frame_buffer.data() : NULL, sample_buffer.data(), &sample_count, NULL, hash);
+
+        if (!hash)
+            continue;
+
+        InputMovie::Frame_Hash frame_hash;
+        InputMovie::HashFrame(core, frame_buffer.data(), sample_buffer.data(), sample_count, frame_hash);
+
+        if (params.write_hashes)
+            movie.SetFrameHash(frame, frame_hash);
+        else
+        {
+            const InputMovie::Frame_Hash* expected = movie.GetFrameHash(frame);
+
+            if (memcmp(expected, &frame_hash, sizeof(frame_hash)) != 0)
+            {
+                if (desync_frames == 0)
+                    log_desync(frame, *expected, frame_hash);
+                desync_frames++;
+            }
+        }
+    }
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    double fps = (elapsed > 0.0) ? (double)total_frames / elapsed : 0.0;
+
+    Log("Replayed %d frames in %.3f s (%.1f fps, %.1fx real time)", total_frames, elapsed, fps, fps / 60.0);
+
+    int ret = 0;
+
+    if (params.write_hashes)
+    {
+        if (movie.Save(params.movie_file))
+            Log("Frame hashes written to %s", params.movie_file);
+        else
+            ret = 4;
+    }
+    else if (verify)
+    {
+        if (desync_frames > 0)
+        {
+            Log("DESYNC: %d of %d frames differ", desync_frames, total_frames);
+            ret = 5;
+        }
+        else
+            Log("All %d frames match", total_frames);
+    }
+
+    headless_destroy_core(core);
+
+    return ret;
+}
+
+static void log_desync(int frame, const InputMovie::Frame_Hash& expected, const InputMovie::Frame_Hash& actual)
+{
+    Log("DESYNC at frame %d:%s%s%s", frame,
+        (expected.video != actual.video) ? " video" : "",
+        (expected.audio != actual.audio) ? " audio" : "",
+        (expected.ram != actual.ram) ? " ram" : "");
+}
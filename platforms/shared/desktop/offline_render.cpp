@@ -0,0 +1,292 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "offline_render.h"
+#include "headless_core.h"
+#include "geargrafx.h"
+#include "config.h"
+#include "utils.h"
+#include "wav_writer.h"
+#include "loop_detector.h"
+
+#define OFFLINE_RENDER_TRACK_SETTLE_FRAMES 60
+#define OFFLINE_RENDER_TRACK_PULSE_FRAMES 4
+
+static const char* k_stem_file_names[GG_AUDIO_STEM_COUNT + 1] =
+{
+    "mix.wav",
+    "psg_1.wav",
+    "psg_2.wav",
+    "psg_3.wav",
+    "psg_4.wav",
+    "psg_5.wav",
+    "psg_6.wav",
+    "adpcm.wav",
+    "cdda.wav"
+};
+
+static bool open_stems(WavWriter* writer, const char* dir);
+static bool start_vgm(GeargrafxCore* core, const char* file_path);
+static void select_track(GeargrafxCore* core, int track, s16* sample_buffer);
+static void run_frames(GeargrafxCore* core, int frames, s16* sample_buffer);
+static int find_end_frame(GeargrafxCore* core, const OfflineRenderParams& params, s16* sample_buffer);
+
+int offline_render_run(const OfflineRenderParams& params)
+{
+    Log("\n%s", GG_TITLE_ASCII);
+    Log("%s %s Offline Render Mode", GG_TITLE, GG_VERSION);
+
+    if (!IsValidPointer(params.rom_file) || (strlen(params.rom_file) == 0))
+    {
+        Error("Offline render requires a game file");
+        return 1;
+    }
+
+    if (!IsValidPointer(params.stems_dir) && !IsValidPointer(params.wav_file) && !IsValidPointer(params.vgm_file))
+    {
+        Error("Offline render requires an output (--render-wav, --render-vgm or --render-stems)");
+        return 1;
+    }
+
+    if (params.frames <= 0)
+    {
+        Error("Invalid frame count: %d", params.frames);
+        return 1;
+    }
+
+    GeargrafxCore* core = headless_create_core();
+
+    if (!core->LoadMedia(params.rom_file))
+    {
+        Error("Failed to load %s", params.rom_file);
+        headless_destroy_core(core);
+        return 2;
+    }
+
+    s16* mix_buffer = new s16[GG_AUDIO_BUFFER_SIZE];
+    s16* stem_buffer = new s16[GG_AUDIO_BUFFER_SIZE];
+
+    if (params.track > 0)
+        select_track(core, params.track, mix_buffer);
+
+    int end_frame = params.frames;
+
+    if (params.loops > 0)
+        end_frame = find_end_frame(core, params, mix_buffer);
+
+    WavWriter wav;
+    WavWriter stems;
+    bool ok = true;
+
+    if (IsValidPointer(params.wav_file))
+        ok = wav.Open(&params.wav_file, 1, GG_AUDIO_SAMPLE_RATE, 2);
+
+    if (ok && IsValidPointer(params.stems_dir))
+        ok = open_stems(&stems, params.stems_dir);
+
+    if (ok && IsValidPointer(params.vgm_file))
+        ok = start_vgm(core, params.vgm_file);
+
+    if (!ok)
+    {
+        wav.Close();
+        stems.Close();
+        SafeDeleteArray(mix_buffer);
+        SafeDeleteArray(stem_buffer);
+        headless_destroy_core(core);
+        return 3;
+    }
+
+    Audio* audio = core->GetAudio();
+    int frame = 0;
+    u64 total_samples = 0;
+
+    Log("Rendering %d frames from %s...", end_frame, params.rom_file);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (; frame < end_frame; frame++)
+    {
+        int sample_count = 0;
+        core->RunToVBlank(NULL, mix_buffer, &sample_count, NULL, false);
+        total_samples += sample_count;
+
+        if (wav.IsOpen())
+            wav.Write(0, mix_buffer, sample_count);
+
+        if (stems.IsOpen())
+        {
+            stems.Write(0, mix_buffer, sample_count);
+
+            for (int stem = 0; stem < GG_AUDIO_STEM_COUNT; stem++)
+            {
+                int count = audio->GetStemFrame((GG_Audio_Stem)stem, stem_buffer);
+                stems.Write(stem + 1, stem_buffer, count);
+            }
+        }
+    }
+
+    if (IsValidPointer(params.vgm_file))
+        audio->StopVgmRecording();
+
+    ok = true;
+
+    if (wav.IsOpen())
+        ok = wav.Close();
+
+    if (stems.IsOpen())
+        ok = stems.Close() && ok;
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    double audio_seconds = (double)(total_samples / 2) / (double)GG_AUDIO_SAMPLE_RATE;
+
+    Log("Rendered %d frames, %.2f s of audio in %.2f s (%.1fx real time)",
+        frame, audio_seconds, elapsed, (elapsed > 0.0) ? audio_seconds / elapsed : 0.0);
+
+    SafeDeleteArray(mix_buffer);
+    SafeDeleteArray(stem_buffer);
+    headless_destroy_core(core);
+
+    return ok ? 0 : 4;
+}
+
+static bool open_stems(WavWriter* writer, const char* dir)
+{
+    if (!create_directory_if_not_exists(dir))
+    {
+        Error("Unable to create output directory %s", dir);
+        return false;
+    }
+
+    std::string paths[GG_AUDIO_STEM_COUNT + 1];
+    const char* path_ptrs[GG_AUDIO_STEM_COUNT + 1];
+
+    for (int i = 0; i < GG_AUDIO_STEM_COUNT + 1; i++)
+    {
+        paths[i] = dir;
+        append_path_component(paths[i], k_stem_file_names[i]);
+        path_ptrs[i] = paths[i].c_str();
+    }
+
+    return writer->Open(path_ptrs, GG_AUDIO_STEM_COUNT + 1, GG_AUDIO_SAMPLE_RATE, 2);
+}
+
+static bool start_vgm(GeargrafxCore* core, const char* file_path)
+{
+    // PC Engine audio chip always runs at 3.579545 MHz
+    int clock_rate = 3579545;
+    Media* media = core->GetMedia();
+    VgmMetadata metadata;
+    metadata.system_name = "NEC PC Engine / TurboGrafx-16";
+    if (media->IsSGX())
+        metadata.system_name = "NEC PC Engine SuperGrafx";
+    else if (media->IsCDROM())
+        metadata.system_name = "NEC PC Engine CD-ROM";
+
+    metadata.game_name = media->IsInGameDatabase() ? media->GetGameDatabaseName() : media->GetFileName();
+    metadata.comment = "Created with " GG_TITLE " " GG_VERSION;
+
+    if (!core->GetAudio()->StartVgmRecording(file_path, clock_rate, metadata))
+    {
+        Error("Unable to start VGM recording: %s", file_path);
+        return false;
+    }
+
+    return true;
+}
+
+// HES rips boot into their own player, which steps to the next track on
+// every RIGHT press. The audio rendered while selecting is discarded.
+static void select_track(GeargrafxCore* core, int track, s16* sample_buffer)
+{
+    if (!core->GetMedia()->IsHES())
+        Log("WARNING: Track selection is meant for HES files, pressing RIGHT %d times anyway", track);
+
+    run_frames(core, OFFLINE_RENDER_TRACK_SETTLE_FRAMES, sample_buffer);
+
+    for (int i = 0; i < track; i++)
+    {
+        core->KeyPressed(GG_CONTROLLER_1, GG_KEY_RIGHT);
+        run_frames(core, OFFLINE_RENDER_TRACK_PULSE_FRAMES, sample_buffer);
+        core->KeyReleased(GG_CONTROLLER_1, GG_KEY_RIGHT);
+        run_frames(core, OFFLINE_RENDER_TRACK_PULSE_FRAMES, sample_buffer);
+    }
+
+    Log("Selected track %d", track);
+}
+
+static void run_frames(GeargrafxCore* core, int frames, s16* sample_buffer)
+{
+    for (int i = 0; i < frames; i++)
+    {
+        int sample_count = 0;
+        core->RunToVBlank(NULL, sample_buffer, &sample_count, NULL, false);
+    }
+}
+
+// The loop is only known some time after it has started, so the track is
+// played once without output to find it. Then the core goes back to the
+// start of the track and renders exactly up to the last loop point.
+static int find_end_frame(GeargrafxCore* core, const OfflineRenderParams& params, s16* sample_buffer)
+{
+    size_t size = core->GetSaveStateSize();
+    std::vector<u8> state(size);
+
+    if (!core->SaveState(state.data(), size))
+    {
+        Log("WARNING: Unable to save the track start, loop detection disabled");
+        return params.frames;
+    }
+
+    Audio* audio = core->GetAudio();
+    LoopDetector detector;
+    LoopDetector::Result result = LoopDetector::RESULT_NONE;
+
+    for (int frame = 0; (frame < params.frames) && (result == LoopDetector::RESULT_NONE); frame++)
+    {
+        int sample_count = 0;
+        core->RunToVBlank(NULL, sample_buffer, &sample_count, NULL, false);
+        result = detector.Update(audio->GetPSG(), sample_buffer, sample_count);
+    }
+
+    if (!core->LoadState(state.data(), size))
+    {
+        Log("WARNING: Unable to restore the track start, loop detection disabled");
+        return params.frames;
+    }
+
+    switch (result)
+    {
+        case LoopDetector::RESULT_LOOP:
+            Log("Loop detected: starts at frame %d, %d frames long", detector.GetLoopStart(), detector.GetLoopLength());
+            break;
+        case LoopDetector::RESULT_SILENCE:
+            Log("Song ends in silence at frame %d", detector.GetSilenceStart());
+            break;
+        default:
+            Log("No loop detected, stopping at the frame limit");
+            break;
+    }
+
+    return detector.GetEndFrame(params.loops, params.frames);
+}
@@ -0,0 +1,36 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef OFFLINE_RENDER_H
+#define OFFLINE_RENDER_H
+
+struct OfflineRenderParams
+{
+    const char* rom_file = NULL;
+    const char* stems_dir = NULL;
+    const char* wav_file = NULL;
+    const char* vgm_file = NULL;
+    int frames = 3600;
+    int track = 0;
+    int loops = 0;
+};
+
+int offline_render_run(const OfflineRenderParams& params);
+
+#endif /* OFFLINE_RENDER_H */
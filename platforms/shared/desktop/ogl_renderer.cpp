@@ -387,6 +387,8 @@ static void render_external_shader_chain(void)
 
     for (int i = 0; i < pass_count; i++)
     {
+        GG_PROFILE_ZONE("ShaderChain::Pass");
+
         int output_width = screen_geometry.physical_width;
         int output_height = screen_geometry.physical_height;
         bool final_pass = i == pass_count - 1;
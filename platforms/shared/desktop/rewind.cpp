@@ -26,28 +26,56 @@
 #define REWIND_IMPORT
 #include "rewind.h"
 
-#define REWIND_SCREENSHOT_WIDTH        2048
-#define REWIND_SCREENSHOT_HEIGHT       256
-
-static u8* buffer = NULL;
-static size_t sizes[REWIND_MAX_SNAPSHOTS] = { 0 };
-static int head = 0;
-static int count = 0;
-static int capacity = 0;
+// Snapshots are kept as XOR deltas against the next newer snapshot, so
+// the oldest one can always be dropped. A full keyframe every
+// REWIND_KEYFRAME_INTERVAL snapshots bounds the cost of seeking.
+#define REWIND_KEYFRAME_INTERVAL       60
+
+struct Rewind_Record
+{
+    size_t offset;
+    u32 size;
+    u32 state_size;
+    bool keyframe;
+};
+
+static u8* ring = NULL;
+static size_t ring_size = 0;
+static size_t write_pos = 0;
+static Rewind_Record* records = NULL;
+static int record_capacity = 0;
+static int record_head = 0;
+static int record_count = 0;
+static int records_since_keyframe = 0;
+static u8* newest_state = NULL;
+static size_t newest_size = 0;
+static bool has_newest = false;
+static u8* work_state = NULL;
+static u8* encode_buffer = NULL;
+static size_t state_capacity = 0;
 static int frame_accum = 0;
 static bool active = false;
 static bool storage_dirty = true;
 static int seek_age = -1;
-static size_t slot_size = 0;
 static size_t allocated_size = 0;
 
-static int slot_at(int age);
+static int record_at(int age);
 static int get_target_capacity(void);
-static size_t get_target_slot_size(void);
+static size_t get_target_state_capacity(void);
+static size_t get_target_ring_size(void);
 static bool ensure_storage(void);
 static void release_storage(void);
+static void clear_history(void);
+static bool store_record(const u8* state, u32 state_size, const u8* newer_state, bool keyframe);
+static size_t allocate_record(size_t size);
+static void drop_oldest_record(void);
+static void count_records_since_keyframe(void);
+static bool reconstruct(int age, u8* out, size_t* out_size);
+static size_t delta_encode(const u8* state, const u8* reference, size_t size, u8* out);
+static void delta_decode(const u8* data, size_t data_size, u8* state, size_t size, bool keyframe);
 static void truncate_to_seek_position(void);
-static void restore_screenshot(const u8* slot, size_t size);
+static bool save_snapshot(u8* buffer, size_t* size);
+static bool load_snapshot(const u8* buffer, size_t size);
 
 bool rewind_init(void)
 {
@@ -58,8 +86,7 @@ bool rewind_init(void)
 void rewind_destroy(void)
 {
     release_storage();
-    count = 0;
-    head = 0;
+    clear_history();
     frame_accum = 0;
     active = false;
     storage_dirty = true;
@@ -68,14 +95,11 @@ void rewind_destroy(void)
 
 void rewind_reset(void)
 {
-    head = 0;
-    count = 0;
+    clear_history();
     frame_accum = 0;
     active = false;
     storage_dirty = true;
     seek_age = -1;
-    for (int i = 0; i < REWIND_MAX_SNAPSHOTS; i++)
-        sizes[i] = 0;
 
     if (!config_rewind.enabled || emu_is_empty())
     {
@@ -83,7 +107,6 @@ void rewind_reset(void)
         return;
     }
 
-    capacity = get_target_capacity();
     ensure_storage();
 }
 
@@ -91,7 +114,7 @@ void rewind_push(void)
 {
     if (!config_rewind.enabled)
         return;
-    if (!IsValidPointer(buffer))
+    if (!IsValidPointer(ring))
         return;
     if (emu_is_empty() || emu_is_paused())
         return;
@@ -106,74 +129,83 @@ void rewind_push(void)
     if (!ensure_storage())
         return;
 
-    u8* slot = buffer + ((size_t)head * slot_size);
-    size_t size = slot_size;
+    size_t size = 0;
 
-    if (!emu_get_core()->SaveState(slot, size, true))
+    if (!save_snapshot(work_state, &size))
     {
+        // The state outgrew the buffers (e.g. MB128 just connected)
         storage_dirty = true;
         if (!ensure_storage())
             return;
 
-        slot = buffer + ((size_t)head * slot_size);
-        size = slot_size;
-        if (!emu_get_core()->SaveState(slot, size, true))
+        if (!save_snapshot(work_state, &size))
         {
-            Log("Rewind: failed to save snapshot into %zu-byte slot", slot_size);
+            Log("Rewind: failed to save snapshot into %zu-byte buffer", state_capacity);
             return;
         }
     }
 
-    sizes[head] = size;
-    head = (head + 1) % capacity;
-    if (count < capacity)
-        count++;
+    if (has_newest)
+    {
+        bool keyframe = (records_since_keyframe >= REWIND_KEYFRAME_INTERVAL - 1) || (newest_size != size);
+
+        if (store_record(newest_state, (u32)newest_size, keyframe ? NULL : work_state, keyframe))
+            records_since_keyframe = keyframe ? 0 : records_since_keyframe + 1;
+        else
+            clear_history();
+    }
+
+    u8* previous = newest_state;
+    newest_state = work_state;
+    work_state = previous;
+    newest_size = size;
+    has_newest = true;
 }
 
 bool rewind_pop(void)
 {
-    if (count == 0)
+    if (!has_newest)
         return false;
-    if (!IsValidPointer(buffer))
+    if (!IsValidPointer(ring))
         return false;
 
-    int idx = slot_at(0);
-    const u8* slot = buffer + ((size_t)idx * slot_size);
-    size_t size = sizes[idx];
-
-    bool ok = emu_get_core()->LoadState(slot, size);
+    bool ok = load_snapshot(newest_state, newest_size);
 
-    if (ok)
+    // The next older snapshot becomes the newest one
+    if (record_count > 0)
     {
-        restore_screenshot(slot, size);
-        events_sync_input();
+        int idx = record_at(1);
+        Rewind_Record* record = &records[idx];
+        delta_decode(ring + record->offset, record->size, newest_state, record->state_size, record->keyframe);
+        newest_size = record->state_size;
+
+        record_head = idx;
+        record_count--;
+        write_pos = (record_count > 0) ? records[record_at(1)].offset + records[record_at(1)].size : 0;
+        count_records_since_keyframe();
     }
+    else
+        has_newest = false;
 
-    head = idx;
-    count--;
     seek_age = -1;
     return ok;
 }
 
 bool rewind_seek(int age)
 {
-    if (age < 0 || age >= count)
+    if (age < 0 || age >= rewind_get_snapshot_count())
         return false;
-    if (!IsValidPointer(buffer))
+    if (!IsValidPointer(ring))
         return false;
 
-    int idx = slot_at(age);
-    const u8* slot = buffer + ((size_t)idx * slot_size);
-    size_t size = sizes[idx];
+    size_t size = 0;
+    if (!reconstruct(age, work_state, &size))
+        return false;
 
-    bool ok = emu_get_core()->LoadState(slot, size);
+    bool ok = load_snapshot(work_state, size);
 
     if (ok)
-    {
-        restore_screenshot(slot, size);
-        events_sync_input();
         seek_age = age;
-    }
 
     return ok;
 }
@@ -197,7 +229,7 @@ bool rewind_is_active(void)
 
 int rewind_get_snapshot_count(void)
 {
-    return count;
+    return has_newest ? record_count + 1 : 0;
 }
 
 int rewind_get_capacity(void)
@@ -215,11 +247,23 @@ size_t rewind_get_memory_usage(void)
     return allocated_size;
 }
 
-static int slot_at(int age)
+size_t rewind_get_memory_used(void)
 {
-    int idx = head - 1 - age;
+    size_t used = has_newest ? newest_size : 0;
+
+    for (int age = 1; age <= record_count; age++)
+        used += records[record_at(age)].size;
+
+    return used;
+}
+
+// Records are indexed by snapshot age: age 0 is the newest snapshot, which
+// lives uncompressed in newest_state, so records start at age 1
+static int record_at(int age)
+{
+    int idx = record_head - age;
     while (idx < 0)
-        idx += capacity;
+        idx += record_capacity;
     return idx;
 }
 
@@ -238,21 +282,21 @@ static int get_target_capacity(void)
     return target;
 }
 
-static size_t get_target_slot_size(void)
+static size_t get_target_state_capacity(void)
 {
     if (emu_is_empty())
         return 0;
 
-    size_t base_size = 0;
-    if (!emu_get_core()->SaveState(NULL, base_size, false))
+    size_t base_size = emu_get_core()->GetSaveStateSize(false);
+    if (base_size == 0)
         return 0;
 
-    int bytes_per_pixel = 4;
-    if (emu_get_core()->GetHuC6260()->GetPixelFormat() == GG_PIXEL_RGB565)
-        bytes_per_pixel = 2;
+    return base_size + emu_get_core()->GetMaxFrameSize() + sizeof(u32);
+}
 
-    size_t screenshot_capacity = (size_t)REWIND_SCREENSHOT_WIDTH * REWIND_SCREENSHOT_HEIGHT * bytes_per_pixel;
-    return base_size + screenshot_capacity;
+static size_t get_target_ring_size(void)
+{
+    return (size_t)config_rewind.memory_mb * 1024 * 1024;
 }
 
 static bool ensure_storage(void)
@@ -264,53 +308,305 @@ static bool ensure_storage(void)
     }
 
     int target_capacity = get_target_capacity();
-    if (!storage_dirty && IsValidPointer(buffer) && (capacity == target_capacity))
+    size_t target_ring_size = get_target_ring_size();
+    if (!storage_dirty && IsValidPointer(ring) && (record_capacity == target_capacity) && (ring_size == target_ring_size))
         return true;
 
-    size_t target_slot_size = get_target_slot_size();
-    if (target_slot_size == 0)
+    size_t target_state_capacity = get_target_state_capacity();
+    if (target_state_capacity == 0)
         return false;
 
-    if (storage_dirty && IsValidPointer(buffer) && (capacity == target_capacity) && (slot_size >= target_slot_size))
+    if (IsValidPointer(ring) && (record_capacity == target_capacity) && (ring_size == target_ring_size) && (state_capacity >= target_state_capacity))
     {
         storage_dirty = false;
         return true;
     }
 
-    size_t target_size = (size_t)target_capacity * target_slot_size;
-    u8* new_buffer = new (std::nothrow) u8[target_size];
-    if (!IsValidPointer(new_buffer))
+    // Worst case encoding is a single literal run plus its two varints
+    size_t target_encode_size = target_state_capacity + 16;
+    size_t total_size = target_ring_size + (2 * target_state_capacity) + target_encode_size + ((size_t)target_capacity * sizeof(Rewind_Record));
+
+    release_storage();
+
+    ring = new (std::nothrow) u8[target_ring_size];
+    newest_state = new (std::nothrow) u8[target_state_capacity];
+    work_state = new (std::nothrow) u8[target_state_capacity];
+    encode_buffer = new (std::nothrow) u8[target_encode_size];
+    records = new (std::nothrow) Rewind_Record[target_capacity];
+
+    if (!IsValidPointer(ring) || !IsValidPointer(newest_state) || !IsValidPointer(work_state) || !IsValidPointer(encode_buffer) || !IsValidPointer(records))
     {
-        Log("Rewind: failed to allocate %zu bytes", target_size);
+        Log("Rewind: failed to allocate %zu bytes", total_size);
+        release_storage();
         return false;
     }
 
-    SafeDeleteArray(buffer);
-    buffer = new_buffer;
-    allocated_size = target_size;
-    slot_size = target_slot_size;
-    capacity = target_capacity;
-    head = 0;
-    count = 0;
+    allocated_size = total_size;
+    ring_size = target_ring_size;
+    state_capacity = target_state_capacity;
+    record_capacity = target_capacity;
+    clear_history();
     frame_accum = 0;
     active = false;
     storage_dirty = false;
     seek_age = -1;
-    for (int i = 0; i < REWIND_MAX_SNAPSHOTS; i++)
-        sizes[i] = 0;
 
-    Log("Rewind: allocated %.1f MB ring buffer (%d snapshots, %zu-byte slots)",
-        (double)target_size / (1024.0 * 1024.0), target_capacity, target_slot_size);
+    Log("Rewind: allocated %.1f MB delta ring buffer (up to %d snapshots, %zu-byte states)",
+        (double)total_size / (1024.0 * 1024.0), target_capacity, target_state_capacity);
 
     return true;
 }
 
 static void release_storage(void)
 {
-    SafeDeleteArray(buffer);
+    SafeDeleteArray(ring);
+    SafeDeleteArray(newest_state);
+    SafeDeleteArray(work_state);
+    SafeDeleteArray(encode_buffer);
+    SafeDeleteArray(records);
     allocated_size = 0;
-    slot_size = 0;
-    capacity = 0;
+    ring_size = 0;
+    state_capacity = 0;
+    record_capacity = 0;
+    clear_history();
+}
+
+static void clear_history(void)
+{
+    write_pos = 0;
+    record_head = 0;
+    record_count = 0;
+    records_since_keyframe = 0;
+    newest_size = 0;
+    has_newest = false;
+}
+
+static bool store_record(const u8* state, u32 state_size, const u8* newer_state, bool keyframe)
+{
+    size_t size = delta_encode(state, newer_state, state_size, encode_buffer);
+
+    if (size > ring_size)
+    {
+        Log("Rewind: %zu-byte snapshot does not fit in the ring buffer", size);
+        return false;
+    }
+
+    if (record_capacity < 2)
+        return true;
+
+    if (record_count >= record_capacity - 1)
+        drop_oldest_record();
+
+    size_t offset = allocate_record(size);
+    memcpy(ring + offset, encode_buffer, size);
+
+    Rewind_Record* record = &records[record_head];
+    record->offset = offset;
+    record->size = (u32)size;
+    record->state_size = state_size;
+    record->keyframe = keyframe;
+
+    record_head = (record_head + 1) % record_capacity;
+    record_count++;
+    write_pos = offset + size;
+
+    return true;
+}
+
+// Finds room for a record after the newest one, dropping the oldest
+// records until it fits. Records are laid out in age order and wrap to the
+// start of the ring at most once.
+static size_t allocate_record(size_t size)
+{
+    while (record_count > 0)
+    {
+        size_t tail = records[record_at(record_count)].offset;
+
+        if (write_pos > tail)
+        {
+            if (write_pos + size <= ring_size)
+                return write_pos;
+            if (size <= tail)
+                return 0;
+        }
+        else if (write_pos + size <= tail)
+            return write_pos;
+
+        drop_oldest_record();
+    }
+
+    write_pos = 0;
+    return 0;
+}
+
+static void drop_oldest_record(void)
+{
+    if (record_count == 0)
+        return;
+
+    record_count--;
+
+    if (record_count == 0)
+        write_pos = 0;
+}
+
+static void count_records_since_keyframe(void)
+{
+    records_since_keyframe = 0;
+
+    for (int age = 1; age <= record_count; age++)
+    {
+        if (records[record_at(age)].keyframe)
+            break;
+        records_since_keyframe++;
+    }
+}
+
+// Rebuilds the snapshot at the given age starting from the closest newer
+// keyframe, or from the newest snapshot when there is none in between
+static bool reconstruct(int age, u8* out, size_t* out_size)
+{
+    if (!has_newest || (age > record_count))
+        return false;
+
+    int start = 0;
+
+    for (int a = age; a >= 1; a--)
+    {
+        if (records[record_at(a)].keyframe)
+        {
+            start = a;
+            break;
+        }
+    }
+
+    size_t size = newest_size;
+
+    if (start == 0)
+        memcpy(out, newest_state, newest_size);
+    else
+    {
+        Rewind_Record* record = &records[record_at(start)];
+        delta_decode(ring + record->offset, record->size, out, record->state_size, true);
+        size = record->state_size;
+    }
+
+    for (int a = start + 1; a <= age; a++)
+    {
+        Rewind_Record* record = &records[record_at(a)];
+        delta_decode(ring + record->offset, record->size, out, record->state_size, record->keyframe);
+        size = record->state_size;
+    }
+
+    *out_size = size;
+    return true;
+}
+
+static inline u64 load_word(const u8* p)
+{
+    u64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline u8* write_varint(u8* out, size_t value)
+{
+    while (value >= 0x80)
+    {
+        *out++ = (u8)(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (u8)value;
+    return out;
+}
+
+static inline const u8* read_varint(const u8* in, size_t* value)
+{
+    size_t result = 0;
+    int shift = 0;
+
+    while (*in & 0x80)
+    {
+        result |= (size_t)(*in++ & 0x7F) << shift;
+        shift += 7;
+    }
+    result |= (size_t)(*in++) << shift;
+
+    *value = result;
+    return in;
+}
+
+// Encodes state XOR reference (or state alone for keyframes) as a list of
+// (zero run, literal run, literal bytes). Runs are measured in 8-byte words,
+// the unaligned tail always goes out as a literal.
+static size_t delta_encode(const u8* state, const u8* reference, size_t size, u8* out)
+{
+    const size_t word = sizeof(u64);
+    size_t words_end = size - (size % word);
+    size_t i = 0;
+    u8* o = out;
+
+    while (i < size)
+    {
+        size_t zero_start = i;
+
+        while ((i < words_end) && ((load_word(state + i) ^ (IsValidPointer(reference) ? load_word(reference + i) : 0)) == 0))
+            i += word;
+
+        size_t literal_start = i;
+
+        while ((i < words_end) && ((load_word(state + i) ^ (IsValidPointer(reference) ? load_word(reference + i) : 0)) != 0))
+            i += word;
+
+        if (i == words_end)
+            i = size;
+
+        o = write_varint(o, literal_start - zero_start);
+        o = write_varint(o, i - literal_start);
+
+        if (IsValidPointer(reference))
+        {
+            for (size_t j = literal_start; j < i; j++)
+                *o++ = state[j] ^ reference[j];
+        }
+        else
+        {
+            memcpy(o, state + literal_start, i - literal_start);
+            o += i - literal_start;
+        }
+    }
+
+    return (size_t)(o - out);
+}
+
+static void delta_decode(const u8* data, size_t data_size, u8* state, size_t size, bool keyframe)
+{
+    const u8* in = data;
+    const u8* end = data + data_size;
+    size_t i = 0;
+
+    while ((in < end) && (i < size))
+    {
+        size_t zero_run = 0;
+        size_t literal_run = 0;
+        in = read_varint(in, &zero_run);
+        in = read_varint(in, &literal_run);
+
+        if (keyframe)
+            memset(state + i, 0, zero_run);
+        i += zero_run;
+
+        if (keyframe)
+            memcpy(state + i, in, literal_run);
+        else
+        {
+            for (size_t j = 0; j < literal_run; j++)
+                state[i + j] ^= in[j];
+        }
+
+        i += literal_run;
+        in += literal_run;
+    }
 }
 
 static void truncate_to_seek_position(void)
@@ -321,34 +617,61 @@ static void truncate_to_seek_position(void)
         return;
     }
 
-    int idx = slot_at(seek_age);
-    head = (idx + 1) % capacity;
-    count -= seek_age;
+    size_t size = 0;
+    if (reconstruct(seek_age, work_state, &size))
+    {
+        u8* previous = newest_state;
+        newest_state = work_state;
+        work_state = previous;
+        newest_size = size;
+        record_head = record_at(seek_age);
+        record_count -= seek_age;
+        write_pos = (record_count > 0) ? records[record_at(1)].offset + records[record_at(1)].size : 0;
+        count_records_since_keyframe();
+    }
+
     seek_age = -1;
 }
 
-static void restore_screenshot(const u8* slot, size_t size)
+// Snapshots hold a save state without screenshot, followed by the compact
+// VCE frame and the size of the state part
+static bool save_snapshot(u8* buffer, size_t* size)
 {
-    if (size <= sizeof(GG_SaveState_Header))
-        return;
+    GeargrafxCore* core = emu_get_core();
 
-    GG_SaveState_Header header;
-    memcpy(&header, slot + size - sizeof(GG_SaveState_Header), sizeof(header));
+    size_t state_size = state_capacity - sizeof(u32);
+    if (!core->SaveState(buffer, state_size, false))
+        return false;
 
-    if (header.magic != GG_SAVESTATE_MAGIC)
-        return;
-    if (header.screenshot_size == 0)
-        return;
+    size_t frame_size = state_capacity - sizeof(u32) - state_size;
+    if (!core->SaveFrame(buffer + state_size, frame_size))
+        return false;
 
-    size_t max_screenshot_size = (size_t)REWIND_SCREENSHOT_WIDTH * REWIND_SCREENSHOT_HEIGHT * 4;
-    if (header.screenshot_size > max_screenshot_size)
-        return;
+    u32 stored_state_size = (u32)state_size;
+    memcpy(buffer + state_size + frame_size, &stored_state_size, sizeof(stored_state_size));
 
-    if (header.screenshot_size > (size - sizeof(GG_SaveState_Header)))
-        return;
+    *size = state_size + frame_size + sizeof(stored_state_size);
+    return true;
+}
+
+static bool load_snapshot(const u8* buffer, size_t size)
+{
+    if (size <= sizeof(u32))
+        return false;
+
+    u32 state_size = 0;
+    memcpy(&state_size, buffer + size - sizeof(state_size), sizeof(state_size));
+
+    if (state_size > size - sizeof(state_size))
+        return false;
 
-    size_t screenshot_offset = size - sizeof(GG_SaveState_Header) - header.screenshot_size;
-    const u8* screenshot_data = slot + screenshot_offset;
+    GeargrafxCore* core = emu_get_core();
 
-    memcpy(emu_frame_buffer, screenshot_data, header.screenshot_size);
+    if (!core->LoadState(buffer, state_size))
+        return false;
+
+    core->LoadFrame(buffer + state_size, size - sizeof(state_size) - state_size, emu_frame_buffer);
+    events_sync_input();
+
+    return true;
 }
@@ -28,9 +28,10 @@
     #define EXTERN extern
 #endif
 
-// Absolute hard cap for the ring buffer. Effective capacity is derived from
-// config_rewind (buffer_seconds / frames_per_snapshot) and clamped to this.
-#define REWIND_MAX_SNAPSHOTS        600
+// Absolute hard cap for the snapshot count. Effective capacity is derived
+// from config_rewind (buffer_seconds / frames_per_snapshot) and clamped to
+// this; the memory actually used is bounded by config_rewind.memory_mb.
+#define REWIND_MAX_SNAPSHOTS        36000
 
 EXTERN bool rewind_init(void);
 EXTERN void rewind_destroy(void);
@@ -45,6 +46,7 @@ EXTERN int rewind_get_snapshot_count(void);
 EXTERN int rewind_get_capacity(void);
 EXTERN int rewind_get_frames_per_snapshot(void);
 EXTERN size_t rewind_get_memory_usage(void);
+EXTERN size_t rewind_get_memory_used(void);
 
 #undef REWIND_IMPORT
 #undef EXTERN
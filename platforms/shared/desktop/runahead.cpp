@@ -17,29 +17,70 @@
  *
  */
 
+#include <string.h>
+#include <string>
 #include "emu.h"
 #include "config.h"
 #include "geargrafx.h"
+#include "utils.h"
 
 #define RUNAHEAD_IMPORT
 #include "runahead.h"
 
+struct Runahead_Input
+{
+    u16 gamepads[GG_MAX_GAMEPADS];
+    s32 mouse_x;
+    s32 mouse_y;
+};
+
 static u8* runahead_buffer = NULL;
-static s16* runahead_audio = NULL;
 static size_t runahead_buffer_size = 0;
 
+struct Runahead_Shadow_Settings
+{
+    std::string media_path;
+    u32 media_crc;
+    GG_Console_Type console_type;
+    GG_CDROM_Type cdrom_type;
+    bool preload_cdrom;
+    bool precache_chd_decode;
+    bool force_backup_ram;
+    std::string syscard_bios_path;
+    std::string gameexpress_bios_path;
+};
+
+static GeargrafxCore* shadow_core = NULL;
+static Runahead_Shadow_Settings shadow_settings;
+static bool shadow_media_failed = false;
+static bool shadow_synced = false;
+static int shadow_frames = 0;
+static u64 primary_cycles = 0;
+static Runahead_Input primary_input;
+
+static void run_single_instance(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count);
+static void run_second_instance(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count);
+static bool prepare_shadow(void);
+static void destroy_shadow(void);
+static void read_shadow_settings(Runahead_Shadow_Settings* settings);
+static bool same_shadow_settings(const Runahead_Shadow_Settings& a, const Runahead_Shadow_Settings& b);
+static std::string shadow_temp_path(void);
+static void read_input(GeargrafxCore* core, Runahead_Input* input);
 static bool ensure_buffer(void);
 
 void runahead_init(void)
 {
-    runahead_audio = new s16[GG_AUDIO_BUFFER_SIZE];
     runahead_buffer = NULL;
     runahead_buffer_size = 0;
+    shadow_core = NULL;
+    shadow_settings = Runahead_Shadow_Settings();
+    shadow_media_failed = false;
+    shadow_synced = false;
 }
 
 void runahead_destroy(void)
 {
-    SafeDeleteArray(runahead_audio);
+    destroy_shadow();
     SafeDeleteArray(runahead_buffer);
     runahead_buffer_size = 0;
 }
@@ -61,6 +102,19 @@ int runahead_get_frames(void)
 }
 
 void runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count)
+{
+    if (config_emulator.runahead_second_instance && prepare_shadow())
+    {
+        run_second_instance(frames, frame_buffer, sample_buffer, sample_count);
+    }
+    else
+    {
+        destroy_shadow();
+        run_single_instance(frames, frame_buffer, sample_buffer, sample_count);
+    }
+}
+
+static void run_single_instance(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count)
 {
     GeargrafxCore* core = emu_get_core();
 
@@ -80,13 +134,12 @@ void runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_
         return;
     }
 
-    // Run the speculative frames with the same input, discarding their audio
-    // and keeping only the last rendered frame.
+    // Run the speculative frames with the same input. They produce no audio
+    // and only the last one is rendered.
     for (int i = 0; i < frames; i++)
     {
-        int discarded_samples = 0;
         bool render = (i == (frames - 1));
-        core->RunToVBlank(frame_buffer, runahead_audio, &discarded_samples, NULL, render);
+        core->RunToVBlankSpeculative(render ? frame_buffer : NULL);
     }
 
     // Roll back to the authoritative frame. If restoring ever fails, the
@@ -100,10 +153,188 @@ void runahead_run(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_
     }
 }
 
+static void run_second_instance(int frames, u8* frame_buffer, s16* sample_buffer, int* sample_count)
+{
+    GeargrafxCore* core = emu_get_core();
+
+    // The shadow is already 'frames' ahead of the primary and only needs to
+    // advance one more frame, unless the input changed or the primary was
+    // moved outside of run-ahead (load state, reset, rewind, debugger...).
+    Runahead_Input input;
+    read_input(core, &input);
+
+    bool resync = !shadow_synced || (shadow_frames != frames) ||
+            (core->GetMasterClockCycles() != primary_cycles) ||
+            (memcmp(&input, &primary_input, sizeof(input)) != 0);
+
+    if (resync && !IsValidPointer(runahead_buffer) && !ensure_buffer())
+        return;
+
+    // Run the authoritative frame, keeping its audio. Its picture is never
+    // shown because the shadow provides the displayed frame.
+    core->RunToVBlank(frame_buffer, sample_buffer, sample_count, NULL, false);
+
+    // The input pump may have delivered new input during the frame.
+    read_input(core, &primary_input);
+    resync = resync || (memcmp(&input, &primary_input, sizeof(input)) != 0);
+    primary_cycles = core->GetMasterClockCycles();
+
+    shadow_core->CopySettings(core);
+
+    int shadow_run = 1;
+
+    if (resync)
+    {
+        size_t saved_size = runahead_buffer_size;
+        if (!core->SaveState(runahead_buffer, saved_size, false))
+        {
+            // The state outgrew the buffer, grow it and retry next frame.
+            shadow_synced = false;
+            ensure_buffer();
+            return;
+        }
+
+        if (!shadow_core->LoadState(runahead_buffer, saved_size))
+        {
+            Log("Run-ahead: failed to sync the second instance, using single instance");
+            shadow_synced = false;
+            shadow_media_failed = true;
+            destroy_shadow();
+            return;
+        }
+
+        shadow_run = frames;
+        shadow_frames = frames;
+        shadow_synced = true;
+    }
+
+    for (int i = 0; i < shadow_run; i++)
+    {
+        bool render = (i == (shadow_run - 1));
+        shadow_core->RunToVBlankSpeculative(render ? frame_buffer : NULL);
+    }
+}
+
+static bool prepare_shadow(void)
+{
+    Runahead_Shadow_Settings settings;
+    read_shadow_settings(&settings);
+
+    // Console, CD-ROM and BIOS settings only apply when media is loaded, so
+    // any change rebuilds the second instance like a media change does.
+    bool same_settings = same_shadow_settings(settings, shadow_settings);
+
+    if (same_settings && IsValidPointer(shadow_core))
+        return true;
+
+    // Do not retry loading media that already failed in the second instance.
+    if (same_settings && shadow_media_failed)
+        return false;
+
+    destroy_shadow();
+    shadow_settings = settings;
+    shadow_media_failed = true;
+
+    const char* path = settings.media_path.c_str();
+
+    if (path[0] == 0)
+        return false;
+
+    // Zipped CD-ROM images are extracted into the temp folder, keep the
+    // second instance away from the primary's copy.
+    std::string temp_path = shadow_temp_path();
+    create_directory_if_not_exists(temp_path.c_str());
+
+    GeargrafxCore* primary = emu_get_core();
+    shadow_core = new GeargrafxCore();
+    shadow_core->Init(NULL, primary->GetHuC6260()->GetPixelFormat());
+    shadow_core->GetMedia()->SetTempPath(temp_path.c_str());
+    shadow_core->GetMedia()->SetConsoleType(settings.console_type);
+    shadow_core->GetMedia()->SetCDROMType(settings.cdrom_type);
+    shadow_core->GetMedia()->PreloadCdRom(settings.preload_cdrom);
+    shadow_core->GetMedia()->PrecacheChdDecode(settings.precache_chd_decode);
+    shadow_core->GetMedia()->ForceBackupRAM(settings.force_backup_ram);
+
+    if (!settings.syscard_bios_path.empty())
+        shadow_core->LoadBios(settings.syscard_bios_path.c_str(), true);
+
+    if (!settings.gameexpress_bios_path.empty())
+        shadow_core->LoadBios(settings.gameexpress_bios_path.c_str(), false);
+
+    if (!shadow_core->LoadMedia(path))
+    {
+        Log("Run-ahead: unable to load media in the second instance, using single instance");
+        destroy_shadow();
+        return false;
+    }
+
+    Debug("Run-ahead: second instance ready for %s", path);
+    shadow_media_failed = false;
+    return true;
+}
+
+static void destroy_shadow(void)
+{
+    if (IsValidPointer(shadow_core))
+    {
+        SafeDelete(shadow_core);
+        // Only once the core is gone, its extracted images may still be open.
+        remove_directory_and_contents(shadow_temp_path().c_str());
+    }
+
+    shadow_synced = false;
+}
+
+static void read_shadow_settings(Runahead_Shadow_Settings* settings)
+{
+    Media* media = emu_get_core()->GetMedia();
+
+    settings->media_path = media->GetFilePath();
+    settings->media_crc = media->GetCRC();
+    settings->console_type = media->GetConsoleType();
+    settings->cdrom_type = media->GetCDROMType();
+    settings->preload_cdrom = media->IsPreloadCdRomEnabled();
+    settings->precache_chd_decode = media->IsPrecacheChdDecodeEnabled();
+    settings->force_backup_ram = media->IsBackupRAMForced();
+    settings->syscard_bios_path = config_emulator.syscard_bios_path;
+    settings->gameexpress_bios_path = config_emulator.gameexpress_bios_path;
+}
+
+static bool same_shadow_settings(const Runahead_Shadow_Settings& a, const Runahead_Shadow_Settings& b)
+{
+    return (a.media_path == b.media_path) &&
+            (a.media_crc == b.media_crc) &&
+            (a.console_type == b.console_type) &&
+            (a.cdrom_type == b.cdrom_type) &&
+            (a.preload_cdrom == b.preload_cdrom) &&
+            (a.precache_chd_decode == b.precache_chd_decode) &&
+            (a.force_backup_ram == b.force_backup_ram) &&
+            (a.syscard_bios_path == b.syscard_bios_path) &&
+            (a.gameexpress_bios_path == b.gameexpress_bios_path);
+}
+
+static std::string shadow_temp_path(void)
+{
+    return std::string(config_temp_path) + "runahead/";
+}
+
+static void read_input(GeargrafxCore* core, Runahead_Input* input)
+{
+    Input* core_input = core->GetInput();
+
+    // Cleared as a whole so padding never breaks the memcmp comparisons.
+    memset(input, 0, sizeof(Runahead_Input));
+
+    for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+        input->gamepads[i] = core_input->GetGamepadState((GG_Controllers)i);
+
+    core_input->GetMouseDelta(&input->mouse_x, &input->mouse_y);
+}
+
 static bool ensure_buffer(void)
 {
-    size_t needed = 0;
-    if (!emu_get_core()->SaveState(NULL, needed, false) || (needed == 0))
+    size_t needed = emu_get_core()->GetSaveStateSize(false);
+    if (needed == 0)
         return false;
 
     // The buffer is allocated once and only ever grows, so it is reused every
@@ -0,0 +1,391 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#include "geargrafx.h"
+
+#define SAVE_WRITER_IMPORT
+#include "save_writer.h"
+
+// Completed results are kept until the GUI polls them. Only the newest ones
+// are kept when nobody is polling. Jobs queued with 'wait' also keep their
+// own result until save_writer_wait or save_writer_try_wait takes it.
+#define SAVE_WRITER_MAX_RESULTS 32
+
+struct Save_Writer_Job
+{
+    u32 id;
+    Save_Writer_Kind kind;
+    int slot;
+    bool wait;
+    std::string path;
+    std::vector<u8> data;
+    std::vector<u32> chunk_sizes;
+};
+
+static std::thread worker;
+static std::mutex mutex;
+static std::condition_variable jobs_cv;
+static std::condition_variable done_cv;
+static std::deque<Save_Writer_Job> jobs;
+static std::deque<Save_Writer_Result> results;
+static std::map<u32, Save_Writer_Result> waited_results;
+static u32 next_id = 1;
+static u32 completed_id = 0;
+static int pending = 0;
+static bool running = false;
+
+static u32 queue_job(Save_Writer_Kind kind, const std::string& path, std::vector<u8>& data, const u32* chunk_sizes, int slot, bool wait);
+static bool take_result(u32 id, Save_Writer_Result* result);
+static void worker_func(void);
+static void take_job(Save_Writer_Job& dest, Save_Writer_Job& source);
+static void complete_job(const Save_Writer_Job& job, bool success);
+static bool write_job(Save_Writer_Job& job);
+static bool write_file(const std::string& path, const std::vector<u8>& data);
+static bool sync_file(FILE* file);
+static bool replace_file(const std::string& tmp_path, const std::string& path);
+
+void save_writer_init(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (running)
+        return;
+
+    running = true;
+    worker = std::thread(worker_func);
+}
+
+void save_writer_destroy(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+            return;
+        running = false;
+    }
+
+    jobs_cv.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    results.clear();
+    waited_results.clear();
+}
+
+u32 save_writer_queue(Save_Writer_Kind kind, const std::string& path, std::vector<u8>& data, int slot, bool wait)
+{
+    return queue_job(kind, path, data, NULL, slot, wait);
+}
+
+// Save states are queued flat and encoded into the chunked file format
+// on the worker thread, so compression stays off the emulation thread
+u32 save_writer_queue_state(const std::string& path, std::vector<u8>& state, const u32* chunk_sizes, int slot, bool wait)
+{
+    return queue_job(Save_Writer_State, path, state, chunk_sizes, slot, wait);
+}
+
+// Blocks until the job is written. Only jobs queued with 'wait' are sure to
+// report their real outcome, and only to the first caller.
+bool save_writer_wait(u32 id, Save_Writer_Result* result)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (completed_id < id)
+        done_cv.wait(lock);
+
+    return take_result(id, result);
+}
+
+// Returns false while the job is still pending, otherwise takes its result
+// like save_writer_wait. The outcome is in result->success.
+bool save_writer_try_wait(u32 id, Save_Writer_Result* result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (completed_id < id)
+        return false;
+
+    take_result(id, result);
+    return true;
+}
+
+void save_writer_flush(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (pending > 0)
+        done_cv.wait(lock);
+}
+
+bool save_writer_poll(Save_Writer_Result* result)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (results.empty())
+        return false;
+
+    *result = results.front();
+    results.pop_front();
+
+    return true;
+}
+
+int save_writer_pending(void)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+static u32 queue_job(Save_Writer_Kind kind, const std::string& path, std::vector<u8>& data, const u32* chunk_sizes, int slot, bool wait)
+{
+    Save_Writer_Job job;
+    job.kind = kind;
+    job.slot = slot;
+    job.wait = wait;
+    job.path = path;
+    job.data.swap(data);
+    if (IsValidPointer(chunk_sizes))
+        job.chunk_sizes.assign(chunk_sizes, chunk_sizes + GG_SAVESTATE_CHUNK_COUNT);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job.id = next_id++;
+    u32 id = job.id;
+
+    if (!running)
+    {
+        // No worker, write it right away
+        lock.unlock();
+        bool success = write_job(job);
+        lock.lock();
+        complete_job(job, success);
+        return id;
+    }
+
+    jobs.push_back(Save_Writer_Job());
+    take_job(jobs.back(), job);
+    pending++;
+    lock.unlock();
+
+    jobs_cv.notify_one();
+
+    return id;
+}
+
+static void worker_func(void)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        while (running && jobs.empty())
+            jobs_cv.wait(lock);
+
+        // Keep writing until the queue is empty, even when stopping, so
+        // nothing queued before shutdown is lost
+        if (jobs.empty())
+            break;
+
+        Save_Writer_Job job;
+        take_job(job, jobs.front());
+        jobs.pop_front();
+
+        lock.unlock();
+        bool success = write_job(job);
+        lock.lock();
+
+        pending--;
+        complete_job(job, success);
+    }
+}
+
+static bool take_result(u32 id, Save_Writer_Result* result)
+{
+    std::map<u32, Save_Writer_Result>::iterator it = waited_results.find(id);
+
+    if (it != waited_results.end())
+    {
+        bool success = it->second.success;
+        if (IsValidPointer(result))
+            *result = it->second;
+        waited_results.erase(it);
+        return success;
+    }
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        if (results[i].id == id)
+        {
+            if (IsValidPointer(result))
+                *result = results[i];
+            return results[i].success;
+        }
+    }
+
+    if (IsValidPointer(result))
+    {
+        result->id = id;
+        result->success = false;
+    }
+
+    return false;
+}
+
+static void take_job(Save_Writer_Job& dest, Save_Writer_Job& source)
+{
+    dest.id = source.id;
+    dest.kind = source.kind;
+    dest.slot = source.slot;
+    dest.wait = source.wait;
+    dest.path.swap(source.path);
+    dest.data.swap(source.data);
+    dest.chunk_sizes.swap(source.chunk_sizes);
+}
+
+static void complete_job(const Save_Writer_Job& job, bool success)
+{
+    Save_Writer_Result result;
+    result.id = job.id;
+    result.kind = job.kind;
+    result.slot = job.slot;
+    result.success = success;
+    result.path = job.path;
+
+    results.push_back(result);
+
+    if (job.wait)
+        waited_results[job.id] = result;
+
+    while (results.size() > SAVE_WRITER_MAX_RESULTS)
+        results.pop_front();
+
+    if (job.id > completed_id)
+        completed_id = job.id;
+
+    done_cv.notify_all();
+}
+
+static bool write_job(Save_Writer_Job& job)
+{
+    if (job.chunk_sizes.empty())
+        return write_file(job.path, job.data);
+
+    std::vector<u8> file;
+
+    if (!SaveStateFile::Encode(job.data.data(), job.chunk_sizes.data(), file))
+    {
+        Error("Failed to encode save state file: %s", job.path.c_str());
+        return false;
+    }
+
+    return write_file(job.path, file);
+}
+
+static bool write_file(const std::string& path, const std::vector<u8>& data)
+{
+    std::string tmp_path = path + ".tmp";
+
+    Debug("Writing %d bytes to %s", (int)data.size(), path.c_str());
+
+    FILE* file = fopen_utf8(tmp_path.c_str(), "wb");
+
+    if (!IsValidPointer(file))
+    {
+        Error("Failed to open file for writing: %s", tmp_path.c_str());
+        return false;
+    }
+
+    bool success = true;
+
+    if (data.size() > 0 && fwrite(data.data(), 1, data.size(), file) != data.size())
+        success = false;
+
+    if (success && fflush(file) != 0)
+        success = false;
+
+    if (success && !sync_file(file))
+        success = false;
+
+    if (fclose(file) != 0)
+        success = false;
+
+    if (!success)
+    {
+        Error("Failed to write file: %s", tmp_path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+
+    if (!replace_file(tmp_path, path))
+    {
+        Error("Failed to replace file: %s", path.c_str());
+        remove(tmp_path.c_str());
+        return false;
+    }
+
+    Debug("File written: %s", path.c_str());
+
+    return true;
+}
+
+static bool sync_file(FILE* file)
+{
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+static bool replace_file(const std::string& tmp_path, const std::string& path)
+{
+#if defined(_WIN32)
+    std::wstring wtmp_path = utf8_to_wstring(tmp_path.c_str());
+    std::wstring wpath = utf8_to_wstring(path.c_str());
+    return MoveFileExW(wtmp_path.c_str(), wpath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    if (rename(tmp_path.c_str(), path.c_str()) != 0)
+        return false;
+
+    // Make the rename itself durable
+    std::string::size_type slash = path.rfind('/');
+    std::string dir = (slash == std::string::npos) ? "." : path.substr(0, slash + 1);
+    int fd = open(dir.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+
+    return true;
+#endif
+}
@@ -0,0 +1,61 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef SAVE_WRITER_H
+#define SAVE_WRITER_H
+
+#include <string>
+#include <vector>
+#include "geargrafx.h"
+
+#ifdef SAVE_WRITER_IMPORT
+    #define EXTERN
+#else
+    #define EXTERN extern
+#endif
+
+enum Save_Writer_Kind
+{
+    Save_Writer_State,
+    Save_Writer_Ram,
+    Save_Writer_MB128
+};
+
+struct Save_Writer_Result
+{
+    u32 id;
+    Save_Writer_Kind kind;
+    int slot;
+    bool success;
+    std::string path;
+};
+
+EXTERN void save_writer_init(void);
+EXTERN void save_writer_destroy(void);
+EXTERN u32 save_writer_queue(Save_Writer_Kind kind, const std::string& path, std::vector<u8>& data, int slot, bool wait = false);
+EXTERN u32 save_writer_queue_state(const std::string& path, std::vector<u8>& state, const u32* chunk_sizes, int slot, bool wait = false);
+EXTERN bool save_writer_wait(u32 id, Save_Writer_Result* result);
+EXTERN bool save_writer_try_wait(u32 id, Save_Writer_Result* result);
+EXTERN void save_writer_flush(void);
+EXTERN bool save_writer_poll(Save_Writer_Result* result);
+EXTERN int save_writer_pending(void);
+
+#undef SAVE_WRITER_IMPORT
+#undef EXTERN
+#endif /* SAVE_WRITER_H */
@@ -18,6 +18,7 @@
  */
 
 #include <string>
+#include <atomic>
 #define SOUND_QUEUE_IMPORT
 #include "sound_queue.h"
 #include "utils.h"
@@ -25,18 +26,46 @@
 #define SOUND_QUEUE_DEBUG(...) { }
 //#define SOUND_QUEUE_DEBUG(x, ...) Debug(x, ## __VA_ARGS__)
 
+// Maximum deviation applied to the resample ratio by the dynamic rate control
+#define SOUND_QUEUE_MAX_RATE_DELTA 0.005f
+#define SOUND_QUEUE_MIN_RING_SIZE 8192
+
 static SDL_AudioStream* sound_queue_stream;
 static bool sound_queue_sound_open;
-static int sound_queue_max_queued_bytes;
-static int sound_queue_buffer_size;
-static int sound_queue_bytes_per_second;
+static int sound_queue_sample_rate;
+static int sound_queue_channel_count;
+static int sound_queue_latency_ms;
+static int sound_queue_target_samples;
+static float sound_queue_rate_ratio;
+static u32 sound_queue_overruns;
+
+// Single producer (emulation thread) / single consumer (SDL audio callback)
+static s16* sound_queue_ring;
+static u32 sound_queue_ring_size;
+static u32 sound_queue_ring_mask;
+static std::atomic<u32> sound_queue_ring_read;
+static std::atomic<u32> sound_queue_ring_write;
 
 static bool is_running_in_wsl(void);
+static void SDLCALL audio_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+static u32 ring_fill(void);
+static u32 ring_push(const s16* samples, u32 count);
+static u32 ring_pop(s16* samples, u32 count);
+static void update_rate_control(u32 fill);
 
 void sound_queue_init(void)
 {
     InitPointer(sound_queue_stream);
+    InitPointer(sound_queue_ring);
     sound_queue_sound_open = false;
+    sound_queue_ring_size = 0;
+    sound_queue_ring_mask = 0;
+    sound_queue_ring_read.store(0);
+    sound_queue_ring_write.store(0);
+    sound_queue_latency_ms = 0;
+    sound_queue_target_samples = 0;
+    sound_queue_rate_ratio = 1.0f;
+    sound_queue_overruns = 0;
 
     int audio_drivers_count = SDL_GetNumAudioDrivers();
 
@@ -86,13 +115,23 @@ void sound_queue_destroy(void)
     sound_queue_stop();
 }
 
-bool sound_queue_start(int sample_rate, int channel_count, int buffer_size, int buffer_count)
+bool sound_queue_start(int sample_rate, int channel_count, int latency_ms)
 {
-    Debug("Sound Queue: Starting with %d Hz, %d channels, %d buffer size, %d buffers ...", sample_rate, channel_count, buffer_size, buffer_count);
-
-    sound_queue_buffer_size = buffer_size;
-    sound_queue_max_queued_bytes = buffer_size * buffer_count * (int)sizeof(s16);
-    sound_queue_bytes_per_second = sample_rate * channel_count * (int)sizeof(s16);
+    Debug("Sound Queue: Starting with %d Hz, %d channels, %d ms latency ...", sample_rate, channel_count, latency_ms);
+
+    sound_queue_sample_rate = sample_rate;
+    sound_queue_channel_count = channel_count;
+    sound_queue_latency_ms = latency_ms;
+    sound_queue_target_samples = (sample_rate * channel_count * latency_ms) / 1000;
+    sound_queue_rate_ratio = 1.0f;
+    sound_queue_overruns = 0;
+
+    sound_queue_ring_size = pow_2_ceil((u32)MAX(sound_queue_target_samples * 4, SOUND_QUEUE_MIN_RING_SIZE));
+    sound_queue_ring_mask = sound_queue_ring_size - 1;
+    sound_queue_ring = new s16[sound_queue_ring_size];
+    memset(sound_queue_ring, 0, sound_queue_ring_size * sizeof(s16));
+    sound_queue_ring_read.store(0);
+    sound_queue_ring_write.store(0);
 
     SDL_AudioSpec spec;
     spec.freq = sample_rate;
@@ -101,17 +140,18 @@ bool sound_queue_start(int sample_rate, int channel_count, int buffer_size, int
 
     Debug("Sound Queue: Spec - frequency: %d format: 0x%04X channels: %d", spec.freq, spec.format, spec.channels);
 
-    sound_queue_stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, NULL, NULL);
+    sound_queue_stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, audio_callback, NULL);
 
     if (!sound_queue_stream)
     {
         SDL_ERROR("SDL_OpenAudioDeviceStream");
+        SafeDeleteArray(sound_queue_ring);
         return false;
     }
 
     SDL_AudioDeviceID selected_device = SDL_GetAudioStreamDevice(sound_queue_stream);
 
-    Log("Sound Queue: Started [%s] - frequency: %d format: 0x%04X channels: %d", SDL_GetAudioDeviceName(selected_device), spec.freq, spec.format, spec.channels);
+    Log("Sound Queue: Started [%s] - frequency: %d format: 0x%04X channels: %d latency: %d ms", SDL_GetAudioDeviceName(selected_device), spec.freq, spec.format, spec.channels, latency_ms);
 
     SDL_ResumeAudioStreamDevice(sound_queue_stream);
     sound_queue_sound_open = true;
@@ -131,6 +171,12 @@ void sound_queue_stop(void)
             InitPointer(sound_queue_stream);
         }
 
+        SafeDeleteArray(sound_queue_ring);
+        sound_queue_ring_size = 0;
+        sound_queue_ring_mask = 0;
+        sound_queue_ring_read.store(0);
+        sound_queue_ring_write.store(0);
+
         Debug("Sound Queue: Stopped");
     }
 }
@@ -139,7 +185,22 @@ int sound_queue_get_sample_count(void)
 {
     if (!sound_queue_stream)
         return 0;
-    return SDL_GetAudioStreamQueued(sound_queue_stream) / (int)sizeof(s16);
+    return (int)ring_fill() + (SDL_GetAudioStreamQueued(sound_queue_stream) / (int)sizeof(s16));
+}
+
+int sound_queue_get_latency_ms(void)
+{
+    return sound_queue_latency_ms;
+}
+
+float sound_queue_get_rate_ratio(void)
+{
+    return sound_queue_rate_ratio;
+}
+
+u32 sound_queue_get_overrun_count(void)
+{
+    return sound_queue_overruns;
 }
 
 bool sound_queue_is_open(void)
@@ -152,41 +213,132 @@ void sound_queue_write(s16* samples, int count, bool sync)
     if (!sound_queue_sound_open || !sound_queue_stream)
         return;
 
-    int bytes = count * (int)sizeof(s16);
-    int queued = SDL_GetAudioStreamQueued(sound_queue_stream);
+    u32 fill = ring_fill();
 
-    if (count > sound_queue_buffer_size)
+    if ((u32)count > (sound_queue_ring_size - fill))
     {
-        Log("Sound Queue: Write exceeds queue buffer size (%d > %d)", count, sound_queue_buffer_size);
+        SOUND_QUEUE_DEBUG("Sound Queue: Ring full (%d + %d > %d)", fill, count, sound_queue_ring_size);
     }
 
-    if (queued == 0)
+    if (fill == 0)
     {
-        SOUND_QUEUE_DEBUG("Sound Queue: Underrun detected, queue was empty");
+        SOUND_QUEUE_DEBUG("Sound Queue: Underrun detected, ring was empty");
     }
 
     if (sync)
     {
-        int room = sound_queue_max_queued_bytes - queued;
-        if (room < bytes)
+        if ((int)fill > sound_queue_target_samples)
         {
-            SOUND_QUEUE_DEBUG("Sound Queue: Sync overrun, queued %d >= max %d, waiting...", queued, sound_queue_max_queued_bytes);
-            int needed = bytes - room;
-            int wait_ms = (needed * 1000) / sound_queue_bytes_per_second;
+            SOUND_QUEUE_DEBUG("Sound Queue: Sync overrun, fill %d > target %d, waiting...", fill, sound_queue_target_samples);
+            int excess = (int)fill - sound_queue_target_samples;
+            int wait_ms = (excess * 1000) / (sound_queue_sample_rate * sound_queue_channel_count);
             if (wait_ms >= 1)
                 SDL_Delay(wait_ms);
         }
     }
     else
     {
-        if (queued >= sound_queue_max_queued_bytes)
+        if ((int)fill >= (sound_queue_target_samples * 2))
         {
-            SOUND_QUEUE_DEBUG("Sound Queue: Async overrun, dropping frame (queued %d >= max %d)", queued, sound_queue_max_queued_bytes);
+            SOUND_QUEUE_DEBUG("Sound Queue: Async overrun, dropping frame (fill %d >= max %d)", fill, sound_queue_target_samples * 2);
+            sound_queue_overruns++;
             return;
         }
     }
 
-    SDL_PutAudioStreamData(sound_queue_stream, samples, bytes);
+    if (ring_push(samples, (u32)count) < (u32)count)
+    {
+        if (sound_queue_overruns == 0)
+            Log("Sound Queue: Ring full, dropping samples");
+        sound_queue_overruns++;
+    }
+
+    update_rate_control(ring_fill());
+}
+
+static void SDLCALL audio_callback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount)
+{
+    UNUSED(userdata);
+    UNUSED(total_amount);
+
+    s16 chunk[1024];
+    int remaining = additional_amount / (int)sizeof(s16);
+
+    while (remaining > 0)
+    {
+        u32 wanted = (u32)MIN(remaining, 1024);
+        u32 popped = ring_pop(chunk, wanted);
+
+        if (popped == 0)
+            break;
+
+        SDL_PutAudioStreamData(stream, chunk, (int)(popped * sizeof(s16)));
+        remaining -= (int)popped;
+    }
+}
+
+static u32 ring_fill(void)
+{
+    u32 write = sound_queue_ring_write.load(std::memory_order_acquire);
+    u32 read = sound_queue_ring_read.load(std::memory_order_acquire);
+    return write - read;
+}
+
+static u32 ring_push(const s16* samples, u32 count)
+{
+    u32 write = sound_queue_ring_write.load(std::memory_order_relaxed);
+    u32 read = sound_queue_ring_read.load(std::memory_order_acquire);
+    u32 room = sound_queue_ring_size - (write - read);
+
+    if (count > room)
+        count = room;
+
+    u32 offset = write & sound_queue_ring_mask;
+    u32 first = MIN(count, sound_queue_ring_size - offset);
+
+    memcpy(sound_queue_ring + offset, samples, first * sizeof(s16));
+    memcpy(sound_queue_ring, samples + first, (count - first) * sizeof(s16));
+
+    sound_queue_ring_write.store(write + count, std::memory_order_release);
+    return count;
+}
+
+static u32 ring_pop(s16* samples, u32 count)
+{
+    u32 read = sound_queue_ring_read.load(std::memory_order_relaxed);
+    u32 write = sound_queue_ring_write.load(std::memory_order_acquire);
+    u32 available = write - read;
+
+    if (count > available)
+        count = available;
+
+    u32 offset = read & sound_queue_ring_mask;
+    u32 first = MIN(count, sound_queue_ring_size - offset);
+
+    memcpy(samples, sound_queue_ring + offset, first * sizeof(s16));
+    memcpy(samples + first, sound_queue_ring, (count - first) * sizeof(s16));
+
+    sound_queue_ring_read.store(read + count, std::memory_order_release);
+    return count;
+}
+
+static void update_rate_control(u32 fill)
+{
+    if (sound_queue_target_samples <= 0)
+        return;
+
+    // Play slightly faster when above target and slightly slower when below,
+    // so the fill level converges to the requested latency
+    float error = ((float)fill - (float)sound_queue_target_samples) / (float)sound_queue_target_samples;
+    error = CLAMP(error, -1.0f, 1.0f);
+    float ratio = 1.0f + (error * SOUND_QUEUE_MAX_RATE_DELTA);
+
+    if (ratio != sound_queue_rate_ratio)
+    {
+        sound_queue_rate_ratio = ratio;
+        if (!SDL_SetAudioStreamFrequencyRatio(sound_queue_stream, ratio))
+            SDL_ERROR("SDL_SetAudioStreamFrequencyRatio");
+    }
 }
 
 static bool is_running_in_wsl(void)
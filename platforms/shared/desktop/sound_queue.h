@@ -32,10 +32,13 @@
 
 EXTERN void sound_queue_init(void);
 EXTERN void sound_queue_destroy(void);
-EXTERN bool sound_queue_start(int sample_rate, int channel_count, int buffer_size = GG_AUDIO_QUEUE_SIZE, int buffer_count = 3);
+EXTERN bool sound_queue_start(int sample_rate, int channel_count, int latency_ms = 40);
 EXTERN void sound_queue_stop(void);
 EXTERN void sound_queue_write(s16* samples, int count, bool sync);
 EXTERN int sound_queue_get_sample_count(void);
+EXTERN int sound_queue_get_latency_ms(void);
+EXTERN float sound_queue_get_rate_ratio(void);
+EXTERN u32 sound_queue_get_overrun_count(void);
 EXTERN bool sound_queue_is_open(void);
 
 #undef SOUND_QUEUE_IMPORT
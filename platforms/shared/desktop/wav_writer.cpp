@@ -0,0 +1,266 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "wav_writer.h"
+
+WavWriter::WavWriter()
+{
+    for (int i = 0; i < WAV_WRITER_MAX_TRACKS; i++)
+    {
+        InitPointer(m_tracks[i].file);
+        m_tracks[i].data_bytes = 0;
+    }
+
+    m_track_count = 0;
+    m_sample_rate = GG_AUDIO_SAMPLE_RATE;
+    m_channels = 2;
+    m_sample_count = 0;
+    m_open = false;
+    m_error = false;
+    m_pending = false;
+    m_quit = false;
+}
+
+WavWriter::~WavWriter()
+{
+    Close();
+}
+
+bool WavWriter::Open(const char* const* file_paths, int track_count, int sample_rate, int channels)
+{
+    if (m_open)
+        Close();
+
+    if ((track_count <= 0) || (track_count > WAV_WRITER_MAX_TRACKS))
+    {
+        Error("WAV Writer: Invalid track count %d", track_count);
+        return false;
+    }
+
+    m_track_count = track_count;
+    m_sample_rate = sample_rate;
+    m_channels = channels;
+    m_sample_count = 0;
+    m_error = false;
+    m_pending = false;
+    m_quit = false;
+
+    for (int i = 0; i < m_track_count; i++)
+    {
+        Track* track = &m_tracks[i];
+        track->file = fopen_utf8(file_paths[i], "wb");
+        track->data_bytes = 0;
+        track->front.clear();
+        track->back.clear();
+        track->front.reserve(WAV_WRITER_FLUSH_SAMPLES + GG_AUDIO_BUFFER_SIZE);
+        track->back.reserve(WAV_WRITER_FLUSH_SAMPLES + GG_AUDIO_BUFFER_SIZE);
+
+        if (!IsValidPointer(track->file))
+        {
+            Error("WAV Writer: Unable to create %s", file_paths[i]);
+            for (int j = 0; j <= i; j++)
+            {
+                if (IsValidPointer(m_tracks[j].file))
+                {
+                    fclose(m_tracks[j].file);
+                    InitPointer(m_tracks[j].file);
+                }
+            }
+            m_track_count = 0;
+            return false;
+        }
+
+        // Placeholder header, patched with the final sizes on Close
+        WriteHeader(track->file, 0);
+        Debug("WAV Writer: Track %d -> %s", i, file_paths[i]);
+    }
+
+    m_thread = std::thread(&WavWriter::WorkerThread, this);
+    m_open = true;
+
+    return true;
+}
+
+void WavWriter::Write(int track, const s16* samples, int count)
+{
+    if (!m_open || (track < 0) || (track >= m_track_count) || (count <= 0))
+        return;
+
+    std::vector<s16>& front = m_tracks[track].front;
+    front.insert(front.end(), samples, samples + count);
+
+    if (track == 0)
+        m_sample_count += (u64)count;
+
+    if ((track == (m_track_count - 1)) && (front.size() >= WAV_WRITER_FLUSH_SAMPLES))
+        Flush();
+}
+
+bool WavWriter::Close()
+{
+    if (!m_open)
+        return false;
+
+    Flush();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this] { return !m_pending; });
+        m_quit = true;
+    }
+    m_cond.notify_all();
+    m_thread.join();
+
+    for (int i = 0; i < m_track_count; i++)
+    {
+        Track* track = &m_tracks[i];
+
+        if (!WriteHeader(track->file, track->data_bytes))
+            m_error = true;
+
+        if (fclose(track->file) != 0)
+            m_error = true;
+
+        InitPointer(track->file);
+        track->front.clear();
+        track->back.clear();
+    }
+
+    m_open = false;
+
+    if (m_error)
+        Error("WAV Writer: Errors while writing WAV files");
+
+    return !m_error;
+}
+
+bool WavWriter::IsOpen()
+{
+    return m_open;
+}
+
+// Samples submitted to the first track. Only the thread calling Write
+// touches the counter, so it never races with the worker.
+u64 WavWriter::GetSampleCount()
+{
+    return m_sample_count;
+}
+
+void WavWriter::Flush()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this] { return !m_pending; });
+
+        for (int i = 0; i < m_track_count; i++)
+        {
+            m_tracks[i].back.swap(m_tracks[i].front);
+            m_tracks[i].front.clear();
+        }
+
+        m_pending = true;
+    }
+    m_cond.notify_all();
+}
+
+void WavWriter::WorkerThread()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_cond.wait(lock, [this] { return m_pending || m_quit; });
+
+        if (m_pending)
+        {
+            u64 written_bytes[WAV_WRITER_MAX_TRACKS];
+            bool error = false;
+
+            lock.unlock();
+
+            for (int i = 0; i < m_track_count; i++)
+            {
+                Track* track = &m_tracks[i];
+                size_t count = track->back.size();
+                written_bytes[i] = 0;
+
+                if (count == 0)
+                    continue;
+
+#if defined(GG_BIG_ENDIAN)
+                for (size_t s = 0; s < count; s++)
+                {
+                    u16 sample = (u16)track->back[s];
+                    track->back[s] = (s16)((sample >> 8) | (sample << 8));
+                }
+#endif
+
+                if (fwrite(track->back.data(), sizeof(s16), count, track->file) != count)
+                    error = true;
+
+                written_bytes[i] = count * sizeof(s16);
+            }
+
+            lock.lock();
+
+            for (int i = 0; i < m_track_count; i++)
+            {
+                m_tracks[i].data_bytes += written_bytes[i];
+                m_tracks[i].back.clear();
+            }
+
+            if (error)
+                m_error = true;
+
+            m_pending = false;
+            m_cond.notify_all();
+        }
+        else if (m_quit)
+            break;
+    }
+}
+
+bool WavWriter::WriteHeader(FILE* file, u64 data_bytes)
+{
+    u32 data_size = (u32)MIN(data_bytes, (u64)0xFFFFFFFF - 36);
+    u32 block_align = m_channels * (u32)sizeof(s16);
+    u8 header[44];
+
+    memcpy(header + 0, "RIFF", 4);
+    write_u32_le(header + 4, 36 + data_size);
+    memcpy(header + 8, "WAVE", 4);
+    memcpy(header + 12, "fmt ", 4);
+    write_u32_le(header + 16, 16);
+    write_u16_le(header + 20, 1);
+    write_u16_le(header + 22, (u16)m_channels);
+    write_u32_le(header + 24, (u32)m_sample_rate);
+    write_u32_le(header + 28, (u32)m_sample_rate * block_align);
+    write_u16_le(header + 32, (u16)block_align);
+    write_u16_le(header + 34, 16);
+    memcpy(header + 36, "data", 4);
+    write_u32_le(header + 40, data_size);
+
+    if (fseek(file, 0, SEEK_SET) != 0)
+        return false;
+
+    bool ok = (fwrite(header, 1, sizeof(header), file) == sizeof(header));
+    fseek(file, 0, SEEK_END);
+
+    return ok;
+}
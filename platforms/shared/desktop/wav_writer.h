@@ -0,0 +1,76 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef WAV_WRITER_H
+#define WAV_WRITER_H
+
+#include <stdio.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "geargrafx.h"
+
+#define WAV_WRITER_MAX_TRACKS 16
+#define WAV_WRITER_FLUSH_SAMPLES (64 * 1024)
+
+// Writes one or more 16-bit PCM WAV files in lockstep. Samples are
+// accumulated in a front buffer and handed to a worker thread that does
+// the file I/O, so the caller never blocks on disk writes.
+class WavWriter
+{
+public:
+    WavWriter();
+    ~WavWriter();
+    bool Open(const char* const* file_paths, int track_count, int sample_rate, int channels = 2);
+    void Write(int track, const s16* samples, int count);
+    bool Close();
+    bool IsOpen();
+    u64 GetSampleCount();
+
+private:
+    struct Track
+    {
+        FILE* file;
+        std::vector<s16> front;
+        std::vector<s16> back;
+        u64 data_bytes;
+    };
+
+private:
+    void Flush();
+    void WorkerThread();
+    bool WriteHeader(FILE* file, u64 data_bytes);
+
+private:
+    Track m_tracks[WAV_WRITER_MAX_TRACKS];
+    int m_track_count;
+    int m_sample_rate;
+    int m_channels;
+    u64 m_sample_count;
+    bool m_open;
+    bool m_error;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_pending;
+    bool m_quit;
+};
+
+#endif /* WAV_WRITER_H */
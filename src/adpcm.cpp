@@ -56,6 +56,7 @@ void Adpcm::Init(GeargrafxCore* core, CdRom* cdrom, ScsiController* scsi_control
     m_core = core;
     m_cdrom = cdrom;
     m_scsi_controller = scsi_controller;
+    m_adpcm_ram_dirty.Init(sizeof(m_adpcm_ram));
     ComputeDeltaLUT();
     ComputeLatencyLUTs();
     Reset();
@@ -157,6 +158,7 @@ void Adpcm::Reset()
     m_dc_prev_y = 0.0f;
     m_gain_smooth = 1.0f;
     memset(m_adpcm_ram, 0, sizeof(m_adpcm_ram));
+    m_adpcm_ram_dirty.MarkAll();
 }
 
 int Adpcm::EndFrame(s16* sample_buffer)
@@ -221,81 +223,81 @@ u8 Adpcm::ComputeLatency(int offset, bool read)
     return 36;
 }
 
-void Adpcm::SaveState(std::ostream& stream)
+void Adpcm::SaveState(StateSerializer& stream)
 {
     using namespace std;
 
-    stream.write(reinterpret_cast<const char*> (m_adpcm_ram), sizeof(m_adpcm_ram));
-    stream.write(reinterpret_cast<const char*> (&m_read_value), sizeof(m_read_value));
-    stream.write(reinterpret_cast<const char*> (&m_write_value), sizeof(m_write_value));
-    stream.write(reinterpret_cast<const char*> (&m_read_cycles), sizeof(m_read_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_write_cycles), sizeof(m_write_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_read_address), sizeof(m_read_address));
-    stream.write(reinterpret_cast<const char*> (&m_write_address), sizeof(m_write_address));
-    stream.write(reinterpret_cast<const char*> (&m_address), sizeof(m_address));
-    stream.write(reinterpret_cast<const char*> (&m_samples_left), sizeof(m_samples_left));
-    stream.write(reinterpret_cast<const char*> (&m_sample_rate), sizeof(m_sample_rate));
-    stream.write(reinterpret_cast<const char*> (&m_cycles_per_sample), sizeof(m_cycles_per_sample));
-    stream.write(reinterpret_cast<const char*> (&m_control), sizeof(m_control));
-    stream.write(reinterpret_cast<const char*> (&m_dma), sizeof(m_dma));
-    stream.write(reinterpret_cast<const char*> (&m_dma_cycles), sizeof(m_dma_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_end_irq), sizeof(m_end_irq));
-    stream.write(reinterpret_cast<const char*> (&m_half_irq), sizeof(m_half_irq));
-    stream.write(reinterpret_cast<const char*> (&m_playing), sizeof(m_playing));
-    stream.write(reinterpret_cast<const char*> (&m_play_pending), sizeof(m_play_pending));
-    stream.write(reinterpret_cast<const char*> (&m_nibble_toggle), sizeof(m_nibble_toggle));
-    stream.write(reinterpret_cast<const char*> (&m_length), sizeof(m_length));
-    stream.write(reinterpret_cast<const char*> (&m_sample), sizeof(m_sample));
-    stream.write(reinterpret_cast<const char*> (&m_step_index), sizeof(m_step_index));
-    stream.write(reinterpret_cast<const char*> (&m_adpcm_cycle_counter), sizeof(m_adpcm_cycle_counter));
-    stream.write(reinterpret_cast<const char*> (&m_buffer_index), sizeof(m_buffer_index));
-    stream.write(reinterpret_cast<const char*> (&m_frame_samples), sizeof(m_frame_samples));
-    stream.write(reinterpret_cast<const char*> (m_buffer), sizeof(m_buffer));
-    stream.write(reinterpret_cast<const char*> (&m_filter_state), sizeof(m_filter_state));
-    stream.write(reinterpret_cast<const char*> (&m_dc_prev_x), sizeof(m_dc_prev_x));
-    stream.write(reinterpret_cast<const char*> (&m_dc_prev_y), sizeof(m_dc_prev_y));
-    stream.write(reinterpret_cast<const char*> (&m_gain_smooth), sizeof(m_gain_smooth));
+    stream.WritePages(m_adpcm_ram, sizeof(m_adpcm_ram), m_adpcm_ram_dirty);
+    stream.Write(&m_read_value, sizeof(m_read_value));
+    stream.Write(&m_write_value, sizeof(m_write_value));
+    stream.Write(&m_read_cycles, sizeof(m_read_cycles));
+    stream.Write(&m_write_cycles, sizeof(m_write_cycles));
+    stream.Write(&m_read_address, sizeof(m_read_address));
+    stream.Write(&m_write_address, sizeof(m_write_address));
+    stream.Write(&m_address, sizeof(m_address));
+    stream.Write(&m_samples_left, sizeof(m_samples_left));
+    stream.Write(&m_sample_rate, sizeof(m_sample_rate));
+    stream.Write(&m_cycles_per_sample, sizeof(m_cycles_per_sample));
+    stream.Write(&m_control, sizeof(m_control));
+    stream.Write(&m_dma, sizeof(m_dma));
+    stream.Write(&m_dma_cycles, sizeof(m_dma_cycles));
+    stream.Write(&m_end_irq, sizeof(m_end_irq));
+    stream.Write(&m_half_irq, sizeof(m_half_irq));
+    stream.Write(&m_playing, sizeof(m_playing));
+    stream.Write(&m_play_pending, sizeof(m_play_pending));
+    stream.Write(&m_nibble_toggle, sizeof(m_nibble_toggle));
+    stream.Write(&m_length, sizeof(m_length));
+    stream.Write(&m_sample, sizeof(m_sample));
+    stream.Write(&m_step_index, sizeof(m_step_index));
+    stream.Write(&m_adpcm_cycle_counter, sizeof(m_adpcm_cycle_counter));
+    stream.Write(&m_buffer_index, sizeof(m_buffer_index));
+    stream.Write(&m_frame_samples, sizeof(m_frame_samples));
+    stream.Write(m_buffer, sizeof(m_buffer));
+    stream.Write(&m_filter_state, sizeof(m_filter_state));
+    stream.Write(&m_dc_prev_x, sizeof(m_dc_prev_x));
+    stream.Write(&m_dc_prev_y, sizeof(m_dc_prev_y));
+    stream.Write(&m_gain_smooth, sizeof(m_gain_smooth));
 }
 
-void Adpcm::LoadState(std::istream& stream, int version)
+void Adpcm::LoadState(StateDeserializer& stream, int version)
 {
     using namespace std;
 
-    stream.read(reinterpret_cast<char*> (m_adpcm_ram), sizeof(m_adpcm_ram));
-    stream.read(reinterpret_cast<char*> (&m_read_value), sizeof(m_read_value));
-    stream.read(reinterpret_cast<char*> (&m_write_value), sizeof(m_write_value));
-    stream.read(reinterpret_cast<char*> (&m_read_cycles), sizeof(m_read_cycles));
-    stream.read(reinterpret_cast<char*> (&m_write_cycles), sizeof(m_write_cycles));
-    stream.read(reinterpret_cast<char*> (&m_read_address), sizeof(m_read_address));
-    stream.read(reinterpret_cast<char*> (&m_write_address), sizeof(m_write_address));
-    stream.read(reinterpret_cast<char*> (&m_address), sizeof(m_address));
-    stream.read(reinterpret_cast<char*> (&m_samples_left), sizeof(m_samples_left));
-    stream.read(reinterpret_cast<char*> (&m_sample_rate), sizeof(m_sample_rate));
-    stream.read(reinterpret_cast<char*> (&m_cycles_per_sample), sizeof(m_cycles_per_sample));
-    stream.read(reinterpret_cast<char*> (&m_control), sizeof(m_control));
-    stream.read(reinterpret_cast<char*> (&m_dma), sizeof(m_dma));
-    stream.read(reinterpret_cast<char*> (&m_dma_cycles), sizeof(m_dma_cycles));
-    stream.read(reinterpret_cast<char*> (&m_end_irq), sizeof(m_end_irq));
-    stream.read(reinterpret_cast<char*> (&m_half_irq), sizeof(m_half_irq));
-    stream.read(reinterpret_cast<char*> (&m_playing), sizeof(m_playing));
-    stream.read(reinterpret_cast<char*> (&m_play_pending), sizeof(m_play_pending));
-    stream.read(reinterpret_cast<char*> (&m_nibble_toggle), sizeof(m_nibble_toggle));
-    stream.read(reinterpret_cast<char*> (&m_length), sizeof(m_length));
-    stream.read(reinterpret_cast<char*> (&m_sample), sizeof(m_sample));
-    stream.read(reinterpret_cast<char*> (&m_step_index), sizeof(m_step_index));
-    stream.read(reinterpret_cast<char*> (&m_adpcm_cycle_counter), sizeof(m_adpcm_cycle_counter));
+    stream.ReadPages(m_adpcm_ram, sizeof(m_adpcm_ram), m_adpcm_ram_dirty);
+    stream.Read(&m_read_value, sizeof(m_read_value));
+    stream.Read(&m_write_value, sizeof(m_write_value));
+    stream.Read(&m_read_cycles, sizeof(m_read_cycles));
+    stream.Read(&m_write_cycles, sizeof(m_write_cycles));
+    stream.Read(&m_read_address, sizeof(m_read_address));
+    stream.Read(&m_write_address, sizeof(m_write_address));
+    stream.Read(&m_address, sizeof(m_address));
+    stream.Read(&m_samples_left, sizeof(m_samples_left));
+    stream.Read(&m_sample_rate, sizeof(m_sample_rate));
+    stream.Read(&m_cycles_per_sample, sizeof(m_cycles_per_sample));
+    stream.Read(&m_control, sizeof(m_control));
+    stream.Read(&m_dma, sizeof(m_dma));
+    stream.Read(&m_dma_cycles, sizeof(m_dma_cycles));
+    stream.Read(&m_end_irq, sizeof(m_end_irq));
+    stream.Read(&m_half_irq, sizeof(m_half_irq));
+    stream.Read(&m_playing, sizeof(m_playing));
+    stream.Read(&m_play_pending, sizeof(m_play_pending));
+    stream.Read(&m_nibble_toggle, sizeof(m_nibble_toggle));
+    stream.Read(&m_length, sizeof(m_length));
+    stream.Read(&m_sample, sizeof(m_sample));
+    stream.Read(&m_step_index, sizeof(m_step_index));
+    stream.Read(&m_adpcm_cycle_counter, sizeof(m_adpcm_cycle_counter));
 
     if (version < 32)
     {
         s32 audio_cycle_counter = 0;
-        stream.read(reinterpret_cast<char*> (&audio_cycle_counter), sizeof(audio_cycle_counter));
+        stream.Read(&audio_cycle_counter, sizeof(audio_cycle_counter));
     }
 
     if (version >= 27)
     {
-        stream.read(reinterpret_cast<char*> (&m_buffer_index), sizeof(m_buffer_index));
-        stream.read(reinterpret_cast<char*> (&m_frame_samples), sizeof(m_frame_samples));
-        stream.read(reinterpret_cast<char*> (m_buffer), sizeof(m_buffer));
+        stream.Read(&m_buffer_index, sizeof(m_buffer_index));
+        stream.Read(&m_frame_samples, sizeof(m_frame_samples));
+        stream.Read(m_buffer, sizeof(m_buffer));
 
         m_buffer_index = CLAMP(m_buffer_index, 0, GG_AUDIO_BUFFER_SIZE - 2);
         m_buffer_index &= ~1;
@@ -308,13 +310,13 @@ void Adpcm::LoadState(std::istream& stream, int version)
         memset(m_buffer, 0, sizeof(m_buffer));
     }
 
-    stream.read(reinterpret_cast<char*> (&m_filter_state), sizeof(m_filter_state));
+    stream.Read(&m_filter_state, sizeof(m_filter_state));
 
     if (version >= 24)
     {
-        stream.read(reinterpret_cast<char*> (&m_dc_prev_x), sizeof(m_dc_prev_x));
-        stream.read(reinterpret_cast<char*> (&m_dc_prev_y), sizeof(m_dc_prev_y));
-        stream.read(reinterpret_cast<char*> (&m_gain_smooth), sizeof(m_gain_smooth));
+        stream.Read(&m_dc_prev_x, sizeof(m_dc_prev_x));
+        stream.Read(&m_dc_prev_y, sizeof(m_dc_prev_y));
+        stream.Read(&m_gain_smooth, sizeof(m_gain_smooth));
     }
     else
     {
@@ -61,9 +61,10 @@ public:
     void Write(u16 address, u8 value);
     int EndFrame(s16* sample_buffer);
     u8* GetRAM();
+    DirtyPages* GetRAMDirtyPages();
     Adpcm_State* GetState();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GG_SAVESTATE_VERSION);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream, int version = GG_SAVESTATE_VERSION);
     void SetTraceLogger(TraceLogger* trace_logger);
 
 private:
@@ -91,6 +92,7 @@ private:
     Adpcm_State m_state;
     s16 m_step_delta[49 * 8] = {};
     u8 m_adpcm_ram[0x10000] = {};
+    DirtyPages m_adpcm_ram_dirty;
     u8 m_read_latency[36] = {};
     u8 m_write_latency[36] = {};
     u8 m_read_value;
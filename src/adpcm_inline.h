@@ -171,6 +171,7 @@ inline void Adpcm::UpdateReadWriteEvents(u32 cycles)
         {
             m_write_cycles = 0;
             m_adpcm_ram[m_write_address] = m_write_value;
+            m_adpcm_ram_dirty.Mark(m_write_address);
             m_write_address++;
 
             SetHalfIRQ(m_length < 0x8000);
@@ -388,6 +389,11 @@ INLINE u8* Adpcm::GetRAM()
     return m_adpcm_ram;
 }
 
+INLINE DirtyPages* Adpcm::GetRAMDirtyPages()
+{
+    return &m_adpcm_ram_dirty;
+}
+
 INLINE Adpcm::Adpcm_State* Adpcm::GetState()
 {
     return &m_state;
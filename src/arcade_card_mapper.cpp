@@ -26,6 +26,7 @@ ArcadeCardMapper::ArcadeCardMapper(Media* media, Memory* memory) : Mapper(media,
     Reset();
     InitPointer(m_card_memory);
     m_card_memory = new u8[0x200000];
+    m_card_memory_dirty.Init(0x200000);
 
     m_state.PORTS = m_ports;
     m_state.REGISTER = &m_register;
@@ -51,7 +52,10 @@ void ArcadeCardMapper::Write(u8 bank, u16 address, u8 value)
     if (bank >= 0x40 && bank <= 0x43)
         WritePortData(bank - 0x40, value);
     else if (m_memory->GetMemoryMapWrite()[bank])
+    {
         m_memory->GetMemoryMap()[bank][address] = value;
+        m_memory->MarkDirty(bank, address);
+    }
 }
 
 u8 ArcadeCardMapper::ReadHardware(u16 address)
@@ -262,48 +266,48 @@ void ArcadeCardMapper::WriteRegister(u8 reg, u8 value)
     }
 }
 
-void ArcadeCardMapper::SaveState(std::ostream& stream)
+void ArcadeCardMapper::SaveState(StateSerializer& stream)
 {
     using namespace std;
-    stream.write(reinterpret_cast<const char*> (&m_register), sizeof(m_register));
-    stream.write(reinterpret_cast<const char*> (&m_shift_amount), sizeof(m_shift_amount));
-    stream.write(reinterpret_cast<const char*> (&m_rotate_amount), sizeof(m_rotate_amount));
+    stream.Write(&m_register, sizeof(m_register));
+    stream.Write(&m_shift_amount, sizeof(m_shift_amount));
+    stream.Write(&m_rotate_amount, sizeof(m_rotate_amount));
 
     for (int i = 0; i < 4; ++i)
     {
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].base), sizeof(m_ports[i].base));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].offset), sizeof(m_ports[i].offset));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].increment), sizeof(m_ports[i].increment));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].control), sizeof(m_ports[i].control));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].add_offset), sizeof(m_ports[i].add_offset));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].auto_increment), sizeof(m_ports[i].auto_increment));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].signed_offset), sizeof(m_ports[i].signed_offset));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].increment_base), sizeof(m_ports[i].increment_base));
-        stream.write(reinterpret_cast<const char*> (&m_ports[i].offset_trigger), sizeof(m_ports[i].offset_trigger));
+        stream.Write(&m_ports[i].base, sizeof(m_ports[i].base));
+        stream.Write(&m_ports[i].offset, sizeof(m_ports[i].offset));
+        stream.Write(&m_ports[i].increment, sizeof(m_ports[i].increment));
+        stream.Write(&m_ports[i].control, sizeof(m_ports[i].control));
+        stream.Write(&m_ports[i].add_offset, sizeof(m_ports[i].add_offset));
+        stream.Write(&m_ports[i].auto_increment, sizeof(m_ports[i].auto_increment));
+        stream.Write(&m_ports[i].signed_offset, sizeof(m_ports[i].signed_offset));
+        stream.Write(&m_ports[i].increment_base, sizeof(m_ports[i].increment_base));
+        stream.Write(&m_ports[i].offset_trigger, sizeof(m_ports[i].offset_trigger));
     }
 
-    stream.write(reinterpret_cast<const char*>(m_card_memory), 0x200000);
+    stream.WritePages(m_card_memory, 0x200000, m_card_memory_dirty);
 }
 
-void ArcadeCardMapper::LoadState(std::istream& stream)
+void ArcadeCardMapper::LoadState(StateDeserializer& stream)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (&m_register), sizeof(m_register));
-    stream.read(reinterpret_cast<char*> (&m_shift_amount), sizeof(m_shift_amount));
-    stream.read(reinterpret_cast<char*> (&m_rotate_amount), sizeof(m_rotate_amount));
+    stream.Read(&m_register, sizeof(m_register));
+    stream.Read(&m_shift_amount, sizeof(m_shift_amount));
+    stream.Read(&m_rotate_amount, sizeof(m_rotate_amount));
 
     for (int i = 0; i < 4; ++i)
     {
-        stream.read(reinterpret_cast<char*> (&m_ports[i].base), sizeof(m_ports[i].base));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].offset), sizeof(m_ports[i].offset));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].increment), sizeof(m_ports[i].increment));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].control), sizeof(m_ports[i].control));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].add_offset), sizeof(m_ports[i].add_offset));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].auto_increment), sizeof(m_ports[i].auto_increment));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].signed_offset), sizeof(m_ports[i].signed_offset));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].increment_base), sizeof(m_ports[i].increment_base));
-        stream.read(reinterpret_cast<char*> (&m_ports[i].offset_trigger), sizeof(m_ports[i].offset_trigger));
+        stream.Read(&m_ports[i].base, sizeof(m_ports[i].base));
+        stream.Read(&m_ports[i].offset, sizeof(m_ports[i].offset));
+        stream.Read(&m_ports[i].increment, sizeof(m_ports[i].increment));
+        stream.Read(&m_ports[i].control, sizeof(m_ports[i].control));
+        stream.Read(&m_ports[i].add_offset, sizeof(m_ports[i].add_offset));
+        stream.Read(&m_ports[i].auto_increment, sizeof(m_ports[i].auto_increment));
+        stream.Read(&m_ports[i].signed_offset, sizeof(m_ports[i].signed_offset));
+        stream.Read(&m_ports[i].increment_base, sizeof(m_ports[i].increment_base));
+        stream.Read(&m_ports[i].offset_trigger, sizeof(m_ports[i].offset_trigger));
     }
 
-    stream.read(reinterpret_cast<char*>(m_card_memory), 0x200000);
+    stream.ReadPages(m_card_memory, 0x200000, m_card_memory_dirty);
 }
\ No newline at end of file
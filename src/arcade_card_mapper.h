@@ -67,10 +67,11 @@ public:
     virtual u8 ReadHardware(u16 address);
     virtual void WriteHardware(u16 address, u8 value);
     virtual void Reset();
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream);
+    virtual void SaveState(StateSerializer& stream);
+    virtual void LoadState(StateDeserializer& stream);
     u8 PeekPortData(u8 port);
     u8* GetRAM(void);
+    DirtyPages* GetDirtyPages(void);
     ArcadeCard_State* GetState(void);
 
 private:
@@ -88,6 +89,7 @@ private:
 private:
     ArcadeCard_State m_state;
     u8* m_card_memory;
+    DirtyPages m_card_memory_dirty;
     ArcadeCard_Port m_ports[4];
     u32 m_register;
     u8 m_shift_amount;
@@ -40,6 +40,7 @@ INLINE void ArcadeCardMapper::WritePortData(u8 port, u8 value)
     u32 address = EffectiveAddress(port);
     Increment(port);
     m_card_memory[address] = value;
+    m_card_memory_dirty.Mark(address);
 }
 
 INLINE void ArcadeCardMapper::Increment(u8 port)
@@ -95,6 +96,11 @@ INLINE u8* ArcadeCardMapper::GetRAM(void)
     return m_card_memory;
 }
 
+INLINE DirtyPages* ArcadeCardMapper::GetDirtyPages(void)
+{
+    return &m_card_memory_dirty;
+}
+
 INLINE ArcadeCardMapper::ArcadeCard_State* ArcadeCardMapper::GetState(void)
 {
     return &m_state;
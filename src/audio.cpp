@@ -25,6 +25,7 @@
 #include "adpcm.h"
 #include "cdrom_audio.h"
 #include "trace_logger.h"
+#include "profiler.h"
 
 Audio::Audio(Adpcm* adpcm, CdRomAudio* cdrom_audio)
 {
@@ -33,9 +34,11 @@ Audio::Audio(Adpcm* adpcm, CdRomAudio* cdrom_audio)
     InitPointer(m_psg);
     InitPointer(m_trace_logger);
     m_mute = false;
+    m_speculative = false;
     m_is_cdrom = false;
     m_cycle_counter = 0;
     m_sample_clock_counter = 0;
+    m_frame_samples = 0;
     m_master_volume = 1.0f;
     m_psg_volume = 1.0f;
     m_adpcm_volume = 1.0f;
@@ -59,6 +62,11 @@ void Audio::SetTraceLogger(TraceLogger* trace_logger)
     m_trace_logger = trace_logger;
 }
 
+void Audio::SetPerfCounters(GG_Perf_Counters* perf_counters)
+{
+    m_psg->SetPerfCounters(perf_counters);
+}
+
 void Audio::LogPsgEvent(u32 address, u8 value)
 {
 #if !defined(GG_DISABLE_DISASSEMBLER)
@@ -79,6 +87,7 @@ void Audio::Reset(bool cdrom)
     m_is_cdrom = cdrom;
     m_cycle_counter = 0;
     m_sample_clock_counter = 0;
+    m_frame_samples = 0;
     m_psg->Reset();
 
     memset(m_psg_buffer, 0, sizeof(m_psg_buffer));
@@ -88,10 +97,30 @@ void Audio::Reset(bool cdrom)
 
 void Audio::EndFrame(s16* sample_buffer, int* sample_count)
 {
+    GG_PROFILE_ZONE("Audio::EndFrame");
+
+    if (m_speculative)
+    {
+        // Sources keep their per-sample cadence and filter history so the
+        // state matches a normal frame, only the final mix is skipped
+        m_psg->EndFrame(m_psg_buffer);
+        if (m_is_cdrom)
+        {
+            m_adpcm->EndFrame(m_adpcm_buffer);
+            m_cdrom_audio->EndFrame(m_cdrom_buffer);
+        }
+
+        m_frame_samples = 0;
+        if (IsValidPointer(sample_count))
+            *sample_count = 0;
+        return;
+    }
+
     if (!IsValidPointer(sample_buffer) || !IsValidPointer(sample_count))
         return;
 
     *sample_count = 0;
+    m_frame_samples = 0;
 
     if (m_is_cdrom)
     {
@@ -122,6 +151,7 @@ void Audio::EndFrame(s16* sample_buffer, int* sample_count)
         int samples = count_psg;
 
         *sample_count = samples;
+        m_frame_samples = samples;
 
         if (m_mute)
             memset(sample_buffer, 0, sizeof(s16) * samples);
@@ -161,6 +191,7 @@ void Audio::EndFrame(s16* sample_buffer, int* sample_count)
         }
 
         *sample_count = samples;
+        m_frame_samples = samples;
 
         if (m_mute || (m_master_volume <= 0.0f) || (m_psg_volume <= 0.0f))
             memset(sample_buffer, 0, sizeof(s16) * samples);
@@ -179,20 +210,50 @@ void Audio::EndFrame(s16* sample_buffer, int* sample_count)
 
 }
 
-void Audio::SaveState(std::ostream& stream)
+// Returns the unmixed samples of one source for the last completed frame,
+// before any volume is applied. Sources not present on the current media are silent.
+int Audio::GetStemFrame(GG_Audio_Stem stem, s16* sample_buffer)
+{
+    if (!IsValidPointer(sample_buffer))
+        return 0;
+
+    int samples = m_frame_samples;
+
+    switch (stem)
+    {
+        case GG_AUDIO_STEM_ADPCM:
+            if (m_is_cdrom)
+                memcpy(sample_buffer, m_adpcm_buffer, sizeof(s16) * samples);
+            else
+                memset(sample_buffer, 0, sizeof(s16) * samples);
+            return samples;
+        case GG_AUDIO_STEM_CDROM:
+            if (m_is_cdrom)
+                memcpy(sample_buffer, m_cdrom_buffer, sizeof(s16) * samples);
+            else
+                memset(sample_buffer, 0, sizeof(s16) * samples);
+            return samples;
+        case GG_AUDIO_STEM_COUNT:
+            return 0;
+        default:
+            return m_psg->GetChannelFrame(stem - GG_AUDIO_STEM_PSG_1, sample_buffer);
+    }
+}
+
+void Audio::SaveState(StateSerializer& stream)
 {
     using namespace std;
-    stream.write(reinterpret_cast<const char*> (&m_cycle_counter), sizeof(m_cycle_counter));
-    stream.write(reinterpret_cast<const char*> (&m_sample_clock_counter), sizeof(m_sample_clock_counter));
+    stream.Write(&m_cycle_counter, sizeof(m_cycle_counter));
+    stream.Write(&m_sample_clock_counter, sizeof(m_sample_clock_counter));
     m_psg->SaveState(stream);
 }
 
-void Audio::LoadState(std::istream& stream, int version)
+void Audio::LoadState(StateDeserializer& stream, int version)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (&m_cycle_counter), sizeof(m_cycle_counter));
+    stream.Read(&m_cycle_counter, sizeof(m_cycle_counter));
     if (version >= 32)
-        stream.read(reinterpret_cast<char*> (&m_sample_clock_counter), sizeof(m_sample_clock_counter));
+        stream.Read(&m_sample_clock_counter, sizeof(m_sample_clock_counter));
     else
         m_sample_clock_counter = 0;
     m_psg->LoadState(stream, version);
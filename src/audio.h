@@ -38,20 +38,24 @@ public:
     void Init();
     void Reset(bool cdrom);
     void Mute(bool mute);
+    void SetSpeculative(bool speculative);
     void SetMasterVolume(float volume);
     void SetPSGVolume(float volume);
     void SetADPCMVolume(float volume);
     void SetCDROMVolume(float volume);
+    void CopySettings(const Audio* source);
     void Clock(u32 cycles);
     void WritePSG(u32 address, u8 value);
     void EndFrame(s16* sample_buffer, int* sample_count);
+    int GetStemFrame(GG_Audio_Stem stem, s16* sample_buffer);
     HuC6280PSG* GetPSG();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GG_SAVESTATE_VERSION);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream, int version = GG_SAVESTATE_VERSION);
     bool StartVgmRecording(const char* file_path, int clock_rate, const VgmMetadata& metadata);
     void StopVgmRecording();
     bool IsVgmRecording() const;
     void SetTraceLogger(TraceLogger* trace_logger);
+    void SetPerfCounters(GG_Perf_Counters* perf_counters);
 
 private:
     void TracePsgEvent(u32 address, u8 value);
@@ -61,6 +65,7 @@ private:
 
 private:
     bool m_mute;
+    bool m_speculative;
     bool m_is_cdrom;
     TraceLogger* m_trace_logger;
     HuC6280PSG* m_psg;
@@ -69,6 +74,7 @@ private:
     s16 m_psg_buffer[GG_AUDIO_BUFFER_SIZE] = {};
     s16 m_adpcm_buffer[GG_AUDIO_BUFFER_SIZE] = {};
     s16 m_cdrom_buffer[GG_AUDIO_BUFFER_SIZE] = {};
+    int m_frame_samples;
     u32 m_cycle_counter;
     u64 m_sample_clock_counter;
     float m_master_volume;
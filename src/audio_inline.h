@@ -117,6 +117,11 @@ INLINE void Audio::Mute(bool mute)
     m_mute = mute;
 }
 
+INLINE void Audio::SetSpeculative(bool speculative)
+{
+    m_speculative = speculative;
+}
+
 INLINE void Audio::SetMasterVolume(float volume)
 {
     m_master_volume = CLAMP(volume, 0.0f, 2.0f);
@@ -137,4 +142,14 @@ INLINE void Audio::SetCDROMVolume(float volume)
     m_cdrom_volume = CLAMP(volume, 0.0f, 2.0f);
 }
 
+INLINE void Audio::CopySettings(const Audio* source)
+{
+    m_mute = source->m_mute;
+    m_master_volume = source->m_master_volume;
+    m_psg_volume = source->m_psg_volume;
+    m_adpcm_volume = source->m_adpcm_volume;
+    m_cdrom_volume = source->m_cdrom_volume;
+    m_psg->CopySettings(source->m_psg);
+}
+
 #endif /* AUDIO_INLINE_H */
@@ -280,50 +280,50 @@ void CdRom::WriteRegister(u16 address, u8 value)
     }
 }
 
-void CdRom::SaveState(std::ostream& stream)
+void CdRom::SaveState(StateSerializer& stream)
 {
     using namespace std;
 
-    stream.write(reinterpret_cast<const char*> (&m_reset), sizeof(m_reset));
-    stream.write(reinterpret_cast<const char*> (&m_bram_enabled), sizeof(m_bram_enabled));
-    stream.write(reinterpret_cast<const char*> (&m_active_irqs), sizeof(m_active_irqs));
-    stream.write(reinterpret_cast<const char*> (&m_enabled_irqs), sizeof(m_enabled_irqs));
-    stream.write(reinterpret_cast<const char*> (&m_cdaudio_sample_toggle), sizeof(m_cdaudio_sample_toggle));
-    stream.write(reinterpret_cast<const char*> (&m_cdaudio_sample), sizeof(m_cdaudio_sample));
-    stream.write(reinterpret_cast<const char*> (&m_cdaudio_sample_last_clock), sizeof(m_cdaudio_sample_last_clock));
-    stream.write(reinterpret_cast<const char*> (&m_fader), sizeof(m_fader));
-    stream.write(reinterpret_cast<const char*> (&m_fader_enabled), sizeof(m_fader_enabled));
-    stream.write(reinterpret_cast<const char*> (&m_fader_adpcm), sizeof(m_fader_adpcm));
-    stream.write(reinterpret_cast<const char*> (&m_fader_fast), sizeof(m_fader_fast));
-    stream.write(reinterpret_cast<const char*> (&m_fader_start_cycles), sizeof(m_fader_start_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_fader_cycles), sizeof(m_fader_cycles));
+    stream.Write(&m_reset, sizeof(m_reset));
+    stream.Write(&m_bram_enabled, sizeof(m_bram_enabled));
+    stream.Write(&m_active_irqs, sizeof(m_active_irqs));
+    stream.Write(&m_enabled_irqs, sizeof(m_enabled_irqs));
+    stream.Write(&m_cdaudio_sample_toggle, sizeof(m_cdaudio_sample_toggle));
+    stream.Write(&m_cdaudio_sample, sizeof(m_cdaudio_sample));
+    stream.Write(&m_cdaudio_sample_last_clock, sizeof(m_cdaudio_sample_last_clock));
+    stream.Write(&m_fader, sizeof(m_fader));
+    stream.Write(&m_fader_enabled, sizeof(m_fader_enabled));
+    stream.Write(&m_fader_adpcm, sizeof(m_fader_adpcm));
+    stream.Write(&m_fader_fast, sizeof(m_fader_fast));
+    stream.Write(&m_fader_start_cycles, sizeof(m_fader_start_cycles));
+    stream.Write(&m_fader_cycles, sizeof(m_fader_cycles));
 }
 
-void CdRom::LoadState(std::istream& stream, int version)
+void CdRom::LoadState(StateDeserializer& stream, int version)
 {
     using namespace std;
 
-    stream.read(reinterpret_cast<char*> (&m_reset), sizeof(m_reset));
-    stream.read(reinterpret_cast<char*> (&m_bram_enabled), sizeof(m_bram_enabled));
-    stream.read(reinterpret_cast<char*> (&m_active_irqs), sizeof(m_active_irqs));
-    stream.read(reinterpret_cast<char*> (&m_enabled_irqs), sizeof(m_enabled_irqs));
-    stream.read(reinterpret_cast<char*> (&m_cdaudio_sample_toggle), sizeof(m_cdaudio_sample_toggle));
-    stream.read(reinterpret_cast<char*> (&m_cdaudio_sample), sizeof(m_cdaudio_sample));
+    stream.Read(&m_reset, sizeof(m_reset));
+    stream.Read(&m_bram_enabled, sizeof(m_bram_enabled));
+    stream.Read(&m_active_irqs, sizeof(m_active_irqs));
+    stream.Read(&m_enabled_irqs, sizeof(m_enabled_irqs));
+    stream.Read(&m_cdaudio_sample_toggle, sizeof(m_cdaudio_sample_toggle));
+    stream.Read(&m_cdaudio_sample, sizeof(m_cdaudio_sample));
     if (version >= 27)
-        stream.read(reinterpret_cast<char*> (&m_cdaudio_sample_last_clock), sizeof(m_cdaudio_sample_last_clock));
+        stream.Read(&m_cdaudio_sample_last_clock, sizeof(m_cdaudio_sample_last_clock));
     else
         m_cdaudio_sample_last_clock = 0;
 
-    stream.read(reinterpret_cast<char*> (&m_fader), sizeof(m_fader));
-    stream.read(reinterpret_cast<char*> (&m_fader_enabled), sizeof(m_fader_enabled));
-    stream.read(reinterpret_cast<char*> (&m_fader_adpcm), sizeof(m_fader_adpcm));
-    stream.read(reinterpret_cast<char*> (&m_fader_fast), sizeof(m_fader_fast));
+    stream.Read(&m_fader, sizeof(m_fader));
+    stream.Read(&m_fader_enabled, sizeof(m_fader_enabled));
+    stream.Read(&m_fader_adpcm, sizeof(m_fader_adpcm));
+    stream.Read(&m_fader_fast, sizeof(m_fader_fast));
     if (version >= 27)
-        stream.read(reinterpret_cast<char*> (&m_fader_start_cycles), sizeof(m_fader_start_cycles));
+        stream.Read(&m_fader_start_cycles, sizeof(m_fader_start_cycles));
     else
         m_fader_start_cycles = 0;
 
-    stream.read(reinterpret_cast<char*> (&m_fader_cycles), sizeof(m_fader_cycles));
+    stream.Read(&m_fader_cycles, sizeof(m_fader_cycles));
 
     m_memory->UpdateBackupRam(m_bram_enabled);
 }
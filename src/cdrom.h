@@ -67,8 +67,8 @@ public:
     double GetFaderValue();
     CdRom_State* GetState();
     void SetTraceLogger(TraceLogger* trace_logger);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GG_SAVESTATE_VERSION);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream, int version = GG_SAVESTATE_VERSION);
 
 private:
     void TraceCdRomEvent(u8 event, u8 value = 0);
@@ -126,41 +126,41 @@ int CdRomAudio::EndFrame(s16* sample_buffer)
     return samples;
 }
 
-void CdRomAudio::SaveState(std::ostream& stream)
+void CdRomAudio::SaveState(StateSerializer& stream)
 {
     using namespace std;
 
-    stream.write(reinterpret_cast<const char*> (&m_buffer_index), sizeof(m_buffer_index));
-    stream.write(reinterpret_cast<const char*> (&m_frame_samples), sizeof(m_frame_samples));
-    stream.write(reinterpret_cast<const char*> (m_buffer), sizeof(m_buffer));
-    stream.write(reinterpret_cast<const char*> (&m_current_state), sizeof(m_current_state));
-    stream.write(reinterpret_cast<const char*> (&m_start_lba), sizeof(m_start_lba));
-    stream.write(reinterpret_cast<const char*> (&m_stop_lba), sizeof(m_stop_lba));
-    stream.write(reinterpret_cast<const char*> (&m_current_lba), sizeof(m_current_lba));
-    stream.write(reinterpret_cast<const char*> (&m_seek_start_lba), sizeof(m_seek_start_lba));
-    stream.write(reinterpret_cast<const char*> (&m_current_sample), sizeof(m_current_sample));
-    stream.write(reinterpret_cast<const char*> (&m_stop_event), sizeof(m_stop_event));
-    stream.write(reinterpret_cast<const char*> (&m_seek_cycles), sizeof(m_seek_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_playback_delay_cycles), sizeof(m_playback_delay_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_left_sample), sizeof(m_left_sample));
-    stream.write(reinterpret_cast<const char*> (&m_right_sample), sizeof(m_right_sample));
+    stream.Write(&m_buffer_index, sizeof(m_buffer_index));
+    stream.Write(&m_frame_samples, sizeof(m_frame_samples));
+    stream.Write(m_buffer, sizeof(m_buffer));
+    stream.Write(&m_current_state, sizeof(m_current_state));
+    stream.Write(&m_start_lba, sizeof(m_start_lba));
+    stream.Write(&m_stop_lba, sizeof(m_stop_lba));
+    stream.Write(&m_current_lba, sizeof(m_current_lba));
+    stream.Write(&m_seek_start_lba, sizeof(m_seek_start_lba));
+    stream.Write(&m_current_sample, sizeof(m_current_sample));
+    stream.Write(&m_stop_event, sizeof(m_stop_event));
+    stream.Write(&m_seek_cycles, sizeof(m_seek_cycles));
+    stream.Write(&m_playback_delay_cycles, sizeof(m_playback_delay_cycles));
+    stream.Write(&m_left_sample, sizeof(m_left_sample));
+    stream.Write(&m_right_sample, sizeof(m_right_sample));
 }
 
-void CdRomAudio::LoadState(std::istream& stream, int version)
+void CdRomAudio::LoadState(StateDeserializer& stream, int version)
 {
     using namespace std;
 
     if (version < 32)
     {
         s32 sample_cycle_counter = 0;
-        stream.read(reinterpret_cast<char*> (&sample_cycle_counter), sizeof(sample_cycle_counter));
+        stream.Read(&sample_cycle_counter, sizeof(sample_cycle_counter));
     }
 
     if (version >= 27)
     {
-        stream.read(reinterpret_cast<char*> (&m_buffer_index), sizeof(m_buffer_index));
-        stream.read(reinterpret_cast<char*> (&m_frame_samples), sizeof(m_frame_samples));
-        stream.read(reinterpret_cast<char*> (m_buffer), sizeof(m_buffer));
+        stream.Read(&m_buffer_index, sizeof(m_buffer_index));
+        stream.Read(&m_frame_samples, sizeof(m_frame_samples));
+        stream.Read(m_buffer, sizeof(m_buffer));
 
         m_buffer_index = CLAMP(m_buffer_index, 0, GG_AUDIO_BUFFER_SIZE - 2);
         m_buffer_index &= ~1;
@@ -173,29 +173,29 @@ void CdRomAudio::LoadState(std::istream& stream, int version)
         memset(m_buffer, 0, sizeof(m_buffer));
     }
 
-    stream.read(reinterpret_cast<char*> (&m_current_state), sizeof(m_current_state));
-    stream.read(reinterpret_cast<char*> (&m_start_lba), sizeof(m_start_lba));
-    stream.read(reinterpret_cast<char*> (&m_stop_lba), sizeof(m_stop_lba));
-    stream.read(reinterpret_cast<char*> (&m_current_lba), sizeof(m_current_lba));
+    stream.Read(&m_current_state, sizeof(m_current_state));
+    stream.Read(&m_start_lba, sizeof(m_start_lba));
+    stream.Read(&m_stop_lba, sizeof(m_stop_lba));
+    stream.Read(&m_current_lba, sizeof(m_current_lba));
 
     if (version >= 32)
-        stream.read(reinterpret_cast<char*> (&m_seek_start_lba), sizeof(m_seek_start_lba));
+        stream.Read(&m_seek_start_lba, sizeof(m_seek_start_lba));
     else
         m_seek_start_lba = m_current_lba;
 
-    stream.read(reinterpret_cast<char*> (&m_current_sample), sizeof(m_current_sample));
+    stream.Read(&m_current_sample, sizeof(m_current_sample));
     if (m_current_sample >= (2352 / 4))
         m_current_sample = 0;
-    stream.read(reinterpret_cast<char*> (&m_stop_event), sizeof(m_stop_event));
-    stream.read(reinterpret_cast<char*> (&m_seek_cycles), sizeof(m_seek_cycles));
+    stream.Read(&m_stop_event, sizeof(m_stop_event));
+    stream.Read(&m_seek_cycles, sizeof(m_seek_cycles));
 
     if (version >= 34)
-        stream.read(reinterpret_cast<char*> (&m_playback_delay_cycles), sizeof(m_playback_delay_cycles));
+        stream.Read(&m_playback_delay_cycles, sizeof(m_playback_delay_cycles));
     else
         m_playback_delay_cycles = 0;
 
-    stream.read(reinterpret_cast<char*> (&m_left_sample), sizeof(m_left_sample));
-    stream.read(reinterpret_cast<char*> (&m_right_sample), sizeof(m_right_sample));
+    stream.Read(&m_left_sample, sizeof(m_left_sample));
+    stream.Read(&m_right_sample, sizeof(m_right_sample));
 
     InvalidateSectorCache();
     SyncMediaCurrentSector();
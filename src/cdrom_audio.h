@@ -80,8 +80,8 @@ public:
     void SetStopLBA(u32 lba, CdAudioStopEvent event);
     s16 GetLeftSample();
     s16 GetRightSample();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GG_SAVESTATE_VERSION);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream, int version = GG_SAVESTATE_VERSION);
     void SetTraceLogger(TraceLogger* trace_logger);
 
 private:
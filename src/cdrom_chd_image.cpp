@@ -26,10 +26,21 @@ CdRomChdImage::CdRomChdImage() : CdRomImage()
     InitPointer(m_chd_file);
     InitPointer(m_file_adapter);
     InitPointer(m_hunk_cache);
+    InitPointer(m_hunk_state);
+    InitPointer(m_lru_prev);
+    InitPointer(m_lru_next);
+    m_load_options = GG_CdRomChdDefaultLoadOptions();
+    m_hunk_count = 0;
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    m_prefetch_running.store(false);
+#endif
 }
 
 CdRomChdImage::~CdRomChdImage()
 {
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    StopPrefetchWorker();
+#endif
     chd_close(m_chd_file);
     SafeDelete(m_file_adapter);
     DestroyHunkCache();
@@ -45,15 +56,24 @@ void CdRomChdImage::Reset()
 {
     CdRomImage::Reset();
 
-    m_hunk_bytes = 0;
-    m_hunk_count = 0;
-    m_sectors_per_hunk = 0;
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    StopPrefetchWorker();
+#endif
 
     chd_close(m_chd_file);
     InitPointer(m_chd_file);
     SafeDelete(m_file_adapter);
 
     DestroyHunkCache();
+
+    m_hunk_bytes = 0;
+    m_hunk_count = 0;
+    m_sectors_per_hunk = 0;
+}
+
+void CdRomChdImage::SetLoadOptions(const GG_CdRomChdLoadOptions& options)
+{
+    m_load_options = options;
 }
 
 bool CdRomChdImage::LoadFromFile(const char* path, bool preload)
@@ -150,6 +170,11 @@ bool CdRomChdImage::LoadFromFile(const char* path, bool preload)
         m_ready = false;
     }
 
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    if (m_ready && (m_load_options.prefetch_hunks > 0) && (m_max_cached_hunks < m_hunk_count))
+        StartPrefetchWorker();
+#endif
+
     if (!m_ready)
         Reset();
 
@@ -176,10 +201,6 @@ bool CdRomChdImage::ReadSector(u32 lba, u8* buffer)
     u32 hunk_index  = sector_index / m_sectors_per_hunk;
     u32 hunk_offset = sector_index % m_sectors_per_hunk;
     u32 byte_offset_in_hunk = hunk_offset * (2352 + 96);
-
-    if (!LoadHunk(hunk_index))
-        return false;
-
     u32 sector_offset = 0;
 
     if (track.sector_size == 2352)
@@ -196,7 +217,12 @@ bool CdRomChdImage::ReadSector(u32 lba, u8* buffer)
     Debug("Reading LBA %d, sector_index %u, hunk_index %u, hunk_offset %u, byte_offset_in_hunk %d, sector_offset %d",
         lba, sector_index, hunk_index, hunk_offset, byte_offset_in_hunk, sector_offset);
 
-    memcpy(buffer, m_hunk_cache[hunk_index] + final_offset, 2048);
+    if (!LoadHunk(m_chd_file, hunk_index, final_offset, buffer, 2048))
+        return false;
+
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    QueuePrefetch(hunk_index + 1, PrefetchWindow());
+#endif
 
     m_current_sector = lba + 1;
     if (m_current_sector >= m_toc.sector_count)
@@ -231,10 +257,6 @@ bool CdRomChdImage::ReadSamples(u32 lba, u32 offset, s16* buffer, u32 count)
     u32 hunk_index  = sector_index / m_sectors_per_hunk;
     u32 hunk_offset = sector_index % m_sectors_per_hunk;
     u32 byte_offset_in_hunk = hunk_offset * (2352 + 96);
-
-    if (!LoadHunk(hunk_index))
-        return false;
-
     u32 size = count * 2;
     u32 final_offset = byte_offset_in_hunk + offset;
 
@@ -244,7 +266,12 @@ bool CdRomChdImage::ReadSamples(u32 lba, u32 offset, s16* buffer, u32 count)
         return false;
     }
 
-    memcpy(buffer, m_hunk_cache[hunk_index] + final_offset, size);
+    if (!LoadHunk(m_chd_file, hunk_index, final_offset, buffer, size))
+        return false;
+
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    QueuePrefetch(hunk_index + 1, PrefetchWindow());
+#endif
 
     m_current_sector = lba;
 
@@ -273,6 +300,19 @@ bool CdRomChdImage::PreloadDisc()
         return false;
     }
 
+    if (m_load_options.precache_decode)
+    {
+        Log("Preloading and decoding CHD disc...");
+
+        if (!PrecacheHunks())
+        {
+            Error("PreloadDisc failed - Unable to decode all hunks");
+            return false;
+        }
+
+        return true;
+    }
+
     Log("Preloading CHD disc...");
     chd_error err = chd_precache(m_chd_file);
 
@@ -310,11 +350,22 @@ bool CdRomChdImage::PreloadTrack(u32 track_number)
     u32 first_hunk = first_sector / m_sectors_per_hunk;
     u32 last_hunk  = last_sector  / m_sectors_per_hunk;
 
-    Debug("Preloading track %u: hunks %u to %u", track_number + 1, first_hunk, last_hunk);
+    // Only the start of the track is warmed up, the rest streams in behind the reads
+    u32 hunk_count = MIN(last_hunk - first_hunk + 1, PrefetchWindow());
+
+    Debug("Preloading track %u: hunks %u to %u", track_number + 1, first_hunk, first_hunk + hunk_count - 1);
+
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    if (m_prefetch_running.load())
+    {
+        QueuePrefetch(first_hunk, hunk_count);
+        return true;
+    }
+#endif
 
-    for (u32 hunk = first_hunk; hunk <= last_hunk; hunk++)
+    for (u32 hunk = first_hunk; hunk < first_hunk + hunk_count; hunk++)
     {
-        if (!LoadHunk(hunk))
+        if (!LoadHunk(m_chd_file, hunk, 0, NULL, 0))
         {
             Error("PreloadTrack failed - Unable to load hunk %u", hunk);
             return false;
@@ -568,12 +619,29 @@ bool CdRomChdImage::InitHunkCache()
     }
 
     m_hunk_cache = new u8*[m_hunk_count];
+    m_hunk_state = new u8[m_hunk_count];
+    m_lru_prev = new u32[m_hunk_count];
+    m_lru_next = new u32[m_hunk_count];
 
     for (u32 i = 0; i < m_hunk_count; i++)
     {
         InitPointer(m_hunk_cache[i]);
+        m_hunk_state[i] = HUNK_EMPTY;
+        m_lru_prev[i] = GG_CDROM_CHD_NO_HUNK;
+        m_lru_next[i] = GG_CDROM_CHD_NO_HUNK;
     }
 
+    m_lru_head = GG_CDROM_CHD_NO_HUNK;
+    m_lru_tail = GG_CDROM_CHD_NO_HUNK;
+    m_cached_hunks = 0;
+
+    if (m_load_options.cache_budget == GG_CDROM_CHD_CACHE_UNLIMITED)
+        m_max_cached_hunks = m_hunk_count;
+    else
+        m_max_cached_hunks = MIN(MAX(m_load_options.cache_budget / m_hunk_bytes, (u32)GG_CDROM_CHD_MIN_CACHED_HUNKS), m_hunk_count);
+
+    Debug("CHD hunk cache: %u of %u hunks (%u bytes each)", m_max_cached_hunks, m_hunk_count, m_hunk_bytes);
+
     return true;
 }
 
@@ -587,9 +655,17 @@ void CdRomChdImage::DestroyHunkCache()
         }
         SafeDeleteArray(m_hunk_cache);
     }
+
+    SafeDeleteArray(m_hunk_state);
+    SafeDeleteArray(m_lru_prev);
+    SafeDeleteArray(m_lru_next);
+    m_lru_head = GG_CDROM_CHD_NO_HUNK;
+    m_lru_tail = GG_CDROM_CHD_NO_HUNK;
+    m_cached_hunks = 0;
+    m_max_cached_hunks = 0;
 }
 
-bool CdRomChdImage::LoadHunk(u32 hunk_index)
+bool CdRomChdImage::LoadHunk(chd_file* chd, u32 hunk_index, u32 offset, void* buffer, u32 size)
 {
     if (hunk_index >= m_hunk_count)
     {
@@ -597,24 +673,311 @@ bool CdRomChdImage::LoadHunk(u32 hunk_index)
         return false;
     }
 
-    if (m_hunk_cache[hunk_index] == NULL)
-    {
-        m_hunk_cache[hunk_index] = new u8[m_hunk_bytes];
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    std::unique_lock<std::mutex> lock(m_cache_mutex);
 
-        Debug("Caching hunk %u", hunk_index);
+    while (m_hunk_state[hunk_index] == HUNK_LOADING)
+    {
+        // Warming up only, whoever is decoding this hunk will finish it
+        if (!IsValidPointer(buffer))
+            return true;
 
-        chd_error err = chd_read(m_chd_file, hunk_index, m_hunk_cache[hunk_index]);
+        m_hunk_condition.wait(lock);
+    }
+#endif
 
-        if (err != CHDERR_NONE)
+    if (m_hunk_state[hunk_index] == HUNK_READY)
+    {
+        if (IsValidPointer(buffer))
         {
-            Error("CHD read hunk %u failed: %d, %s", hunk_index, err, chd_error_string(err));
-            return false;
+            GG_PERF_ADD(m_perf_counters, cd_cache_hits, 1);
+            UnlinkHunk(hunk_index);
+            LinkHunk(hunk_index);
+            memcpy(buffer, m_hunk_cache[hunk_index] + offset, size);
         }
+        return true;
+    }
+
+    if (IsValidPointer(buffer))
+        GG_PERF_ADD(m_perf_counters, cd_cache_misses, 1);
+
+    u8* data = AcquireHunkBuffer();
+    m_hunk_state[hunk_index] = HUNK_LOADING;
+
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    lock.unlock();
+#endif
+
+    Debug("Caching hunk %u", hunk_index);
+
+    chd_error err = chd_read(chd, hunk_index, data);
+
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    lock.lock();
+#endif
+
+    if (err != CHDERR_NONE)
+    {
+        Error("CHD read hunk %u failed: %d, %s", hunk_index, err, chd_error_string(err));
+        SafeDeleteArray(data);
+        m_cached_hunks--;
+        m_hunk_state[hunk_index] = HUNK_EMPTY;
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+        m_hunk_condition.notify_all();
+#endif
+        return false;
+    }
+
+    m_hunk_cache[hunk_index] = data;
+    m_hunk_state[hunk_index] = HUNK_READY;
+    LinkHunk(hunk_index);
+
+    if (IsValidPointer(buffer))
+        memcpy(buffer, data + offset, size);
+
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    m_hunk_condition.notify_all();
+#endif
+
+    return true;
+}
+
+u8* CdRomChdImage::AcquireHunkBuffer()
+{
+    u32 victim = m_lru_tail;
+
+    if ((m_cached_hunks < m_max_cached_hunks) || (victim == GG_CDROM_CHD_NO_HUNK))
+    {
+        m_cached_hunks++;
+        return new u8[m_hunk_bytes];
+    }
+
+    UnlinkHunk(victim);
+    u8* data = m_hunk_cache[victim];
+    InitPointer(m_hunk_cache[victim]);
+    m_hunk_state[victim] = HUNK_EMPTY;
+
+    return data;
+}
+
+void CdRomChdImage::LinkHunk(u32 hunk_index)
+{
+    m_lru_prev[hunk_index] = GG_CDROM_CHD_NO_HUNK;
+    m_lru_next[hunk_index] = m_lru_head;
+
+    if (m_lru_head != GG_CDROM_CHD_NO_HUNK)
+        m_lru_prev[m_lru_head] = hunk_index;
+    else
+        m_lru_tail = hunk_index;
+
+    m_lru_head = hunk_index;
+}
+
+void CdRomChdImage::UnlinkHunk(u32 hunk_index)
+{
+    u32 prev = m_lru_prev[hunk_index];
+    u32 next = m_lru_next[hunk_index];
+
+    if (prev != GG_CDROM_CHD_NO_HUNK)
+        m_lru_next[prev] = next;
+    else
+        m_lru_head = next;
+
+    if (next != GG_CDROM_CHD_NO_HUNK)
+        m_lru_prev[next] = prev;
+    else
+        m_lru_tail = prev;
+
+    m_lru_prev[hunk_index] = GG_CDROM_CHD_NO_HUNK;
+    m_lru_next[hunk_index] = GG_CDROM_CHD_NO_HUNK;
+}
+
+u32 CdRomChdImage::PrefetchWindow()
+{
+    // Keep the window well below the cache size so prefetching never evicts what is being read
+    u32 window = MIN(m_load_options.prefetch_hunks, m_max_cached_hunks / 2);
+    return MAX(window, (u32)1);
+}
+
+bool CdRomChdImage::OpenChd(CdRomChdFileAdapter** adapter, chd_file** chd)
+{
+    *adapter = new CdRomChdFileAdapter;
+    *chd = NULL;
+
+    chd_error err = (*adapter)->Open(m_file_path) ? chd_open_core_file((*adapter)->GetCoreFile(), CHD_OPEN_READ, NULL, chd) : CHDERR_FILE_NOT_FOUND;
+
+    if (err != CHDERR_NONE)
+    {
+        Debug("Unable to open additional CHD handle for %s: %d, %s", m_file_path, err, chd_error_string(err));
+        chd_close(*chd);
+        *chd = NULL;
+        SafeDelete(*adapter);
+        return false;
+    }
+
+    return true;
+}
+
+bool CdRomChdImage::PrecacheHunks()
+{
+    {
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+        std::lock_guard<std::mutex> lock(m_cache_mutex);
+#endif
+        // A preloaded disc stays resident, the cache budget no longer applies
+        m_max_cached_hunks = m_hunk_count;
+    }
+
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    u32 thread_count = m_load_options.precache_threads;
+
+    if (thread_count == 0)
+        thread_count = std::thread::hardware_concurrency();
+
+    thread_count = MIN(MAX(thread_count, (u32)1), MIN(m_hunk_count, (u32)GG_CDROM_CHD_MAX_PRECACHE_THREADS));
+
+    Debug("Decoding %u CHD hunks with %u threads", m_hunk_count, thread_count);
+
+    std::atomic<u32> next_hunk(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+
+    for (u32 i = 1; i < thread_count; i++)
+        threads.push_back(std::thread(&CdRomChdImage::PrecacheThread, this, &next_hunk, &failed));
+
+    // The calling thread decodes with the main handle alongside the helpers
+    while (!failed.load())
+    {
+        u32 hunk_index = next_hunk.fetch_add(1);
+
+        if (hunk_index >= m_hunk_count)
+            break;
+
+        if (!LoadHunk(m_chd_file, hunk_index, 0, NULL, 0))
+            failed.store(true);
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    return !failed.load();
+#else
+    for (u32 hunk_index = 0; hunk_index < m_hunk_count; hunk_index++)
+    {
+        if (!LoadHunk(m_chd_file, hunk_index, 0, NULL, 0))
+            return false;
     }
 
     return true;
+#endif
 }
 
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+void CdRomChdImage::PrecacheThread(std::atomic<u32>* next_hunk, std::atomic<bool>* failed)
+{
+    CdRomChdFileAdapter* adapter = NULL;
+    chd_file* chd = NULL;
+
+    if (!OpenChd(&adapter, &chd))
+        return;
+
+    while (!failed->load())
+    {
+        u32 hunk_index = next_hunk->fetch_add(1);
+
+        if (hunk_index >= m_hunk_count)
+            break;
+
+        if (!LoadHunk(chd, hunk_index, 0, NULL, 0))
+            failed->store(true);
+    }
+
+    chd_close(chd);
+    SafeDelete(adapter);
+}
+
+void CdRomChdImage::StartPrefetchWorker()
+{
+    if (m_prefetch_running.load())
+        return;
+
+    m_prefetch_next = 0;
+    m_prefetch_end = 0;
+    m_prefetch_running.store(true);
+    m_prefetch_thread = std::thread(&CdRomChdImage::PrefetchThread, this);
+}
+
+void CdRomChdImage::StopPrefetchWorker()
+{
+    if (!m_prefetch_running.load() && !m_prefetch_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_cache_mutex);
+        m_prefetch_running.store(false);
+    }
+
+    m_prefetch_condition.notify_one();
+
+    if (m_prefetch_thread.joinable())
+        m_prefetch_thread.join();
+}
+
+void CdRomChdImage::QueuePrefetch(u32 first_hunk, u32 count)
+{
+    if (!m_prefetch_running.load() || (first_hunk >= m_hunk_count))
+        return;
+
+    u32 end = first_hunk + MIN(count, m_hunk_count - first_hunk);
+
+    std::lock_guard<std::mutex> lock(m_cache_mutex);
+
+    if (end == m_prefetch_end)
+        return;
+
+    m_prefetch_next = first_hunk;
+    m_prefetch_end = end;
+    m_prefetch_condition.notify_one();
+}
+
+void CdRomChdImage::PrefetchThread()
+{
+    CdRomChdFileAdapter* adapter = NULL;
+    chd_file* chd = NULL;
+
+    if (!OpenChd(&adapter, &chd))
+    {
+        Debug("CHD prefetch disabled for %s", m_file_path);
+        return;
+    }
+
+    while (true)
+    {
+        u32 hunk_index = 0;
+
+        {
+            std::unique_lock<std::mutex> lock(m_cache_mutex);
+
+            while (m_prefetch_running.load() && (m_prefetch_next >= m_prefetch_end))
+                m_prefetch_condition.wait(lock);
+
+            if (!m_prefetch_running.load())
+                break;
+
+            hunk_index = m_prefetch_next++;
+
+            if (m_hunk_state[hunk_index] != HUNK_EMPTY)
+                continue;
+        }
+
+        LoadHunk(chd, hunk_index, 0, NULL, 0);
+    }
+
+    chd_close(chd);
+    SafeDelete(adapter);
+}
+#endif
+
 GG_CdRomTrackType CdRomChdImage::GetTrackType(const char* type_str)
 {
     if (strcmp(type_str, "AUDIO") == 0)
@@ -20,9 +20,29 @@
 #ifndef CDROM_CHD_IMAGE_H
 #define CDROM_CHD_IMAGE_H
 
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
 #include <libchdr/chd.h>
 #include "cdrom_image.h"
 
+#define GG_CDROM_CHD_CACHE_UNLIMITED 0
+#define GG_CDROM_CHD_MIN_CACHED_HUNKS 8
+#define GG_CDROM_CHD_MAX_PRECACHE_THREADS 16
+#define GG_CDROM_CHD_NO_HUNK 0xFFFFFFFF
+
+struct GG_CdRomChdLoadOptions
+{
+    u32 cache_budget;
+    u32 prefetch_hunks;
+    u32 precache_threads;
+    bool precache_decode;
+};
+
 class CdRomChdFileAdapter;
 
 class CdRomChdImage : public CdRomImage
@@ -37,25 +57,73 @@ public:
     virtual bool ReadSamples(u32 lba, u32 offset, s16* buffer, u32 count) override;
     virtual bool PreloadDisc() override;
     virtual bool PreloadTrack(u32 track_number) override;
+    void SetLoadOptions(const GG_CdRomChdLoadOptions& options);
+
+private:
+    enum HunkState
+    {
+        HUNK_EMPTY,
+        HUNK_LOADING,
+        HUNK_READY
+    };
 
 private:
     bool ReadTOC();
     void CalculateCRC();
     bool InitHunkCache();
     void DestroyHunkCache();
-    bool LoadHunk(u32 hunk_index);
+    bool LoadHunk(chd_file* chd, u32 hunk_index, u32 offset, void* buffer, u32 size);
+    u32 PrefetchWindow();
+    u8* AcquireHunkBuffer();
+    void LinkHunk(u32 hunk_index);
+    void UnlinkHunk(u32 hunk_index);
+    bool OpenChd(CdRomChdFileAdapter** adapter, chd_file** chd);
+    bool PrecacheHunks();
     GG_CdRomTrackType GetTrackType(const char* type_str);
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    void StartPrefetchWorker();
+    void StopPrefetchWorker();
+    void QueuePrefetch(u32 first_hunk, u32 count);
+    void PrefetchThread();
+    void PrecacheThread(std::atomic<u32>* next_hunk, std::atomic<bool>* failed);
+#endif
 
 private:
     chd_file* m_chd_file;
     CdRomChdFileAdapter* m_file_adapter;
+    GG_CdRomChdLoadOptions m_load_options;
     u8** m_hunk_cache;
+    u8* m_hunk_state;
+    u32* m_lru_prev;
+    u32* m_lru_next;
+    u32 m_lru_head;
+    u32 m_lru_tail;
+    u32 m_cached_hunks;
+    u32 m_max_cached_hunks;
     u32 m_hunk_bytes;
     u32 m_hunk_count;
     u32 m_sectors_per_hunk;
+#if defined(GG_ENABLE_CDROM_CHD_WORKERS)
+    std::mutex m_cache_mutex;
+    std::condition_variable m_hunk_condition;
+    std::thread m_prefetch_thread;
+    std::atomic<bool> m_prefetch_running;
+    std::condition_variable m_prefetch_condition;
+    u32 m_prefetch_next;
+    u32 m_prefetch_end;
+#endif
+};
 
-private:
+INLINE GG_CdRomChdLoadOptions GG_CdRomChdDefaultLoadOptions()
+{
+    GG_CdRomChdLoadOptions options;
 
-};
+    options.cache_budget = (32 * 1024 * 1024);
+    options.prefetch_hunks = 8;
+    options.precache_threads = 0;
+    options.precache_decode = false;
+
+    return options;
+}
 
 #endif /* CDROM_CHD_IMAGE_H */
\ No newline at end of file
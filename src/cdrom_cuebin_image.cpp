@@ -24,6 +24,10 @@
 #if defined(GG_ENABLE_CDROM_CUEBIN_READAHEAD)
 #include <chrono>
 #endif
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 #include "cdrom_common.h"
 #include "media_file.h"
 #include "crc.h"
@@ -31,6 +35,9 @@
 CdRomCueBinImage::CdRomCueBinImage() : CdRomImage()
 {
     m_load_options = GG_CdRomCueBinDefaultLoadOptions();
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    m_page_size = 0;
+#endif
 #if defined(GG_ENABLE_CDROM_CUEBIN_READAHEAD)
     m_read_ahead_running.store(false);
     m_keep_alive_file = NULL;
@@ -78,6 +85,10 @@ bool CdRomCueBinImage::LoadFromFile(const char* path, bool preload)
     Reset();
     GatherPaths(path);
 
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    m_page_size = (size_t)sysconf(_SC_PAGESIZE);
+#endif
+
     if (strcmp(m_file_extension, "cue") != 0)
     {
         Error("Invalid file extension %s. Expected .cue", m_file_extension);
@@ -185,6 +196,10 @@ void CdRomCueBinImage::SetLoadOptions(const GG_CdRomCueBinLoadOptions& options)
     m_load_options.enable_read_ahead = false;
     m_load_options.read_ahead_chunks = 0;
 #endif
+
+#if !defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    m_load_options.memory_map = false;
+#endif
 }
 
 bool CdRomCueBinImage::ReadSector(u32 lba, u8* buffer)
@@ -324,6 +339,17 @@ bool CdRomCueBinImage::PreloadDisc()
             return false;
         }
 
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+        // Every page is faulted in, so the disc is read into the page cache
+        // now like the chunks below. The kernel may still evict clean pages
+        // under memory pressure, they are read again on access.
+        if (IsValidPointer(img_file->mapped_data))
+        {
+            AdviseMappedRange(img_file, 0, img_file->file_size, true);
+            continue;
+        }
+#endif
+
         if (!PreloadChunks(img_file, 0, img_file->chunk_count))
         {
             Error("Failed to preload chunks for ImgFile %s", img_file->file_path);
@@ -352,6 +378,16 @@ bool CdRomCueBinImage::PreloadTrack(u32 track_number)
     if (total_bytes == 0)
         return true;
 
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    if (IsValidPointer(track_file.img_file->mapped_data))
+    {
+        // Track changes happen while playing, only ask the kernel to read ahead
+        Debug("Advising page cache for track %u (sectors: %u, bytes: %u)", track_number, track.sector_count, total_bytes);
+        AdviseMappedRange(track_file.img_file, start_offset, total_bytes, false);
+        return true;
+    }
+#endif
+
     u32 chunk_size = track_file.img_file->chunk_size;
     u32 start_chunk = start_offset / chunk_size;
     u32 end_chunk = (start_offset + total_bytes - 1) / chunk_size;
@@ -389,6 +425,8 @@ void CdRomCueBinImage::InitImgFile(ImgFile* img_file)
     InitPointer(img_file->file);
     img_file->is_wav = false;
     img_file->wav_data_offset = 0;
+    img_file->mapped_data = NULL;
+    img_file->mapped_size = 0;
 }
 
 void CdRomCueBinImage::InitParsedCueTrack(ParsedCueTrack& track)
@@ -459,6 +497,16 @@ bool CdRomCueBinImage::GatherImgInfo(ImgFile* img_file)
         return false;
     }
 
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    if (m_load_options.memory_map && MapImgFile(img_file))
+    {
+        // Reads are served from the mapping, which lives until the file is closed
+        Debug("Gathered ImgFile info: %s", img_file->file_path);
+        Debug("ImgFile info Size: %d, memory mapped", img_file->file_size);
+        return true;
+    }
+#endif
+
     if (!SetupFileChunks(img_file))
     {
         SafeDelete(img_file->file);
@@ -1047,6 +1095,12 @@ bool CdRomCueBinImage::ReadFromImgFile(ImgFile* img_file, u32 offset, u8* buffer
         return false;
     }
 
+    if (IsValidPointer(img_file->mapped_data))
+    {
+        memcpy(buffer, img_file->mapped_data + img_file->wav_data_offset + offset, size);
+        return true;
+    }
+
     const u32 chunk_size = img_file->chunk_size;
     u32 chunk_index = offset / chunk_size;
     u32 chunk_offset = offset % chunk_size;
@@ -1054,7 +1108,7 @@ bool CdRomCueBinImage::ReadFromImgFile(ImgFile* img_file, u32 offset, u8* buffer
     u32 last_chunk_index = chunk_index;
 #endif
 
-    if (!LoadChunk(img_file, chunk_index))
+    if (!LoadChunk(img_file, chunk_index, true))
     {
         Error("Failed to load chunk %d", chunk_index);
         return false;
@@ -1068,7 +1122,7 @@ bool CdRomCueBinImage::ReadFromImgFile(ImgFile* img_file, u32 offset, u8* buffer
             return false;
         }
 
-        if (!LoadChunk(img_file, chunk_index + 1))
+        if (!LoadChunk(img_file, chunk_index + 1, true))
         {
             Error("Failed to load chunk %d", chunk_index + 1);
             return false;
@@ -1103,7 +1157,7 @@ bool CdRomCueBinImage::ReadFromImgFile(ImgFile* img_file, u32 offset, u8* buffer
     return true;
 }
 
-bool CdRomCueBinImage::LoadChunk(ImgFile* img_file, u32 chunk_index)
+bool CdRomCueBinImage::LoadChunk(ImgFile* img_file, u32 chunk_index, bool count_access)
 {
     if (!IsValidPointer(img_file))
     {
@@ -1121,6 +1175,16 @@ bool CdRomCueBinImage::LoadChunk(ImgFile* img_file, u32 chunk_index)
     std::lock_guard<std::mutex> lock(m_chunk_mutex);
 #endif
 
+    // Only reads issued by the emulation thread are counted, read-ahead
+    // loads run on their own thread
+    if (count_access)
+    {
+        if (img_file->chunks[chunk_index])
+            GG_PERF_ADD(m_perf_counters, cd_cache_hits, 1);
+        else
+            GG_PERF_ADD(m_perf_counters, cd_cache_misses, 1);
+    }
+
     if (!img_file->chunks[chunk_index])
     {
         if (!IsValidPointer(img_file->file))
@@ -1370,6 +1434,57 @@ void CdRomCueBinImage::ResetReadAheadQueue()
 }
 #endif
 
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+bool CdRomCueBinImage::MapImgFile(ImgFile* img_file)
+{
+    if (!IsValidPointer(img_file->file))
+        return false;
+
+    u64 mapped_size = 0;
+    const u8* mapped_data = img_file->file->Map(&mapped_size);
+
+    if (!IsValidPointer(mapped_data) || (mapped_size < ((u64)img_file->wav_data_offset + img_file->file_size)))
+    {
+        Debug("Memory mapping not available for %s, falling back to chunks", img_file->file_path);
+        return false;
+    }
+
+    img_file->mapped_data = mapped_data;
+    img_file->mapped_size = (size_t)mapped_size;
+
+    return true;
+}
+
+void CdRomCueBinImage::AdviseMappedRange(ImgFile* img_file, u32 offset, u32 size, bool populate)
+{
+    if (!IsValidPointer(img_file->mapped_data) || (size == 0) || (m_page_size == 0))
+        return;
+
+    size_t start = (size_t)img_file->wav_data_offset + offset;
+    size_t end = MIN(start + size, img_file->mapped_size);
+    size_t aligned_start = start - (start % m_page_size);
+
+    if (end <= aligned_start)
+        return;
+
+    u8* address = const_cast<u8*>(img_file->mapped_data) + aligned_start;
+    size_t length = end - aligned_start;
+
+    madvise(address, length, MADV_SEQUENTIAL);
+    madvise(address, length, MADV_WILLNEED);
+
+    if (!populate)
+        return;
+
+    volatile u8 sink = 0;
+
+    for (size_t i = 0; i < length; i += m_page_size)
+        sink ^= address[i];
+
+    (void)sink;
+}
+#endif
+
 void CdRomCueBinImage::CalculateCRC()
 {
     m_crc = 0;
@@ -1418,7 +1533,7 @@ void CdRomCueBinImage::CalculateCRC()
         return;
     }
 
-    if (!IsValidPointer(img_file->file))
+    if (!IsValidPointer(img_file->file) && !IsValidPointer(img_file->mapped_data))
     {
         Error("File %s is not open for CRC calculation", img_file->file_path);
         SafeDeleteArray(buffer);
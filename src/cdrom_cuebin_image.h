@@ -43,6 +43,7 @@ struct GG_CdRomCueBinLoadOptions
     bool allow_disc_preload;
     bool enable_read_ahead;
     bool track_files_start_at_index1;
+    bool memory_map;
 };
 
 class MediaFile;
@@ -62,6 +63,8 @@ private:
         MediaFile* file;
         bool is_wav;
         u32 wav_data_offset;
+        const u8* mapped_data;
+        size_t mapped_size;
     };
 
     struct ParsedCueTrack
@@ -123,8 +126,12 @@ private:
     bool IsUriPath(const char* path);
     bool ParseCueFile(const char* cue_content);
     bool ReadFromImgFile(ImgFile* img_file, u32 offset, u8* buffer, u32 size);
-    bool LoadChunk(ImgFile* img_file, u32 chunk_index);
+    bool LoadChunk(ImgFile* img_file, u32 chunk_index, bool count_access = false);
     bool PreloadChunks(ImgFile* img_file, u32 start_chunk, u32 count);
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    bool MapImgFile(ImgFile* img_file);
+    void AdviseMappedRange(ImgFile* img_file, u32 offset, u32 size, bool populate);
+#endif
 #if defined(GG_ENABLE_CDROM_CUEBIN_READAHEAD)
     void QueueReadAhead(ImgFile* img_file, u32 start_chunk);
     void QueueChunk(ImgFile* img_file, u32 chunk_index);
@@ -140,6 +147,9 @@ private:
     std::vector<ImgFile*> m_img_files;
     std::vector<TrackFile> m_track_files;
     GG_CdRomCueBinLoadOptions m_load_options;
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    size_t m_page_size;
+#endif
 #if defined(GG_ENABLE_CDROM_CUEBIN_READAHEAD)
     std::mutex m_chunk_mutex;
     std::mutex m_queue_mutex;
@@ -164,6 +174,7 @@ INLINE GG_CdRomCueBinLoadOptions GG_CdRomCueBinDefaultLoadOptions()
     options.allow_disc_preload = true;
     options.enable_read_ahead = false;
     options.track_files_start_at_index1 = false;
+    options.memory_map = true;
 
     return options;
 }
@@ -179,6 +190,7 @@ INLINE GG_CdRomCueBinLoadOptions GG_CdRomCueBinStreamingLoadOptions()
     options.allow_disc_preload = false;
     options.enable_read_ahead = true;
     options.track_files_start_at_index1 = true;
+    options.memory_map = false;
 #else
     options.chunk_size = (2352 * 128);
     options.max_preload_chunks = GG_CDROM_CUEBIN_PRELOAD_FULL_TRACK;
@@ -186,6 +198,7 @@ INLINE GG_CdRomCueBinLoadOptions GG_CdRomCueBinStreamingLoadOptions()
     options.allow_disc_preload = false;
     options.enable_read_ahead = false;
     options.track_files_start_at_index1 = true;
+    options.memory_map = false;
 #endif
 
     return options;
@@ -23,6 +23,7 @@
 
 CdRomImage::CdRomImage()
 {
+    InitPointer(m_perf_counters);
     Reset();
 }
 
@@ -53,6 +54,11 @@ bool CdRomImage::IsReady()
     return m_ready;
 }
 
+void CdRomImage::SetPerfCounters(GG_Perf_Counters* perf_counters)
+{
+    m_perf_counters = perf_counters;
+}
+
 u32 CdRomImage::GetFirstSectorOfTrack(u8 track)
 {
     if (track < m_toc.tracks.size())
@@ -60,6 +60,7 @@ public:
     virtual bool PreloadDisc() = 0;
     virtual bool PreloadTrack(u32 track_number) = 0;
     bool IsReady();
+    void SetPerfCounters(GG_Perf_Counters* perf_counters);
     u32 GetFirstSectorOfTrack(u8 track);
     u32 GetLastSectorOfTrack(u8 track);
     s32 GetTrackFromLBA(u32 lba);
@@ -87,6 +88,7 @@ protected:
     char m_file_extension[512];
     u32 m_current_sector;
     u32 m_crc;
+    GG_Perf_Counters* m_perf_counters;
 };
 
 #endif /* CDROM_IMAGE_H */
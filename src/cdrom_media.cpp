@@ -20,6 +20,7 @@
 #include "cdrom_media.h"
 #include "cdrom_cuebin_image.h"
 #include "cdrom_chd_image.h"
+#include "profiler.h"
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
 #include "cdrom_physical_image.h"
 #endif
@@ -27,6 +28,7 @@
 CdRomMedia::CdRomMedia()
 {
     InitPointer(m_current_image);
+    InitPointer(m_perf_counters);
     m_media_generation = 0;
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
     InitPointer(m_physical_image);
@@ -108,6 +110,11 @@ bool CdRomMedia::LoadChdFromFile(const char* path, bool preload)
     }
 }
 
+void CdRomMedia::SetChdLoadOptions(const GG_CdRomChdLoadOptions& options)
+{
+    m_chd_image->SetLoadOptions(options);
+}
+
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
 bool CdRomMedia::LoadPhysicalDrive(const char* device_id, bool preload)
 {
@@ -133,8 +140,11 @@ bool CdRomMedia::HasPhysicalDriveError()
 
 bool CdRomMedia::ReadSector(u32 lba, u8* buffer)
 {
+    GG_PROFILE_ZONE("CdRomMedia::ReadSector");
+
     if (IsValidPointer(m_current_image))
     {
+        GG_PERF_ADD(m_perf_counters, cd_sector_reads, 1);
         return m_current_image->ReadSector(lba, buffer);
     }
     else
@@ -170,6 +180,16 @@ bool CdRomMedia::PreloadTrack(u32 track_number)
     }
 }
 
+void CdRomMedia::SetPerfCounters(GG_Perf_Counters* perf_counters)
+{
+    m_perf_counters = perf_counters;
+    m_cue_bin_image->SetPerfCounters(perf_counters);
+    m_chd_image->SetPerfCounters(perf_counters);
+#if defined(GG_ENABLE_PHYSICAL_CDROM)
+    m_physical_image->SetPerfCounters(perf_counters);
+#endif
+}
+
 u32 CdRomMedia::GetFirstSectorOfTrack(u8 track)
 {
     if (IsValidPointer(m_current_image))
@@ -28,6 +28,7 @@
 
 class CdRomCueBinImage;
 class CdRomChdImage;
+struct GG_CdRomChdLoadOptions;
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
 class CdRomPhysicalImage;
 #endif
@@ -56,6 +57,7 @@ public:
     void SetCurrentSector(u32 sector);
     bool LoadCueFromFile(const char* path, bool preload);
     bool LoadChdFromFile(const char* path, bool preload);
+    void SetChdLoadOptions(const GG_CdRomChdLoadOptions& options);
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
     bool LoadPhysicalDrive(const char* device_id, bool preload);
     bool HasPhysicalDriveError();
@@ -69,6 +71,7 @@ public:
     s32 GetTrackFromLBA(u32 lba);
     s32 FindTrackFromLBA(u32 lba, bool include_lead_in = false);
     bool PreloadTrack(u32 track_number);
+    void SetPerfCounters(GG_Perf_Counters* perf_counters);
 
 private:
     bool IsCdRomUriPath(const char* path);
@@ -77,11 +80,13 @@ private:
 private:
     CdRomImage* m_current_image;
     u32 m_media_generation;
+    GG_Perf_Counters* m_perf_counters;
     CdRomCueBinImage* m_cue_bin_image;
     CdRomChdImage* m_chd_image;
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
     CdRomPhysicalImage* m_physical_image;
 #endif
+    std::vector<CdRomImage::Track> m_empty_tracks;
 };
 
 
@@ -109,8 +109,7 @@ INLINE const std::vector<CdRomImage::Track>& CdRomMedia::GetTracks()
     else
     {
         Error("CdRomMedia::GetTracks failed - Current image is NULL");
-        static std::vector<CdRomImage::Track> empty_tracks;
-        return empty_tracks;
+        return m_empty_tracks;
     }
 }
 
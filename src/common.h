@@ -35,6 +35,7 @@
 #include "types.h"
 #include "log.h"
 #include "bit_ops.h"
+#include "state_serializer.h"
 #define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
 #include <miniz.h>
 #undef MINIZ_NO_ZLIB_COMPATIBLE_NAMES
@@ -55,6 +55,12 @@
 #define GG_SAVESTATE_VERSION 34
 #define GG_SAVESTATE_MIN_VERSION 23
 #define GG_SAVESTATE_MAGIC 0x82190619
+#define GG_SAVESTATE_INCREMENTAL_MAGIC 0x82190620
+#define GG_SAVESTATE_FILE_MAGIC 0x43534747
+#define GG_SAVESTATE_FILE_VERSION 1
+
+#define GG_MOVIE_MAGIC 0x4D474747
+#define GG_MOVIE_VERSION 1
 
 #if !defined(NULL)
     #define NULL 0
@@ -97,6 +103,12 @@
     #define unlikely(x) (x)
 #endif
 
+#if defined(GG_ENABLE_PERF_COUNTERS)
+    #define GG_PERF_ADD(counters, field, value) do { if ((counters) != NULL) (counters)->field += (value); } while (0)
+#else
+    #define GG_PERF_ADD(counters, field, value) do { } while (0)
+#endif
+
 #if !defined(GG_DEBUG)
     #if defined(__GNUC__) || defined(__clang__)
         #if !defined(__OPTIMIZE__) && !defined(__OPTIMIZE_SIZE__)
@@ -0,0 +1,120 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef DIRTY_PAGES_H
+#define DIRTY_PAGES_H
+
+#include <string.h>
+#include "types.h"
+#include "defines.h"
+
+#define GG_DIRTY_PAGE_SHIFT 8
+#define GG_DIRTY_PAGE_SIZE (1 << GG_DIRTY_PAGE_SHIFT)
+
+// Tracks which 256-byte pages of a RAM array were written since the last
+// Clear. Flags are one byte per page so the write paths only need a store.
+class DirtyPages
+{
+public:
+    DirtyPages()
+    {
+        m_flags = NULL;
+        m_page_count = 0;
+        m_size = 0;
+    }
+
+    ~DirtyPages()
+    {
+        if (m_flags != NULL)
+            delete[] m_flags;
+    }
+
+    void Init(u32 size)
+    {
+        if (m_flags != NULL)
+            delete[] m_flags;
+
+        m_size = size;
+        m_page_count = (size + GG_DIRTY_PAGE_SIZE - 1) >> GG_DIRTY_PAGE_SHIFT;
+        m_flags = new u8[m_page_count];
+        MarkAll();
+    }
+
+    void Mark(u32 offset)
+    {
+        m_flags[offset >> GG_DIRTY_PAGE_SHIFT] = 1;
+    }
+
+    void MarkRange(u32 offset, u32 size)
+    {
+        if (size == 0)
+            return;
+
+        u32 first = offset >> GG_DIRTY_PAGE_SHIFT;
+        u32 last = (offset + size - 1) >> GG_DIRTY_PAGE_SHIFT;
+        memset(m_flags + first, 1, last - first + 1);
+    }
+
+    void MarkAll()
+    {
+        memset(m_flags, 1, m_page_count);
+    }
+
+    void Clear()
+    {
+        memset(m_flags, 0, m_page_count);
+    }
+
+    bool IsDirty(u32 page) const
+    {
+        return m_flags[page] != 0;
+    }
+
+    u32 GetDirtyCount() const
+    {
+        u32 count = 0;
+        for (u32 i = 0; i < m_page_count; i++)
+            count += m_flags[i];
+        return count;
+    }
+
+    u8* GetFlags()
+    {
+        return m_flags;
+    }
+
+    u32 GetPageCount() const
+    {
+        return m_page_count;
+    }
+
+    u32 GetSize() const
+    {
+        return m_size;
+    }
+
+private:
+    DirtyPages(const DirtyPages&);
+    DirtyPages& operator=(const DirtyPages&);
+    u8* m_flags;
+    u32 m_page_count;
+    u32 m_size;
+};
+
+#endif /* DIRTY_PAGES_H */
@@ -22,6 +22,7 @@
 
 #include "common.h"
 #include "geargrafx_core.h"
+#include "geargrafx_batch.h"
 #include "input.h"
 #include "audio.h"
 #include "media.h"
@@ -37,8 +38,11 @@
 #include "cdrom_audio.h"
 #include "adpcm.h"
 #include "trace_logger.h"
+#include "profiler.h"
 #include "mapper.h"
 #include "sf2_mapper.h"
 #include "arcade_card_mapper.h"
+#include "savestate_file.h"
+#include "input_movie.h"
 
 #endif /* GEARGRAFX_H */
\ No newline at end of file
@@ -0,0 +1,493 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "geargrafx_batch.h"
+#include "geargrafx_core.h"
+#include "memory.h"
+
+GeargrafxBatch::GeargrafxBatch()
+{
+    InitPointer(m_cores);
+    InitPointer(m_frames);
+    InitPointer(m_samples);
+    InitPointer(m_sample_counts);
+    InitPointer(m_runtime_info);
+    InitPointer(m_input);
+    InitPointer(m_ram_watch);
+    InitPointer(m_ram);
+    InitPointer(m_snapshots);
+    InitPointer(m_snapshot_sizes);
+    InitPointer(m_workers);
+    m_env_count = 0;
+    m_thread_count = 0;
+    m_pixel_format = GG_PIXEL_RGBA8888;
+    m_frame_stride = 0;
+    m_ram_watch_count = 0;
+    m_snapshot_stride = 0;
+    m_render = true;
+    m_audio = true;
+    m_generation = 0;
+    m_active_workers = 0;
+    m_quit = false;
+    m_next_env = 0;
+}
+
+GeargrafxBatch::~GeargrafxBatch()
+{
+    StopWorkers();
+    DestroyEnvs();
+    if (IsValidPointer(m_cores))
+        SafeDelete(m_cores[0]);
+    SafeDeleteArray(m_cores);
+    SafeDeleteArray(m_frames);
+    SafeDeleteArray(m_samples);
+    SafeDeleteArray(m_sample_counts);
+    SafeDeleteArray(m_runtime_info);
+    SafeDeleteArray(m_input);
+    SafeDeleteArray(m_ram_watch);
+    SafeDeleteArray(m_ram);
+}
+
+// A thread count of 0 uses one thread per hardware thread. The calling
+// thread always takes part in Step(), so thread_count - 1 workers are
+// started.
+bool GeargrafxBatch::Init(int env_count, int thread_count, GG_Pixel_Format pixel_format)
+{
+    if (IsValidPointer(m_cores) || (env_count <= 0))
+        return false;
+
+    if (thread_count <= 0)
+        thread_count = MAX((int)std::thread::hardware_concurrency(), 1);
+
+    m_env_count = env_count;
+    m_thread_count = MIN(thread_count, env_count);
+    m_pixel_format = pixel_format;
+    m_frame_stride = GG_BATCH_MAX_FRAME_PIXELS * (pixel_format == GG_PIXEL_RGB565 ? 2 : 4);
+
+    m_cores = new GeargrafxCore*[m_env_count];
+    m_frames = new u8[(size_t)m_env_count * m_frame_stride];
+    m_samples = new s16[(size_t)m_env_count * GG_AUDIO_BUFFER_SIZE];
+    m_sample_counts = new int[m_env_count];
+    m_runtime_info = new GG_Runtime_Info[m_env_count];
+    m_input = new u16[m_env_count * GG_MAX_GAMEPADS];
+
+    for (int i = 0; i < m_env_count; i++)
+        InitPointer(m_cores[i]);
+
+    memset(m_frames, 0, (size_t)m_env_count * m_frame_stride);
+    memset(m_samples, 0, (size_t)m_env_count * GG_AUDIO_BUFFER_SIZE * sizeof(s16));
+    memset(m_sample_counts, 0, m_env_count * sizeof(int));
+    memset(m_runtime_info, 0, m_env_count * sizeof(GG_Runtime_Info));
+    memset(m_input, 0, m_env_count * GG_MAX_GAMEPADS * sizeof(u16));
+
+    m_cores[0] = new GeargrafxCore();
+    m_cores[0]->Init(NULL, m_pixel_format);
+
+    StartWorkers();
+
+    Log("Batch initialized with %d envs and %d threads", m_env_count, m_thread_count);
+
+    return true;
+}
+
+bool GeargrafxBatch::LoadMedia(const char* file_path)
+{
+    if (!IsValidPointer(m_cores))
+        return false;
+
+    DestroyEnvs();
+
+    if (!m_cores[0]->LoadMedia(file_path))
+        return false;
+
+    return CreateEnvs();
+}
+
+bool GeargrafxBatch::LoadHuCardFromBuffer(const u8* buffer, int size, const char* path)
+{
+    if (!IsValidPointer(m_cores))
+        return false;
+
+    DestroyEnvs();
+
+    if (!m_cores[0]->LoadHuCardFromBuffer(buffer, size, path))
+        return false;
+
+    return CreateEnvs();
+}
+
+// Addresses are offsets into work RAM. The watched bytes of every env are
+// copied to GetRam() after each step.
+bool GeargrafxBatch::SetRamWatch(const u16* addresses, int count)
+{
+    if (!IsValidPointer(m_cores) || (count < 0))
+        return false;
+
+    int ram_size = m_cores[0]->GetMemory()->GetWorkingRAMSize();
+
+    for (int i = 0; i < count; i++)
+    {
+        if (addresses[i] >= ram_size)
+        {
+            Error("Batch RAM watch address out of range: %04X", addresses[i]);
+            return false;
+        }
+    }
+
+    SafeDeleteArray(m_ram_watch);
+    SafeDeleteArray(m_ram);
+    m_ram_watch_count = count;
+
+    if (count > 0)
+    {
+        m_ram_watch = new u16[count];
+        m_ram = new u8[(size_t)m_env_count * count];
+        memcpy(m_ram_watch, addresses, count * sizeof(u16));
+        memset(m_ram, 0, (size_t)m_env_count * count);
+    }
+
+    return true;
+}
+
+// Keys are a mask of GG_Keys held down, applied on the next Step()
+void GeargrafxBatch::SetInput(int env, GG_Controllers controller, u16 keys)
+{
+    m_input[(env * GG_MAX_GAMEPADS) + controller] = keys;
+}
+
+// Sets every controller of every env from env_count * GG_MAX_GAMEPADS masks
+void GeargrafxBatch::SetInputs(const u16* keys)
+{
+    memcpy(m_input, keys, m_env_count * GG_MAX_GAMEPADS * sizeof(u16));
+}
+
+// Runs every env to its next vblank. Without render the frame slots keep
+// their previous contents; without audio no samples are produced and the
+// sample counts are zero.
+void GeargrafxBatch::Step(bool render, bool audio)
+{
+    if (!IsValidPointer(m_cores) || !IsValidPointer(m_cores[m_env_count - 1]))
+        return;
+
+    m_render = render;
+    m_audio = audio;
+    m_next_env = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_active_workers = m_thread_count - 1;
+        m_generation++;
+    }
+    m_start_condition.notify_all();
+
+    RunJobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (m_active_workers > 0)
+        m_done_condition.wait(lock);
+}
+
+// Stores the current state of source_env (env itself by default) as the
+// snapshot env returns to with ResetToSnapshot()
+bool GeargrafxBatch::SaveSnapshot(int env, int source_env)
+{
+    if (!IsValidPointer(m_snapshots) || (env < 0) || (env >= m_env_count))
+        return false;
+
+    if (source_env < 0)
+        source_env = env;
+    else if (source_env >= m_env_count)
+        return false;
+
+    size_t size = m_cores[source_env]->GetSaveStateSize(false);
+
+    if (size == 0)
+        return false;
+
+    // The state grows when the MB128 connects
+    if (size > m_snapshot_stride)
+        GrowSnapshots(size);
+
+    if (!m_cores[source_env]->SaveState(m_snapshots + (env * m_snapshot_stride), size, false))
+        return false;
+
+    m_snapshot_sizes[env] = size;
+    return true;
+}
+
+bool GeargrafxBatch::ResetToSnapshot(int env)
+{
+    if (!IsValidPointer(m_snapshots) || (env < 0) || (env >= m_env_count))
+        return false;
+
+    if (m_snapshot_sizes[env] == 0)
+    {
+        Error("Batch env %d has no snapshot", env);
+        return false;
+    }
+
+    return m_cores[env]->LoadState(m_snapshots + (env * m_snapshot_stride), m_snapshot_sizes[env]);
+}
+
+GeargrafxCore* GeargrafxBatch::GetCore(int env)
+{
+    return m_cores[env];
+}
+
+int GeargrafxBatch::GetEnvCount()
+{
+    return m_env_count;
+}
+
+int GeargrafxBatch::GetThreadCount()
+{
+    return m_thread_count;
+}
+
+int GeargrafxBatch::GetFrameStride()
+{
+    return m_frame_stride;
+}
+
+u8* GeargrafxBatch::GetFrames()
+{
+    return m_frames;
+}
+
+u8* GeargrafxBatch::GetFrame(int env)
+{
+    return m_frames + ((size_t)env * m_frame_stride);
+}
+
+s16* GeargrafxBatch::GetSamples()
+{
+    return m_samples;
+}
+
+s16* GeargrafxBatch::GetSamples(int env)
+{
+    return m_samples + ((size_t)env * GG_AUDIO_BUFFER_SIZE);
+}
+
+int* GeargrafxBatch::GetSampleCounts()
+{
+    return m_sample_counts;
+}
+
+u8* GeargrafxBatch::GetRam()
+{
+    return m_ram;
+}
+
+u8* GeargrafxBatch::GetRam(int env)
+{
+    return m_ram + ((size_t)env * m_ram_watch_count);
+}
+
+int GeargrafxBatch::GetRamWatchCount()
+{
+    return m_ram_watch_count;
+}
+
+GG_Runtime_Info* GeargrafxBatch::GetRuntimeInfo()
+{
+    return m_runtime_info;
+}
+
+// Every env starts from the power-on state of env 0, which is also saved as
+// each env's initial snapshot
+bool GeargrafxBatch::CreateEnvs()
+{
+    for (int i = 1; i < m_env_count; i++)
+    {
+        m_cores[i] = m_cores[0]->Fork();
+
+        if (!IsValidPointer(m_cores[i]))
+        {
+            Error("Failed to create batch env %d", i);
+            DestroyEnvs();
+            return false;
+        }
+    }
+
+    m_snapshot_stride = m_cores[0]->GetSaveStateSize(false);
+    m_snapshots = new u8[m_env_count * m_snapshot_stride];
+    m_snapshot_sizes = new size_t[m_env_count];
+
+    for (int i = 0; i < m_env_count; i++)
+    {
+        m_snapshot_sizes[i] = 0;
+        m_cores[i]->GetRuntimeInfo(m_runtime_info[i]);
+
+        if (!SaveSnapshot(i))
+        {
+            Error("Failed to save snapshot for batch env %d", i);
+            DestroyEnvs();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Moves every snapshot to a larger slot, keeping the ones already saved
+void GeargrafxBatch::GrowSnapshots(size_t stride)
+{
+    u8* snapshots = new u8[m_env_count * stride];
+
+    for (int i = 0; i < m_env_count; i++)
+        memcpy(snapshots + (i * stride), m_snapshots + (i * m_snapshot_stride), m_snapshot_sizes[i]);
+
+    SafeDeleteArray(m_snapshots);
+    m_snapshots = snapshots;
+    m_snapshot_stride = stride;
+}
+
+// Forks share the ROM of env 0, so they go first
+void GeargrafxBatch::DestroyEnvs()
+{
+    if (!IsValidPointer(m_cores))
+        return;
+
+    for (int i = m_env_count - 1; i > 0; i--)
+        SafeDelete(m_cores[i]);
+
+    SafeDeleteArray(m_snapshots);
+    SafeDeleteArray(m_snapshot_sizes);
+    m_snapshot_stride = 0;
+}
+
+void GeargrafxBatch::StartWorkers()
+{
+    m_quit = false;
+
+    if (m_thread_count <= 1)
+        return;
+
+    m_workers = new std::thread[m_thread_count - 1];
+
+    for (int i = 0; i < m_thread_count - 1; i++)
+        m_workers[i] = std::thread(&GeargrafxBatch::WorkerThread, this);
+}
+
+void GeargrafxBatch::StopWorkers()
+{
+    if (!IsValidPointer(m_workers))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_start_condition.notify_all();
+
+    for (int i = 0; i < m_thread_count - 1; i++)
+    {
+        if (m_workers[i].joinable())
+            m_workers[i].join();
+    }
+
+    SafeDeleteArray(m_workers);
+}
+
+void GeargrafxBatch::WorkerThread()
+{
+    u32 generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (!m_quit && (m_generation == generation))
+                m_start_condition.wait(lock);
+
+            if (m_quit)
+                return;
+
+            generation = m_generation;
+        }
+
+        RunJobs();
+
+        bool last = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active_workers--;
+            last = (m_active_workers == 0);
+        }
+
+        if (last)
+            m_done_condition.notify_one();
+    }
+}
+
+// Envs are handed out one at a time so threads that finish early pick up
+// the slower ones
+void GeargrafxBatch::RunJobs()
+{
+    while (true)
+    {
+        int env = m_next_env.fetch_add(1);
+
+        if (env >= m_env_count)
+            return;
+
+        StepEnv(env);
+    }
+}
+
+void GeargrafxBatch::StepEnv(int env)
+{
+    GeargrafxCore* core = m_cores[env];
+    u16* input = m_input + (env * GG_MAX_GAMEPADS);
+
+    for (int c = 0; c < GG_MAX_GAMEPADS; c++)
+    {
+        for (int k = 0; k < 12; k++)
+        {
+            GG_Keys key = (GG_Keys)(1 << k);
+
+            if (input[c] & key)
+                core->KeyPressed((GG_Controllers)c, key);
+            else
+                core->KeyReleased((GG_Controllers)c, key);
+        }
+    }
+
+    u8* frame = m_render ? GetFrame(env) : NULL;
+
+    if (m_audio)
+        core->RunToVBlank(frame, GetSamples(env), &m_sample_counts[env], NULL, m_render);
+    else
+    {
+        core->RunToVBlankSpeculative(frame);
+        m_sample_counts[env] = 0;
+    }
+
+    core->GetRuntimeInfo(m_runtime_info[env]);
+
+    if (m_ram_watch_count > 0)
+    {
+        u8* wram = core->GetMemory()->GetWorkingRAM();
+        u8* ram = GetRam(env);
+
+        for (int i = 0; i < m_ram_watch_count; i++)
+            ram[i] = wram[m_ram_watch[i]];
+    }
+}
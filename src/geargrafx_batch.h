@@ -0,0 +1,105 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef GEARGRAFX_BATCH_H
+#define GEARGRAFX_BATCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "common.h"
+
+#define GG_BATCH_MAX_FRAME_PIXELS (1120 * 242)
+
+class GeargrafxCore;
+
+// Runs several cores with the same media in lockstep, one frame per Step(),
+// spread over a persistent pool of worker threads. Env 0 loads the media
+// and the other envs are forks of it. Every output lives in a contiguous
+// array allocated up front with one fixed-size slot per env, so stepping
+// never allocates.
+class GeargrafxBatch
+{
+public:
+    GeargrafxBatch();
+    ~GeargrafxBatch();
+    bool Init(int env_count, int thread_count = 0, GG_Pixel_Format pixel_format = GG_PIXEL_RGBA8888);
+    bool LoadMedia(const char* file_path);
+    bool LoadHuCardFromBuffer(const u8* buffer, int size, const char* path = NULL);
+    bool SetRamWatch(const u16* addresses, int count);
+    void SetInput(int env, GG_Controllers controller, u16 keys);
+    void SetInputs(const u16* keys);
+    void Step(bool render = true, bool audio = true);
+    bool SaveSnapshot(int env, int source_env = -1);
+    bool ResetToSnapshot(int env);
+    GeargrafxCore* GetCore(int env);
+    int GetEnvCount();
+    int GetThreadCount();
+    int GetFrameStride();
+    u8* GetFrames();
+    u8* GetFrame(int env);
+    s16* GetSamples();
+    s16* GetSamples(int env);
+    int* GetSampleCounts();
+    u8* GetRam();
+    u8* GetRam(int env);
+    int GetRamWatchCount();
+    GG_Runtime_Info* GetRuntimeInfo();
+
+private:
+    bool CreateEnvs();
+    void DestroyEnvs();
+    void GrowSnapshots(size_t stride);
+    void StartWorkers();
+    void StopWorkers();
+    void WorkerThread();
+    void RunJobs();
+    void StepEnv(int env);
+
+private:
+    GeargrafxCore** m_cores;
+    int m_env_count;
+    int m_thread_count;
+    GG_Pixel_Format m_pixel_format;
+    int m_frame_stride;
+    u8* m_frames;
+    s16* m_samples;
+    int* m_sample_counts;
+    GG_Runtime_Info* m_runtime_info;
+    u16* m_input;
+    u16* m_ram_watch;
+    int m_ram_watch_count;
+    u8* m_ram;
+    u8* m_snapshots;
+    size_t* m_snapshot_sizes;
+    size_t m_snapshot_stride;
+    bool m_render;
+    bool m_audio;
+    std::thread* m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_start_condition;
+    std::condition_variable m_done_condition;
+    u32 m_generation;
+    int m_active_workers;
+    bool m_quit;
+    std::atomic<int> m_next_env;
+};
+
+#endif /* GEARGRAFX_BATCH_H */
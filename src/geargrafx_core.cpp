@@ -23,6 +23,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <vector>
 #include "geargrafx_core.h"
 #include "common.h"
 #include "media.h"
@@ -40,7 +41,7 @@
 #include "adpcm.h"
 #include "audio.h"
 #include "input.h"
-#include "memory_stream.h"
+#include "savestate_file.h"
 
 GeargrafxCore::GeargrafxCore()
 {
@@ -64,6 +65,12 @@ GeargrafxCore::GeargrafxCore()
     m_master_clock_cycles = 0;
     m_frame_ready = false;
     m_mb128_mode = GG_MB128_AUTO;
+    m_reference_mode = false;
+    memset(m_reference_samples, 0, sizeof(m_reference_samples));
+    InitPointer(m_perf_counters);
+    memset(&m_perf_live, 0, sizeof(m_perf_live));
+    memset(&m_perf_frame, 0, sizeof(m_perf_frame));
+    m_perf_sample_counter = 0;
 }
 
 GeargrafxCore::~GeargrafxCore()
@@ -137,6 +144,45 @@ void GeargrafxCore::Init(GG_Input_Pump_Fn input_pump_fn, GG_Pixel_Format pixel_f
     m_adpcm->SetTraceLogger(m_trace_logger);
     m_scsi_controller->SetTraceLogger(m_trace_logger);
 #endif
+
+#if defined(GG_ENABLE_PERF_COUNTERS)
+    m_perf_counters = &m_perf_live;
+    m_huc6270_1->SetPerfCounters(m_perf_counters);
+    m_huc6270_2->SetPerfCounters(m_perf_counters);
+    m_audio->SetPerfCounters(m_perf_counters);
+    m_cdrom_media->SetPerfCounters(m_perf_counters);
+#endif
+}
+
+// Runs a frame whose output is thrown away (e.g. run-ahead). Emulated state
+// advances exactly as in RunToVBlank() but the audio sources are not mixed into
+// samples and, unless a frame buffer is given, VDC lines and the VCE output are
+// not rendered.
+// In reference mode the frame runs the plain way and its samples are dropped.
+bool GeargrafxCore::RunToVBlankSpeculative(u8* frame_buffer)
+{
+    bool render = IsValidPointer(frame_buffer);
+
+    if (m_reference_mode)
+    {
+        int sample_count = 0;
+        return RunToVBlank(frame_buffer, m_reference_samples, &sample_count, NULL, render);
+    }
+
+    m_huc6260->SetSpeculative(!render);
+    m_huc6270_1->SetSpeculative(!render);
+    m_huc6270_2->SetSpeculative(!render);
+    m_audio->SetSpeculative(true);
+
+    int sample_count = 0;
+    bool ret = RunToVBlank(frame_buffer, NULL, &sample_count, NULL, render);
+
+    m_huc6260->SetSpeculative(false);
+    m_huc6270_1->SetSpeculative(false);
+    m_huc6270_2->SetSpeculative(false);
+    m_audio->SetSpeculative(false);
+
+    return ret;
 }
 
 bool GeargrafxCore::LoadMedia(const char* file_path)
@@ -201,6 +247,69 @@ bool GeargrafxCore::GetRuntimeInfo(GG_Runtime_Info& runtime_info)
     return m_media->IsReady();
 }
 
+bool GeargrafxCore::GetPerfCounters(GG_Perf_Counters& counters)
+{
+#if defined(GG_ENABLE_PERF_COUNTERS)
+    counters = m_perf_frame;
+    return true;
+#else
+    memset(&counters, 0, sizeof(counters));
+    return false;
+#endif
+}
+
+// Hashes every component in place through the save state writers, without
+// a buffer, so the result covers exactly what a save state would hold
+u64 GeargrafxCore::HashState(GG_State_Hash* state_hash)
+{
+    GG_PROFILE_ZONE("GeargrafxCore::HashState");
+
+    GG_State_Hash hash;
+    StateSerializer stream(NULL, 0);
+    stream.EnableHash(true);
+
+    SaveStateComponents(stream, NULL, hash.components);
+    hash.total = CalculateXXH64(hash.components, sizeof(hash.components));
+
+    if (IsValidPointer(state_hash))
+        *state_hash = hash;
+
+    return hash.total;
+}
+
+const char* GeargrafxCore::GetStateComponentName(int component)
+{
+    static const char* const k_names[GG_SAVESTATE_CHUNK_COUNT] =
+    {
+        "Clock", "Memory", "HuC6202", "HuC6260", "HuC6270 1", "HuC6270 2", "HuC6280",
+        "Audio", "Input", "CD-ROM", "SCSI", "CD-ROM Audio", "ADPCM", "Random",
+        "Screenshot", "Header"
+    };
+
+    if ((component < 0) || (component >= GG_SAVESTATE_CHUNK_COUNT))
+        return "Unknown";
+
+    return k_names[component];
+}
+
+#if defined(GG_ENABLE_PERF_COUNTERS)
+void GeargrafxCore::PerfEndRun(u64 start_ns, bool frame_done)
+{
+    m_perf_live.frame_host_ns += PerfNow() - start_ns;
+
+    // A debugger run can stop mid-frame, keep accumulating until vblank
+    if (!frame_done)
+        return;
+
+    u64 clocked_ns = m_perf_live.host_ns[GG_PERF_VIDEO] + m_perf_live.host_ns[GG_PERF_AUDIO] + m_perf_live.host_ns[GG_PERF_CDROM];
+    m_perf_live.host_ns[GG_PERF_CPU] = (m_perf_live.frame_host_ns > clocked_ns) ? m_perf_live.frame_host_ns - clocked_ns : 0;
+    m_perf_live.frame = m_perf_frame.frame + 1;
+
+    m_perf_frame = m_perf_live;
+    memset(&m_perf_live, 0, sizeof(m_perf_live));
+}
+#endif
+
 TraceLogger* GeargrafxCore::GetTraceLogger()
 {
     return m_trace_logger;
@@ -259,6 +368,26 @@ void GeargrafxCore::ResetMedia(bool preserve_ram)
     }
 }
 
+void GeargrafxCore::SetRandomSeed(u32 seed)
+{
+    m_random->Seed(seed);
+}
+
+// Reference mode keeps the core on the plain emulation code. Optional fast
+// paths (catch-up scheduling, bulk transfers, specialized renderers...) must
+// check IsReferenceMode() and fall back to the plain code when it is set, so
+// the lockstep runner can compare them frame by frame against a reference core.
+// RunToVBlankSpeculative() honors it by skipping neither audio nor rendering.
+void GeargrafxCore::SetReferenceMode(bool reference)
+{
+    m_reference_mode = reference;
+}
+
+bool GeargrafxCore::IsReferenceMode()
+{
+    return m_reference_mode;
+}
+
 void GeargrafxCore::SaveRam()
 {
     SaveRam(NULL);
@@ -269,25 +398,7 @@ void GeargrafxCore::SaveRam(const char* path, bool full_path)
     if (m_media->IsReady() && m_memory->IsBackupRamUsed())
     {
         using namespace std;
-        string final_path;
-
-        if (IsValidPointer(path))
-        {
-            final_path = path;
-            if (!full_path)
-            {
-                append_path_component(final_path, m_media->GetFileName());
-            }
-        }
-        else
-            final_path = m_media->GetFilePath();
-
-        if (!full_path)
-        {
-            string::size_type i = final_path.rfind('.', final_path.length());
-            if (i != string::npos)
-                final_path.replace(i, final_path.length() - i, ".sav");
-        }
+        string final_path = GetRamPath(path, full_path);
 
         Log("Saving BRAM file: %s", final_path.c_str());
 
@@ -309,18 +420,7 @@ void GeargrafxCore::SaveMB128(const char* path, bool full_path)
     if (m_input->GetMB128()->IsConnected())
     {
         using namespace std;
-        string final_path;
-
-        if (IsValidPointer(path))
-        {
-            final_path = path;
-            if (!full_path)
-                append_path_component(final_path, "mb128.sav");
-        }
-        else
-        {
-            final_path = "mb128.sav";
-        }
+        string final_path = GetMB128Path(path, full_path);
 
         Log("Saving MB128 file: %s", final_path.c_str());
 
@@ -352,18 +452,7 @@ void GeargrafxCore::LoadMB128(const char* path, bool full_path)
     if (m_input->GetMB128()->IsConnected())
     {
         using namespace std;
-        string final_path;
-
-        if (IsValidPointer(path))
-        {
-            final_path = path;
-            if (!full_path)
-                append_path_component(final_path, "mb128.sav");
-        }
-        else
-        {
-            final_path = "mb128.sav";
-        }
+        string final_path = GetMB128Path(path, full_path);
 
         Log("Loading MB128 file: %s", final_path.c_str());
 
@@ -410,25 +499,7 @@ void GeargrafxCore::LoadRam(const char* path, bool full_path)
     if (m_media->IsReady() && m_memory->IsBackupRamEnabled())
     {
         using namespace std;
-        string final_path;
-
-        if (IsValidPointer(path))
-        {
-            final_path = path;
-            if (!full_path)
-            {
-                append_path_component(final_path, m_media->GetFileName());
-            }
-        }
-        else
-            final_path = m_media->GetFilePath();
-
-        if (!full_path)
-        {
-            string::size_type i = final_path.rfind('.', final_path.length());
-            if (i != string::npos)
-                final_path.replace(i, final_path.length() - i, ".sav");
-        }
+        string final_path = GetRamPath(path, full_path);
 
         Log("Loading BRAM file: %s", final_path.c_str());
 
@@ -458,6 +529,51 @@ void GeargrafxCore::LoadRam(const char* path, bool full_path)
     }
 }
 
+std::string GeargrafxCore::GetRamPath(const char* path, bool full_path)
+{
+    using namespace std;
+    string final_path;
+
+    if (IsValidPointer(path))
+    {
+        final_path = path;
+        if (!full_path)
+        {
+            append_path_component(final_path, m_media->GetFileName());
+        }
+    }
+    else
+        final_path = m_media->GetFilePath();
+
+    if (!full_path)
+    {
+        string::size_type i = final_path.rfind('.', final_path.length());
+        if (i != string::npos)
+            final_path.replace(i, final_path.length() - i, ".sav");
+    }
+
+    return final_path;
+}
+
+std::string GeargrafxCore::GetMB128Path(const char* path, bool full_path)
+{
+    using namespace std;
+    string final_path;
+
+    if (IsValidPointer(path))
+    {
+        final_path = path;
+        if (!full_path)
+            append_path_component(final_path, "mb128.sav");
+    }
+    else
+    {
+        final_path = "mb128.sav";
+    }
+
+    return final_path;
+}
+
 std::string GeargrafxCore::GetSaveStatePath(const char* path, int index)
 {
     if (index < 0)
@@ -502,26 +618,38 @@ bool GeargrafxCore::SaveState(const char* path, int index, bool screenshot)
 {
     using namespace std;
 
+    if (!m_media->IsReady())
+    {
+        Error("Cartridge is not ready when trying to save state");
+        return false;
+    }
+
     string full_path = GetSaveStatePath(path, index);
     Debug("Saving state to %s...", full_path.c_str());
 
-    ofstream stream;
-    open_ofstream_utf8(stream, full_path.c_str(), ios::out | ios::binary);
+    size_t size = GetSaveStateSize(screenshot);
+    vector<u8> state(size);
+    u32 chunk_sizes[GG_SAVESTATE_CHUNK_COUNT];
+    vector<u8> buffer;
 
-    if (!stream.is_open())
+    if (!SaveState(state.data(), size, screenshot, chunk_sizes) || !SaveStateFile::Encode(state.data(), chunk_sizes, buffer))
     {
-        Error("Failed to open save state file for writing: %s", full_path.c_str());
+        Error("Failed to save state to file: %s", full_path.c_str());
         return false;
     }
 
-    size_t size = 0;
-    if (!SaveState(stream, size, screenshot))
+    size = buffer.size();
+
+    ofstream stream;
+    open_ofstream_utf8(stream, full_path.c_str(), ios::out | ios::binary);
+
+    if (!stream.is_open())
     {
-        stream.close();
-        Error("Failed to save state to file: %s", full_path.c_str());
+        Error("Failed to open save state file for writing: %s", full_path.c_str());
         return false;
     }
 
+    stream.write(reinterpret_cast<const char*> (buffer.data()), size);
     stream.close();
 
     if (!stream.good())
@@ -534,10 +662,8 @@ bool GeargrafxCore::SaveState(const char* path, int index, bool screenshot)
     return true;
 }
 
-bool GeargrafxCore::SaveState(u8* buffer, size_t& size, bool screenshot)
+bool GeargrafxCore::SaveState(u8* buffer, size_t& size, bool screenshot, u32* chunk_sizes)
 {
-    using namespace std;
-
     Debug("Saving state to buffer [%d bytes]...", size);
 
     if (!m_media->IsReady())
@@ -546,69 +672,51 @@ bool GeargrafxCore::SaveState(u8* buffer, size_t& size, bool screenshot)
         return false;
     }
 
-    if (!IsValidPointer(buffer))
+    // A NULL buffer only measures the state
+    StateSerializer stream(buffer, IsValidPointer(buffer) ? size : 0);
+
+    if (!SaveState(stream, size, screenshot, chunk_sizes))
     {
-        stringstream stream;
-        if (!SaveState(stream, size, screenshot))
-        {
-            Error("Failed to save state to stream to calculate size");
-            return false;
-        }
-        return true;
+        Error("Failed to save state to buffer");
+        return false;
     }
-    else
+
+    if (stream.HasFailed())
     {
-        memory_stream direct_stream(reinterpret_cast<char*>(buffer), size);
+        Error("Failed to save state to buffer: output buffer is too small");
+        return false;
+    }
 
-        if (!SaveState(direct_stream, size, screenshot))
-        {
-            Error("Failed to save state to buffer");
-            return false;
-        }
+    return true;
+}
 
-        if (!direct_stream.good())
-        {
-            Error("Failed to save state to buffer: output buffer is too small");
-            return false;
-        }
+size_t GeargrafxCore::GetSaveStateSize(bool screenshot)
+{
+    size_t size = 0;
 
-        size = direct_stream.size();
-        return true;
-    }
+    if (!m_media->IsReady())
+        return 0;
+
+    StateSerializer stream(NULL, 0);
+
+    if (!SaveState(stream, size, screenshot))
+        return 0;
+
+    return size;
 }
 
-bool GeargrafxCore::SaveState(std::ostream& stream, size_t& size, bool screenshot)
+bool GeargrafxCore::SaveState(StateSerializer& stream, size_t& size, bool screenshot, u32* chunk_sizes)
 {
     using namespace std;
 
-    if (!m_media->IsReady())
-    {
-        Error("Cartridge is not ready when trying to save state");
-        return false;
-    }
+    GG_PROFILE_ZONE("GeargrafxCore::SaveState");
 
     Debug("Serializing save state...");
 
-    stream.write(reinterpret_cast<const char*> (&m_master_clock_cycles), sizeof(m_master_clock_cycles));
+    SaveStateComponents(stream, chunk_sizes);
+    size_t chunk_start = stream.GetSize();
 
-    m_memory->SaveState(stream);
-    m_huc6202->SaveState(stream);
-    m_huc6260->SaveState(stream);
-    m_huc6270_1->SaveState(stream);
-    m_huc6270_2->SaveState(stream);
-    m_huc6280->SaveState(stream);
-    m_audio->SaveState(stream);
-    m_input->SaveState(stream);
-    if (m_media->IsCDROM())
-    {
-        m_cdrom->SaveState(stream);
-        m_scsi_controller->SaveState(stream);
-        m_cdrom_audio->SaveState(stream);
-        m_adpcm->SaveState(stream);
-    }
-    m_random->SaveState(stream);
-
-    if (stream.fail())
+    if (stream.HasFailed())
     {
         Error("Failed to serialize save state");
         return false;
@@ -621,7 +729,7 @@ bool GeargrafxCore::SaveState(std::ostream& stream, size_t& size, bool screensho
     Debug("Save state header magic: 0x%08x", header.magic);
     Debug("Save state header version: %d", header.version);
 #else
-    GG_SaveState_Header header;
+    GG_SaveState_Header header = {};
     header.magic = GG_SAVESTATE_MAGIC;
     header.version = GG_SAVESTATE_VERSION;
 
@@ -650,7 +758,7 @@ bool GeargrafxCore::SaveState(std::ostream& stream, size_t& size, bool screensho
         u8* frame_buffer = m_huc6260->GetBuffer();
 
         header.screenshot_size = header.screenshot_width * header.screenshot_height * bytes_per_pixel;
-        stream.write(reinterpret_cast<const char*>(frame_buffer), header.screenshot_size);
+        stream.Write(frame_buffer, header.screenshot_size);
     }
     else
     {
@@ -665,24 +773,18 @@ bool GeargrafxCore::SaveState(std::ostream& stream, size_t& size, bool screensho
     Debug("Save state header screenshot height: %d", header.screenshot_height);
 #endif
 
-    std::streampos position = stream.tellp();
-    if (position == std::streampos(-1))
-    {
-        Error("Failed to calculate save state size");
-        return false;
-    }
-
-    size = static_cast<size_t>(position);
-    size += sizeof(header);
+    size = stream.GetSize() + sizeof(header);
 
 #if !defined(__LIBRETRO__)
     header.size = static_cast<u32>(size);
     Debug("Save state header size: %d", header.size);
 #endif
 
-    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    EndStateChunk(stream, chunk_sizes, NULL, GG_SAVESTATE_CHUNK_SCREENSHOT, chunk_start);
+    stream.Write(&header, sizeof(header));
+    EndStateChunk(stream, chunk_sizes, NULL, GG_SAVESTATE_CHUNK_HEADER, chunk_start);
 
-    if (stream.fail())
+    if (stream.HasFailed())
     {
         Error("Failed to write save state header");
         return false;
@@ -704,7 +806,29 @@ bool GeargrafxCore::LoadState(const char* path, int index)
 
     if (!stream.fail())
     {
-        ret = LoadState(stream);
+        stream.seekg(0, ios::end);
+        streampos end = stream.tellg();
+        stream.seekg(0, ios::beg);
+
+        size_t size = (end > 0) ? static_cast<size_t>(end) : 0;
+        vector<u8> buffer(size);
+
+        if (size > 0)
+            stream.read(reinterpret_cast<char*> (buffer.data()), size);
+        else
+            Error("Unable to get the size of %s", full_path.c_str());
+
+        if ((size > 0) && !stream.fail())
+        {
+            if (SaveStateFile::IsChunked(buffer.data(), size))
+            {
+                vector<u8> state;
+                if (SaveStateFile::Decode(buffer.data(), size, state))
+                    ret = LoadState(state.data(), state.size());
+            }
+            else
+                ret = LoadState(buffer.data(), size);
+        }
 
         if (ret)
             Log("Loaded state from %s", full_path.c_str());
@@ -722,8 +846,6 @@ bool GeargrafxCore::LoadState(const char* path, int index)
 
 bool GeargrafxCore::LoadState(const u8* buffer, size_t size)
 {
-    using namespace std;
-
     Debug("Loading state to buffer [%d bytes]...", size);
 
     if (!m_media->IsReady())
@@ -738,34 +860,29 @@ bool GeargrafxCore::LoadState(const u8* buffer, size_t size)
         return false;
     }
 
-    memory_input_stream direct_stream(reinterpret_cast<const char*>(buffer), size);
-    return LoadState(direct_stream);
+    StateDeserializer stream(buffer, size);
+    return LoadState(stream);
 }
 
-bool GeargrafxCore::LoadState(std::istream& stream)
+bool GeargrafxCore::LoadState(StateDeserializer& stream)
 {
     using namespace std;
 
-    if (!m_media->IsReady())
-    {
-        Error("Cartridge is not ready when trying to load state");
-        return false;
-    }
+    GG_PROFILE_ZONE("GeargrafxCore::LoadState");
 
     GG_SaveState_Header_Libretro header = {};
 #if !defined(__LIBRETRO__)
     bool is_desktop_savestate = false;
 #endif
 
-    stream.seekg(0, ios::end);
-    size_t size = static_cast<size_t>(stream.tellg());
+    size_t size = stream.GetSize();
 
     // Try desktop header first (larger, contains all info)
     GG_SaveState_Header desktop_header;
     if (size >= sizeof(desktop_header))
     {
-        stream.seekg(size - sizeof(desktop_header), ios::beg);
-        stream.read(reinterpret_cast<char*> (&desktop_header), sizeof(desktop_header));
+        stream.Seek(size - sizeof(desktop_header));
+        stream.Read(&desktop_header, sizeof(desktop_header));
 
         if (desktop_header.magic == GG_SAVESTATE_MAGIC)
         {
@@ -781,11 +898,11 @@ bool GeargrafxCore::LoadState(std::istream& stream)
     // Fallback to libretro header
     if ((header.magic != GG_SAVESTATE_MAGIC) && (size >= sizeof(header)))
     {
-        stream.seekg(size - sizeof(header), ios::beg);
-        stream.read(reinterpret_cast<char*> (&header), sizeof(header));
+        stream.Seek(size - sizeof(header));
+        stream.Read(&header, sizeof(header));
     }
 
-    stream.seekg(0, ios::beg);
+    stream.Seek(0);
 
     Debug("Load state header magic: 0x%08x", header.magic);
     Debug("Load state header version: %d", header.version);
@@ -831,39 +948,236 @@ bool GeargrafxCore::LoadState(std::istream& stream)
 
     Debug("Unserializing save state...");
 
-    if (header.version >= 27)
-        stream.read(reinterpret_cast<char*> (&m_master_clock_cycles), sizeof(m_master_clock_cycles));
+    LoadStateComponents(stream, header.version);
+
+    if (stream.HasFailed())
+    {
+        Error("Failed to unserialize save state");
+        return false;
+    }
+
+    return true;
+}
+
+void GeargrafxCore::SaveStateComponents(StateSerializer& stream, u32* chunk_sizes, u64* chunk_hashes)
+{
+    size_t chunk_start = stream.GetSize();
+
+    if (IsValidPointer(chunk_sizes))
+        memset(chunk_sizes, 0, sizeof(u32) * GG_SAVESTATE_CHUNK_COUNT);
+
+    if (IsValidPointer(chunk_hashes))
+        memset(chunk_hashes, 0, sizeof(u64) * GG_SAVESTATE_CHUNK_COUNT);
+
+    stream.Write(&m_master_clock_cycles, sizeof(m_master_clock_cycles));
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_CLOCK, chunk_start);
+
+    m_memory->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_MEMORY, chunk_start);
+    m_huc6202->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_HUC6202, chunk_start);
+    m_huc6260->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_HUC6260, chunk_start);
+    m_huc6270_1->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_HUC6270_1, chunk_start);
+    m_huc6270_2->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_HUC6270_2, chunk_start);
+    m_huc6280->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_HUC6280, chunk_start);
+    m_audio->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_AUDIO, chunk_start);
+    m_input->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_INPUT, chunk_start);
+    if (m_media->IsCDROM())
+    {
+        m_cdrom->SaveState(stream);
+        EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_CDROM, chunk_start);
+        m_scsi_controller->SaveState(stream);
+        EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_SCSI, chunk_start);
+        m_cdrom_audio->SaveState(stream);
+        EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_CDROM_AUDIO, chunk_start);
+        m_adpcm->SaveState(stream);
+        EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_ADPCM, chunk_start);
+    }
+    m_random->SaveState(stream);
+    EndStateChunk(stream, chunk_sizes, chunk_hashes, GG_SAVESTATE_CHUNK_RANDOM, chunk_start);
+}
+
+// Records the size, and the hash when the stream is hashing, of the chunk
+// that ends at the current stream position
+void GeargrafxCore::EndStateChunk(StateSerializer& stream, u32* chunk_sizes, u64* chunk_hashes, int chunk, size_t& chunk_start)
+{
+    size_t position = stream.GetSize();
+
+    if (IsValidPointer(chunk_sizes))
+        chunk_sizes[chunk] = (u32)(position - chunk_start);
+
+    if (IsValidPointer(chunk_hashes) && stream.IsHashing())
+        chunk_hashes[chunk] = stream.TakeHash();
+
+    chunk_start = position;
+}
+
+void GeargrafxCore::LoadStateComponents(StateDeserializer& stream, int version)
+{
+    if (version >= 27)
+        stream.Read(&m_master_clock_cycles, sizeof(m_master_clock_cycles));
     else
         m_master_clock_cycles = 0;
 
     m_memory->LoadState(stream);
     m_huc6202->LoadState(stream);
     m_huc6260->LoadState(stream);
-    m_huc6270_1->LoadState(stream, header.version);
-    m_huc6270_2->LoadState(stream, header.version);
+    m_huc6270_1->LoadState(stream, version);
+    m_huc6270_2->LoadState(stream, version);
     m_huc6280->LoadState(stream);
-    m_audio->LoadState(stream, header.version);
-    m_input->LoadState(stream, header.version);
+    m_audio->LoadState(stream, version);
+    m_input->LoadState(stream, version);
     if (m_media->IsCDROM())
     {
-        m_cdrom->LoadState(stream, header.version);
-        m_scsi_controller->LoadState(stream, header.version);
-        m_cdrom_audio->LoadState(stream, header.version);
-        m_adpcm->LoadState(stream, header.version);
+        m_cdrom->LoadState(stream, version);
+        m_scsi_controller->LoadState(stream, version);
+        m_cdrom_audio->LoadState(stream, version);
+        m_adpcm->LoadState(stream, version);
     }
 
-    if (header.version >= 33)
+    if (version >= 33)
         m_random->LoadState(stream);
+}
 
-    if (stream.fail())
+// Incremental states hold every register but only the RAM pages written
+// since the last incremental save (or ClearDirtyPages). They can only be
+// loaded on top of the state they were taken from, or a later one that
+// shares all clean pages with it. A NULL buffer measures the size without
+// clearing the dirty pages.
+bool GeargrafxCore::SaveStateIncremental(u8* buffer, size_t& size)
+{
+    if (!m_media->IsReady())
     {
-        Error("Failed to unserialize save state");
+        Error("Cartridge is not ready when trying to save incremental state");
+        return false;
+    }
+
+    StateSerializer stream(buffer, IsValidPointer(buffer) ? size : 0, true);
+
+    SaveStateComponents(stream);
+
+    GG_SaveState_Header_Libretro header;
+    header.magic = GG_SAVESTATE_INCREMENTAL_MAGIC;
+    header.version = GG_SAVESTATE_VERSION;
+    stream.Write(&header, sizeof(header));
+
+    size = stream.GetSize();
+
+    if (stream.HasFailed())
+    {
+        Error("Failed to save incremental state: output buffer is too small");
+        return false;
+    }
+
+    if (IsValidPointer(buffer))
+        ClearDirtyPages();
+
+    return true;
+}
+
+bool GeargrafxCore::LoadStateIncremental(const u8* buffer, size_t size)
+{
+    if (!m_media->IsReady())
+    {
+        Error("Cartridge is not ready when trying to load incremental state");
+        return false;
+    }
+
+    GG_SaveState_Header_Libretro header;
+
+    if (!IsValidPointer(buffer) || (size < sizeof(header)))
+    {
+        Error("Invalid incremental state buffer");
+        return false;
+    }
+
+    memcpy(&header, buffer + size - sizeof(header), sizeof(header));
+
+    if ((header.magic != GG_SAVESTATE_INCREMENTAL_MAGIC) || (header.version != GG_SAVESTATE_VERSION))
+    {
+        Error("Invalid incremental state: 0x%08x, version %d", header.magic, header.version);
+        return false;
+    }
+
+    StateDeserializer stream(buffer, size - sizeof(header), true);
+
+    LoadStateComponents(stream, header.version);
+
+    if (stream.HasFailed())
+    {
+        Error("Failed to unserialize incremental state");
         return false;
     }
 
     return true;
 }
 
+// Compact copy of the last video frame for callers that keep many states
+// (rewind) and do not want a full screenshot in each one. A NULL buffer
+// measures the size.
+bool GeargrafxCore::SaveFrame(u8* buffer, size_t& size)
+{
+    if (!m_media->IsReady())
+        return false;
+
+    StateSerializer stream(buffer, IsValidPointer(buffer) ? size : 0);
+    m_huc6260->SaveFrame(stream, m_media->IsSGX());
+    size = stream.GetSize();
+
+    return !stream.HasFailed();
+}
+
+bool GeargrafxCore::LoadFrame(const u8* buffer, size_t size, u8* frame_buffer)
+{
+    if (!m_media->IsReady() || !IsValidPointer(buffer))
+        return false;
+
+    u8* current_buffer = m_huc6260->GetBuffer();
+    m_huc6260->SetBuffer(frame_buffer);
+
+    StateDeserializer stream(buffer, size);
+    m_huc6260->LoadFrame(stream, m_media->IsSGX());
+
+    m_huc6260->SetBuffer(current_buffer);
+
+    return !stream.HasFailed();
+}
+
+size_t GeargrafxCore::GetMaxFrameSize()
+{
+    return m_huc6260->GetMaxFrameSize();
+}
+
+void GeargrafxCore::ClearDirtyPages()
+{
+    m_memory->ClearDirtyPages();
+    m_huc6270_1->GetVRAMDirtyPages()->Clear();
+    m_huc6270_2->GetVRAMDirtyPages()->Clear();
+    m_adpcm->GetRAMDirtyPages()->Clear();
+}
+
+void GeargrafxCore::MarkAllPagesDirty()
+{
+    m_memory->MarkAllPagesDirty();
+    m_huc6270_1->GetVRAMDirtyPages()->MarkAll();
+    m_huc6270_2->GetVRAMDirtyPages()->MarkAll();
+    m_adpcm->GetRAMDirtyPages()->MarkAll();
+}
+
+u32 GeargrafxCore::GetDirtyPageCount()
+{
+    return m_memory->GetDirtyPageCount() +
+        m_huc6270_1->GetVRAMDirtyPages()->GetDirtyCount() +
+        m_huc6270_2->GetVRAMDirtyPages()->GetDirtyCount() +
+        m_adpcm->GetRAMDirtyPages()->GetDirtyCount();
+}
+
 bool GeargrafxCore::GetSaveStateHeader(int index, const char* path, GG_SaveState_Header* header)
 {
     using namespace std;
@@ -881,10 +1195,18 @@ bool GeargrafxCore::GetSaveStateHeader(int index, const char* path, GG_SaveState
         return false;
     }
 
+    if (SaveStateFile::IsChunked(stream))
+    {
+        bool ret = SaveStateFile::ReadChunk(stream, GG_SAVESTATE_CHUNK_HEADER, reinterpret_cast<u8*>(header), sizeof(GG_SaveState_Header));
+        return ret && (header->magic == GG_SAVESTATE_MAGIC);
+    }
+
     stream.seekg(0, ios::end);
-    size_t savestate_size = static_cast<size_t>(stream.tellg());
+    streampos end = stream.tellg();
     stream.seekg(0, ios::beg);
 
+    size_t savestate_size = (end > 0) ? static_cast<size_t>(end) : 0;
+
     if (savestate_size < sizeof(GG_SaveState_Header))
     {
         Error("Invalid save state file size: %zu", savestate_size);
@@ -969,6 +1291,13 @@ bool GeargrafxCore::GetSaveStateScreenshot(int index, const char* path, GG_SaveS
     Debug("Screenshot height: %d", screenshot->height);
     Debug("Screenshot width scale: %d", screenshot->width_scale);
 
+    if (SaveStateFile::IsChunked(stream))
+    {
+        bool ret = SaveStateFile::ReadChunk(stream, GG_SAVESTATE_CHUNK_SCREENSHOT, screenshot->data, screenshot->size);
+        stream.close();
+        return ret;
+    }
+
     if (header.size < sizeof(header) + screenshot->size)
     {
         Error("Invalid screenshot offset");
@@ -990,6 +1319,11 @@ void GeargrafxCore::Reset()
 
     m_media->GatherMediaInfo();
 
+    ResetHardware();
+}
+
+void GeargrafxCore::ResetHardware()
+{
     GG_Console_Type console_type = m_media->GetConsoleType();
     bool force_backup_ram = m_media->IsBackupRAMForced();
     bool is_sgx = m_media->IsSGX();
@@ -1035,3 +1369,78 @@ void GeargrafxCore::EnableMB128(GG_MB128_Mode mode)
 
     m_input->EnableMB128(enable);
 }
+
+// Creates an independent core running the same media, with the same
+// settings and state as this one. HuCard ROMs are shared instead of copied,
+// so this core must outlive the fork. CD-ROM images are opened again, see
+// Media::ShareMedia. Forks have no input pump and are fed with
+// KeyPressed/KeyReleased.
+GeargrafxCore* GeargrafxCore::Fork()
+{
+    if (!m_media->IsReady())
+    {
+        Error("Cartridge is not ready when trying to fork core");
+        return NULL;
+    }
+
+    GeargrafxCore* fork = new GeargrafxCore();
+    fork->Init(NULL, m_huc6260->GetPixelFormat());
+    fork->CopySettings(this);
+
+    if (!fork->m_media->ShareMedia(m_media))
+    {
+        Error("Failed to share media when forking core");
+        SafeDelete(fork);
+        return NULL;
+    }
+
+    fork->m_memory->ResetDisassemblerRecords();
+    fork->m_master_clock_cycles = 0;
+    fork->m_paused = false;
+
+    // Shared HuCards keep the media info already gathered here
+    if (m_media->IsCDROM())
+        fork->Reset();
+    else
+        fork->ResetHardware();
+
+    if (!fork->CopyStateFrom(this))
+    {
+        Error("Failed to copy state when forking core");
+        SafeDelete(fork);
+        return NULL;
+    }
+
+    return fork;
+}
+
+// Brings this core to the current state of another one running the same
+// media, typically a core created with Fork(). After the first call the
+// transfer buffer is reused, so branching repeatedly does not allocate.
+bool GeargrafxCore::CopyStateFrom(GeargrafxCore* source)
+{
+    size_t size = source->GetSaveStateSize(false);
+
+    if (size == 0)
+        return false;
+
+    // Grow only, a state that shrinks (e.g. MB128 disconnected) still fits
+    if (size > m_fork_state.size())
+        m_fork_state.resize(size);
+
+    if (!source->SaveState(m_fork_state.data(), size, false))
+        return false;
+
+    return LoadState(m_fork_state.data(), size);
+}
+
+void GeargrafxCore::CopySettings(GeargrafxCore* source)
+{
+    m_mb128_mode = source->m_mb128_mode;
+    m_reference_mode = source->m_reference_mode;
+    m_huc6260->CopySettings(source->m_huc6260);
+    m_huc6270_1->CopySettings(source->m_huc6270_1);
+    m_huc6270_2->CopySettings(source->m_huc6270_2);
+    m_input->CopySettings(source->m_input);
+    m_audio->CopySettings(source->m_audio);
+}
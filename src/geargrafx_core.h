@@ -22,6 +22,10 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#if defined(GG_ENABLE_PERF_COUNTERS)
+#include <chrono>
+#endif
 #include "common.h"
 
 class Audio;
@@ -40,6 +44,14 @@ class ScsiController;
 class Random;
 class TraceLogger;
 
+// Thread safety: a core owns all of its emulation state, so any number of
+// cores can run concurrently, each one driven by a single thread at a time.
+// Calls into the same core from several threads must be serialized by the
+// caller. Cores share nothing mutable: Log/Error only format into a local
+// buffer before a single stdio call, and g_mcp_stdio_mode must be set
+// before cores start running. Profiling zones record into per-thread
+// rings. Forks share the source HuCard ROM read-only, so the source must
+// not load other media or be destroyed while its forks are alive.
 class GeargrafxCore
 {
 public:
@@ -60,6 +72,7 @@ public:
     ~GeargrafxCore();
     void Init(GG_Input_Pump_Fn input_pump_fn, GG_Pixel_Format pixel_format = GG_PIXEL_RGBA8888);
     bool RunToVBlank(u8* frame_buffer, s16* sample_buffer, int* sample_count, GG_Debug_Run* debug = NULL, bool render = true);
+    bool RunToVBlankSpeculative(u8* frame_buffer = NULL);
     bool LoadMedia(const char* file_path);
 #if defined(GG_ENABLE_PHYSICAL_CDROM)
     bool LoadPhysicalCdRom(const char* device_id);
@@ -69,6 +82,9 @@ public:
     bool LoadBiosFromBuffer(const u8* buffer, int size, bool syscard);
     void UnloadBios(bool syscard);
     void ResetMedia(bool preserve_ram);
+    void SetRandomSeed(u32 seed);
+    void SetReferenceMode(bool reference);
+    bool IsReferenceMode();
     void KeyPressed(GG_Controllers controller, GG_Keys key);
     void KeyReleased(GG_Controllers controller, GG_Keys key);
     void Pause(bool paused);
@@ -80,13 +96,31 @@ public:
     void SaveMB128(const char* path, bool full_path = false);
     void LoadMB128(const char* path, bool full_path = false);
     void EnableMB128(GG_MB128_Mode mode);
+    void CopySettings(GeargrafxCore* source);
+    GeargrafxCore* Fork();
+    bool CopyStateFrom(GeargrafxCore* source);
     bool SaveState(const char* path = NULL, int index = -1, bool screenshot = false);
-    bool SaveState(u8* buffer, size_t& size, bool screenshot = false);
+    bool SaveState(u8* buffer, size_t& size, bool screenshot = false, u32* chunk_sizes = NULL);
+    size_t GetSaveStateSize(bool screenshot = false);
     bool LoadState(const char* path = NULL, int index = -1);
     bool LoadState(const u8* buffer, size_t size);
+    bool SaveStateIncremental(u8* buffer, size_t& size);
+    bool LoadStateIncremental(const u8* buffer, size_t size);
+    bool SaveFrame(u8* buffer, size_t& size);
+    bool LoadFrame(const u8* buffer, size_t size, u8* frame_buffer);
+    size_t GetMaxFrameSize();
+    void ClearDirtyPages();
+    void MarkAllPagesDirty();
+    u32 GetDirtyPageCount();
     bool GetSaveStateHeader(int index, const char* path, GG_SaveState_Header* header);
     bool GetSaveStateScreenshot(int index, const char* path, GG_SaveState_Screenshot* screenshot);
+    std::string GetSaveStatePath(const char* path, int index);
+    std::string GetRamPath(const char* path, bool full_path = false);
+    std::string GetMB128Path(const char* path, bool full_path = false);
     bool GetRuntimeInfo(GG_Runtime_Info& runtime_info);
+    bool GetPerfCounters(GG_Perf_Counters& counters);
+    u64 HashState(GG_State_Hash* state_hash = NULL);
+    static const char* GetStateComponentName(int component);
     Memory* GetMemory();
     Media* GetMedia();
     HuC6202* GetHuC6202();
@@ -106,15 +140,24 @@ public:
 
 private:
     void Reset();
+    void ResetHardware();
     template<bool is_cdrom, bool is_sgx>
     bool ClockHardware(u32 cycles);
     template<bool is_cdrom, bool is_sgx>
     static void ClockHardwareCallback(void* context, u32 cycles);
     template<bool debugger, bool is_cdrom, bool is_sgx>
     bool RunToVBlankTemplate(u8* frame_buffer, s16* sample_buffer, int* sample_count, GG_Debug_Run* debug, bool render);
-    bool SaveState(std::ostream& stream, size_t& size, bool screenshot);
-    bool LoadState(std::istream& stream);
-    std::string GetSaveStatePath(const char* path, int index);
+    bool SaveState(StateSerializer& stream, size_t& size, bool screenshot, u32* chunk_sizes = NULL);
+    bool LoadState(StateDeserializer& stream);
+    void SaveStateComponents(StateSerializer& stream, u32* chunk_sizes = NULL, u64* chunk_hashes = NULL);
+    void EndStateChunk(StateSerializer& stream, u32* chunk_sizes, u64* chunk_hashes, int chunk, size_t& chunk_start);
+    void LoadStateComponents(StateDeserializer& stream, int version);
+#if defined(GG_ENABLE_PERF_COUNTERS)
+    static u64 PerfNow();
+    u64 PerfLapBegin();
+    void PerfLap(u64& lap, GG_Perf_Subsystem subsystem);
+    void PerfEndRun(u64 start_ns, bool frame_done);
+#endif
 
 private:
     Memory* m_memory;
@@ -136,7 +179,14 @@ private:
     TraceLogger* m_trace_logger;
     u64 m_master_clock_cycles;
     bool m_frame_ready;
+    std::vector<u8> m_fork_state;
     GG_MB128_Mode m_mb128_mode;
+    bool m_reference_mode;
+    s16 m_reference_samples[GG_AUDIO_BUFFER_SIZE * 2];
+    GG_Perf_Counters* m_perf_counters;
+    GG_Perf_Counters m_perf_live;
+    GG_Perf_Counters m_perf_frame;
+    u32 m_perf_sample_counter;
 };
 
 #include "geargrafx_core_inline.h"
@@ -29,6 +29,16 @@
 #include "cdrom.h"
 #include "cdrom_audio.h"
 #include "adpcm.h"
+#include "profiler.h"
+
+#if defined(GG_ENABLE_PERF_COUNTERS)
+    #define GG_PERF_SAMPLE_RATE 32
+    #define GG_PERF_LAP_BEGIN() u64 perf_lap = PerfLapBegin()
+    #define GG_PERF_LAP(subsystem) PerfLap(perf_lap, subsystem)
+#else
+    #define GG_PERF_LAP_BEGIN() do { } while (0)
+    #define GG_PERF_LAP(subsystem) do { } while (0)
+#endif
 
 INLINE bool GeargrafxCore::RunToVBlank(u8* frame_buffer, s16* sample_buffer, int* sample_count, GG_Debug_Run* debug, bool render)
 {
@@ -70,8 +80,14 @@ INLINE bool GeargrafxCore::RunToVBlank(u8* frame_buffer, s16* sample_buffer, int
 template<bool debugger, bool is_cdrom, bool is_sgx>
 bool GeargrafxCore::RunToVBlankTemplate(u8* frame_buffer, s16* sample_buffer, int* sample_count, GG_Debug_Run* debug, bool render)
 {
+    GG_PROFILE_ZONE("GeargrafxCore::RunToVBlank");
+
     m_huc6280->SetHardwareClock(&GeargrafxCore::ClockHardwareCallback<is_cdrom, is_sgx>, this);
 
+#if defined(GG_ENABLE_PERF_COUNTERS)
+    u64 perf_start = PerfNow();
+#endif
+
     if (debugger)
     {
         bool debug_enable = false;
@@ -88,6 +104,7 @@ bool GeargrafxCore::RunToVBlankTemplate(u8* frame_buffer, s16* sample_buffer, in
 
         m_huc6260->SetBuffer(render ? frame_buffer : NULL);
         bool stop = false;
+        bool frame_done = false;
 
         do
         {
@@ -95,10 +112,12 @@ bool GeargrafxCore::RunToVBlankTemplate(u8* frame_buffer, s16* sample_buffer, in
             u32 cycles = m_huc6280->RunInstruction(&instruction_completed);
             u32 clocked_cycles = m_huc6280->GetClockedMasterCycles();
             u32 remaining_cycles = (cycles > clocked_cycles) ? cycles - clocked_cycles : 0;
+            GG_PERF_ADD(m_perf_counters, instructions, 1);
 
             stop = m_frame_ready;
             if (ClockHardware<is_cdrom, is_sgx>(remaining_cycles))
                 stop = true;
+            frame_done = stop;
 
             if (debug_enable)
             {
@@ -123,6 +142,12 @@ bool GeargrafxCore::RunToVBlankTemplate(u8* frame_buffer, s16* sample_buffer, in
         m_audio->EndFrame(sample_buffer, sample_count);
         m_input->EndFrame();
 
+#if defined(GG_ENABLE_PERF_COUNTERS)
+        PerfEndRun(perf_start, frame_done);
+#else
+        UNUSED(frame_done);
+#endif
+
         return m_huc6280->BreakpointHit() || m_huc6280->RunToBreakpointHit();
     }
     else
@@ -137,6 +162,7 @@ bool GeargrafxCore::RunToVBlankTemplate(u8* frame_buffer, s16* sample_buffer, in
             u32 cycles = m_huc6280->RunInstruction();
             u32 clocked_cycles = m_huc6280->GetClockedMasterCycles();
             u32 remaining_cycles = (cycles > clocked_cycles) ? cycles - clocked_cycles : 0;
+            GG_PERF_ADD(m_perf_counters, instructions, 1);
 
             stop = m_frame_ready;
             if (ClockHardware<is_cdrom, is_sgx>(remaining_cycles))
@@ -147,6 +173,10 @@ bool GeargrafxCore::RunToVBlankTemplate(u8* frame_buffer, s16* sample_buffer, in
         m_audio->EndFrame(sample_buffer, sample_count);
         m_input->EndFrame();
 
+#if defined(GG_ENABLE_PERF_COUNTERS)
+        PerfEndRun(perf_start, true);
+#endif
+
         return false;
     }
 }
@@ -156,33 +186,46 @@ INLINE bool GeargrafxCore::ClockHardware(u32 cycles)
 {
     bool frame_ready = false;
 
+    GG_PERF_ADD(m_perf_counters, clock_hardware_calls, 1);
+    GG_PERF_ADD(m_perf_counters, master_cycles, cycles);
+
     while (cycles > 0)
     {
+        GG_PERF_LAP_BEGIN();
+
         if (!m_huc6202->HasPendingCpuVramAccess())
         {
             m_master_clock_cycles += cycles;
             m_huc6280->ClockTimer(cycles);
             if (m_huc6260->Clock<is_sgx>(cycles))
                 frame_ready = true;
+            GG_PERF_LAP(GG_PERF_VIDEO);
             if (is_cdrom)
             {
                 m_cdrom->Clock(cycles);
+                GG_PERF_LAP(GG_PERF_CDROM);
             }
             m_audio->Clock(cycles);
+            GG_PERF_LAP(GG_PERF_AUDIO);
             break;
         }
 
+        GG_PERF_ADD(m_perf_counters, clock_hardware_slow_steps, 1);
+
         u32 step = (cycles > 3) ? 3 : cycles;
         m_master_clock_cycles += step;
         m_huc6280->ClockTimer(step);
         m_huc6202->ProcessCpuVramAccesses(step);
         if (m_huc6260->Clock<is_sgx>(step))
             frame_ready = true;
+        GG_PERF_LAP(GG_PERF_VIDEO);
         if (is_cdrom)
         {
             m_cdrom->Clock(step);
+            GG_PERF_LAP(GG_PERF_CDROM);
         }
         m_audio->Clock(step);
+        GG_PERF_LAP(GG_PERF_AUDIO);
         cycles -= step;
     }
 
@@ -199,6 +242,34 @@ INLINE void GeargrafxCore::ClockHardwareCallback(void* context, u32 cycles)
         core->m_frame_ready = true;
 }
 
+#if defined(GG_ENABLE_PERF_COUNTERS)
+INLINE u64 GeargrafxCore::PerfNow()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+INLINE u64 GeargrafxCore::PerfLapBegin()
+{
+    // Reading the clock on every call would cost more than the work
+    // measured, time one call out of GG_PERF_SAMPLE_RATE and scale it
+    m_perf_sample_counter++;
+    if ((m_perf_sample_counter & (GG_PERF_SAMPLE_RATE - 1)) != 0)
+        return 0;
+
+    return PerfNow();
+}
+
+INLINE void GeargrafxCore::PerfLap(u64& lap, GG_Perf_Subsystem subsystem)
+{
+    if (lap == 0)
+        return;
+
+    u64 now = PerfNow();
+    m_perf_live.host_ns[subsystem] += (now - lap) * GG_PERF_SAMPLE_RATE;
+    lap = now;
+}
+#endif
+
 INLINE Memory* GeargrafxCore::GetMemory()
 {
     return m_memory;
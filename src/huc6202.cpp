@@ -162,39 +162,39 @@ void HuC6202::CalculateSourceSelection(HuC6202_Window_Mode window_mode)
     }
 }
 
-void HuC6202::SaveState(std::ostream& stream)
+void HuC6202::SaveState(StateSerializer& stream)
 {
     using namespace std;
-    stream.write(reinterpret_cast<const char*> (&m_priority_1), sizeof(m_priority_1));
-    stream.write(reinterpret_cast<const char*> (&m_priority_2), sizeof(m_priority_2));
-    stream.write(reinterpret_cast<const char*> (&m_window_1), sizeof(m_window_1));
-    stream.write(reinterpret_cast<const char*> (&m_window_2), sizeof(m_window_2));
-    stream.write(reinterpret_cast<const char*> (&m_vdc2_selected), sizeof(m_vdc2_selected));
-    stream.write(reinterpret_cast<const char*> (&m_irq1_1), sizeof(m_irq1_1));
-    stream.write(reinterpret_cast<const char*> (&m_irq1_2), sizeof(m_irq1_2));
+    stream.Write(&m_priority_1, sizeof(m_priority_1));
+    stream.Write(&m_priority_2, sizeof(m_priority_2));
+    stream.Write(&m_window_1, sizeof(m_window_1));
+    stream.Write(&m_window_2, sizeof(m_window_2));
+    stream.Write(&m_vdc2_selected, sizeof(m_vdc2_selected));
+    stream.Write(&m_irq1_1, sizeof(m_irq1_1));
+    stream.Write(&m_irq1_2, sizeof(m_irq1_2));
     for (int i = 0; i < 4; i++)
     {
-        stream.write(reinterpret_cast<const char*> (&m_window_priority[i].vdc_1_enabled), sizeof(m_window_priority[i].vdc_1_enabled));
-        stream.write(reinterpret_cast<const char*> (&m_window_priority[i].vdc_2_enabled), sizeof(m_window_priority[i].vdc_2_enabled));
-        stream.write(reinterpret_cast<const char*> (&m_window_priority[i].priority_mode), sizeof(m_window_priority[i].priority_mode));
+        stream.Write(&m_window_priority[i].vdc_1_enabled, sizeof(m_window_priority[i].vdc_1_enabled));
+        stream.Write(&m_window_priority[i].vdc_2_enabled, sizeof(m_window_priority[i].vdc_2_enabled));
+        stream.Write(&m_window_priority[i].priority_mode, sizeof(m_window_priority[i].priority_mode));
     }
 }
 
-void HuC6202::LoadState(std::istream& stream)
+void HuC6202::LoadState(StateDeserializer& stream)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (&m_priority_1), sizeof(m_priority_1));
-    stream.read(reinterpret_cast<char*> (&m_priority_2), sizeof(m_priority_2));
-    stream.read(reinterpret_cast<char*> (&m_window_1), sizeof(m_window_1));
-    stream.read(reinterpret_cast<char*> (&m_window_2), sizeof(m_window_2));
-    stream.read(reinterpret_cast<char*> (&m_vdc2_selected), sizeof(m_vdc2_selected));
-    stream.read(reinterpret_cast<char*> (&m_irq1_1), sizeof(m_irq1_1));
-    stream.read(reinterpret_cast<char*> (&m_irq1_2), sizeof(m_irq1_2));
+    stream.Read(&m_priority_1, sizeof(m_priority_1));
+    stream.Read(&m_priority_2, sizeof(m_priority_2));
+    stream.Read(&m_window_1, sizeof(m_window_1));
+    stream.Read(&m_window_2, sizeof(m_window_2));
+    stream.Read(&m_vdc2_selected, sizeof(m_vdc2_selected));
+    stream.Read(&m_irq1_1, sizeof(m_irq1_1));
+    stream.Read(&m_irq1_2, sizeof(m_irq1_2));
     for (int i = 0; i < 4; i++)
     {
-        stream.read(reinterpret_cast<char*> (&m_window_priority[i].vdc_1_enabled), sizeof(m_window_priority[i].vdc_1_enabled));
-        stream.read(reinterpret_cast<char*> (&m_window_priority[i].vdc_2_enabled), sizeof(m_window_priority[i].vdc_2_enabled));
-        stream.read(reinterpret_cast<char*> (&m_window_priority[i].priority_mode), sizeof(m_window_priority[i].priority_mode));
+        stream.Read(&m_window_priority[i].vdc_1_enabled, sizeof(m_window_priority[i].vdc_1_enabled));
+        stream.Read(&m_window_priority[i].vdc_2_enabled, sizeof(m_window_priority[i].vdc_2_enabled));
+        stream.Read(&m_window_priority[i].priority_mode, sizeof(m_window_priority[i].priority_mode));
         CalculateSourceSelection((HuC6202_Window_Mode)i);
     }
 }
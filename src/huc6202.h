@@ -93,8 +93,8 @@ public:
     HuC6202_Window_Priority* GetWindowPriorities();
     const u8* GetSourceSelection();
     HuC6202_State* GetState();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream);
 
 private:
     void TraceVpcEvent(u8 event, u16 address, u8 raw);
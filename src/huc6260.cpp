@@ -22,6 +22,7 @@
 #include "huc6260.h"
 #include "random.h"
 #include "trace_logger.h"
+#include "profiler.h"
 
 HuC6260::HuC6260(HuC6202* huc6202, HuC6280* huc6280, Random* random)
 {
@@ -49,6 +50,7 @@ HuC6260::HuC6260(HuC6202* huc6202, HuC6280* huc6280, Random* random)
     m_lowpass_speed[0] = false;
     m_lowpass_speed[1] = true;
     m_lowpass_speed[2] = true;
+    m_speculative = false;
 
     CalculateScreenBounds();
 }
@@ -156,6 +158,7 @@ void HuC6260::Reset()
     m_hpos = 0;
     m_vpos = 0;
     m_pixel_index = 0;
+    m_frame_pixel_count = 0;
     m_pixel_x = 0;
     m_hsync = true;
     m_vsync = true;
@@ -386,9 +389,29 @@ void HuC6260::SetLowPassFilter(bool enabled, float intensity, float cutoff_mhz,
     m_lowpass_speed[2] = speed_10_8;
 }
 
+void HuC6260::CopySettings(const HuC6260* source)
+{
+    m_overscan = source->m_overscan;
+    m_scanline_start = source->m_scanline_start;
+    m_scanline_end = source->m_scanline_end;
+    m_palette = source->m_palette;
+    m_lowpass_enabled = source->m_lowpass_enabled;
+    m_lowpass_intensity = source->m_lowpass_intensity;
+    m_lowpass_cutoff_mhz = source->m_lowpass_cutoff_mhz;
+    memcpy(m_lowpass_speed, source->m_lowpass_speed, sizeof(m_lowpass_speed));
+
+    // Built-in palettes are generated identically by every instance
+    memcpy(m_rgba888_palette[HuC6260_PALETTE_CUSTOM], source->m_rgba888_palette[HuC6260_PALETTE_CUSTOM], sizeof(m_rgba888_palette[HuC6260_PALETTE_CUSTOM]));
+    memcpy(m_rgb565_palette[HuC6260_PALETTE_CUSTOM], source->m_rgb565_palette[HuC6260_PALETTE_CUSTOM], sizeof(m_rgb565_palette[HuC6260_PALETTE_CUSTOM]));
+
+    CalculateScreenBounds();
+}
+
 template <int bytes_per_pixel>
 void HuC6260::ApplyLowPassFilter()
 {
+    GG_PROFILE_ZONE("HuC6260::ApplyLowPassFilter");
+
     static const float k_speed_mhz[4] = { 5.36f, 7.16f, 10.8f, 10.8f };
 
     int speed_index = MIN(m_speed, 2);
@@ -471,44 +494,112 @@ void HuC6260::ApplyLowPassFilter()
 template void HuC6260::ApplyLowPassFilter<2>();
 template void HuC6260::ApplyLowPassFilter<4>();
 
-void HuC6260::SaveState(std::ostream& stream)
+void HuC6260::SaveState(StateSerializer& stream)
 {
     using namespace std;
-    stream.write(reinterpret_cast<const char*> (&m_control_register), sizeof(m_control_register));
-    stream.write(reinterpret_cast<const char*> (&m_color_table_address), sizeof(m_color_table_address));
-    stream.write(reinterpret_cast<const char*> (&m_speed), sizeof(m_speed));
-    stream.write(reinterpret_cast<const char*> (&m_clock_divider), sizeof(m_clock_divider));
-    stream.write(reinterpret_cast<const char*> (m_color_table), sizeof(u16) * 512);
-    stream.write(reinterpret_cast<const char*> (&m_hpos), sizeof(m_hpos));
-    stream.write(reinterpret_cast<const char*> (&m_vpos), sizeof(m_vpos));
-    stream.write(reinterpret_cast<const char*> (&m_pixel_index), sizeof(m_pixel_index));
-    stream.write(reinterpret_cast<const char*> (&m_pixel_x), sizeof(m_pixel_x));
-    stream.write(reinterpret_cast<const char*> (&m_hsync), sizeof(m_hsync));
-    stream.write(reinterpret_cast<const char*> (&m_vsync), sizeof(m_vsync));
-    stream.write(reinterpret_cast<const char*> (&m_blur), sizeof(m_blur));
-    stream.write(reinterpret_cast<const char*> (&m_black_and_white), sizeof(m_black_and_white));
-    stream.write(reinterpret_cast<const char*> (&m_multiple_speeds), sizeof(m_multiple_speeds));
-    stream.write(reinterpret_cast<const char*> (&m_active_line), sizeof(m_active_line));
+    stream.Write(&m_control_register, sizeof(m_control_register));
+    stream.Write(&m_color_table_address, sizeof(m_color_table_address));
+    stream.Write(&m_speed, sizeof(m_speed));
+    stream.Write(&m_clock_divider, sizeof(m_clock_divider));
+    stream.Write(m_color_table, sizeof(u16) * 512);
+    stream.Write(&m_hpos, sizeof(m_hpos));
+    stream.Write(&m_vpos, sizeof(m_vpos));
+    stream.Write(&m_pixel_index, sizeof(m_pixel_index));
+    stream.Write(&m_pixel_x, sizeof(m_pixel_x));
+    stream.Write(&m_hsync, sizeof(m_hsync));
+    stream.Write(&m_vsync, sizeof(m_vsync));
+    stream.Write(&m_blur, sizeof(m_blur));
+    stream.Write(&m_black_and_white, sizeof(m_black_and_white));
+    stream.Write(&m_multiple_speeds, sizeof(m_multiple_speeds));
+    stream.Write(&m_active_line, sizeof(m_active_line));
 }
 
-void HuC6260::LoadState(std::istream& stream)
+void HuC6260::LoadState(StateDeserializer& stream)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (&m_control_register), sizeof(m_control_register));
-    stream.read(reinterpret_cast<char*> (&m_color_table_address), sizeof(m_color_table_address));
-    stream.read(reinterpret_cast<char*> (&m_speed), sizeof(m_speed));
-    stream.read(reinterpret_cast<char*> (&m_clock_divider), sizeof(m_clock_divider));
-    stream.read(reinterpret_cast<char*> (m_color_table), sizeof(u16) * 512);
-    stream.read(reinterpret_cast<char*> (&m_hpos), sizeof(m_hpos));
-    stream.read(reinterpret_cast<char*> (&m_vpos), sizeof(m_vpos));
-    stream.read(reinterpret_cast<char*> (&m_pixel_index), sizeof(m_pixel_index));
-    stream.read(reinterpret_cast<char*> (&m_pixel_x), sizeof(m_pixel_x));
-    stream.read(reinterpret_cast<char*> (&m_hsync), sizeof(m_hsync));
-    stream.read(reinterpret_cast<char*> (&m_vsync), sizeof(m_vsync));
-    stream.read(reinterpret_cast<char*> (&m_blur), sizeof(m_blur));
-    stream.read(reinterpret_cast<char*> (&m_black_and_white), sizeof(m_black_and_white));
-    stream.read(reinterpret_cast<char*> (&m_multiple_speeds), sizeof(m_multiple_speeds));
-    stream.read(reinterpret_cast<char*> (&m_active_line), sizeof(m_active_line));
+    stream.Read(&m_control_register, sizeof(m_control_register));
+    stream.Read(&m_color_table_address, sizeof(m_color_table_address));
+    stream.Read(&m_speed, sizeof(m_speed));
+    stream.Read(&m_clock_divider, sizeof(m_clock_divider));
+    stream.Read(m_color_table, sizeof(u16) * 512);
+    stream.Read(&m_hpos, sizeof(m_hpos));
+    stream.Read(&m_vpos, sizeof(m_vpos));
+    stream.Read(&m_pixel_index, sizeof(m_pixel_index));
+    stream.Read(&m_pixel_x, sizeof(m_pixel_x));
+    stream.Read(&m_hsync, sizeof(m_hsync));
+    stream.Read(&m_vsync, sizeof(m_vsync));
+    stream.Read(&m_blur, sizeof(m_blur));
+    stream.Read(&m_black_and_white, sizeof(m_black_and_white));
+    stream.Read(&m_multiple_speeds, sizeof(m_multiple_speeds));
+    stream.Read(&m_active_line, sizeof(m_active_line));
 
     SanitizeState();
 }
+
+// The last frame as the VCE composed it: raw color table entries per pixel
+// (plus the second VDC layer on SuperGrafx) and the line speeds needed to
+// scale it. Much smaller than the rendered frame and independent of the
+// output pixel format.
+void HuC6260::SaveFrame(StateSerializer& stream, bool is_sgx)
+{
+    using namespace std;
+    stream.Write(&m_frame_pixel_count, sizeof(m_frame_pixel_count));
+    stream.Write(&m_scaled_width, sizeof(m_scaled_width));
+    stream.Write(m_line_speed, sizeof(m_line_speed));
+    stream.Write(m_vce_buffer_1, sizeof(u16) * m_frame_pixel_count);
+    if (is_sgx)
+        stream.Write(m_vce_buffer_2, sizeof(u16) * m_frame_pixel_count);
+}
+
+// Renders a frame saved with SaveFrame into the current frame buffer using
+// the current palette and filter settings
+void HuC6260::LoadFrame(StateDeserializer& stream, bool is_sgx)
+{
+    using namespace std;
+    s32 pixel_count = 0;
+    bool scaled_width = false;
+    s32 line_speed[242];
+    stream.Read(&pixel_count, sizeof(pixel_count));
+    stream.Read(&scaled_width, sizeof(scaled_width));
+
+    if (stream.HasFailed() || (pixel_count < 0) || (pixel_count > HUC6260_MAX_FRAME_PIXELS))
+    {
+        stream.Skip(stream.GetSize());
+        return;
+    }
+
+    stream.Read(line_speed, sizeof(line_speed));
+    stream.Read(m_vce_buffer_1, sizeof(u16) * pixel_count);
+    if (is_sgx)
+        stream.Read(m_vce_buffer_2, sizeof(u16) * pixel_count);
+
+    if (stream.HasFailed())
+        return;
+
+    // The line speeds belong to the frame being emulated, only borrow them
+    s32 current_line_speed[242];
+    memcpy(current_line_speed, m_line_speed, sizeof(m_line_speed));
+
+    for (int i = 0; i < 242; i++)
+        m_line_speed[i] = CLAMP(line_speed[i], 0, 2);
+
+    s32 pixel_index = m_pixel_index;
+    bool multiple_speeds = m_multiple_speeds;
+
+    m_pixel_index = pixel_count;
+    m_multiple_speeds = scaled_width;
+
+    if (is_sgx)
+        RenderFrame<true>();
+    else
+        RenderFrame<false>();
+
+    m_pixel_index = pixel_index;
+    m_multiple_speeds = multiple_speeds;
+    memcpy(m_line_speed, current_line_speed, sizeof(m_line_speed));
+}
+
+size_t HuC6260::GetMaxFrameSize()
+{
+    return sizeof(m_frame_pixel_count) + sizeof(m_scaled_width) + sizeof(m_line_speed) + (2 * sizeof(u16) * HUC6260_MAX_FRAME_PIXELS);
+}
@@ -30,6 +30,7 @@
 #define HUC6260_HSYNC_START_HPOS (HUC6260_LINE_LENGTH - HUC6260_HSYNC_LENGTH)
 #define HUC6260_HSYNC_END_HPOS 0
 #define HUC6260_VSYNC_HPOS (HUC6260_HSYNC_START_HPOS + 30)
+#define HUC6260_MAX_FRAME_PIXELS ((512 + 48) * 242)
 
 class HuC6202;
 class HuC6280;
@@ -38,6 +39,9 @@ class TraceLogger;
 
 class HuC6260
 {
+#if defined(GG_BENCHMARK)
+    friend class Benchmark;
+#endif
 public:
     struct HuC6260_State
     {
@@ -93,8 +97,13 @@ public:
     void SetPalette(int palette);
     void SetCustomPalette(const u8* data);
     void SetLowPassFilter(bool enabled, float intensity, float cutoff_mhz, bool speed_5_36, bool speed_7_16, bool speed_10_8);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void CopySettings(const HuC6260* source);
+    void SetSpeculative(bool speculative);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream);
+    void SaveFrame(StateSerializer& stream, bool is_sgx);
+    void LoadFrame(StateDeserializer& stream, bool is_sgx);
+    size_t GetMaxFrameSize();
 
 private:
     void TraceVceEvent(u8 event);
@@ -135,6 +144,7 @@ private:
     s32 m_hpos;
     s32 m_vpos;
     s32 m_pixel_index;
+    s32 m_frame_pixel_count;
     s32 m_pixel_x;
     bool m_hsync;
     bool m_vsync;
@@ -156,6 +166,7 @@ private:
     float m_lowpass_intensity;
     float m_lowpass_cutoff_mhz;
     bool m_lowpass_speed[3];
+    bool m_speculative;
 };
 
 static const HuC6260::HuC6260_Speed k_huc6260_speed[4] = {
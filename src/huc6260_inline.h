@@ -24,6 +24,7 @@
 #include "huc6202.h"
 #include "huc6280.h"
 #include "trace_logger.h"
+#include "profiler.h"
 
 INLINE void HuC6260::TraceVceEvent(u8 event)
 {
@@ -79,7 +80,7 @@ INLINE bool HuC6260::Clock(u32 cycles)
             {
                 u16 pixel_1, pixel_2;
                 m_huc6202->ClockSGX(&pixel_1, &pixel_2);
-                if (m_active_line && (m_pixel_x >= m_screen_start_x) && (m_pixel_x < m_screen_end_x))
+                if (m_active_line && !m_speculative && (m_pixel_x >= m_screen_start_x) && (m_pixel_x < m_screen_end_x))
                 {
                     u16 win_1_width = m_huc6202->GetWindow1Width();
                     u16 win_2_width = m_huc6202->GetWindow2Width();
@@ -102,7 +103,7 @@ INLINE bool HuC6260::Clock(u32 cycles)
             else
             {
                 u16 pixel = m_huc6202->Clock();
-                if (m_active_line && (m_pixel_x >= m_screen_start_x) && (m_pixel_x < m_screen_end_x))
+                if (m_active_line && !m_speculative && (m_pixel_x >= m_screen_start_x) && (m_pixel_x < m_screen_end_x))
                 {
                     if (pixel & HUC6270_PIXEL_BLACK)
                         m_vce_buffer_1[m_pixel_index] = HUC6270_PIXEL_BLACK;
@@ -164,7 +165,10 @@ INLINE bool HuC6260::Clock(u32 cycles)
 template <bool is_sgx>
 INLINE void HuC6260::RenderFrame()
 {
+    GG_PROFILE_ZONE("HuC6260::RenderFrame");
+
     bool multiple_speeds = m_multiple_speeds;
+    m_frame_pixel_count = m_pixel_index;
 
     if (IsValidPointer(m_frame_buffer))
     {
@@ -414,6 +418,11 @@ INLINE void HuC6260::SetResetValue(int value)
     m_reset_value = value;
 }
 
+INLINE void HuC6260::SetSpeculative(bool speculative)
+{
+    m_speculative = speculative;
+}
+
 INLINE void HuC6260::SetPalette(int palette)
 {
     if (palette >= 0 && palette < HuC6260_PALETTE_COUNT)
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include "huc6270.h"
 #include "trace_logger.h"
+#include "profiler.h"
 
 HuC6270::HuC6270(HuC6280* huC6280)
 {
@@ -29,6 +30,7 @@ HuC6270::HuC6270(HuC6280* huC6280)
     InitPointer(m_input_pump_fn);
     m_chip_id = 0;
     InitPointer(m_trace_logger);
+    InitPointer(m_perf_counters);
     m_state.AR = &m_address_register;
     m_state.SR = &m_status_register;
     m_state.R = m_register;
@@ -39,6 +41,7 @@ HuC6270::HuC6270(HuC6280* huC6280)
     m_state.H_STATE = &m_h_state;
     m_no_sprite_limit = false;
     m_safe_defaults = false;
+    m_speculative = false;
 }
 
 HuC6270::~HuC6270()
@@ -51,6 +54,7 @@ void HuC6270::Init(HuC6260* huC6260, HuC6202* huC6202, GG_Input_Pump_Fn input_pu
     m_huc6202 = huC6202;
     m_input_pump_fn = input_pump_fn;
     m_chip_id = chip_id;
+    m_vram_dirty.Init(sizeof(m_vram));
     Reset();
 }
 
@@ -59,6 +63,11 @@ void HuC6270::SetTraceLogger(TraceLogger* trace_logger)
     m_trace_logger = trace_logger;
 }
 
+void HuC6270::SetPerfCounters(GG_Perf_Counters* perf_counters)
+{
+    m_perf_counters = perf_counters;
+}
+
 void HuC6270::LogVdcEvent(u8 event, u8 raw, bool msb)
 {
 #if !defined(GG_DISABLE_DISASSEMBLER)
@@ -170,6 +179,7 @@ void HuC6270::Reset()
 
     memset(m_vram, 0, sizeof(m_vram));
     memset(m_sat, 0, sizeof(m_sat));
+    m_vram_dirty.MarkAll();
     memset(m_line_buffer, 0, sizeof(m_line_buffer));
     memset(m_line_buffer_sprites, 0, sizeof(m_line_buffer_sprites));
     memset(m_sprites, 0, sizeof(m_sprites));
@@ -530,6 +540,7 @@ void HuC6270::SATTransfer()
         u16 satb = m_register[HUC6270_REG_DVSSR];
         int i = 255 - (m_sat_transfer_pending >> 2);
         m_sat[i] = ReadVRAM(satb + i);
+        GG_PERF_ADD(m_perf_counters, satb_dma_words, 1);
 
         if (m_sat_transfer_pending == 0)
         {
@@ -553,12 +564,15 @@ void HuC6270::VRAMTransfer()
         if (m_vram_transfer_dest < 0x8000)
         {
             m_vram[m_vram_transfer_dest] = ReadVRAM(m_vram_transfer_src);
+            m_vram_dirty.Mark(m_vram_transfer_dest << 1);
         }
         else
         {
             Debug("[PC=%04X] HuC6270 ignoring write VRAM-DMA out of bounds: %04X", m_huc6280->GetState()->PC->GetValue(), m_register[HUC6270_REG_DESR]);
         }
 
+        GG_PERF_ADD(m_perf_counters, vram_dma_words, 1);
+
         s8 src_increment = IS_SET_BIT(m_register[HUC6270_REG_DCR], 2) ? -1 : 1;
         s8 dest_increment = IS_SET_BIT(m_register[HUC6270_REG_DCR], 3) ? -1 : 1;
         m_vram_transfer_src += src_increment;
@@ -679,8 +693,26 @@ void HuC6270::VBlankIRQ()
 
 void HuC6270::RenderLine()
 {
+    GG_PROFILE_ZONE("HuC6270::RenderLine");
+
     int width = MIN(1024, (m_latched_hdw + 1) << 3);
 
+    if (m_speculative)
+    {
+        // The line is never displayed, keep only what the CPU can observe:
+        // the VRAM open bus left by the BG fetches and sprite #0 collisions
+        if (!m_burst_mode)
+        {
+            if ((m_latched_cr & 0x80) != 0)
+                LatchBackgroundOpenBus(width);
+
+            if (((m_latched_cr & 0x40) != 0) && (m_register[HUC6270_REG_CR] & HUC6270_CONTROL_COLLISION) &&
+                (m_sprite_count > 0) && (m_sprites[0].index == 0))
+                RenderSprites(width);
+        }
+        return;
+    }
+
     if((m_latched_cr & 0x80) == 0)
         for (int i = 0; i < width; i++)
             m_line_buffer[i] = 0x100;
@@ -746,6 +778,28 @@ void HuC6270::RenderBackground(int width)
     }
 }
 
+void HuC6270::LatchBackgroundOpenBus(int width)
+{
+    int screen_reg = (m_latched_mwr >> 4) & 0x07;
+    int screen_size_x = k_huc6270_screen_size_x[screen_reg];
+    int screen_size_x_mask = k_huc6270_screen_size_x_pixels_mask[screen_reg];
+    int bg_y = m_bg_offset_y;
+    bg_y &= k_huc6270_screen_size_y_pixels_mask[screen_reg];
+    int tile_y = (bg_y & 7);
+    int bat_offset = (bg_y >> 3) * screen_size_x;
+
+    // Same tile RenderBackground() fetches last, the one under the last pixel
+    int bg_x = (m_latched_bxr + width - 1) & screen_size_x_mask;
+    int bat_address = bat_offset + (bg_x >> 3);
+    assert(bat_address < HUC6270_VRAM_SIZE);
+
+    u16 bat_entry = m_vram[bat_address];
+    int line_start_b = ((bat_entry & 0x07FF) << 4) + tile_y + 8;
+    assert(line_start_b < HUC6270_VRAM_SIZE);
+
+    m_vram_openbus = m_vram[line_start_b];
+}
+
 void HuC6270::RenderSprites(int width)
 {
     static const u16 sprite_rendered_flag = 0x0200;
@@ -931,92 +985,92 @@ void HuC6270::FetchSprites()
     }
 }
 
-void HuC6270::SaveState(std::ostream& stream)
+void HuC6270::SaveState(StateSerializer& stream)
 {
     using namespace std;
     UpdateCpuVramBusyStatus();
-    stream.write(reinterpret_cast<const char*> (m_vram), sizeof(u16) * HUC6270_VRAM_SIZE);
-    stream.write(reinterpret_cast<const char*> (&m_address_register), sizeof(m_address_register));
-    stream.write(reinterpret_cast<const char*> (&m_status_register), sizeof(m_status_register));
-    stream.write(reinterpret_cast<const char*> (m_register), sizeof(m_register));
-    stream.write(reinterpret_cast<const char*> (m_sat), sizeof(u16) * HUC6270_SAT_SIZE);
-    stream.write(reinterpret_cast<const char*> (&m_read_buffer), sizeof(m_read_buffer));
-    stream.write(reinterpret_cast<const char*> (&m_vram_openbus), sizeof(m_vram_openbus));
-    stream.write(reinterpret_cast<const char*> (&m_pending_memory_read), sizeof(m_pending_memory_read));
-    stream.write(reinterpret_cast<const char*> (&m_pending_memory_write), sizeof(m_pending_memory_write));
-    stream.write(reinterpret_cast<const char*> (&m_transfer_delay), sizeof(m_transfer_delay));
-    stream.write(reinterpret_cast<const char*> (&m_trigger_sat_transfer), sizeof(m_trigger_sat_transfer));
-    stream.write(reinterpret_cast<const char*> (&m_sat_transfer_pending), sizeof(m_sat_transfer_pending));
-    stream.write(reinterpret_cast<const char*> (&m_vram_transfer_pending), sizeof(m_vram_transfer_pending));
-    stream.write(reinterpret_cast<const char*> (&m_vram_transfer_src), sizeof(m_vram_transfer_src));
-    stream.write(reinterpret_cast<const char*> (&m_vram_transfer_dest), sizeof(m_vram_transfer_dest));
-    stream.write(reinterpret_cast<const char*> (&m_hpos), sizeof(m_hpos));
-    stream.write(reinterpret_cast<const char*> (&m_vpos), sizeof(m_vpos));
-    stream.write(reinterpret_cast<const char*> (&m_bg_offset_y), sizeof(m_bg_offset_y));
-    stream.write(reinterpret_cast<const char*> (&m_bg_counter_y), sizeof(m_bg_counter_y));
-    stream.write(reinterpret_cast<const char*> (&m_increment_bg_counter_y), sizeof(m_increment_bg_counter_y));
-    stream.write(reinterpret_cast<const char*> (&m_need_to_increment_raster_line), sizeof(m_need_to_increment_raster_line));
-    stream.write(reinterpret_cast<const char*> (&m_raster_line), sizeof(m_raster_line));
-    stream.write(reinterpret_cast<const char*> (&m_latched_bxr), sizeof(m_latched_bxr));
-    stream.write(reinterpret_cast<const char*> (&m_latched_hds), sizeof(m_latched_hds));
-    stream.write(reinterpret_cast<const char*> (&m_latched_hdw), sizeof(m_latched_hdw));
-    stream.write(reinterpret_cast<const char*> (&m_latched_hde), sizeof(m_latched_hde));
-    stream.write(reinterpret_cast<const char*> (&m_latched_hsw), sizeof(m_latched_hsw));
-    stream.write(reinterpret_cast<const char*> (&m_latched_vds), sizeof(m_latched_vds));
-    stream.write(reinterpret_cast<const char*> (&m_latched_vdw), sizeof(m_latched_vdw));
-    stream.write(reinterpret_cast<const char*> (&m_latched_vcr), sizeof(m_latched_vcr));
-    stream.write(reinterpret_cast<const char*> (&m_latched_vsw), sizeof(m_latched_vsw));
-    stream.write(reinterpret_cast<const char*> (&m_latched_mwr), sizeof(m_latched_mwr));
-    stream.write(reinterpret_cast<const char*> (&m_latched_cr), sizeof(m_latched_cr));
-    stream.write(reinterpret_cast<const char*> (&m_v_state), sizeof(m_v_state));
-    stream.write(reinterpret_cast<const char*> (&m_h_state), sizeof(m_h_state));
-    stream.write(reinterpret_cast<const char*> (&m_lines_to_next_v_state), sizeof(m_lines_to_next_v_state));
-    stream.write(reinterpret_cast<const char*> (&m_clocks_to_next_h_state), sizeof(m_clocks_to_next_h_state));
-    stream.write(reinterpret_cast<const char*> (&m_vblank_triggered), sizeof(m_vblank_triggered));
-    stream.write(reinterpret_cast<const char*> (&m_active_line), sizeof(m_active_line));
-    stream.write(reinterpret_cast<const char*> (&m_burst_mode), sizeof(m_burst_mode));
-    stream.write(reinterpret_cast<const char*> (&m_line_buffer_index), sizeof(m_line_buffer_index));
-    stream.write(reinterpret_cast<const char*> (&m_no_sprite_limit), sizeof(m_no_sprite_limit));
-    stream.write(reinterpret_cast<const char*> (&m_sprite_count), sizeof(m_sprite_count));
-    stream.write(reinterpret_cast<const char*> (&m_sprite_overflow), sizeof(m_sprite_overflow));
-    stream.write(reinterpret_cast<const char*> (&m_next_event), sizeof(m_next_event));
-    stream.write(reinterpret_cast<const char*> (&m_clocks_to_next_event), sizeof(m_clocks_to_next_event));
+    stream.WritePages(m_vram, sizeof(u16) * HUC6270_VRAM_SIZE, m_vram_dirty);
+    stream.Write(&m_address_register, sizeof(m_address_register));
+    stream.Write(&m_status_register, sizeof(m_status_register));
+    stream.Write(m_register, sizeof(m_register));
+    stream.Write(m_sat, sizeof(u16) * HUC6270_SAT_SIZE);
+    stream.Write(&m_read_buffer, sizeof(m_read_buffer));
+    stream.Write(&m_vram_openbus, sizeof(m_vram_openbus));
+    stream.Write(&m_pending_memory_read, sizeof(m_pending_memory_read));
+    stream.Write(&m_pending_memory_write, sizeof(m_pending_memory_write));
+    stream.Write(&m_transfer_delay, sizeof(m_transfer_delay));
+    stream.Write(&m_trigger_sat_transfer, sizeof(m_trigger_sat_transfer));
+    stream.Write(&m_sat_transfer_pending, sizeof(m_sat_transfer_pending));
+    stream.Write(&m_vram_transfer_pending, sizeof(m_vram_transfer_pending));
+    stream.Write(&m_vram_transfer_src, sizeof(m_vram_transfer_src));
+    stream.Write(&m_vram_transfer_dest, sizeof(m_vram_transfer_dest));
+    stream.Write(&m_hpos, sizeof(m_hpos));
+    stream.Write(&m_vpos, sizeof(m_vpos));
+    stream.Write(&m_bg_offset_y, sizeof(m_bg_offset_y));
+    stream.Write(&m_bg_counter_y, sizeof(m_bg_counter_y));
+    stream.Write(&m_increment_bg_counter_y, sizeof(m_increment_bg_counter_y));
+    stream.Write(&m_need_to_increment_raster_line, sizeof(m_need_to_increment_raster_line));
+    stream.Write(&m_raster_line, sizeof(m_raster_line));
+    stream.Write(&m_latched_bxr, sizeof(m_latched_bxr));
+    stream.Write(&m_latched_hds, sizeof(m_latched_hds));
+    stream.Write(&m_latched_hdw, sizeof(m_latched_hdw));
+    stream.Write(&m_latched_hde, sizeof(m_latched_hde));
+    stream.Write(&m_latched_hsw, sizeof(m_latched_hsw));
+    stream.Write(&m_latched_vds, sizeof(m_latched_vds));
+    stream.Write(&m_latched_vdw, sizeof(m_latched_vdw));
+    stream.Write(&m_latched_vcr, sizeof(m_latched_vcr));
+    stream.Write(&m_latched_vsw, sizeof(m_latched_vsw));
+    stream.Write(&m_latched_mwr, sizeof(m_latched_mwr));
+    stream.Write(&m_latched_cr, sizeof(m_latched_cr));
+    stream.Write(&m_v_state, sizeof(m_v_state));
+    stream.Write(&m_h_state, sizeof(m_h_state));
+    stream.Write(&m_lines_to_next_v_state, sizeof(m_lines_to_next_v_state));
+    stream.Write(&m_clocks_to_next_h_state, sizeof(m_clocks_to_next_h_state));
+    stream.Write(&m_vblank_triggered, sizeof(m_vblank_triggered));
+    stream.Write(&m_active_line, sizeof(m_active_line));
+    stream.Write(&m_burst_mode, sizeof(m_burst_mode));
+    stream.Write(&m_line_buffer_index, sizeof(m_line_buffer_index));
+    stream.Write(&m_no_sprite_limit, sizeof(m_no_sprite_limit));
+    stream.Write(&m_sprite_count, sizeof(m_sprite_count));
+    stream.Write(&m_sprite_overflow, sizeof(m_sprite_overflow));
+    stream.Write(&m_next_event, sizeof(m_next_event));
+    stream.Write(&m_clocks_to_next_event, sizeof(m_clocks_to_next_event));
 
     for (int i = 0; i < (HUC6270_MAX_SPRITE_HEIGHT * 2); i++)
     {
-        stream.write(reinterpret_cast<const char*> (&m_sprites[i].index), sizeof(m_sprites[i].index));
-        stream.write(reinterpret_cast<const char*> (&m_sprites[i].x), sizeof(m_sprites[i].x));
-        stream.write(reinterpret_cast<const char*> (&m_sprites[i].flags), sizeof(m_sprites[i].flags));
-        stream.write(reinterpret_cast<const char*> (&m_sprites[i].palette), sizeof(m_sprites[i].palette));
-        stream.write(reinterpret_cast<const char*> (m_sprites[i].data), sizeof(m_sprites[i].data));
+        stream.Write(&m_sprites[i].index, sizeof(m_sprites[i].index));
+        stream.Write(&m_sprites[i].x, sizeof(m_sprites[i].x));
+        stream.Write(&m_sprites[i].flags, sizeof(m_sprites[i].flags));
+        stream.Write(&m_sprites[i].palette, sizeof(m_sprites[i].palette));
+        stream.Write(m_sprites[i].data, sizeof(m_sprites[i].data));
     }
 
-    stream.write(reinterpret_cast<const char*> (&m_load_bg_start_clock), sizeof(m_load_bg_start_clock));
-    stream.write(reinterpret_cast<const char*> (&m_load_bg_end_clock), sizeof(m_load_bg_end_clock));
-    stream.write(reinterpret_cast<const char*> (&m_hsync_start_clock), sizeof(m_hsync_start_clock));
-    stream.write(reinterpret_cast<const char*> (&m_allow_vram_access), sizeof(m_allow_vram_access));
-    stream.write(reinterpret_cast<const char*> (&m_bg_scroll_y_update_pending), sizeof(m_bg_scroll_y_update_pending));
-    stream.write(reinterpret_cast<const char*> (&m_latch_clock_y), sizeof(m_latch_clock_y));
-    stream.write(reinterpret_cast<const char*> (&m_latch_clock_x), sizeof(m_latch_clock_x));
-    stream.write(reinterpret_cast<const char*> (&m_bxr_written_before_latch), sizeof(m_bxr_written_before_latch));
-    stream.write(reinterpret_cast<const char*> (&m_byr_lsb_write_clock), sizeof(m_byr_lsb_write_clock));
+    stream.Write(&m_load_bg_start_clock, sizeof(m_load_bg_start_clock));
+    stream.Write(&m_load_bg_end_clock, sizeof(m_load_bg_end_clock));
+    stream.Write(&m_hsync_start_clock, sizeof(m_hsync_start_clock));
+    stream.Write(&m_allow_vram_access, sizeof(m_allow_vram_access));
+    stream.Write(&m_bg_scroll_y_update_pending, sizeof(m_bg_scroll_y_update_pending));
+    stream.Write(&m_latch_clock_y, sizeof(m_latch_clock_y));
+    stream.Write(&m_latch_clock_x, sizeof(m_latch_clock_x));
+    stream.Write(&m_bxr_written_before_latch, sizeof(m_bxr_written_before_latch));
+    stream.Write(&m_byr_lsb_write_clock, sizeof(m_byr_lsb_write_clock));
 }
 
-void HuC6270::LoadState(std::istream& stream, int version)
+void HuC6270::LoadState(StateDeserializer& stream, int version)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (m_vram), sizeof(u16) * HUC6270_VRAM_SIZE);
-    stream.read(reinterpret_cast<char*> (&m_address_register), sizeof(m_address_register));
-    stream.read(reinterpret_cast<char*> (&m_status_register), sizeof(m_status_register));
-    stream.read(reinterpret_cast<char*> (m_register), sizeof(m_register));
-    stream.read(reinterpret_cast<char*> (m_sat), sizeof(u16) * HUC6270_SAT_SIZE);
-    stream.read(reinterpret_cast<char*> (&m_read_buffer), sizeof(m_read_buffer));
-    stream.read(reinterpret_cast<char*> (&m_vram_openbus), sizeof(m_vram_openbus));
+    stream.ReadPages(m_vram, sizeof(u16) * HUC6270_VRAM_SIZE, m_vram_dirty);
+    stream.Read(&m_address_register, sizeof(m_address_register));
+    stream.Read(&m_status_register, sizeof(m_status_register));
+    stream.Read(m_register, sizeof(m_register));
+    stream.Read(m_sat, sizeof(u16) * HUC6270_SAT_SIZE);
+    stream.Read(&m_read_buffer, sizeof(m_read_buffer));
+    stream.Read(&m_vram_openbus, sizeof(m_vram_openbus));
     if (version >= 29)
     {
-        stream.read(reinterpret_cast<char*> (&m_pending_memory_read), sizeof(m_pending_memory_read));
-        stream.read(reinterpret_cast<char*> (&m_pending_memory_write), sizeof(m_pending_memory_write));
-        stream.read(reinterpret_cast<char*> (&m_transfer_delay), sizeof(m_transfer_delay));
+        stream.Read(&m_pending_memory_read, sizeof(m_pending_memory_read));
+        stream.Read(&m_pending_memory_write, sizeof(m_pending_memory_write));
+        stream.Read(&m_transfer_delay, sizeof(m_transfer_delay));
     }
     else
     {
@@ -1025,59 +1079,59 @@ void HuC6270::LoadState(std::istream& stream, int version)
         m_transfer_delay = 0;
     }
     UpdateCpuVramBusyStatus();
-    stream.read(reinterpret_cast<char*> (&m_trigger_sat_transfer), sizeof(m_trigger_sat_transfer));
-    stream.read(reinterpret_cast<char*> (&m_sat_transfer_pending), sizeof(m_sat_transfer_pending));
+    stream.Read(&m_trigger_sat_transfer, sizeof(m_trigger_sat_transfer));
+    stream.Read(&m_sat_transfer_pending, sizeof(m_sat_transfer_pending));
     m_sat_transfer_pending = MIN(m_sat_transfer_pending, 1024);
-    stream.read(reinterpret_cast<char*> (&m_vram_transfer_pending), sizeof(m_vram_transfer_pending));
-    stream.read(reinterpret_cast<char*> (&m_vram_transfer_src), sizeof(m_vram_transfer_src));
-    stream.read(reinterpret_cast<char*> (&m_vram_transfer_dest), sizeof(m_vram_transfer_dest));
-    stream.read(reinterpret_cast<char*> (&m_hpos), sizeof(m_hpos));
-    stream.read(reinterpret_cast<char*> (&m_vpos), sizeof(m_vpos));
-    stream.read(reinterpret_cast<char*> (&m_bg_offset_y), sizeof(m_bg_offset_y));
-    stream.read(reinterpret_cast<char*> (&m_bg_counter_y), sizeof(m_bg_counter_y));
-    stream.read(reinterpret_cast<char*> (&m_increment_bg_counter_y), sizeof(m_increment_bg_counter_y));
-    stream.read(reinterpret_cast<char*> (&m_need_to_increment_raster_line), sizeof(m_need_to_increment_raster_line));
-    stream.read(reinterpret_cast<char*> (&m_raster_line), sizeof(m_raster_line));
-    stream.read(reinterpret_cast<char*> (&m_latched_bxr), sizeof(m_latched_bxr));
-    stream.read(reinterpret_cast<char*> (&m_latched_hds), sizeof(m_latched_hds));
-    stream.read(reinterpret_cast<char*> (&m_latched_hdw), sizeof(m_latched_hdw));
-    stream.read(reinterpret_cast<char*> (&m_latched_hde), sizeof(m_latched_hde));
-    stream.read(reinterpret_cast<char*> (&m_latched_hsw), sizeof(m_latched_hsw));
-    stream.read(reinterpret_cast<char*> (&m_latched_vds), sizeof(m_latched_vds));
-    stream.read(reinterpret_cast<char*> (&m_latched_vdw), sizeof(m_latched_vdw));
-    stream.read(reinterpret_cast<char*> (&m_latched_vcr), sizeof(m_latched_vcr));
-    stream.read(reinterpret_cast<char*> (&m_latched_vsw), sizeof(m_latched_vsw));
-    stream.read(reinterpret_cast<char*> (&m_latched_mwr), sizeof(m_latched_mwr));
-    stream.read(reinterpret_cast<char*> (&m_latched_cr), sizeof(m_latched_cr));
-    stream.read(reinterpret_cast<char*> (&m_v_state), sizeof(m_v_state));
-    stream.read(reinterpret_cast<char*> (&m_h_state), sizeof(m_h_state));
-    stream.read(reinterpret_cast<char*> (&m_lines_to_next_v_state), sizeof(m_lines_to_next_v_state));
-    stream.read(reinterpret_cast<char*> (&m_clocks_to_next_h_state), sizeof(m_clocks_to_next_h_state));
-    stream.read(reinterpret_cast<char*> (&m_vblank_triggered), sizeof(m_vblank_triggered));
-    stream.read(reinterpret_cast<char*> (&m_active_line), sizeof(m_active_line));
-    stream.read(reinterpret_cast<char*> (&m_burst_mode), sizeof(m_burst_mode));
-    stream.read(reinterpret_cast<char*> (&m_line_buffer_index), sizeof(m_line_buffer_index));
-    stream.read(reinterpret_cast<char*> (&m_no_sprite_limit), sizeof(m_no_sprite_limit));
-    stream.read(reinterpret_cast<char*> (&m_sprite_count), sizeof(m_sprite_count));
-    stream.read(reinterpret_cast<char*> (&m_sprite_overflow), sizeof(m_sprite_overflow));
-    stream.read(reinterpret_cast<char*> (&m_next_event), sizeof(m_next_event));
-    stream.read(reinterpret_cast<char*> (&m_clocks_to_next_event), sizeof(m_clocks_to_next_event));
+    stream.Read(&m_vram_transfer_pending, sizeof(m_vram_transfer_pending));
+    stream.Read(&m_vram_transfer_src, sizeof(m_vram_transfer_src));
+    stream.Read(&m_vram_transfer_dest, sizeof(m_vram_transfer_dest));
+    stream.Read(&m_hpos, sizeof(m_hpos));
+    stream.Read(&m_vpos, sizeof(m_vpos));
+    stream.Read(&m_bg_offset_y, sizeof(m_bg_offset_y));
+    stream.Read(&m_bg_counter_y, sizeof(m_bg_counter_y));
+    stream.Read(&m_increment_bg_counter_y, sizeof(m_increment_bg_counter_y));
+    stream.Read(&m_need_to_increment_raster_line, sizeof(m_need_to_increment_raster_line));
+    stream.Read(&m_raster_line, sizeof(m_raster_line));
+    stream.Read(&m_latched_bxr, sizeof(m_latched_bxr));
+    stream.Read(&m_latched_hds, sizeof(m_latched_hds));
+    stream.Read(&m_latched_hdw, sizeof(m_latched_hdw));
+    stream.Read(&m_latched_hde, sizeof(m_latched_hde));
+    stream.Read(&m_latched_hsw, sizeof(m_latched_hsw));
+    stream.Read(&m_latched_vds, sizeof(m_latched_vds));
+    stream.Read(&m_latched_vdw, sizeof(m_latched_vdw));
+    stream.Read(&m_latched_vcr, sizeof(m_latched_vcr));
+    stream.Read(&m_latched_vsw, sizeof(m_latched_vsw));
+    stream.Read(&m_latched_mwr, sizeof(m_latched_mwr));
+    stream.Read(&m_latched_cr, sizeof(m_latched_cr));
+    stream.Read(&m_v_state, sizeof(m_v_state));
+    stream.Read(&m_h_state, sizeof(m_h_state));
+    stream.Read(&m_lines_to_next_v_state, sizeof(m_lines_to_next_v_state));
+    stream.Read(&m_clocks_to_next_h_state, sizeof(m_clocks_to_next_h_state));
+    stream.Read(&m_vblank_triggered, sizeof(m_vblank_triggered));
+    stream.Read(&m_active_line, sizeof(m_active_line));
+    stream.Read(&m_burst_mode, sizeof(m_burst_mode));
+    stream.Read(&m_line_buffer_index, sizeof(m_line_buffer_index));
+    stream.Read(&m_no_sprite_limit, sizeof(m_no_sprite_limit));
+    stream.Read(&m_sprite_count, sizeof(m_sprite_count));
+    stream.Read(&m_sprite_overflow, sizeof(m_sprite_overflow));
+    stream.Read(&m_next_event, sizeof(m_next_event));
+    stream.Read(&m_clocks_to_next_event, sizeof(m_clocks_to_next_event));
 
     for (int i = 0; i < (HUC6270_MAX_SPRITE_HEIGHT * 2); i++)
     {
-        stream.read(reinterpret_cast<char*> (&m_sprites[i].index), sizeof(m_sprites[i].index));
-        stream.read(reinterpret_cast<char*> (&m_sprites[i].x), sizeof(m_sprites[i].x));
-        stream.read(reinterpret_cast<char*> (&m_sprites[i].flags), sizeof(m_sprites[i].flags));
-        stream.read(reinterpret_cast<char*> (&m_sprites[i].palette), sizeof(m_sprites[i].palette));
-        stream.read(reinterpret_cast<char*> (m_sprites[i].data), sizeof(m_sprites[i].data));
+        stream.Read(&m_sprites[i].index, sizeof(m_sprites[i].index));
+        stream.Read(&m_sprites[i].x, sizeof(m_sprites[i].x));
+        stream.Read(&m_sprites[i].flags, sizeof(m_sprites[i].flags));
+        stream.Read(&m_sprites[i].palette, sizeof(m_sprites[i].palette));
+        stream.Read(m_sprites[i].data, sizeof(m_sprites[i].data));
     }
 
     if (version >= 29)
     {
-        stream.read(reinterpret_cast<char*> (&m_load_bg_start_clock), sizeof(m_load_bg_start_clock));
-        stream.read(reinterpret_cast<char*> (&m_load_bg_end_clock), sizeof(m_load_bg_end_clock));
-        stream.read(reinterpret_cast<char*> (&m_hsync_start_clock), sizeof(m_hsync_start_clock));
-        stream.read(reinterpret_cast<char*> (&m_allow_vram_access), sizeof(m_allow_vram_access));
+        stream.Read(&m_load_bg_start_clock, sizeof(m_load_bg_start_clock));
+        stream.Read(&m_load_bg_end_clock, sizeof(m_load_bg_end_clock));
+        stream.Read(&m_hsync_start_clock, sizeof(m_hsync_start_clock));
+        stream.Read(&m_allow_vram_access, sizeof(m_allow_vram_access));
     }
     else
     {
@@ -1089,13 +1143,13 @@ void HuC6270::LoadState(std::istream& stream, int version)
 
     if (version >= 30)
     {
-        stream.read(reinterpret_cast<char*> (&m_bg_scroll_y_update_pending), sizeof(m_bg_scroll_y_update_pending));
-        stream.read(reinterpret_cast<char*> (&m_latch_clock_y), sizeof(m_latch_clock_y));
-        stream.read(reinterpret_cast<char*> (&m_latch_clock_x), sizeof(m_latch_clock_x));
+        stream.Read(&m_bg_scroll_y_update_pending, sizeof(m_bg_scroll_y_update_pending));
+        stream.Read(&m_latch_clock_y, sizeof(m_latch_clock_y));
+        stream.Read(&m_latch_clock_x, sizeof(m_latch_clock_x));
         if (version >= 31)
         {
-            stream.read(reinterpret_cast<char*> (&m_bxr_written_before_latch), sizeof(m_bxr_written_before_latch));
-            stream.read(reinterpret_cast<char*> (&m_byr_lsb_write_clock), sizeof(m_byr_lsb_write_clock));
+            stream.Read(&m_bxr_written_before_latch, sizeof(m_bxr_written_before_latch));
+            stream.Read(&m_byr_lsb_write_clock, sizeof(m_byr_lsb_write_clock));
         }
         else
         {
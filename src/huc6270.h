@@ -32,6 +32,9 @@ class TraceLogger;
 
 class HuC6270
 {
+#if defined(GG_BENCHMARK)
+    friend class Benchmark;
+#endif
 public:
     enum HuC6270_Vertical_State
     {
@@ -85,13 +88,17 @@ public:
     HuC6270_State* GetState();
     u16* GetVRAM();
     u16* GetSAT();
+    DirtyPages* GetVRAMDirtyPages();
     void SetNoSpriteLimit(bool no_sprite_limit);
     void SetSafeDefaults(bool safe_defaults);
+    void CopySettings(const HuC6270* source);
+    void SetSpeculative(bool speculative);
     void SetTraceLogger(TraceLogger* trace_logger);
+    void SetPerfCounters(GG_Perf_Counters* perf_counters);
     void ProcessCpuVramAccesses(u32 cycles);
     bool HasPendingCpuVramAccess();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GG_SAVESTATE_VERSION);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream, int version = GG_SAVESTATE_VERSION);
 
 private:
     struct HuC6270_Sprite_Data
@@ -107,8 +114,10 @@ private:
     HuC6260* m_huc6260;
     HuC6280* m_huc6280;
     TraceLogger* m_trace_logger;
+    GG_Perf_Counters* m_perf_counters;
     HuC6270_State m_state;
     u16 m_vram[HUC6270_VRAM_SIZE] = {};
+    DirtyPages m_vram_dirty;
     u16 m_address_register;
     u16 m_status_register;
     u16 m_register[20];
@@ -164,6 +173,7 @@ private:
     s32 m_line_buffer_index;
     bool m_no_sprite_limit;
     bool m_safe_defaults;
+    bool m_speculative;
     s32 m_sprite_count;
     bool m_sprite_overflow;
     HuC6270_Sprite_Data m_sprites[HUC6270_SPRITES * 2] = {};
@@ -205,6 +215,7 @@ private:
     void SpriteCollisionIRQ();
     void RenderLine();
     void RenderBackground(int width);
+    void LatchBackgroundOpenBus(int width);
     void RenderSprites(int width);
     void FetchSprites();
 };
@@ -82,6 +82,11 @@ INLINE u16* HuC6270::GetSAT()
     return m_sat;
 }
 
+INLINE DirtyPages* HuC6270::GetVRAMDirtyPages()
+{
+    return &m_vram_dirty;
+}
+
 INLINE void HuC6270::ProcessCpuVramAccesses(u32 cycles)
 {
     while (HasPendingCpuVramAccess() && (cycles >= 3))
@@ -229,6 +234,7 @@ INLINE void HuC6270::ProcessVramWrite()
         m_huc6280->CheckMemoryBreakpoints(HuC6280::HuC6280_BREAKPOINT_TYPE_VRAM, m_register[HUC6270_REG_MAWR], false);
 #endif
         m_vram[m_register[HUC6270_REG_MAWR] & 0x7FFF] = m_register[HUC6270_REG_VWR];
+        m_vram_dirty.Mark((m_register[HUC6270_REG_MAWR] & 0x7FFF) << 1);
     }
 
     m_register[HUC6270_REG_MAWR] += k_huc6270_read_write_increment[(m_register[HUC6270_REG_CR] >> 11) & 0x03];
@@ -254,6 +260,17 @@ INLINE void HuC6270::SetSafeDefaults(bool safe_defaults)
     m_safe_defaults = safe_defaults;
 }
 
+INLINE void HuC6270::SetSpeculative(bool speculative)
+{
+    m_speculative = speculative;
+}
+
+INLINE void HuC6270::CopySettings(const HuC6270* source)
+{
+    m_no_sprite_limit = source->m_no_sprite_limit;
+    m_safe_defaults = source->m_safe_defaults;
+}
+
 INLINE int HuC6270::GetCpuVramReadDelay()
 {
     int speed = m_huc6260->GetSpeed();
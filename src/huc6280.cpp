@@ -860,7 +860,7 @@ void HuC6280::CreateZNFlagsTable()
     }
 }
 
-void HuC6280::SaveState(std::ostream& stream)
+void HuC6280::SaveState(StateSerializer& stream)
 {
     m_PC.SaveState(stream);
     m_A.SaveState(stream);
@@ -869,25 +869,25 @@ void HuC6280::SaveState(std::ostream& stream)
     m_S.SaveState(stream);
     m_P.SaveState(stream);
 
-    stream.write(reinterpret_cast<const char*> (&m_cycles), sizeof(m_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_irq_pending), sizeof(m_irq_pending));
-    stream.write(reinterpret_cast<const char*> (&m_speed), sizeof(m_speed));
-    stream.write(reinterpret_cast<const char*> (&m_transfer_state), sizeof(m_transfer_state));
-    stream.write(reinterpret_cast<const char*> (&m_transfer_count), sizeof(m_transfer_count));
-    stream.write(reinterpret_cast<const char*> (&m_transfer_length), sizeof(m_transfer_length));
-    stream.write(reinterpret_cast<const char*> (&m_transfer_source), sizeof(m_transfer_source));
-    stream.write(reinterpret_cast<const char*> (&m_transfer_dest), sizeof(m_transfer_dest));
-    stream.write(reinterpret_cast<const char*> (&m_timer_enabled), sizeof(m_timer_enabled));
-    stream.write(reinterpret_cast<const char*> (&m_timer_cycles), sizeof(m_timer_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_timer_counter), sizeof(m_timer_counter));
-    stream.write(reinterpret_cast<const char*> (&m_timer_reload), sizeof(m_timer_reload));
-    stream.write(reinterpret_cast<const char*> (&m_interrupt_disable_register), sizeof(m_interrupt_disable_register));
-    stream.write(reinterpret_cast<const char*> (&m_interrupt_request_register), sizeof(m_interrupt_request_register));
-    stream.write(reinterpret_cast<const char*> (&m_transfer_flag), sizeof(m_transfer_flag));
-    stream.write(reinterpret_cast<const char*> (&m_debug_next_irq), sizeof(m_debug_next_irq));
-}
-
-void HuC6280::LoadState(std::istream& stream)
+    stream.Write(&m_cycles, sizeof(m_cycles));
+    stream.Write(&m_irq_pending, sizeof(m_irq_pending));
+    stream.Write(&m_speed, sizeof(m_speed));
+    stream.Write(&m_transfer_state, sizeof(m_transfer_state));
+    stream.Write(&m_transfer_count, sizeof(m_transfer_count));
+    stream.Write(&m_transfer_length, sizeof(m_transfer_length));
+    stream.Write(&m_transfer_source, sizeof(m_transfer_source));
+    stream.Write(&m_transfer_dest, sizeof(m_transfer_dest));
+    stream.Write(&m_timer_enabled, sizeof(m_timer_enabled));
+    stream.Write(&m_timer_cycles, sizeof(m_timer_cycles));
+    stream.Write(&m_timer_counter, sizeof(m_timer_counter));
+    stream.Write(&m_timer_reload, sizeof(m_timer_reload));
+    stream.Write(&m_interrupt_disable_register, sizeof(m_interrupt_disable_register));
+    stream.Write(&m_interrupt_request_register, sizeof(m_interrupt_request_register));
+    stream.Write(&m_transfer_flag, sizeof(m_transfer_flag));
+    stream.Write(&m_debug_next_irq, sizeof(m_debug_next_irq));
+}
+
+void HuC6280::LoadState(StateDeserializer& stream)
 {
     m_PC.LoadState(stream);
     m_A.LoadState(stream);
@@ -896,21 +896,21 @@ void HuC6280::LoadState(std::istream& stream)
     m_S.LoadState(stream);
     m_P.LoadState(stream);
 
-    stream.read(reinterpret_cast<char*> (&m_cycles), sizeof(m_cycles));
-    stream.read(reinterpret_cast<char*> (&m_irq_pending), sizeof(m_irq_pending));
-    stream.read(reinterpret_cast<char*> (&m_speed), sizeof(m_speed));
+    stream.Read(&m_cycles, sizeof(m_cycles));
+    stream.Read(&m_irq_pending, sizeof(m_irq_pending));
+    stream.Read(&m_speed, sizeof(m_speed));
     m_speed = CLAMP(m_speed, 0, 1);
-    stream.read(reinterpret_cast<char*> (&m_transfer_state), sizeof(m_transfer_state));
-    stream.read(reinterpret_cast<char*> (&m_transfer_count), sizeof(m_transfer_count));
-    stream.read(reinterpret_cast<char*> (&m_transfer_length), sizeof(m_transfer_length));
-    stream.read(reinterpret_cast<char*> (&m_transfer_source), sizeof(m_transfer_source));
-    stream.read(reinterpret_cast<char*> (&m_transfer_dest), sizeof(m_transfer_dest));
-    stream.read(reinterpret_cast<char*> (&m_timer_enabled), sizeof(m_timer_enabled));
-    stream.read(reinterpret_cast<char*> (&m_timer_cycles), sizeof(m_timer_cycles));
-    stream.read(reinterpret_cast<char*> (&m_timer_counter), sizeof(m_timer_counter));
-    stream.read(reinterpret_cast<char*> (&m_timer_reload), sizeof(m_timer_reload));
-    stream.read(reinterpret_cast<char*> (&m_interrupt_disable_register), sizeof(m_interrupt_disable_register));
-    stream.read(reinterpret_cast<char*> (&m_interrupt_request_register), sizeof(m_interrupt_request_register));
-    stream.read(reinterpret_cast<char*> (&m_transfer_flag), sizeof(m_transfer_flag));
-    stream.read(reinterpret_cast<char*> (&m_debug_next_irq), sizeof(m_debug_next_irq));
+    stream.Read(&m_transfer_state, sizeof(m_transfer_state));
+    stream.Read(&m_transfer_count, sizeof(m_transfer_count));
+    stream.Read(&m_transfer_length, sizeof(m_transfer_length));
+    stream.Read(&m_transfer_source, sizeof(m_transfer_source));
+    stream.Read(&m_transfer_dest, sizeof(m_transfer_dest));
+    stream.Read(&m_timer_enabled, sizeof(m_timer_enabled));
+    stream.Read(&m_timer_cycles, sizeof(m_timer_cycles));
+    stream.Read(&m_timer_counter, sizeof(m_timer_counter));
+    stream.Read(&m_timer_reload, sizeof(m_timer_reload));
+    stream.Read(&m_interrupt_disable_register, sizeof(m_interrupt_disable_register));
+    stream.Read(&m_interrupt_request_register, sizeof(m_interrupt_request_register));
+    stream.Read(&m_transfer_flag, sizeof(m_transfer_flag));
+    stream.Read(&m_debug_next_irq, sizeof(m_debug_next_irq));
 }
@@ -168,8 +168,8 @@ public:
     std::stack<GG_CallStackEntry>* GetDisassemblerCallStack();
     void CheckMemoryBreakpoints(int type, u32 address, bool read);
     void SetTraceLogger(TraceLogger* trace_logger);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream);
 
 private:
     typedef void (HuC6280::*opcode_member_ptr) (void);
@@ -21,16 +21,20 @@
 #include <assert.h>
 #include <algorithm>
 #include "huc6280_psg.h"
+#include "profiler.h"
 
 HuC6280PSG::HuC6280PSG()
 {
     InitPointer(m_channels);
     InitPointer(m_ch);
+    InitPointer(m_perf_counters);
     m_dc_offset = 16;
     m_hpf_prev_input[0] = 0.0f;
     m_hpf_prev_input[1] = 0.0f;
     m_hpf_prev_output[0] = 0.0f;
     m_hpf_prev_output[1] = 0.0f;
+    memset(m_stem_hpf_prev_input, 0, sizeof(m_stem_hpf_prev_input));
+    memset(m_stem_hpf_prev_output, 0, sizeof(m_stem_hpf_prev_output));
 }
 
 HuC6280PSG::~HuC6280PSG()
@@ -71,6 +75,8 @@ void HuC6280PSG::Reset()
     m_hpf_prev_input[1] = 0.0f;
     m_hpf_prev_output[0] = 0.0f;
     m_hpf_prev_output[1] = 0.0f;
+    memset(m_stem_hpf_prev_input, 0, sizeof(m_stem_hpf_prev_input));
+    memset(m_stem_hpf_prev_output, 0, sizeof(m_stem_hpf_prev_output));
 
     m_channel_select = 0;
     m_main_vol = 0;
@@ -242,9 +248,14 @@ void HuC6280PSG::Write(u16 address, u8 value)
 
 void HuC6280PSG::Sync()
 {
+    GG_PROFILE_ZONE("HuC6280PSG::Sync");
+
     int remaining_cycles = m_elapsed_cycles;
     m_elapsed_cycles = 0;
 
+    GG_PERF_ADD(m_perf_counters, psg_sync_calls, 1);
+    GG_PERF_ADD(m_perf_counters, psg_sync_cycles, remaining_cycles);
+
     while (remaining_cycles > 0)
     {
         int batch_size = remaining_cycles;
@@ -428,6 +439,35 @@ int HuC6280PSG::EndFrame(s16* sample_buffer)
     return samples;
 }
 
+// Returns the samples of one channel for the last completed frame.
+// Must be called once per frame after EndFrame to keep the filter state continuous.
+int HuC6280PSG::GetChannelFrame(int channel, s16* sample_buffer)
+{
+    if ((channel < 0) || (channel >= 6) || !IsValidPointer(sample_buffer))
+        return 0;
+
+    int samples = m_frame_samples;
+    s16* output = m_channels[channel].output;
+    float* prev_input = m_stem_hpf_prev_input[channel];
+    float* prev_output = m_stem_hpf_prev_output[channel];
+
+    for (int s = 0; s < samples; s++)
+    {
+        int side = s & 0x01;
+        float raw = output[s];
+
+        const float hpf_r = 0.9985f;
+        float out_sample = raw - prev_input[side] + hpf_r * prev_output[side];
+
+        prev_input[side] = raw;
+        prev_output[side] = out_sample;
+
+        sample_buffer[s] = (s16)CLAMP(out_sample, -32768.0f, 32767.0f);
+    }
+
+    return samples;
+}
+
 void HuC6280PSG::ComputeVolumeLUT()
 {
     double amplitude = 65535.0 / 6.0 / 32.0;
@@ -454,69 +494,69 @@ void HuC6280PSG::UpdateChannelVolume(int channel)
     ch->gain_right = m_volume_lut[(temp_right_vol << 1) | (~ch->control & 0x01)];
 }
 
-void HuC6280PSG::SaveState(std::ostream& stream)
+void HuC6280PSG::SaveState(StateSerializer& stream)
 {
-    stream.write(reinterpret_cast<const char*> (&m_channel_select), sizeof(m_channel_select));
-    stream.write(reinterpret_cast<const char*> (&m_main_vol), sizeof(m_main_vol));
-    stream.write(reinterpret_cast<const char*> (&m_main_vol_left), sizeof(m_main_vol_left));
-    stream.write(reinterpret_cast<const char*> (&m_main_vol_right), sizeof(m_main_vol_right));
-    stream.write(reinterpret_cast<const char*> (&m_lfo_enabled), sizeof(m_lfo_enabled));
-    stream.write(reinterpret_cast<const char*> (&m_lfo_frequency), sizeof(m_lfo_frequency));
-    stream.write(reinterpret_cast<const char*> (&m_lfo_control), sizeof(m_lfo_control));
-    stream.write(reinterpret_cast<const char*> (&m_elapsed_cycles), sizeof(m_elapsed_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_frame_samples), sizeof(m_frame_samples));
-    stream.write(reinterpret_cast<const char*> (&m_buffer_index), sizeof(m_buffer_index));
+    stream.Write(&m_channel_select, sizeof(m_channel_select));
+    stream.Write(&m_main_vol, sizeof(m_main_vol));
+    stream.Write(&m_main_vol_left, sizeof(m_main_vol_left));
+    stream.Write(&m_main_vol_right, sizeof(m_main_vol_right));
+    stream.Write(&m_lfo_enabled, sizeof(m_lfo_enabled));
+    stream.Write(&m_lfo_frequency, sizeof(m_lfo_frequency));
+    stream.Write(&m_lfo_control, sizeof(m_lfo_control));
+    stream.Write(&m_elapsed_cycles, sizeof(m_elapsed_cycles));
+    stream.Write(&m_frame_samples, sizeof(m_frame_samples));
+    stream.Write(&m_buffer_index, sizeof(m_buffer_index));
 
     for (int i = 0; i < 6; i++)
     {
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].enabled), sizeof(m_channels[i].enabled));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].frequency), sizeof(m_channels[i].frequency));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].control), sizeof(m_channels[i].control));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].amplitude), sizeof(m_channels[i].amplitude));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].vol), sizeof(m_channels[i].vol));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].vol_left), sizeof(m_channels[i].vol_left));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].vol_right), sizeof(m_channels[i].vol_right));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].wave), sizeof(m_channels[i].wave));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].wave_index), sizeof(m_channels[i].wave_index));
-        stream.write(reinterpret_cast<const char*> (m_channels[i].wave_data), sizeof(m_channels[i].wave_data));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].noise_control), sizeof(m_channels[i].noise_control));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].noise_enabled), sizeof(m_channels[i].noise_enabled));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].noise_freq), sizeof(m_channels[i].noise_freq));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].noise_seed), sizeof(m_channels[i].noise_seed));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].noise_counter), sizeof(m_channels[i].noise_counter));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].counter), sizeof(m_channels[i].counter));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].dda), sizeof(m_channels[i].dda));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].dda_enabled), sizeof(m_channels[i].dda_enabled));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].left_sample), sizeof(m_channels[i].left_sample));
-        stream.write(reinterpret_cast<const char*> (&m_channels[i].right_sample), sizeof(m_channels[i].right_sample));
-        stream.write(reinterpret_cast<const char*> (m_channels[i].output), sizeof(m_channels[i].output));
+        stream.Write(&m_channels[i].enabled, sizeof(m_channels[i].enabled));
+        stream.Write(&m_channels[i].frequency, sizeof(m_channels[i].frequency));
+        stream.Write(&m_channels[i].control, sizeof(m_channels[i].control));
+        stream.Write(&m_channels[i].amplitude, sizeof(m_channels[i].amplitude));
+        stream.Write(&m_channels[i].vol, sizeof(m_channels[i].vol));
+        stream.Write(&m_channels[i].vol_left, sizeof(m_channels[i].vol_left));
+        stream.Write(&m_channels[i].vol_right, sizeof(m_channels[i].vol_right));
+        stream.Write(&m_channels[i].wave, sizeof(m_channels[i].wave));
+        stream.Write(&m_channels[i].wave_index, sizeof(m_channels[i].wave_index));
+        stream.Write(m_channels[i].wave_data, sizeof(m_channels[i].wave_data));
+        stream.Write(&m_channels[i].noise_control, sizeof(m_channels[i].noise_control));
+        stream.Write(&m_channels[i].noise_enabled, sizeof(m_channels[i].noise_enabled));
+        stream.Write(&m_channels[i].noise_freq, sizeof(m_channels[i].noise_freq));
+        stream.Write(&m_channels[i].noise_seed, sizeof(m_channels[i].noise_seed));
+        stream.Write(&m_channels[i].noise_counter, sizeof(m_channels[i].noise_counter));
+        stream.Write(&m_channels[i].counter, sizeof(m_channels[i].counter));
+        stream.Write(&m_channels[i].dda, sizeof(m_channels[i].dda));
+        stream.Write(&m_channels[i].dda_enabled, sizeof(m_channels[i].dda_enabled));
+        stream.Write(&m_channels[i].left_sample, sizeof(m_channels[i].left_sample));
+        stream.Write(&m_channels[i].right_sample, sizeof(m_channels[i].right_sample));
+        stream.Write(m_channels[i].output, sizeof(m_channels[i].output));
     }
 
-    stream.write(reinterpret_cast<const char*> (m_hpf_prev_input), sizeof(m_hpf_prev_input));
-    stream.write(reinterpret_cast<const char*> (m_hpf_prev_output), sizeof(m_hpf_prev_output));
+    stream.Write(m_hpf_prev_input, sizeof(m_hpf_prev_input));
+    stream.Write(m_hpf_prev_output, sizeof(m_hpf_prev_output));
 }
 
-void HuC6280PSG::LoadState(std::istream& stream, int version)
+void HuC6280PSG::LoadState(StateDeserializer& stream, int version)
 {
-    stream.read(reinterpret_cast<char*> (&m_channel_select), sizeof(m_channel_select));
-    stream.read(reinterpret_cast<char*> (&m_main_vol), sizeof(m_main_vol));
-    stream.read(reinterpret_cast<char*> (&m_main_vol_left), sizeof(m_main_vol_left));
-    stream.read(reinterpret_cast<char*> (&m_main_vol_right), sizeof(m_main_vol_right));
-    stream.read(reinterpret_cast<char*> (&m_lfo_enabled), sizeof(m_lfo_enabled));
-    stream.read(reinterpret_cast<char*> (&m_lfo_frequency), sizeof(m_lfo_frequency));
-    stream.read(reinterpret_cast<char*> (&m_lfo_control), sizeof(m_lfo_control));
-    stream.read(reinterpret_cast<char*> (&m_elapsed_cycles), sizeof(m_elapsed_cycles));
+    stream.Read(&m_channel_select, sizeof(m_channel_select));
+    stream.Read(&m_main_vol, sizeof(m_main_vol));
+    stream.Read(&m_main_vol_left, sizeof(m_main_vol_left));
+    stream.Read(&m_main_vol_right, sizeof(m_main_vol_right));
+    stream.Read(&m_lfo_enabled, sizeof(m_lfo_enabled));
+    stream.Read(&m_lfo_frequency, sizeof(m_lfo_frequency));
+    stream.Read(&m_lfo_control, sizeof(m_lfo_control));
+    stream.Read(&m_elapsed_cycles, sizeof(m_elapsed_cycles));
 
     if (version < 32)
     {
         s32 sample_cycle_counter = 0;
-        stream.read(reinterpret_cast<char*> (&sample_cycle_counter), sizeof(sample_cycle_counter));
+        stream.Read(&sample_cycle_counter, sizeof(sample_cycle_counter));
     }
 
     if (version >= 27)
     {
-        stream.read(reinterpret_cast<char*> (&m_frame_samples), sizeof(m_frame_samples));
-        stream.read(reinterpret_cast<char*> (&m_buffer_index), sizeof(m_buffer_index));
+        stream.Read(&m_frame_samples, sizeof(m_frame_samples));
+        stream.Read(&m_buffer_index, sizeof(m_buffer_index));
 
         m_buffer_index = CLAMP(m_buffer_index, 0, GG_AUDIO_BUFFER_SIZE - 2);
         m_buffer_index &= ~1;
@@ -530,44 +570,44 @@ void HuC6280PSG::LoadState(std::istream& stream, int version)
 
     for (int i = 0; i < 6; i++)
     {
-        stream.read(reinterpret_cast<char*> (&m_channels[i].enabled), sizeof(m_channels[i].enabled));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].frequency), sizeof(m_channels[i].frequency));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].control), sizeof(m_channels[i].control));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].amplitude), sizeof(m_channels[i].amplitude));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].vol), sizeof(m_channels[i].vol));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].vol_left), sizeof(m_channels[i].vol_left));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].vol_right), sizeof(m_channels[i].vol_right));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].wave), sizeof(m_channels[i].wave));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].wave_index), sizeof(m_channels[i].wave_index));
-        stream.read(reinterpret_cast<char*> (m_channels[i].wave_data), sizeof(m_channels[i].wave_data));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].noise_control), sizeof(m_channels[i].noise_control));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].noise_enabled), sizeof(m_channels[i].noise_enabled));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].noise_freq), sizeof(m_channels[i].noise_freq));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].noise_seed), sizeof(m_channels[i].noise_seed));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].noise_counter), sizeof(m_channels[i].noise_counter));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].counter), sizeof(m_channels[i].counter));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].dda), sizeof(m_channels[i].dda));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].dda_enabled), sizeof(m_channels[i].dda_enabled));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].left_sample), sizeof(m_channels[i].left_sample));
-        stream.read(reinterpret_cast<char*> (&m_channels[i].right_sample), sizeof(m_channels[i].right_sample));
+        stream.Read(&m_channels[i].enabled, sizeof(m_channels[i].enabled));
+        stream.Read(&m_channels[i].frequency, sizeof(m_channels[i].frequency));
+        stream.Read(&m_channels[i].control, sizeof(m_channels[i].control));
+        stream.Read(&m_channels[i].amplitude, sizeof(m_channels[i].amplitude));
+        stream.Read(&m_channels[i].vol, sizeof(m_channels[i].vol));
+        stream.Read(&m_channels[i].vol_left, sizeof(m_channels[i].vol_left));
+        stream.Read(&m_channels[i].vol_right, sizeof(m_channels[i].vol_right));
+        stream.Read(&m_channels[i].wave, sizeof(m_channels[i].wave));
+        stream.Read(&m_channels[i].wave_index, sizeof(m_channels[i].wave_index));
+        stream.Read(m_channels[i].wave_data, sizeof(m_channels[i].wave_data));
+        stream.Read(&m_channels[i].noise_control, sizeof(m_channels[i].noise_control));
+        stream.Read(&m_channels[i].noise_enabled, sizeof(m_channels[i].noise_enabled));
+        stream.Read(&m_channels[i].noise_freq, sizeof(m_channels[i].noise_freq));
+        stream.Read(&m_channels[i].noise_seed, sizeof(m_channels[i].noise_seed));
+        stream.Read(&m_channels[i].noise_counter, sizeof(m_channels[i].noise_counter));
+        stream.Read(&m_channels[i].counter, sizeof(m_channels[i].counter));
+        stream.Read(&m_channels[i].dda, sizeof(m_channels[i].dda));
+        stream.Read(&m_channels[i].dda_enabled, sizeof(m_channels[i].dda_enabled));
+        stream.Read(&m_channels[i].left_sample, sizeof(m_channels[i].left_sample));
+        stream.Read(&m_channels[i].right_sample, sizeof(m_channels[i].right_sample));
 
         if (version >= 27)
-            stream.read(reinterpret_cast<char*> (m_channels[i].output), sizeof(m_channels[i].output));
+            stream.Read(m_channels[i].output, sizeof(m_channels[i].output));
         else
             memset(m_channels[i].output, 0, sizeof(m_channels[i].output));
     }
 
     if (version >= 28)
     {
-        stream.read(reinterpret_cast<char*> (m_hpf_prev_input), sizeof(m_hpf_prev_input));
-        stream.read(reinterpret_cast<char*> (m_hpf_prev_output), sizeof(m_hpf_prev_output));
+        stream.Read(m_hpf_prev_input, sizeof(m_hpf_prev_input));
+        stream.Read(m_hpf_prev_output, sizeof(m_hpf_prev_output));
     }
     else if (version >= 24)
     {
         float hpf_prev_input = 0.0f;
         float hpf_prev_output = 0.0f;
-        stream.read(reinterpret_cast<char*> (&hpf_prev_input), sizeof(hpf_prev_input));
-        stream.read(reinterpret_cast<char*> (&hpf_prev_output), sizeof(hpf_prev_output));
+        stream.Read(&hpf_prev_input, sizeof(hpf_prev_input));
+        stream.Read(&hpf_prev_output, sizeof(hpf_prev_output));
 
         m_hpf_prev_input[0] = hpf_prev_input;
         m_hpf_prev_input[1] = hpf_prev_input;
@@ -75,10 +75,13 @@ public:
     void Sample();
     void Write(u16 address, u8 value);
     int EndFrame(s16* sample_buffer);
+    int GetChannelFrame(int channel, s16* sample_buffer);
     void EnableHuC6280A(bool enabled);
+    void CopySettings(const HuC6280PSG* source);
+    void SetPerfCounters(GG_Perf_Counters* perf_counters);
     HuC6280PSG_State* GetState();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version = GG_SAVESTATE_VERSION);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream, int version = GG_SAVESTATE_VERSION);
 
 private:
     void Sync();
@@ -91,6 +94,7 @@ private:
     HuC6280PSG_Channel* m_ch;
     HuC6280PSG_Channel* m_lfo_src;
     HuC6280PSG_Channel* m_lfo_dest;
+    GG_Perf_Counters* m_perf_counters;
     u8 m_channel_select;
     u8 m_main_vol;
     u8 m_main_vol_left;
@@ -105,6 +109,8 @@ private:
     u8 m_dc_offset;
     float m_hpf_prev_input[2];
     float m_hpf_prev_output[2];
+    float m_stem_hpf_prev_input[6][2];
+    float m_stem_hpf_prev_output[6][2];
 };
 
 #include "huc6280_psg_inline.h"
@@ -36,6 +36,16 @@ INLINE void HuC6280PSG::EnableHuC6280A(bool enabled)
     m_hpf_prev_output[1] = 0.0f;
 }
 
+INLINE void HuC6280PSG::CopySettings(const HuC6280PSG* source)
+{
+    m_dc_offset = source->m_dc_offset;
+}
+
+INLINE void HuC6280PSG::SetPerfCounters(GG_Perf_Counters* perf_counters)
+{
+    m_perf_counters = perf_counters;
+}
+
 INLINE HuC6280PSG::HuC6280PSG_State* HuC6280PSG::GetState()
 {
     return &m_state;
@@ -32,8 +32,8 @@ public:
     void Increment(u8 value);
     void Decrement();
     void Decrement(u8 value);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream);
 
 private:
     u8 m_value;
@@ -69,14 +69,14 @@ INLINE void EightBitRegister::Decrement(u8 value)
     m_value -= value;
 }
 
-INLINE void EightBitRegister::SaveState(std::ostream& stream)
+INLINE void EightBitRegister::SaveState(StateSerializer& stream)
 {
-    stream.write(reinterpret_cast<const char*> (&m_value), sizeof(m_value));
+    stream.Write(&m_value, sizeof(m_value));
 }
 
-INLINE void EightBitRegister::LoadState(std::istream& stream)
+INLINE void EightBitRegister::LoadState(StateDeserializer& stream)
 {
-    stream.read(reinterpret_cast<char*> (&m_value), sizeof(m_value));
+    stream.Read(&m_value, sizeof(m_value));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -97,8 +97,8 @@ public:
     void Increment(u16 value);
     void Decrement();
     void Decrement(u16 value);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream);
 
 private:
     union sixteenBit
@@ -178,14 +178,14 @@ INLINE void SixteenBitRegister::Decrement(u16 value)
     m_value.v -= value;
 }
 
-INLINE void SixteenBitRegister::SaveState(std::ostream& stream)
+INLINE void SixteenBitRegister::SaveState(StateSerializer& stream)
 {
-    stream.write(reinterpret_cast<const char*> (&m_value.v), sizeof(m_value.v));
+    stream.Write(&m_value.v, sizeof(m_value.v));
 }
 
-INLINE void SixteenBitRegister::LoadState(std::istream& stream)
+INLINE void SixteenBitRegister::LoadState(StateDeserializer& stream)
 {
-    stream.read(reinterpret_cast<char*> (&m_value.v), sizeof(m_value.v));
+    stream.Read(&m_value.v, sizeof(m_value.v));
 }
 
 #endif /* HUC6280_REGISTERS_H */
\ No newline at end of file
@@ -41,6 +41,8 @@ Input::Input(Media* media, GeargrafxCore* core)
     m_mouse_shifter = 0;
     m_mouse_latched = false;
     m_mouse_last_latch_cycles = 0;
+    m_input_latch = false;
+    memset(&m_latched_input, 0, sizeof(m_latched_input));
 
     for (int i = 0; i < GG_MAX_GAMEPADS; i++)
     {
@@ -155,41 +157,98 @@ void Input::EndFrame()
     }
 }
 
-void Input::SaveState(std::ostream& stream)
+void Input::SetInputLatch(bool enabled)
+{
+    if (enabled == m_input_latch)
+        return;
+
+    if (enabled)
+    {
+        memset(&m_latched_input, 0, sizeof(m_latched_input));
+
+        for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+            m_latched_input.keys[i] = ~m_gamepads[i] & 0x0FFF;
+
+        m_input_latch = true;
+    }
+    else
+    {
+        m_input_latch = false;
+        ApplyFrameInput(m_latched_input);
+    }
+}
+
+void Input::GetLatchedInput(GG_Input_Frame& frame)
+{
+    frame = m_latched_input;
+    m_latched_input.mouse_x = 0;
+    m_latched_input.mouse_y = 0;
+}
+
+// Sets every pad from scratch so the outcome only depends on the frame,
+// never on the order of the events that produced it.
+void Input::ApplyFrameInput(const GG_Input_Frame& frame)
+{
+    for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+    {
+        GG_Controllers controller = (GG_Controllers)i;
+
+        for (int bit = 0; bit < 12; bit++)
+        {
+            GG_Keys key = (GG_Keys)(1 << bit);
+            if (!(frame.keys[i] & key))
+                ReleaseKey(controller, key);
+        }
+
+        for (int bit = 0; bit < 12; bit++)
+        {
+            GG_Keys key = (GG_Keys)(1 << bit);
+            if (frame.keys[i] & key)
+                PressKey(controller, key);
+        }
+
+        m_latched_input.keys[i] = frame.keys[i];
+    }
+
+    m_mouse_x += frame.mouse_x;
+    m_mouse_y += frame.mouse_y;
+}
+
+void Input::SaveState(StateSerializer& stream)
 {
     using namespace std;
-    stream.write(reinterpret_cast<const char*> (&m_clr), sizeof(m_clr));
-    stream.write(reinterpret_cast<const char*> (&m_sel), sizeof(m_sel));
-    stream.write(reinterpret_cast<const char*> (&m_register), sizeof(m_register));
-    stream.write(reinterpret_cast<const char*> (&m_selected_pad), sizeof(m_selected_pad));
-    stream.write(reinterpret_cast<const char*> (&m_selected_extra_buttons), sizeof(m_selected_extra_buttons));
-    stream.write(reinterpret_cast<const char*> (m_gamepads), sizeof(m_gamepads));
-    stream.write(reinterpret_cast<const char*> (&m_mouse_x), sizeof(m_mouse_x));
-    stream.write(reinterpret_cast<const char*> (&m_mouse_y), sizeof(m_mouse_y));
-    stream.write(reinterpret_cast<const char*> (&m_mouse_shifter), sizeof(m_mouse_shifter));
-    stream.write(reinterpret_cast<const char*> (&m_mouse_latched), sizeof(m_mouse_latched));
-    stream.write(reinterpret_cast<const char*> (&m_mouse_last_latch_cycles), sizeof(m_mouse_last_latch_cycles));
+    stream.Write(&m_clr, sizeof(m_clr));
+    stream.Write(&m_sel, sizeof(m_sel));
+    stream.Write(&m_register, sizeof(m_register));
+    stream.Write(&m_selected_pad, sizeof(m_selected_pad));
+    stream.Write(&m_selected_extra_buttons, sizeof(m_selected_extra_buttons));
+    stream.Write(m_gamepads, sizeof(m_gamepads));
+    stream.Write(&m_mouse_x, sizeof(m_mouse_x));
+    stream.Write(&m_mouse_y, sizeof(m_mouse_y));
+    stream.Write(&m_mouse_shifter, sizeof(m_mouse_shifter));
+    stream.Write(&m_mouse_latched, sizeof(m_mouse_latched));
+    stream.Write(&m_mouse_last_latch_cycles, sizeof(m_mouse_last_latch_cycles));
 
     bool mb128_included = m_mb128.IsConnected();
-    stream.write(reinterpret_cast<const char*> (&mb128_included), sizeof(mb128_included));
+    stream.Write(&mb128_included, sizeof(mb128_included));
 
     if (mb128_included)
         m_mb128.SaveState(stream);
 }
 
-void Input::LoadState(std::istream& stream, int version)
+void Input::LoadState(StateDeserializer& stream, int version)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (&m_clr), sizeof(m_clr));
-    stream.read(reinterpret_cast<char*> (&m_sel), sizeof(m_sel));
-    stream.read(reinterpret_cast<char*> (&m_register), sizeof(m_register));
-    stream.read(reinterpret_cast<char*> (&m_selected_pad), sizeof(m_selected_pad));
-    stream.read(reinterpret_cast<char*> (&m_selected_extra_buttons), sizeof(m_selected_extra_buttons));
+    stream.Read(&m_clr, sizeof(m_clr));
+    stream.Read(&m_sel, sizeof(m_sel));
+    stream.Read(&m_register, sizeof(m_register));
+    stream.Read(&m_selected_pad, sizeof(m_selected_pad));
+    stream.Read(&m_selected_extra_buttons, sizeof(m_selected_extra_buttons));
 
     m_selected_pad = MAX(m_selected_pad, 0);
 
     if (version >= 25)
-        stream.read(reinterpret_cast<char*> (m_gamepads), sizeof(m_gamepads));
+        stream.Read(m_gamepads, sizeof(m_gamepads));
     else
     {
         for (int i = 0; i < GG_MAX_GAMEPADS; i++)
@@ -198,13 +257,13 @@ void Input::LoadState(std::istream& stream, int version)
 
     if (version >= 26)
     {
-        stream.read(reinterpret_cast<char*> (&m_mouse_x), sizeof(m_mouse_x));
-        stream.read(reinterpret_cast<char*> (&m_mouse_y), sizeof(m_mouse_y));
-        stream.read(reinterpret_cast<char*> (&m_mouse_shifter), sizeof(m_mouse_shifter));
-        stream.read(reinterpret_cast<char*> (&m_mouse_latched), sizeof(m_mouse_latched));
+        stream.Read(&m_mouse_x, sizeof(m_mouse_x));
+        stream.Read(&m_mouse_y, sizeof(m_mouse_y));
+        stream.Read(&m_mouse_shifter, sizeof(m_mouse_shifter));
+        stream.Read(&m_mouse_latched, sizeof(m_mouse_latched));
 
         if (version >= 27)
-            stream.read(reinterpret_cast<char*> (&m_mouse_last_latch_cycles), sizeof(m_mouse_last_latch_cycles));
+            stream.Read(&m_mouse_last_latch_cycles, sizeof(m_mouse_last_latch_cycles));
         else
             m_mouse_last_latch_cycles = 0;
     }
@@ -218,12 +277,35 @@ void Input::LoadState(std::istream& stream, int version)
     }
 
     bool mb128_included = false;
-    stream.read(reinterpret_cast<char*> (&mb128_included), sizeof(mb128_included));
+    stream.Read(&mb128_included, sizeof(mb128_included));
 
     if (mb128_included)
         m_mb128.LoadState(stream);
 }
 
+void Input::CopySettings(const Input* source)
+{
+    m_pce_jap = source->m_pce_jap;
+    m_cdrom = source->m_cdrom;
+    m_turbo_tap = source->m_turbo_tap;
+
+    for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+    {
+        m_controller_type[i] = source->m_controller_type[i];
+        m_avenue_pad_3_button[i] = source->m_avenue_pad_3_button[i];
+
+        for (int j = 0; j < 2; j++)
+        {
+            m_turbo_enabled[i][j] = source->m_turbo_enabled[i][j];
+            m_turbo_speed[i][j] = source->m_turbo_speed[i][j];
+        }
+    }
+
+    // Disconnecting resets the MB128, so only follow actual changes
+    if (m_mb128.IsConnected() != source->m_mb128.IsConnected())
+        m_mb128.Connect(source->m_mb128.IsConnected());
+}
+
 u64 Input::GetMasterClockCycles()
 {
     return m_core->GetMasterClockCycles();
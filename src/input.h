@@ -29,6 +29,15 @@ class GeargrafxCore;
 class Media;
 class TraceLogger;
 
+// Input of one emulated frame: the GG_Keys held on each controller (set
+// bits are pressed) and the mouse motion accumulated during the frame.
+struct GG_Input_Frame
+{
+    u16 keys[GG_MAX_GAMEPADS];
+    s16 mouse_x;
+    s16 mouse_y;
+};
+
 class Input
 {
 public:
@@ -48,6 +57,7 @@ public:
     void EnablePCEJap(bool enable);
     void EnableCDROM(bool enable);
     void EnableTurboTap(bool enabled);
+    bool IsTurboTapEnabled() const;
     void EnableTurbo(GG_Controllers controller, GG_Keys key, bool enabled);
     bool IsTurboEnabled(GG_Controllers controller, GG_Keys key);
     void SetTurboSpeed(GG_Controllers controller, GG_Keys key, u8 speed);
@@ -56,13 +66,22 @@ public:
     void SetAvenuePad3Button(GG_Controllers controller, GG_Keys button);
     void SetMouseDelta(s32 x, s32 y);
     void EnableMB128(bool enable);
+    void CopySettings(const Input* source);
+    u16 GetGamepadState(GG_Controllers controller) const;
+    void GetMouseDelta(s32* x, s32* y) const;
+    void SetInputLatch(bool enabled);
+    bool IsInputLatched() const;
+    void GetLatchedInput(GG_Input_Frame& frame);
+    void ApplyFrameInput(const GG_Input_Frame& frame);
     void SetTraceLogger(TraceLogger* trace_logger);
     MB128* GetMB128();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream, int version);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream, int version);
 
 private:
     u64 GetMasterClockCycles();
+    void PressKey(GG_Controllers controller, GG_Keys key);
+    void ReleaseKey(GG_Controllers controller, GG_Keys key);
     void TraceInputEvent(u8 event, u8 value);
     void LogInputEvent(u8 event, u8 value);
 
@@ -92,6 +111,8 @@ private:
     bool m_mouse_latched;
     u64 m_mouse_last_latch_cycles;
     MB128 m_mb128;
+    bool m_input_latch;
+    GG_Input_Frame m_latched_input;
 };
 
 #include "input_inline.h"
@@ -25,6 +25,22 @@
 #include "trace_logger.h"
 
 INLINE void Input::KeyPressed(GG_Controllers controller, GG_Keys key)
+{
+    if (m_input_latch)
+        m_latched_input.keys[controller] |= key;
+    else
+        PressKey(controller, key);
+}
+
+INLINE void Input::KeyReleased(GG_Controllers controller, GG_Keys key)
+{
+    if (m_input_latch)
+        m_latched_input.keys[controller] &= ~key;
+    else
+        ReleaseKey(controller, key);
+}
+
+INLINE void Input::PressKey(GG_Controllers controller, GG_Keys key)
 {
     m_gamepads[controller] &= ~key;
 
@@ -42,7 +58,7 @@ INLINE void Input::KeyPressed(GG_Controllers controller, GG_Keys key)
     }
 }
 
-INLINE void Input::KeyReleased(GG_Controllers controller, GG_Keys key)
+INLINE void Input::ReleaseKey(GG_Controllers controller, GG_Keys key)
 {
     m_gamepads[controller] |= key;
 
@@ -239,6 +255,11 @@ INLINE void Input::EnableTurboTap(bool enabled)
     m_turbo_tap = enabled;
 }
 
+INLINE bool Input::IsTurboTapEnabled() const
+{
+    return m_turbo_tap;
+}
+
 INLINE void Input::EnableTurbo(GG_Controllers controller, GG_Keys key, bool enabled)
 {
     if (key < GG_KEY_I || key > GG_KEY_II)
@@ -286,6 +307,13 @@ INLINE void Input::SetAvenuePad3Button(GG_Controllers controller, GG_Keys button
 
 INLINE void Input::SetMouseDelta(s32 x, s32 y)
 {
+    if (m_input_latch)
+    {
+        m_latched_input.mouse_x = (s16)CLAMP(m_latched_input.mouse_x + x, -32768, 32767);
+        m_latched_input.mouse_y = (s16)CLAMP(m_latched_input.mouse_y + y, -32768, 32767);
+        return;
+    }
+
     m_mouse_x += x;
     m_mouse_y += y;
 }
@@ -295,6 +323,22 @@ INLINE void Input::EnableMB128(bool enable)
     m_mb128.Connect(enable);
 }
 
+INLINE u16 Input::GetGamepadState(GG_Controllers controller) const
+{
+    return m_gamepads[controller];
+}
+
+INLINE void Input::GetMouseDelta(s32* x, s32* y) const
+{
+    *x = m_mouse_x;
+    *y = m_mouse_y;
+}
+
+INLINE bool Input::IsInputLatched() const
+{
+    return m_input_latch;
+}
+
 INLINE MB128* Input::GetMB128()
 {
     return &m_mb128;
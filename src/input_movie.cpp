@@ -0,0 +1,564 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <fstream>
+#include <sstream>
+#include "input_movie.h"
+#include "geargrafx_core.h"
+#include "input.h"
+#include "media.h"
+#include "memory.h"
+#include "huc6260.h"
+#include "xxhash.h"
+
+InputMovie::InputMovie()
+{
+    InitPointer(m_core);
+    memset(&m_header, 0, sizeof(m_header));
+    m_recording = false;
+    m_playing = false;
+    m_current_frame = 0;
+}
+
+InputMovie::~InputMovie()
+{
+    Stop();
+}
+
+bool InputMovie::StartRecording(GeargrafxCore* core, Start start)
+{
+    Stop();
+
+    if (!core->GetMedia()->IsReady())
+    {
+        Error("Movie: no media loaded");
+        return false;
+    }
+
+    memset(&m_header, 0, sizeof(m_header));
+    m_header.magic = GG_MOVIE_MAGIC;
+    m_header.version = GG_MOVIE_VERSION;
+    m_header.rom_crc = core->GetMedia()->GetCRC();
+    strncpy_fit(m_header.emu_build, GG_VERSION, sizeof(m_header.emu_build));
+
+    Input* input = core->GetInput();
+    m_header.turbo_tap = input->IsTurboTapEnabled() ? 1 : 0;
+
+    for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+        m_header.controller_types[i] = (u8)input->GetControllerType((GG_Controllers)i);
+
+    ReadSettings(core, m_header);
+
+    m_state.clear();
+    m_frames.clear();
+    m_hashes.clear();
+
+    if (start == START_SAVESTATE)
+    {
+        size_t size = core->GetSaveStateSize();
+        m_state.resize(size);
+
+        if (!core->SaveState(m_state.data(), size))
+        {
+            Error("Movie: unable to capture the start state");
+            m_state.clear();
+            return false;
+        }
+
+        m_state.resize(size);
+        m_header.flags |= FLAG_SAVESTATE;
+        m_header.state_size = (u32)size;
+    }
+    else
+    {
+        Memory* memory = core->GetMemory();
+        u8* backup_ram = memory->GetBackupRAM();
+        m_state.assign(backup_ram, backup_ram + memory->GetBackupRAMSize());
+        m_header.state_size = (u32)m_state.size();
+        m_header.seed = (u32)time(NULL);
+    }
+
+    if (!Begin(core))
+        return false;
+
+    m_recording = true;
+    Log("Movie: recording started (%s)", (start == START_SAVESTATE) ? "save state" : "power on");
+
+    return true;
+}
+
+bool InputMovie::StartPlayback(GeargrafxCore* core)
+{
+    Stop();
+
+    if (m_header.magic != GG_MOVIE_MAGIC)
+    {
+        Error("Movie: nothing to play");
+        return false;
+    }
+
+    if (!core->GetMedia()->IsReady())
+    {
+        Error("Movie: no media loaded");
+        return false;
+    }
+
+    if (core->GetMedia()->GetCRC() != m_header.rom_crc)
+    {
+        Error("Movie: recorded with a different game (CRC 0x%08X, loaded 0x%08X)", m_header.rom_crc, core->GetMedia()->GetCRC());
+        return false;
+    }
+
+    if (!CheckSettings(core))
+        return false;
+
+    if (!Begin(core))
+        return false;
+
+    m_playing = true;
+    Log("Movie: playback started, %d frames", GetFrameCount());
+
+    return true;
+}
+
+bool InputMovie::Begin(GeargrafxCore* core)
+{
+    Input* input = core->GetInput();
+    input->EnableTurboTap(m_header.turbo_tap != 0);
+
+    for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+        input->SetControllerType((GG_Controllers)i, (GG_Controller_Type)m_header.controller_types[i]);
+
+    if (m_header.flags & FLAG_SAVESTATE)
+    {
+        if (!core->LoadState(m_state.data(), m_state.size()))
+        {
+            Error("Movie: unable to load the start state");
+            return false;
+        }
+    }
+    else
+    {
+        core->SetRandomSeed(m_header.seed);
+        core->ResetMedia(false);
+
+        if (!m_state.empty())
+        {
+            std::stringstream stream(std::string(m_state.begin(), m_state.end()));
+            core->GetMemory()->LoadRam(stream, (s32)m_state.size());
+        }
+    }
+
+    m_core = core;
+    m_current_frame = 0;
+    input->SetInputLatch(true);
+
+    return true;
+}
+
+// Settings the core must share with the recording, they change what the
+// game sees at power-on and can't be carried by the input frames
+void InputMovie::ReadSettings(GeargrafxCore* core, Header& header)
+{
+    Media* media = core->GetMedia();
+
+    header.console_type = (u8)media->GetConsoleType();
+    header.cdrom_type = (u8)media->GetCDROMType();
+    header.mb128 = core->GetInput()->GetMB128()->IsConnected() ? 1 : 0;
+    header.bios_crc = 0;
+
+    if (media->IsCDROM())
+        header.bios_crc = media->GetBiosCRC(!media->IsGameExpress());
+}
+
+bool InputMovie::CheckSettings(GeargrafxCore* core)
+{
+    Header current;
+    memset(&current, 0, sizeof(current));
+    ReadSettings(core, current);
+
+    if (current.console_type != m_header.console_type)
+    {
+        Error("Movie: recorded with console type %d, current is %d", m_header.console_type, current.console_type);
+        return false;
+    }
+
+    if (current.cdrom_type != m_header.cdrom_type)
+    {
+        Error("Movie: recorded with CD-ROM type %d, current is %d", m_header.cdrom_type, current.cdrom_type);
+        return false;
+    }
+
+    if (current.bios_crc != m_header.bios_crc)
+    {
+        Error("Movie: recorded with a different BIOS (CRC 0x%08X, loaded 0x%08X)", m_header.bios_crc, current.bios_crc);
+        return false;
+    }
+
+    if (current.mb128 != m_header.mb128)
+    {
+        Error("Movie: recorded with the MB128 %s", m_header.mb128 ? "connected" : "disconnected");
+        return false;
+    }
+
+    return true;
+}
+
+void InputMovie::Stop()
+{
+    if (!IsValidPointer(m_core))
+        return;
+
+    Input* input = m_core->GetInput();
+
+    // Don't leave the last movie buttons held once the player takes over
+    if (m_playing)
+    {
+        GG_Input_Frame released;
+        memset(&released, 0, sizeof(released));
+        input->ApplyFrameInput(released);
+    }
+
+    input->SetInputLatch(false);
+
+    if (m_recording)
+    {
+        m_header.frame_count = (u32)m_frames.size();
+        Log("Movie: recording stopped, %d frames", GetFrameCount());
+    }
+
+    m_recording = false;
+    m_playing = false;
+    InitPointer(m_core);
+}
+
+bool InputMovie::Update()
+{
+    if (m_recording)
+    {
+        GG_Input_Frame frame;
+        Input* input = m_core->GetInput();
+        input->GetLatchedInput(frame);
+        input->ApplyFrameInput(frame);
+        m_frames.push_back(frame);
+        m_header.frame_count = (u32)m_frames.size();
+        m_current_frame++;
+        return true;
+    }
+
+    if (m_playing)
+    {
+        if (IsFinished())
+        {
+            Log("Movie: playback finished");
+            Stop();
+            return false;
+        }
+
+        m_core->GetInput()->ApplyFrameInput(m_frames[m_current_frame]);
+        m_current_frame++;
+        return true;
+    }
+
+    return false;
+}
+
+bool InputMovie::Save(const char* path)
+{
+    using namespace std;
+
+    if (m_header.magic != GG_MOVIE_MAGIC)
+        return false;
+
+    Header header = m_header;
+    header.frame_count = (u32)m_frames.size();
+    header.state_size = (u32)m_state.size();
+
+    if (HasHashes())
+        header.flags |= FLAG_HASHES;
+    else
+        header.flags &= ~FLAG_HASHES;
+
+    vector<u8> runs;
+    size_t count = m_frames.size();
+    size_t i = 0;
+
+    while (i < count)
+    {
+        size_t run = 1;
+        while (((i + run) < count) && (memcmp(&m_frames[i], &m_frames[i + run], sizeof(GG_Input_Frame)) == 0))
+            run++;
+
+        WriteRunLength(runs, (u32)run);
+        const u8* frame = reinterpret_cast<const u8*>(&m_frames[i]);
+        runs.insert(runs.end(), frame, frame + sizeof(GG_Input_Frame));
+        i += run;
+    }
+
+    ofstream file;
+    open_ofstream_utf8(file, path, ios::out | ios::binary | ios::trunc);
+
+    if (!file.is_open())
+    {
+        Error("Movie: unable to open %s for writing", path);
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    if (!m_state.empty())
+        file.write(reinterpret_cast<const char*>(m_state.data()), m_state.size());
+
+    if (!runs.empty())
+        file.write(reinterpret_cast<const char*>(runs.data()), runs.size());
+
+    if (header.flags & FLAG_HASHES)
+        file.write(reinterpret_cast<const char*>(m_hashes.data()), m_hashes.size() * sizeof(Frame_Hash));
+
+    if (file.fail())
+    {
+        Error("Movie: failed writing %s", path);
+        return false;
+    }
+
+    Debug("Movie: saved %d frames to %s (%d bytes of input)", (int)count, path, (int)runs.size());
+
+    return true;
+}
+
+bool InputMovie::Load(const char* path)
+{
+    using namespace std;
+
+    Stop();
+
+    ifstream file;
+    open_ifstream_utf8(file, path, ios::in | ios::binary);
+
+    if (!file.is_open())
+    {
+        Error("Movie: unable to open %s", path);
+        return false;
+    }
+
+    vector<u8> data((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    const u8* p = data.data();
+    const u8* end = p + data.size();
+    Header header;
+
+    if (data.size() < sizeof(header))
+    {
+        Error("Movie: %s is truncated", path);
+        return false;
+    }
+
+    memcpy(&header, p, sizeof(header));
+    p += sizeof(header);
+
+    if ((header.magic != GG_MOVIE_MAGIC) || (header.version != GG_MOVIE_VERSION))
+    {
+        Error("Movie: %s is not a supported movie file", path);
+        return false;
+    }
+
+    for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+    {
+        if (header.controller_types[i] > GG_CONTROLLER_MOUSE)
+        {
+            Error("Movie: %s has an invalid controller type", path);
+            return false;
+        }
+    }
+
+    if ((size_t)(end - p) < header.state_size)
+    {
+        Error("Movie: %s is truncated", path);
+        return false;
+    }
+
+    vector<u8> state(p, p + header.state_size);
+    p += header.state_size;
+
+    vector<GG_Input_Frame> frames;
+
+    while (frames.size() < header.frame_count)
+    {
+        u32 run = 0;
+        GG_Input_Frame frame;
+
+        if (!ReadRunLength(p, end, run) || (run == 0) || ((size_t)(end - p) < sizeof(frame)) ||
+            (run > (header.frame_count - frames.size())))
+        {
+            Error("Movie: %s has corrupt input data", path);
+            return false;
+        }
+
+        memcpy(&frame, p, sizeof(frame));
+        p += sizeof(frame);
+        frames.insert(frames.end(), run, frame);
+    }
+
+    vector<Frame_Hash> hashes;
+
+    if (header.flags & FLAG_HASHES)
+    {
+        size_t hashes_size = header.frame_count * sizeof(Frame_Hash);
+
+        if ((size_t)(end - p) < hashes_size)
+        {
+            Error("Movie: %s is truncated", path);
+            return false;
+        }
+
+        hashes.resize(header.frame_count);
+        memcpy(hashes.data(), p, hashes_size);
+    }
+
+    m_header = header;
+    m_state.swap(state);
+    m_frames.swap(frames);
+    m_hashes.swap(hashes);
+    m_current_frame = 0;
+
+    Debug("Movie: loaded %d frames from %s", GetFrameCount(), path);
+
+    return true;
+}
+
+bool InputMovie::IsRecording() const
+{
+    return m_recording;
+}
+
+bool InputMovie::IsPlaying() const
+{
+    return m_playing;
+}
+
+bool InputMovie::IsFinished() const
+{
+    return m_current_frame >= (int)m_frames.size();
+}
+
+int InputMovie::GetFrameCount() const
+{
+    return (int)m_frames.size();
+}
+
+int InputMovie::GetCurrentFrame() const
+{
+    return m_current_frame;
+}
+
+InputMovie::Start InputMovie::GetStart() const
+{
+    return (m_header.flags & FLAG_SAVESTATE) ? START_SAVESTATE : START_POWER_ON;
+}
+
+const GG_Input_Frame* InputMovie::GetFrame(int frame) const
+{
+    if ((frame < 0) || (frame >= (int)m_frames.size()))
+        return NULL;
+
+    return &m_frames[frame];
+}
+
+bool InputMovie::HasHashes() const
+{
+    return !m_hashes.empty() && (m_hashes.size() == m_frames.size());
+}
+
+const InputMovie::Frame_Hash* InputMovie::GetFrameHash(int frame) const
+{
+    if (!HasHashes() || (frame < 0) || (frame >= (int)m_hashes.size()))
+        return NULL;
+
+    return &m_hashes[frame];
+}
+
+void InputMovie::SetFrameHash(int frame, const Frame_Hash& hash)
+{
+    if ((frame < 0) || (frame >= (int)m_frames.size()))
+        return;
+
+    if (m_hashes.size() != m_frames.size())
+    {
+        Frame_Hash empty = { 0, 0, 0 };
+        m_hashes.resize(m_frames.size(), empty);
+    }
+
+    m_hashes[frame] = hash;
+}
+
+void InputMovie::ClearHashes()
+{
+    m_hashes.clear();
+}
+
+void InputMovie::HashFrame(GeargrafxCore* core, const u8* frame_buffer, const s16* sample_buffer, int sample_count, Frame_Hash& hash)
+{
+    HuC6260* huc6260 = core->GetHuC6260();
+    Memory* memory = core->GetMemory();
+
+    hash.video = 0;
+    if (IsValidPointer(frame_buffer))
+    {
+        int bytes_per_pixel = (huc6260->GetPixelFormat() == GG_PIXEL_RGBA8888) ? 4 : 2;
+        size_t size = (size_t)huc6260->GetCurrentWidth() * huc6260->GetCurrentHeight() * bytes_per_pixel;
+        hash.video = CalculateXXH64(frame_buffer, size);
+    }
+
+    hash.audio = 0;
+    if (IsValidPointer(sample_buffer) && (sample_count > 0))
+        hash.audio = CalculateXXH64(sample_buffer, sample_count * sizeof(s16));
+
+    hash.ram = CalculateXXH64(memory->GetWorkingRAM(), memory->GetWorkingRAMSize());
+    if (core->GetMedia()->IsCDROM())
+        hash.ram = CalculateXXH64(memory->GetCDROMRAM(), memory->GetCDROMRAMSize(), hash.ram);
+}
+
+void InputMovie::WriteRunLength(std::vector<u8>& buffer, u32 value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back((u8)(value | 0x80));
+        value >>= 7;
+    }
+
+    buffer.push_back((u8)value);
+}
+
+bool InputMovie::ReadRunLength(const u8*& data, const u8* end, u32& value)
+{
+    value = 0;
+
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (data >= end)
+            return false;
+
+        u8 byte = *data++;
+        value |= (u32)(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
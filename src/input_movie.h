@@ -0,0 +1,125 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef INPUT_MOVIE_H
+#define INPUT_MOVIE_H
+
+#include <vector>
+#include "common.h"
+#include "input.h"
+
+class GeargrafxCore;
+
+// Deterministic input recording. A movie starts either at power-on, with
+// the seed of the core random generator and the backup RAM, or from an
+// embedded save state, followed by the GG_Input_Frame of every emulated
+// frame. On disk the
+// frames are run-length encoded, so held buttons cost a few bytes.
+// The controller types and TurboTap setting are stored too, along with
+// the console type, CD-ROM type, BIOS and MB128 a movie was recorded
+// with, which playback requires to match. Optional
+// per-frame hashes of the picture, audio and RAM let a replay report the
+// first frame that diverged.
+//
+// While a movie is recording or playing, the core input is latched:
+// key and mouse events only reach the emulated pads when Update is called
+// right before each RunToVBlank, so the input pump can't apply them
+// mid-frame and a replay sees exactly what the recording saw.
+class InputMovie
+{
+public:
+    enum Start
+    {
+        START_POWER_ON = 0,
+        START_SAVESTATE
+    };
+
+    enum Flags
+    {
+        FLAG_SAVESTATE = 0x01,
+        FLAG_HASHES = 0x02
+    };
+
+    struct Header
+    {
+        u32 magic;
+        u32 version;
+        u32 flags;
+        u32 rom_crc;
+        u32 seed;
+        u32 frame_count;
+        u32 state_size;
+        u32 bios_crc;
+        u8 controller_types[GG_MAX_GAMEPADS];
+        u8 turbo_tap;
+        u8 console_type;
+        u8 cdrom_type;
+        u8 mb128;
+        u8 reserved[3];
+        char emu_build[32];
+    };
+
+    struct Frame_Hash
+    {
+        u64 video;
+        u64 audio;
+        u64 ram;
+    };
+
+public:
+    InputMovie();
+    ~InputMovie();
+    bool StartRecording(GeargrafxCore* core, Start start);
+    bool StartPlayback(GeargrafxCore* core);
+    void Stop();
+    bool Update();
+    bool Save(const char* path);
+    bool Load(const char* path);
+    bool IsRecording() const;
+    bool IsPlaying() const;
+    bool IsFinished() const;
+    int GetFrameCount() const;
+    int GetCurrentFrame() const;
+    Start GetStart() const;
+    const GG_Input_Frame* GetFrame(int frame) const;
+    bool HasHashes() const;
+    const Frame_Hash* GetFrameHash(int frame) const;
+    void SetFrameHash(int frame, const Frame_Hash& hash);
+    void ClearHashes();
+    static void HashFrame(GeargrafxCore* core, const u8* frame_buffer, const s16* sample_buffer, int sample_count, Frame_Hash& hash);
+
+private:
+    bool Begin(GeargrafxCore* core);
+    void ReadSettings(GeargrafxCore* core, Header& header);
+    bool CheckSettings(GeargrafxCore* core);
+    static void WriteRunLength(std::vector<u8>& buffer, u32 value);
+    static bool ReadRunLength(const u8*& data, const u8* end, u32& value);
+
+private:
+    GeargrafxCore* m_core;
+    Header m_header;
+    std::vector<u8> m_state;
+    std::vector<GG_Input_Frame> m_frames;
+    std::vector<Frame_Hash> m_hashes;
+    bool m_recording;
+    bool m_playing;
+    int m_current_frame;
+};
+
+#endif /* INPUT_MOVIE_H */
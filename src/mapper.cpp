@@ -43,12 +43,12 @@ void Mapper::WriteHardware(u16, u8)
     Debug("Mapper::WriteHardware not implemented");
 }
 
-void Mapper::SaveState(std::ostream&)
+void Mapper::SaveState(StateSerializer&)
 {
     Debug("Mapper::SaveState not implemented");
 }
 
-void Mapper::LoadState(std::istream&)
+void Mapper::LoadState(StateDeserializer&)
 {
     Debug("Mapper::LoadState not implemented");
 }
@@ -23,6 +23,7 @@
 #include <iostream>
 #include <fstream>
 #include "types.h"
+#include "state_serializer.h"
 
 class Media;
 class Memory;
@@ -37,8 +38,8 @@ public:
     virtual u8 ReadHardware(u16 address);
     virtual void WriteHardware(u16 address, u8 value);
     virtual void Reset() = 0;
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream);
+    virtual void SaveState(StateSerializer& stream);
+    virtual void LoadState(StateDeserializer& stream);
 
 protected:
     Media* m_media;
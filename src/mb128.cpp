@@ -200,38 +200,38 @@ void MB128::SendBit(bool sel_bit)
     }
 }
 
-void MB128::SaveState(std::ostream& stream)
+void MB128::SaveState(StateSerializer& stream)
 {
     using namespace std;
 
-    stream.write(reinterpret_cast<const char*>(m_ram), sizeof(m_ram));
-    stream.write(reinterpret_cast<const char*>(&m_connected), sizeof(m_connected));
-    stream.write(reinterpret_cast<const char*>(&m_prev_data), sizeof(m_prev_data));
-    stream.write(reinterpret_cast<const char*>(&m_shiftreg), sizeof(m_shiftreg));
-    stream.write(reinterpret_cast<const char*>(&m_active), sizeof(m_active));
-    stream.write(reinterpret_cast<const char*>(&m_state), sizeof(m_state));
-    stream.write(reinterpret_cast<const char*>(&m_bitnum), sizeof(m_bitnum));
-    stream.write(reinterpret_cast<const char*>(&m_cmd_wr_rd), sizeof(m_cmd_wr_rd));
-    stream.write(reinterpret_cast<const char*>(&m_address), sizeof(m_address));
-    stream.write(reinterpret_cast<const char*>(&m_len_bits), sizeof(m_len_bits));
-    stream.write(reinterpret_cast<const char*>(&m_retval), sizeof(m_retval));
-    stream.write(reinterpret_cast<const char*>(&m_dirty), sizeof(m_dirty));
+    stream.Write(m_ram, sizeof(m_ram));
+    stream.Write(&m_connected, sizeof(m_connected));
+    stream.Write(&m_prev_data, sizeof(m_prev_data));
+    stream.Write(&m_shiftreg, sizeof(m_shiftreg));
+    stream.Write(&m_active, sizeof(m_active));
+    stream.Write(&m_state, sizeof(m_state));
+    stream.Write(&m_bitnum, sizeof(m_bitnum));
+    stream.Write(&m_cmd_wr_rd, sizeof(m_cmd_wr_rd));
+    stream.Write(&m_address, sizeof(m_address));
+    stream.Write(&m_len_bits, sizeof(m_len_bits));
+    stream.Write(&m_retval, sizeof(m_retval));
+    stream.Write(&m_dirty, sizeof(m_dirty));
 }
 
-void MB128::LoadState(std::istream& stream)
+void MB128::LoadState(StateDeserializer& stream)
 {
     using namespace std;
 
-    stream.read(reinterpret_cast<char*>(m_ram), sizeof(m_ram));
-    stream.read(reinterpret_cast<char*>(&m_connected), sizeof(m_connected));
-    stream.read(reinterpret_cast<char*>(&m_prev_data), sizeof(m_prev_data));
-    stream.read(reinterpret_cast<char*>(&m_shiftreg), sizeof(m_shiftreg));
-    stream.read(reinterpret_cast<char*>(&m_active), sizeof(m_active));
-    stream.read(reinterpret_cast<char*>(&m_state), sizeof(m_state));
-    stream.read(reinterpret_cast<char*>(&m_bitnum), sizeof(m_bitnum));
-    stream.read(reinterpret_cast<char*>(&m_cmd_wr_rd), sizeof(m_cmd_wr_rd));
-    stream.read(reinterpret_cast<char*>(&m_address), sizeof(m_address));
-    stream.read(reinterpret_cast<char*>(&m_len_bits), sizeof(m_len_bits));
-    stream.read(reinterpret_cast<char*>(&m_retval), sizeof(m_retval));
-    stream.read(reinterpret_cast<char*>(&m_dirty), sizeof(m_dirty));
+    stream.Read(m_ram, sizeof(m_ram));
+    stream.Read(&m_connected, sizeof(m_connected));
+    stream.Read(&m_prev_data, sizeof(m_prev_data));
+    stream.Read(&m_shiftreg, sizeof(m_shiftreg));
+    stream.Read(&m_active, sizeof(m_active));
+    stream.Read(&m_state, sizeof(m_state));
+    stream.Read(&m_bitnum, sizeof(m_bitnum));
+    stream.Read(&m_cmd_wr_rd, sizeof(m_cmd_wr_rd));
+    stream.Read(&m_address, sizeof(m_address));
+    stream.Read(&m_len_bits, sizeof(m_len_bits));
+    stream.Read(&m_retval, sizeof(m_retval));
+    stream.Read(&m_dirty, sizeof(m_dirty));
 }
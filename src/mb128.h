@@ -38,8 +38,8 @@ public:
     u32 GetRAMSize() const;
     bool IsDirty() const { return m_dirty; }
     void ClearDirty() { m_dirty = false; }
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream);
 
 private:
     enum Mode
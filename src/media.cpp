@@ -26,11 +26,13 @@
 #include "crc.h"
 #include "media_file.h"
 #include "cdrom_media.h"
+#include "cdrom_chd_image.h"
 
 Media::Media(CdRomMedia* cdrom_media)
 {
     m_cdrom_media = cdrom_media;
     InitPointer(m_rom);
+    m_rom_shared = false;
     m_rom_size = 0;
     m_card_ram_size = 0;
     m_ready = false;
@@ -65,6 +67,7 @@ Media::Media(CdRomMedia* cdrom_media)
     m_cdrom_type = GG_CDROM_AUTO;
     m_force_backup_ram = false;
     m_preload_cdrom = false;
+    m_precache_chd_decode = false;
 
     m_rom_map = new u8*[128];
     m_rom_bank_offset = new u32[128];
@@ -77,6 +80,8 @@ Media::Media(CdRomMedia* cdrom_media)
 
 Media::~Media()
 {
+    if (m_rom_shared)
+        InitPointer(m_rom);
     SafeDeleteArray(m_rom);
     SafeDeleteArray(m_rom_map);
     SafeDeleteArray(m_rom_bank_offset);
@@ -89,7 +94,10 @@ void Media::Init()
 
 void Media::Reset()
 {
+    if (m_rom_shared)
+        InitPointer(m_rom);
     SafeDeleteArray(m_rom);
+    m_rom_shared = false;
     m_rom_size = 0;
     m_card_ram_size = 0;
     m_ready = false;
@@ -271,6 +279,78 @@ bool Media::LoadHuCardFromBuffer(const u8* buffer, int size, const char* path)
     return m_ready;
 }
 
+// Takes the media loaded in another Media without touching the disk. HuCard
+// ROMs are shared, so the source must outlive this one.
+//
+// CD-ROM images are opened again instead of shared. Forks usually run on
+// other threads, and an image is only safe on the thread of its core: it
+// keeps the current sector, open file handles with their read positions,
+// and chunk tables and a CHD hunk LRU that fill in lazily without locks
+// (the CHD cache mutex only exists with GG_ENABLE_CDROM_CHD_WORKERS and
+// still reads through a single chd_file). Memory-mapped CUE/BIN images
+// (GG_ENABLE_CDROM_CUEBIN_MMAP) still share their data, because every map
+// of the same file is backed by the same OS page cache.
+bool Media::ShareMedia(Media* source)
+{
+    Reset();
+
+    if (!source->m_ready)
+        return false;
+
+    m_console_type = source->m_console_type;
+    m_cdrom_type = source->m_cdrom_type;
+    m_force_backup_ram = source->m_force_backup_ram;
+    m_preload_cdrom = source->m_preload_cdrom;
+    m_precache_chd_decode = source->m_precache_chd_decode;
+    strncpy_fit(m_temp_path, source->m_temp_path, sizeof(m_temp_path));
+
+    memcpy(m_syscard_bios, source->m_syscard_bios, sizeof(m_syscard_bios));
+    memcpy(m_gameexpress_bios, source->m_gameexpress_bios, sizeof(m_gameexpress_bios));
+    m_bios_crc_syscard = source->m_bios_crc_syscard;
+    m_bios_crc_gameexpress = source->m_bios_crc_gameexpress;
+    m_is_loaded_bios_syscard = source->m_is_loaded_bios_syscard;
+    m_is_loaded_bios_gameexpress = source->m_is_loaded_bios_gameexpress;
+    m_is_valid_bios_syscard = source->m_is_valid_bios_syscard;
+    m_is_valid_bios_gameexpress = source->m_is_valid_bios_gameexpress;
+    strncpy_fit(m_bios_name_syscard, source->m_bios_name_syscard, sizeof(m_bios_name_syscard));
+    strncpy_fit(m_bios_name_gameexpress, source->m_bios_name_gameexpress, sizeof(m_bios_name_gameexpress));
+
+    if (source->m_is_cdrom)
+    {
+#if defined(GG_ENABLE_PHYSICAL_CDROM)
+        if (source->m_is_physical_cdrom)
+        {
+            Error("Physical CD-ROM media can't be shared");
+            return false;
+        }
+#endif
+        return LoadMedia(source->m_file_path);
+    }
+
+    m_rom = source->m_rom;
+    m_rom_shared = true;
+    m_rom_size = source->m_rom_size;
+    m_card_ram_size = source->m_card_ram_size;
+    strncpy_fit(m_file_path, source->m_file_path, sizeof(m_file_path));
+    strncpy_fit(m_file_directory, source->m_file_directory, sizeof(m_file_directory));
+    strncpy_fit(m_file_name, source->m_file_name, sizeof(m_file_name));
+    strncpy_fit(m_file_extension, source->m_file_extension, sizeof(m_file_extension));
+    m_crc = source->m_crc;
+    m_is_hes = source->m_is_hes;
+    m_is_gameexpress = source->m_is_gameexpress;
+    m_is_sgx = source->m_is_sgx;
+    m_is_in_game_database = source->m_is_in_game_database;
+    m_game_database_name = source->m_game_database_name;
+    m_is_mb128 = source->m_is_mb128;
+    m_mapper = source->m_mapper;
+    m_avenue_pad_3_button = source->m_avenue_pad_3_button;
+    m_ready = true;
+
+    InitRomMAP();
+
+    return m_ready;
+}
+
 bool Media::LoadCueFromFile(const char* path)
 {
     m_ready = m_cdrom_media->LoadCueFromFile(path, m_preload_cdrom);
@@ -279,6 +359,10 @@ bool Media::LoadCueFromFile(const char* path)
 
 bool Media::LoadChdFromFile(const char* path)
 {
+    GG_CdRomChdLoadOptions options = GG_CdRomChdDefaultLoadOptions();
+    options.precache_decode = m_precache_chd_decode;
+    m_cdrom_media->SetChdLoadOptions(options);
+
     m_ready = m_cdrom_media->LoadChdFromFile(path, m_preload_cdrom);
     return m_ready;
 }
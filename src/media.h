@@ -63,6 +63,8 @@ public:
     bool IsBackupRAMForced();
     void PreloadCdRom(bool enable);
     bool IsPreloadCdRomEnabled();
+    void PrecacheChdDecode(bool enable);
+    bool IsPrecacheChdDecodeEnabled();
     int GetROMSize();
     int GetCardRAMSize();
     GG_Keys GetAvenuePad3Button();
@@ -71,6 +73,7 @@ public:
     const char* GetFileName();
     const char* GetFileExtension();
     const char* GetBiosName(bool syscard);
+    u32 GetBiosCRC(bool syscard);
     u8* GetROM();
     u8** GetROMMap();
     u32* GetROMBankOffset();
@@ -83,6 +86,7 @@ public:
     const char* GetPhysicalCdRomDeviceId();
     bool HasPhysicalCdRomError();
 #endif
+    bool ShareMedia(Media* source);
     bool LoadBios(const char* file_path, bool syscard);
     bool LoadBiosFromBuffer(const u8* buffer, int size, bool syscard);
     void UnloadBios(bool syscard);
@@ -101,6 +105,7 @@ private:
 private:
     CdRomMedia* m_cdrom_media;
     u8* m_rom;
+    bool m_rom_shared;
     u8** m_rom_map;
     u32* m_rom_bank_offset;
     int m_rom_size;
@@ -137,6 +142,7 @@ private:
     GG_CDROM_Type m_cdrom_type;
     bool m_force_backup_ram;
     bool m_preload_cdrom;
+    bool m_precache_chd_decode;
     u8 m_syscard_bios[GG_BIOS_SYSCARD_SIZE] = {};
     u8 m_gameexpress_bios[GG_BIOS_GAME_EXPRESS_SIZE] = {};
 };
@@ -55,6 +55,15 @@ MediaFile* MediaFile::OpenFile(const char* path)
     return NULL;
 }
 
+// Maps the whole file read-only. Backends that can't map files return NULL
+// and callers read through Read() instead. The mapping stays valid until
+// the file is closed.
+const u8* MediaFile::Map(u64* size)
+{
+    *size = 0;
+    return NULL;
+}
+
 void MediaFile::SetVfsInterface(const retro_vfs_interface* iface)
 {
 #if defined(__LIBRETRO__)
@@ -41,6 +41,7 @@ public:
     virtual s64 Tell() = 0;
     virtual bool Seek(s64 offset) = 0;
     virtual s64 Read(void* buffer, u64 size) = 0;
+    virtual const u8* Map(u64* size);
 };
 
 #endif /* MEDIA_FILE_H */
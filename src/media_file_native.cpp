@@ -17,12 +17,19 @@
  *
  */
 
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 #include "media_file_native.h"
 #include "common.h"
 
 MediaFileNative::MediaFileNative()
 {
-
+    InitPointer(m_mapped_data);
+    m_mapped_size = 0;
 }
 
 MediaFileNative::~MediaFileNative()
@@ -38,13 +45,25 @@ bool MediaFileNative::Open(const char* path)
         return false;
 
     open_ifstream_utf8(m_file, path, std::ios::in | std::ios::binary);
+    m_path = path;
     return IsValid();
 }
 
 void MediaFileNative::Close()
 {
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    if (IsValidPointer(m_mapped_data))
+    {
+        munmap(m_mapped_data, m_mapped_size);
+        InitPointer(m_mapped_data);
+        m_mapped_size = 0;
+    }
+#endif
+
     if (m_file.is_open())
         m_file.close();
+
+    m_path.clear();
 }
 
 bool MediaFileNative::IsOpen() const
@@ -116,4 +135,47 @@ s64 MediaFileNative::Read(void* buffer, u64 size)
 
     m_file.read(reinterpret_cast<char*>(buffer), (std::streamsize)size);
     return (s64)m_file.gcount();
+}
+
+const u8* MediaFileNative::Map(u64* size)
+{
+    *size = 0;
+
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    if (IsValidPointer(m_mapped_data))
+    {
+        *size = m_mapped_size;
+        return m_mapped_data;
+    }
+
+    if (!m_file.is_open())
+        return NULL;
+
+    // std::ifstream doesn't expose its descriptor, so the file is opened
+    // again only to create the mapping, which keeps its own reference
+    int fd = open(m_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return NULL;
+
+    m_mapped_data = (u8*)data;
+    m_mapped_size = (size_t)st.st_size;
+    *size = m_mapped_size;
+
+    return m_mapped_data;
+#else
+    return NULL;
+#endif
 }
\ No newline at end of file
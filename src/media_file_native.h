@@ -21,6 +21,7 @@
 #define MEDIA_FILE_NATIVE_H
 
 #include <fstream>
+#include <string>
 #include "media_file.h"
 
 class MediaFileNative : public MediaFile
@@ -37,9 +38,13 @@ public:
     virtual s64 Tell() override;
     virtual bool Seek(s64 offset) override;
     virtual s64 Read(void* buffer, u64 size) override;
+    virtual const u8* Map(u64* size) override;
 
 private:
     std::ifstream m_file;
+    std::string m_path;
+    u8* m_mapped_data;
+    size_t m_mapped_size;
 };
 
 #endif /* MEDIA_FILE_NATIVE_H */
\ No newline at end of file
@@ -140,6 +140,16 @@ inline bool Media::IsPreloadCdRomEnabled()
     return m_preload_cdrom;
 }
 
+inline void Media::PrecacheChdDecode(bool enable)
+{
+    m_precache_chd_decode = enable;
+}
+
+inline bool Media::IsPrecacheChdDecodeEnabled()
+{
+    return m_precache_chd_decode;
+}
+
 inline int Media::GetROMSize()
 {
     return m_rom_size;
@@ -187,6 +197,11 @@ inline const char* Media::GetBiosName(bool syscard)
     return syscard ? m_bios_name_syscard : m_bios_name_gameexpress;
 }
 
+inline u32 Media::GetBiosCRC(bool syscard)
+{
+    return syscard ? m_bios_crc_syscard : m_bios_crc_gameexpress;
+}
+
 inline u8* Media::GetROM()
 {
     return m_rom;
@@ -76,7 +76,15 @@ Memory::~Memory()
 void Memory::Init()
 {
     for (int i = 0; i < 0x100; i++)
+    {
         InitPointer(m_memory_map[i]);
+        m_memory_map_dirty[i] = m_unused_dirty;
+    }
+
+    m_wram_dirty.Init(sizeof(m_wram));
+    m_card_ram_dirty.Init(sizeof(m_card_ram));
+    m_cdrom_ram_dirty.Init(sizeof(m_cdrom_ram));
+    m_backup_ram_dirty.Init(0x800);
 
 #if !defined(GG_DISABLE_DISASSEMBLER)
     m_disassembler = new GG_Disassembler_Record*[0x200000];
@@ -193,6 +201,7 @@ void Memory::Reset()
 
     memset(m_unused_memory, 0xFF, 0x2000);
 
+    MarkAllPagesDirty();
     ReloadMemoryMap();
 }
 
@@ -249,6 +258,53 @@ void Memory::ReloadMemoryMap()
         else
             m_memory_map[i] = &m_wram[0];
     }
+
+    ReloadDirtyMap();
+}
+
+void Memory::ReloadDirtyMap()
+{
+    for (int i = 0; i <= 0xFF; i++)
+        m_memory_map_dirty[i] = m_memory_map_write[i] ? GetDirtyFlags(m_memory_map[i]) : m_unused_dirty;
+}
+
+u8* Memory::GetDirtyFlags(u8* bank_memory)
+{
+    if ((bank_memory >= m_wram) && (bank_memory < m_wram + sizeof(m_wram)))
+        return m_wram_dirty.GetFlags() + ((bank_memory - m_wram) >> GG_DIRTY_PAGE_SHIFT);
+    if ((bank_memory >= m_card_ram) && (bank_memory < m_card_ram + sizeof(m_card_ram)))
+        return m_card_ram_dirty.GetFlags() + ((bank_memory - m_card_ram) >> GG_DIRTY_PAGE_SHIFT);
+    if ((bank_memory >= m_cdrom_ram) && (bank_memory < m_cdrom_ram + sizeof(m_cdrom_ram)))
+        return m_cdrom_ram_dirty.GetFlags() + ((bank_memory - m_cdrom_ram) >> GG_DIRTY_PAGE_SHIFT);
+    if (bank_memory == m_backup_ram)
+        return m_backup_ram_dirty.GetFlags();
+
+    return m_unused_dirty;
+}
+
+void Memory::ClearDirtyPages()
+{
+    m_wram_dirty.Clear();
+    m_card_ram_dirty.Clear();
+    m_cdrom_ram_dirty.Clear();
+    m_backup_ram_dirty.Clear();
+    m_arcade_card_mapper->GetDirtyPages()->Clear();
+}
+
+void Memory::MarkAllPagesDirty()
+{
+    m_wram_dirty.MarkAll();
+    m_card_ram_dirty.MarkAll();
+    m_cdrom_ram_dirty.MarkAll();
+    m_backup_ram_dirty.MarkAll();
+    m_arcade_card_mapper->GetDirtyPages()->MarkAll();
+}
+
+u32 Memory::GetDirtyPageCount()
+{
+    return m_wram_dirty.GetDirtyCount() + m_card_ram_dirty.GetDirtyCount() +
+        m_cdrom_ram_dirty.GetDirtyCount() + m_backup_ram_dirty.GetDirtyCount() +
+        m_arcade_card_mapper->GetDirtyPages()->GetDirtyCount();
 }
 
 void Memory::SetResetValues(int mpr, int wram, int card_ram, int arcade_card)
@@ -435,61 +491,58 @@ bool Memory::LoadRam(std::istream &file, s32 file_size)
     }
 
     memcpy(m_backup_ram, loaded_data, sizeof(loaded_data));
+    m_backup_ram_dirty.MarkAll();
 
     return true;
 }
 
-void Memory::SaveState(std::ostream& stream)
+void Memory::SaveState(StateSerializer& stream)
 {
     using namespace std;
-    stream.write(reinterpret_cast<const char*> (m_mpr), sizeof(m_mpr));
-    stream.write(reinterpret_cast<const char*> (m_wram), sizeof(u8) * 0x8000);
-    stream.write(reinterpret_cast<const char*> (&m_cdrom_ram_size), sizeof(m_cdrom_ram_size));
-    stream.write(reinterpret_cast<const char*> (m_cdrom_ram), sizeof(u8) * m_cdrom_ram_size);
-    stream.write(reinterpret_cast<const char*> (&m_card_ram_size), sizeof(m_card_ram_size));
-    stream.write(reinterpret_cast<const char*> (m_card_ram), sizeof(u8) * m_card_ram_size);
-    stream.write(reinterpret_cast<const char*> (&m_card_ram_start), sizeof(m_card_ram_start));
-    stream.write(reinterpret_cast<const char*> (&m_card_ram_end), sizeof(m_card_ram_end));
-    stream.write(reinterpret_cast<const char*> (m_backup_ram), sizeof(u8) * 0x800);
-    stream.write(reinterpret_cast<const char*> (&m_backup_ram_enabled), sizeof(m_backup_ram_enabled));
-    stream.write(reinterpret_cast<const char*> (&m_io_buffer), sizeof(m_io_buffer));
-    stream.write(reinterpret_cast<const char*> (&m_mpr_buffer), sizeof(m_mpr_buffer));
+    stream.Write(m_mpr, sizeof(m_mpr));
+    stream.WritePages(m_wram, sizeof(u8) * 0x8000, m_wram_dirty);
+    stream.Write(&m_cdrom_ram_size, sizeof(m_cdrom_ram_size));
+    stream.WritePages(m_cdrom_ram, sizeof(u8) * m_cdrom_ram_size, m_cdrom_ram_dirty);
+    stream.Write(&m_card_ram_size, sizeof(m_card_ram_size));
+    stream.WritePages(m_card_ram, sizeof(u8) * m_card_ram_size, m_card_ram_dirty);
+    stream.Write(&m_card_ram_start, sizeof(m_card_ram_start));
+    stream.Write(&m_card_ram_end, sizeof(m_card_ram_end));
+    stream.WritePages(m_backup_ram, sizeof(u8) * 0x800, m_backup_ram_dirty);
+    stream.Write(&m_backup_ram_enabled, sizeof(m_backup_ram_enabled));
+    stream.Write(&m_io_buffer, sizeof(m_io_buffer));
+    stream.Write(&m_mpr_buffer, sizeof(m_mpr_buffer));
     if (IsValidPointer(m_current_mapper))
         m_current_mapper->SaveState(stream);
 }
 
-void Memory::LoadState(std::istream& stream)
+void Memory::LoadState(StateDeserializer& stream)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (m_mpr), sizeof(m_mpr));
-    stream.read(reinterpret_cast<char*> (m_wram), sizeof(u8) * 0x8000);
+    stream.Read(m_mpr, sizeof(m_mpr));
+    stream.ReadPages(m_wram, sizeof(u8) * 0x8000, m_wram_dirty);
 
     u32 serialized_cdrom_ram_size;
-    stream.read(reinterpret_cast<char*> (&serialized_cdrom_ram_size), sizeof(serialized_cdrom_ram_size));
+    stream.Read(&serialized_cdrom_ram_size, sizeof(serialized_cdrom_ram_size));
     u32 cdrom_ram_read_size = serialized_cdrom_ram_size;
     if (cdrom_ram_read_size > sizeof(m_cdrom_ram))
         cdrom_ram_read_size = sizeof(m_cdrom_ram);
     m_cdrom_ram_size = cdrom_ram_read_size;
-    stream.read(reinterpret_cast<char*> (m_cdrom_ram), sizeof(u8) * cdrom_ram_read_size);
-    if (serialized_cdrom_ram_size > cdrom_ram_read_size)
-        stream.ignore(static_cast<streamsize>(serialized_cdrom_ram_size - cdrom_ram_read_size));
+    stream.ReadPages(m_cdrom_ram, sizeof(u8) * cdrom_ram_read_size, serialized_cdrom_ram_size, m_cdrom_ram_dirty);
 
     u32 serialized_card_ram_size;
-    stream.read(reinterpret_cast<char*> (&serialized_card_ram_size), sizeof(serialized_card_ram_size));
+    stream.Read(&serialized_card_ram_size, sizeof(serialized_card_ram_size));
     u32 card_ram_read_size = serialized_card_ram_size;
     if (card_ram_read_size > sizeof(m_card_ram))
         card_ram_read_size = sizeof(m_card_ram);
     m_card_ram_size = card_ram_read_size;
-    stream.read(reinterpret_cast<char*> (m_card_ram), sizeof(u8) * card_ram_read_size);
-    if (serialized_card_ram_size > card_ram_read_size)
-        stream.ignore(static_cast<streamsize>(serialized_card_ram_size - card_ram_read_size));
-
-    stream.read(reinterpret_cast<char*> (&m_card_ram_start), sizeof(m_card_ram_start));
-    stream.read(reinterpret_cast<char*> (&m_card_ram_end), sizeof(m_card_ram_end));
-    stream.read(reinterpret_cast<char*> (m_backup_ram), sizeof(u8) * 0x800);
-    stream.read(reinterpret_cast<char*> (&m_backup_ram_enabled), sizeof(m_backup_ram_enabled));
-    stream.read(reinterpret_cast<char*> (&m_io_buffer), sizeof(m_io_buffer));
-    stream.read(reinterpret_cast<char*> (&m_mpr_buffer), sizeof(m_mpr_buffer));
+    stream.ReadPages(m_card_ram, sizeof(u8) * card_ram_read_size, serialized_card_ram_size, m_card_ram_dirty);
+
+    stream.Read(&m_card_ram_start, sizeof(m_card_ram_start));
+    stream.Read(&m_card_ram_end, sizeof(m_card_ram_end));
+    stream.ReadPages(m_backup_ram, sizeof(u8) * 0x800, m_backup_ram_dirty);
+    stream.Read(&m_backup_ram_enabled, sizeof(m_backup_ram_enabled));
+    stream.Read(&m_io_buffer, sizeof(m_io_buffer));
+    stream.Read(&m_mpr_buffer, sizeof(m_mpr_buffer));
     if (IsValidPointer(m_current_mapper))
         m_current_mapper->LoadState(stream);
     ReloadMemoryMap();
@@ -99,11 +99,17 @@ public:
     MemoryBankType GetBankType(u8 bank);
     void SaveRam(std::ostream &file);
     bool LoadRam(std::istream &file, s32 file_size);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void MarkDirty(u8 bank, u16 offset);
+    void ClearDirtyPages();
+    void MarkAllPagesDirty();
+    u32 GetDirtyPageCount();
+    void SaveState(StateSerializer& stream);
+    void LoadState(StateDeserializer& stream);
 
 private:
     void ReloadMemoryMap();
+    void ReloadDirtyMap();
+    u8* GetDirtyFlags(u8* bank_memory);
     void TraceMprEvent(u8 bits, u8 index, u8 new_value);
     void LogMprEvent(u8 bits, u8 index, u8 new_value);
 #if !defined(GG_DISABLE_DISASSEMBLER)
@@ -125,11 +131,17 @@ private:
     u8 m_mpr[8];
     u8* m_memory_map[0x100] = {};
     bool m_memory_map_write[0x100] = {};
+    u8* m_memory_map_dirty[0x100] = {};
     u8 m_unused_memory[0x2000];
+    u8 m_unused_dirty[0x2000 >> GG_DIRTY_PAGE_SHIFT];
     u8 m_wram[0x8000] = {};
     u8 m_card_ram[0x30000] = {};
     u8 m_cdrom_ram[0x10000] = {};
     u8 m_backup_ram[0x2000] = {};
+    DirtyPages m_wram_dirty;
+    DirtyPages m_card_ram_dirty;
+    DirtyPages m_cdrom_ram_dirty;
+    DirtyPages m_backup_ram_dirty;
     u32 m_cdrom_ram_size;
     u32 m_card_ram_size;
     u8 m_card_ram_start;
@@ -235,12 +235,18 @@ INLINE void Memory::Write(u16 address, u8 value, bool block_transfer)
     else if (bank == 0xF7)
     {
         if (m_memory_map_write[bank] && (offset < 0x800))
+        {
             m_memory_map[bank][offset] = value;
+            m_memory_map_dirty[bank][offset >> GG_DIRTY_PAGE_SHIFT] = 1;
+        }
     }
     else if (bank != 0xFF)
     {
         if (m_memory_map_write[bank])
+        {
             m_memory_map[bank][offset] = value;
+            m_memory_map_dirty[bank][offset >> GG_DIRTY_PAGE_SHIFT] = 1;
+        }
     }
     else
     {
@@ -510,15 +516,22 @@ INLINE void Memory::UpdateBackupRam(bool enable)
         //Debug("Backup RAM enabled");
         m_memory_map_write[0xF7] = true;
         m_memory_map[0xF7] = m_backup_ram;
+        m_memory_map_dirty[0xF7] = m_backup_ram_dirty.GetFlags();
     }
     else
     {
         //Debug("Backup RAM disabled");
         m_memory_map_write[0xF7] = false;
         m_memory_map[0xF7] = m_unused_memory;
+        m_memory_map_dirty[0xF7] = m_unused_dirty;
     }
 }
 
+INLINE void Memory::MarkDirty(u8 bank, u16 offset)
+{
+    m_memory_map_dirty[bank][offset >> GG_DIRTY_PAGE_SHIFT] = 1;
+}
+
 #if !defined(GG_DISABLE_DISASSEMBLER)
 INLINE void Memory::CheckPhysicalMemoryBreakpoints(u8 bank, u32 offset, bool read)
 {
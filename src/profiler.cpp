@@ -0,0 +1,332 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <fstream>
+#include "profiler.h"
+
+#if defined(GG_ENABLE_PROFILER)
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// How long Export and Clear wait for zones still open on other threads
+#define PROFILER_DRAIN_TIMEOUT_MS 1000
+
+struct Profiler_Event
+{
+    const char* name;
+    u64 start_ns;
+    u64 duration_ns;
+};
+
+struct Profiler_Ring
+{
+    Profiler_Event events[GG_PROFILER_RING_SIZE];
+    std::atomic<u64> count;
+    std::atomic<u32> open_zones;
+    std::atomic<bool> thread_exited;
+    int thread_id;
+    char thread_name[64];
+};
+
+// Flags the ring of a thread when it exits, so Clear can free it
+struct Profiler_Ring_Owner
+{
+    Profiler_Ring* ring;
+
+    ~Profiler_Ring_Owner()
+    {
+        if (IsValidPointer(ring))
+            ring->thread_exited.store(true, std::memory_order_release);
+    }
+};
+
+static std::atomic<bool> profiler_enabled(false);
+static std::mutex profiler_mutex;
+static std::vector<Profiler_Ring*> profiler_rings;
+static int profiler_next_thread_id = 1;
+static thread_local Profiler_Ring_Owner profiler_thread_ring = { NULL };
+
+static Profiler_Ring* get_thread_ring(void);
+static void drain_zones(void);
+static void write_escaped(std::ofstream& stream, const char* text);
+
+void Profiler::SetEnabled(bool enabled)
+{
+    profiler_enabled.store(enabled, std::memory_order_release);
+}
+
+bool Profiler::IsEnabled()
+{
+    return profiler_enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    Profiler_Ring* ring = get_thread_ring();
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    strncpy_fit(ring->thread_name, name, sizeof(ring->thread_name));
+}
+
+void Profiler::Clear()
+{
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+
+    drain_zones();
+
+    size_t kept = 0;
+
+    for (size_t i = 0; i < profiler_rings.size(); i++)
+    {
+        Profiler_Ring* ring = profiler_rings[i];
+
+        if (ring->thread_exited.load(std::memory_order_acquire))
+        {
+            SafeDelete(ring);
+            continue;
+        }
+
+        ring->count.store(0, std::memory_order_relaxed);
+        profiler_rings[kept++] = ring;
+    }
+
+    profiler_rings.resize(kept);
+}
+
+bool Profiler::ExportChromeTrace(const char* path)
+{
+    std::ofstream stream;
+    open_ofstream_utf8(stream, path, std::ios::out | std::ios::binary);
+
+    if (!stream.is_open())
+    {
+        Error("Profiler: unable to open %s for writing", path);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+
+    drain_zones();
+
+    u64 origin_ns = 0;
+    for (size_t i = 0; i < profiler_rings.size(); i++)
+    {
+        Profiler_Ring* ring = profiler_rings[i];
+        u64 count = ring->count.load(std::memory_order_acquire);
+        if (count == 0)
+            continue;
+
+        u64 first = (count > GG_PROFILER_RING_SIZE) ? count - GG_PROFILER_RING_SIZE : 0;
+        u64 start_ns = ring->events[first & (GG_PROFILER_RING_SIZE - 1)].start_ns;
+        if (origin_ns == 0 || start_ns < origin_ns)
+            origin_ns = start_ns;
+    }
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    bool first_event = true;
+    char line[256];
+
+    for (size_t i = 0; i < profiler_rings.size(); i++)
+    {
+        Profiler_Ring* ring = profiler_rings[i];
+
+        stream << (first_event ? "\n" : ",\n");
+        first_event = false;
+        snprintf(line, sizeof(line), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"", ring->thread_id);
+        stream << line;
+        write_escaped(stream, ring->thread_name);
+        stream << "\"}}";
+
+        u64 count = ring->count.load(std::memory_order_acquire);
+        u64 first = (count > GG_PROFILER_RING_SIZE) ? count - GG_PROFILER_RING_SIZE : 0;
+
+        for (u64 e = first; e < count; e++)
+        {
+            const Profiler_Event& event = ring->events[e & (GG_PROFILER_RING_SIZE - 1)];
+            u64 start_ns = (event.start_ns > origin_ns) ? event.start_ns - origin_ns : 0;
+
+            stream << ",\n{\"name\":\"";
+            write_escaped(stream, event.name);
+            snprintf(line, sizeof(line), "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+                ring->thread_id,
+                (unsigned long long)(start_ns / 1000), (unsigned)(start_ns % 1000),
+                (unsigned long long)(event.duration_ns / 1000), (unsigned)(event.duration_ns % 1000));
+            stream << line;
+        }
+    }
+
+    stream << "\n]}\n";
+    stream.close();
+
+    if (!stream.good())
+    {
+        Error("Profiler: failed writing %s", path);
+        return false;
+    }
+
+    Log("Profiler: saved trace to %s", path);
+    return true;
+}
+
+u64 Profiler::Now()
+{
+    return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns the start time of a new zone, or 0 if recording stopped. The zone
+// is counted as open before the enabled flag is checked again, so a
+// drain that stopped recording either sees it open or it is never started.
+u64 Profiler::BeginZone()
+{
+    Profiler_Ring* ring = get_thread_ring();
+
+    ring->open_zones.fetch_add(1);
+
+    if (!profiler_enabled.load())
+    {
+        ring->open_zones.fetch_sub(1, std::memory_order_release);
+        return 0;
+    }
+
+    return Now();
+}
+
+void Profiler::EndZone(const char* name, u64 start_ns)
+{
+    u64 end_ns = Now();
+    Profiler_Ring* ring = get_thread_ring();
+
+    // Only the owning thread writes to its ring, publish the event after
+    // it is complete so a concurrent export never sees a partial slot
+    u64 index = ring->count.load(std::memory_order_relaxed);
+    Profiler_Event& event = ring->events[index & (GG_PROFILER_RING_SIZE - 1)];
+    event.name = name;
+    event.start_ns = start_ns;
+    event.duration_ns = end_ns - start_ns;
+    ring->count.store(index + 1, std::memory_order_release);
+
+    ring->open_zones.fetch_sub(1, std::memory_order_release);
+}
+
+static Profiler_Ring* get_thread_ring(void)
+{
+    if (IsValidPointer(profiler_thread_ring.ring))
+        return profiler_thread_ring.ring;
+
+    // Rings outlive their threads so the trace keeps finished workers
+    // until the next Clear
+    Profiler_Ring* ring = new Profiler_Ring();
+    ring->count.store(0, std::memory_order_relaxed);
+    ring->open_zones.store(0, std::memory_order_relaxed);
+    ring->thread_exited.store(false, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(profiler_mutex);
+    ring->thread_id = profiler_next_thread_id++;
+    snprintf(ring->thread_name, sizeof(ring->thread_name), "Thread %d", ring->thread_id);
+    profiler_rings.push_back(ring);
+
+    profiler_thread_ring.ring = ring;
+    return ring;
+}
+
+// Called with the mutex held. While recording, zones keep opening and
+// there is nothing to wait for.
+static void drain_zones(void)
+{
+    if (profiler_enabled.load())
+        return;
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(PROFILER_DRAIN_TIMEOUT_MS);
+
+    for (size_t i = 0; i < profiler_rings.size(); i++)
+    {
+        Profiler_Ring* ring = profiler_rings[i];
+
+        while (ring->open_zones.load() != 0)
+        {
+            if (std::chrono::steady_clock::now() > deadline)
+            {
+                Log("Profiler: %s still has open zones, they are left out", ring->thread_name);
+                break;
+            }
+
+            std::this_thread::yield();
+        }
+    }
+}
+
+static void write_escaped(std::ofstream& stream, const char* text)
+{
+    for (const char* c = text; *c != 0; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            stream << '\\';
+        if ((unsigned char)*c >= 0x20)
+            stream << *c;
+    }
+}
+
+#else
+
+void Profiler::SetEnabled(bool enabled)
+{
+    UNUSED(enabled);
+}
+
+bool Profiler::IsEnabled()
+{
+    return false;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    UNUSED(name);
+}
+
+void Profiler::Clear()
+{
+}
+
+bool Profiler::ExportChromeTrace(const char* path)
+{
+    UNUSED(path);
+    return false;
+}
+
+u64 Profiler::Now()
+{
+    return 0;
+}
+
+u64 Profiler::BeginZone()
+{
+    return 0;
+}
+
+void Profiler::EndZone(const char* name, u64 start_ns)
+{
+    UNUSED(name);
+    UNUSED(start_ns);
+}
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "common.h"
+
+#if defined(GG_ENABLE_PROFILER)
+    #define GG_PROFILE_CONCAT_INNER(a, b) a##b
+    #define GG_PROFILE_CONCAT(a, b) GG_PROFILE_CONCAT_INNER(a, b)
+    #define GG_PROFILE_ZONE(name) ProfileZone GG_PROFILE_CONCAT(gg_profile_zone_, __LINE__)(name)
+#else
+    #define GG_PROFILE_ZONE(name) do { } while (0)
+#endif
+
+#define GG_PROFILER_RING_SIZE (1 << 17)
+
+// Records scoped zones into one ring per thread, so threads never contend
+// while recording. Zone names must be string literals. Stop recording
+// before exporting or clearing: both then wait for the zones still open on
+// other threads. Clear frees the rings of threads that have exited.
+class Profiler
+{
+public:
+    static void SetEnabled(bool enabled);
+    static bool IsEnabled();
+    static void SetThreadName(const char* name);
+    static void Clear();
+    static bool ExportChromeTrace(const char* path);
+    static u64 Now();
+    static u64 BeginZone();
+    static void EndZone(const char* name, u64 start_ns);
+};
+
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name);
+    ~ProfileZone();
+
+private:
+    const char* m_name;
+    u64 m_start_ns;
+};
+
+#include "profiler_inline.h"
+
+#endif /* PROFILER_H */
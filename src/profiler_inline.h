@@ -0,0 +1,37 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef PROFILER_INLINE_H
+#define PROFILER_INLINE_H
+
+#include "profiler.h"
+
+INLINE ProfileZone::ProfileZone(const char* name)
+{
+    m_name = name;
+    m_start_ns = Profiler::IsEnabled() ? Profiler::BeginZone() : 0;
+}
+
+INLINE ProfileZone::~ProfileZone()
+{
+    if (m_start_ns != 0)
+        Profiler::EndZone(m_name, m_start_ns);
+}
+
+#endif /* PROFILER_INLINE_H */
@@ -36,15 +36,15 @@ public:
         SetState(seed);
     }
 
-    void SaveState(std::ostream& stream)
+    void SaveState(StateSerializer& stream)
     {
-        stream.write(reinterpret_cast<const char*>(&m_state), sizeof(m_state));
+        stream.Write(&m_state, sizeof(m_state));
     }
 
-    void LoadState(std::istream& stream)
+    void LoadState(StateDeserializer& stream)
     {
         u32 state;
-        stream.read(reinterpret_cast<char*>(&state), sizeof(state));
+        stream.Read(&state, sizeof(state));
         SetState(state);
     }
 
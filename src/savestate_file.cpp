@@ -0,0 +1,285 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "savestate_file.h"
+
+// Tiny chunks are not worth a deflate stream
+#define SAVESTATE_FILE_MIN_DEFLATE_SIZE 64
+// Largest chunk accepted when reading, well above any real component
+#define SAVESTATE_FILE_MAX_CHUNK_SIZE 0x2000000
+// Deflate can't expand data more than about 1032 times
+#define SAVESTATE_FILE_MAX_DEFLATE_RATIO 1032
+
+bool SaveStateFile::Encode(const u8* state, const u32* chunk_sizes, std::vector<u8>& file)
+{
+    if (!IsValidPointer(state) || !IsValidPointer(chunk_sizes))
+        return false;
+
+    u32 chunk_count = 0;
+    for (int i = 0; i < GG_SAVESTATE_CHUNK_COUNT; i++)
+        if (chunk_sizes[i] > 0)
+            chunk_count++;
+
+    Header header;
+    header.magic = GG_SAVESTATE_FILE_MAGIC;
+    header.version = GG_SAVESTATE_FILE_VERSION;
+    header.chunk_count = chunk_count;
+    header.reserved = 0;
+
+    std::vector<Chunk> toc;
+    toc.reserve(chunk_count);
+
+    size_t data_start = sizeof(Header) + (chunk_count * sizeof(Chunk));
+    file.clear();
+    file.resize(data_start);
+
+    const u8* src = state;
+
+    for (int i = 0; i < GG_SAVESTATE_CHUNK_COUNT; i++)
+    {
+        u32 raw_size = chunk_sizes[i];
+
+        if (raw_size == 0)
+            continue;
+
+        Chunk chunk;
+        chunk.id = i;
+        chunk.flags = 0;
+        chunk.offset = (u32)file.size();
+        chunk.raw_size = raw_size;
+        chunk.size = raw_size;
+
+        bool stored = false;
+
+        if (raw_size >= SAVESTATE_FILE_MIN_DEFLATE_SIZE)
+        {
+            mz_ulong compressed_size = mz_compressBound(raw_size);
+            file.resize(chunk.offset + compressed_size);
+
+            if ((mz_compress2(file.data() + chunk.offset, &compressed_size, src, raw_size, MZ_BEST_SPEED) == MZ_OK) && (compressed_size < raw_size))
+            {
+                chunk.flags = CHUNK_DEFLATE;
+                chunk.size = (u32)compressed_size;
+                file.resize(chunk.offset + compressed_size);
+                stored = true;
+            }
+        }
+
+        if (!stored)
+        {
+            file.resize(chunk.offset + raw_size);
+            memcpy(file.data() + chunk.offset, src, raw_size);
+        }
+
+        toc.push_back(chunk);
+        src += raw_size;
+    }
+
+    memcpy(file.data(), &header, sizeof(Header));
+    if (chunk_count > 0)
+        memcpy(file.data() + sizeof(Header), toc.data(), chunk_count * sizeof(Chunk));
+
+    Debug("Save state file encoded: %d bytes -> %d bytes", (int)(src - state), (int)file.size());
+
+    return true;
+}
+
+bool SaveStateFile::Decode(const u8* file, size_t size, std::vector<u8>& state)
+{
+    if (!IsChunked(file, size))
+        return false;
+
+    Header header;
+    memcpy(&header, file, sizeof(Header));
+
+    size_t toc_end = sizeof(Header) + ((size_t)header.chunk_count * sizeof(Chunk));
+
+    if (toc_end > size)
+    {
+        Error("Invalid save state file table of contents");
+        return false;
+    }
+
+    std::vector<Chunk> toc(header.chunk_count);
+    if (header.chunk_count > 0)
+        memcpy(toc.data(), file + sizeof(Header), header.chunk_count * sizeof(Chunk));
+
+    size_t state_size = 0;
+    for (u32 i = 0; i < header.chunk_count; i++)
+    {
+        if (!IsValidChunk(toc[i], size))
+        {
+            Error("Invalid save state file chunk %d", toc[i].id);
+            return false;
+        }
+        state_size += toc[i].raw_size;
+    }
+
+    state.resize(state_size);
+
+    size_t position = 0;
+    for (u32 i = 0; i < header.chunk_count; i++)
+    {
+        const Chunk& chunk = toc[i];
+
+        if (chunk.flags & CHUNK_DEFLATE)
+        {
+            if (!Inflate(file + chunk.offset, chunk.size, state.data() + position, chunk.raw_size))
+            {
+                Error("Failed to inflate save state file chunk %d", chunk.id);
+                return false;
+            }
+        }
+        else
+            memcpy(state.data() + position, file + chunk.offset, chunk.size);
+
+        position += chunk.raw_size;
+    }
+
+    return true;
+}
+
+bool SaveStateFile::IsChunked(const u8* file, size_t size)
+{
+    if (!IsValidPointer(file) || (size < sizeof(Header)))
+        return false;
+
+    Header header;
+    memcpy(&header, file, sizeof(Header));
+
+    return (header.magic == GG_SAVESTATE_FILE_MAGIC) && (header.version == GG_SAVESTATE_FILE_VERSION) && (header.chunk_count <= GG_SAVESTATE_CHUNK_COUNT);
+}
+
+bool SaveStateFile::IsChunked(std::istream& stream)
+{
+    Header header;
+
+    stream.seekg(0, std::ios::beg);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+    if (stream.fail())
+    {
+        stream.clear();
+        return false;
+    }
+
+    return IsChunked(reinterpret_cast<const u8*>(&header), sizeof(Header));
+}
+
+bool SaveStateFile::ReadChunk(std::istream& stream, u32 id, u8* buffer, u32 size)
+{
+    std::vector<Chunk> toc;
+
+    if (!ReadToc(stream, toc))
+        return false;
+
+    for (size_t i = 0; i < toc.size(); i++)
+    {
+        const Chunk& chunk = toc[i];
+
+        if (chunk.id != id)
+            continue;
+
+        if (chunk.raw_size != size)
+        {
+            Error("Invalid save state file chunk %d size: %d (expected %d)", id, chunk.raw_size, size);
+            return false;
+        }
+
+        std::vector<u8> data(chunk.size);
+        stream.seekg(chunk.offset, std::ios::beg);
+        stream.read(reinterpret_cast<char*>(data.data()), chunk.size);
+
+        if (stream.fail())
+        {
+            Error("Failed to read save state file chunk %d", id);
+            return false;
+        }
+
+        if (chunk.flags & CHUNK_DEFLATE)
+            return Inflate(data.data(), chunk.size, buffer, size);
+
+        memcpy(buffer, data.data(), size);
+        return true;
+    }
+
+    Debug("Save state file chunk %d not found", id);
+    return false;
+}
+
+bool SaveStateFile::ReadToc(std::istream& stream, std::vector<Chunk>& toc)
+{
+    Header header;
+
+    stream.seekg(0, std::ios::end);
+    std::streampos end = stream.tellg();
+    size_t file_size = (end > 0) ? static_cast<size_t>(end) : 0;
+
+    stream.seekg(0, std::ios::beg);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+    if (stream.fail() || !IsChunked(reinterpret_cast<const u8*>(&header), sizeof(Header)))
+        return false;
+
+    toc.resize(header.chunk_count);
+
+    if (header.chunk_count > 0)
+        stream.read(reinterpret_cast<char*>(toc.data()), header.chunk_count * sizeof(Chunk));
+
+    if (stream.fail())
+        return false;
+
+    for (size_t i = 0; i < toc.size(); i++)
+    {
+        if (!IsValidChunk(toc[i], file_size))
+        {
+            Error("Invalid save state file chunk %d", toc[i].id);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// A chunk must lie inside the file and inflate to a size that deflate
+// can actually produce from it, so a corrupt table of contents can't
+// make readers allocate huge buffers
+bool SaveStateFile::IsValidChunk(const Chunk& chunk, size_t file_size)
+{
+    if ((chunk.offset > file_size) || (chunk.size > (file_size - chunk.offset)))
+        return false;
+
+    if (chunk.raw_size > SAVESTATE_FILE_MAX_CHUNK_SIZE)
+        return false;
+
+    if (chunk.flags & CHUNK_DEFLATE)
+        return (u64)chunk.raw_size <= ((u64)chunk.size * SAVESTATE_FILE_MAX_DEFLATE_RATIO);
+
+    return chunk.size == chunk.raw_size;
+}
+
+bool SaveStateFile::Inflate(const u8* data, u32 size, u8* buffer, u32 raw_size)
+{
+    mz_ulong out_size = raw_size;
+
+    if (mz_uncompress(buffer, &out_size, data, size) != MZ_OK)
+        return false;
+
+    return out_size == raw_size;
+}
@@ -0,0 +1,70 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef SAVESTATE_FILE_H
+#define SAVESTATE_FILE_H
+
+#include <istream>
+#include <vector>
+#include "common.h"
+
+// On-disk container for save states. A fixed header and a table of
+// contents are followed by one chunk per component (see
+// GG_SaveState_Chunk), each deflated when that makes it smaller. Concatenating
+// the chunks in order gives back the flat state used everywhere else, and
+// a single chunk (header, screenshot) can be read without the rest.
+class SaveStateFile
+{
+public:
+    struct Header
+    {
+        u32 magic;
+        u32 version;
+        u32 chunk_count;
+        u32 reserved;
+    };
+
+    struct Chunk
+    {
+        u32 id;
+        u32 flags;
+        u32 offset;
+        u32 size;
+        u32 raw_size;
+    };
+
+    enum Chunk_Flags
+    {
+        CHUNK_DEFLATE = 0x01
+    };
+
+public:
+    static bool Encode(const u8* state, const u32* chunk_sizes, std::vector<u8>& file);
+    static bool Decode(const u8* file, size_t size, std::vector<u8>& state);
+    static bool IsChunked(const u8* file, size_t size);
+    static bool IsChunked(std::istream& stream);
+    static bool ReadChunk(std::istream& stream, u32 id, u8* buffer, u32 size);
+
+private:
+    static bool ReadToc(std::istream& stream, std::vector<Chunk>& toc);
+    static bool IsValidChunk(const Chunk& chunk, size_t file_size);
+    static bool Inflate(const u8* data, u32 size, u8* buffer, u32 raw_size);
+};
+
+#endif /* SAVESTATE_FILE_H */
@@ -833,67 +833,65 @@ u32 ScsiController::AudioLBA()
     }
 }
 
-void ScsiController::SaveState(std::ostream& stream)
+void ScsiController::SaveState(StateSerializer& stream)
 {
     using namespace std;
 
-    stream.write(reinterpret_cast<const char*> (&m_bus.db), sizeof(m_bus.db));
-    stream.write(reinterpret_cast<const char*> (&m_bus.signals), sizeof(m_bus.signals));
-    stream.write(reinterpret_cast<const char*> (&m_phase), sizeof(m_phase));
-    stream.write(reinterpret_cast<const char*> (&m_next_event), sizeof(m_next_event));
-    stream.write(reinterpret_cast<const char*> (&m_next_event_cycles), sizeof(m_next_event_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_next_load_cycles), sizeof(m_next_load_cycles));
-    stream.write(reinterpret_cast<const char*> (&m_load_sector), sizeof(m_load_sector));
-    stream.write(reinterpret_cast<const char*> (&m_load_sector_count), sizeof(m_load_sector_count));
-    stream.write(reinterpret_cast<const char*> (&m_auto_ack_cycles), sizeof(m_auto_ack_cycles));
+    stream.Write(&m_bus.db, sizeof(m_bus.db));
+    stream.Write(&m_bus.signals, sizeof(m_bus.signals));
+    stream.Write(&m_phase, sizeof(m_phase));
+    stream.Write(&m_next_event, sizeof(m_next_event));
+    stream.Write(&m_next_event_cycles, sizeof(m_next_event_cycles));
+    stream.Write(&m_next_load_cycles, sizeof(m_next_load_cycles));
+    stream.Write(&m_load_sector, sizeof(m_load_sector));
+    stream.Write(&m_load_sector_count, sizeof(m_load_sector_count));
+    stream.Write(&m_auto_ack_cycles, sizeof(m_auto_ack_cycles));
     u32 command_buffer_size = MIN((u32)m_command_buffer.size(), k_scsi_command_buffer_capacity);
-    stream.write(reinterpret_cast<const char*> (&command_buffer_size), sizeof(command_buffer_size));
+    stream.Write(&command_buffer_size, sizeof(command_buffer_size));
     if (command_buffer_size > 0)
-        stream.write(reinterpret_cast<const char*> (m_command_buffer.data()), command_buffer_size * sizeof(u8));
+        stream.Write(m_command_buffer.data(), command_buffer_size * sizeof(u8));
     if (command_buffer_size < k_scsi_command_buffer_capacity)
     {
-        stream.write(reinterpret_cast<const char*> (k_scsi_command_buffer_padding),
-                     (k_scsi_command_buffer_capacity - command_buffer_size) * sizeof(u8));
+        stream.Write(k_scsi_command_buffer_padding, (k_scsi_command_buffer_capacity - command_buffer_size) * sizeof(u8));
     }
 
     u32 data_buffer_size = MIN((u32)m_data_buffer.size(), k_scsi_data_buffer_capacity);
-    stream.write(reinterpret_cast<const char*> (&data_buffer_size), sizeof(data_buffer_size));
+    stream.Write(&data_buffer_size, sizeof(data_buffer_size));
     if (data_buffer_size > 0)
-        stream.write(reinterpret_cast<const char*> (m_data_buffer.data()), data_buffer_size * sizeof(u8));
+        stream.Write(m_data_buffer.data(), data_buffer_size * sizeof(u8));
     if (data_buffer_size < k_scsi_data_buffer_capacity)
     {
-        stream.write(reinterpret_cast<const char*> (k_scsi_data_buffer_padding),
-                     (k_scsi_data_buffer_capacity - data_buffer_size) * sizeof(u8));
+        stream.Write(k_scsi_data_buffer_padding, (k_scsi_data_buffer_capacity - data_buffer_size) * sizeof(u8));
     }
 
-    stream.write(reinterpret_cast<const char*> (&m_data_buffer_offset), sizeof(m_data_buffer_offset));
-    stream.write(reinterpret_cast<const char*> (&m_bus_changed), sizeof(m_bus_changed));
-    stream.write(reinterpret_cast<const char*> (&m_previous_signals), sizeof(m_previous_signals));
-    stream.write(reinterpret_cast<const char*> (&m_data_bus_latch), sizeof(m_data_bus_latch));
+    stream.Write(&m_data_buffer_offset, sizeof(m_data_buffer_offset));
+    stream.Write(&m_bus_changed, sizeof(m_bus_changed));
+    stream.Write(&m_previous_signals, sizeof(m_previous_signals));
+    stream.Write(&m_data_bus_latch, sizeof(m_data_bus_latch));
     u32 current_sector = m_cdrom_media->GetCurrentSector();
-    stream.write(reinterpret_cast<const char*> (&current_sector), sizeof(current_sector));
+    stream.Write(&current_sector, sizeof(current_sector));
 }
 
-void ScsiController::LoadState(std::istream& stream, int version)
+void ScsiController::LoadState(StateDeserializer& stream, int version)
 {
     using namespace std;
 
-    stream.read(reinterpret_cast<char*> (&m_bus.db), sizeof(m_bus.db));
-    stream.read(reinterpret_cast<char*> (&m_bus.signals), sizeof(m_bus.signals));
-    stream.read(reinterpret_cast<char*> (&m_phase), sizeof(m_phase));
-    stream.read(reinterpret_cast<char*> (&m_next_event), sizeof(m_next_event));
-    stream.read(reinterpret_cast<char*> (&m_next_event_cycles), sizeof(m_next_event_cycles));
-    stream.read(reinterpret_cast<char*> (&m_next_load_cycles), sizeof(m_next_load_cycles));
-    stream.read(reinterpret_cast<char*> (&m_load_sector), sizeof(m_load_sector));
-    stream.read(reinterpret_cast<char*> (&m_load_sector_count), sizeof(m_load_sector_count));
-    stream.read(reinterpret_cast<char*> (&m_auto_ack_cycles), sizeof(m_auto_ack_cycles));
+    stream.Read(&m_bus.db, sizeof(m_bus.db));
+    stream.Read(&m_bus.signals, sizeof(m_bus.signals));
+    stream.Read(&m_phase, sizeof(m_phase));
+    stream.Read(&m_next_event, sizeof(m_next_event));
+    stream.Read(&m_next_event_cycles, sizeof(m_next_event_cycles));
+    stream.Read(&m_next_load_cycles, sizeof(m_next_load_cycles));
+    stream.Read(&m_load_sector, sizeof(m_load_sector));
+    stream.Read(&m_load_sector_count, sizeof(m_load_sector_count));
+    stream.Read(&m_auto_ack_cycles, sizeof(m_auto_ack_cycles));
     u32 command_buffer_size;
-    stream.read(reinterpret_cast<char*> (&command_buffer_size), sizeof(command_buffer_size));
+    stream.Read(&command_buffer_size, sizeof(command_buffer_size));
 
     if (version >= 27)
     {
         u8 command_buffer[k_scsi_command_buffer_capacity] = {};
-        stream.read(reinterpret_cast<char*> (command_buffer), sizeof(command_buffer));
+        stream.Read(command_buffer, sizeof(command_buffer));
 
         if (command_buffer_size > k_scsi_command_buffer_capacity)
         {
@@ -907,16 +905,16 @@ void ScsiController::LoadState(std::istream& stream, int version)
     else
     {
         m_command_buffer.resize(command_buffer_size);
-        stream.read(reinterpret_cast<char*> (m_command_buffer.data()), command_buffer_size * sizeof(u8));
+        stream.Read(m_command_buffer.data(), command_buffer_size * sizeof(u8));
     }
 
     u32 data_buffer_size;
-    stream.read(reinterpret_cast<char*> (&data_buffer_size), sizeof(data_buffer_size));
+    stream.Read(&data_buffer_size, sizeof(data_buffer_size));
 
     if (version >= 27)
     {
         u8 data_buffer[k_scsi_data_buffer_capacity] = {};
-        stream.read(reinterpret_cast<char*> (data_buffer), sizeof(data_buffer));
+        stream.Read(data_buffer, sizeof(data_buffer));
 
         if (data_buffer_size > k_scsi_data_buffer_capacity)
         {
@@ -930,15 +928,15 @@ void ScsiController::LoadState(std::istream& stream, int version)
     else
     {
         m_data_buffer.resize(data_buffer_size);
-        stream.read(reinterpret_cast<char*> (m_data_buffer.data()), data_buffer_size * sizeof(u8));
+        stream.Read(m_data_buffer.data(), data_buffer_size * sizeof(u8));
     }
 
-    stream.read(reinterpret_cast<char*> (&m_data_buffer_offset), sizeof(m_data_buffer_offset));
-    stream.read(reinterpret_cast<char*> (&m_bus_changed), sizeof(m_bus_changed));
-    stream.read(reinterpret_cast<char*> (&m_previous_signals), sizeof(m_previous_signals));
-    stream.read(reinterpret_cast<char*> (&m_data_bus_latch), sizeof(m_data_bus_latch));
+    stream.Read(&m_data_buffer_offset, sizeof(m_data_buffer_offset));
+    stream.Read(&m_bus_changed, sizeof(m_bus_changed));
+    stream.Read(&m_previous_signals, sizeof(m_previous_signals));
+    stream.Read(&m_data_bus_latch, sizeof(m_data_bus_latch));
     u32 current_sector;
-    stream.read(reinterpret_cast<char*> (&current_sector), sizeof(current_sector));
+    stream.Read(&current_sector, sizeof(current_sector));
 
     u32 max_data_buffer_offset = m_data_buffer.empty() ?
         k_scsi_data_buffer_capacity : (u32)m_data_buffer.size();
@@ -123,19 +123,19 @@ void SF2Mapper::Reset()
     m_bank_address = 0;
 }
 
-void SF2Mapper::SaveState(std::ostream& stream)
+void SF2Mapper::SaveState(StateSerializer& stream)
 {
     using namespace std;
-    stream.write(reinterpret_cast<const char*> (&m_bank), sizeof(m_bank));
-    stream.write(reinterpret_cast<const char*> (&m_bank_address), sizeof(m_bank_address));
+    stream.Write(&m_bank, sizeof(m_bank));
+    stream.Write(&m_bank_address, sizeof(m_bank_address));
 
 }
 
-void SF2Mapper::LoadState(std::istream& stream)
+void SF2Mapper::LoadState(StateDeserializer& stream)
 {
     using namespace std;
-    stream.read(reinterpret_cast<char*> (&m_bank), sizeof(m_bank));
-    stream.read(reinterpret_cast<char*> (&m_bank_address), sizeof(m_bank_address));
+    stream.Read(&m_bank, sizeof(m_bank));
+    stream.Read(&m_bank_address, sizeof(m_bank_address));
     m_bank &= 0x0F;
     m_bank_address = ComputeBankAddress(m_bank);
 }
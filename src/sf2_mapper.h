@@ -37,8 +37,8 @@ public:
     bool GetROMPhysicalAddress(u8 bank, u16 address, u32& rom_address);
     virtual void Write(u8 bank, u16 address, u8 value);
     virtual void Reset();
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream);
+    virtual void SaveState(StateSerializer& stream);
+    virtual void LoadState(StateDeserializer& stream);
     void SetTraceLogger(TraceLogger* trace_logger);
 
 private:
@@ -0,0 +1,278 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef STATE_SERIALIZER_H
+#define STATE_SERIALIZER_H
+
+#include <string.h>
+#include "types.h"
+#include "defines.h"
+#include "dirty_pages.h"
+#include "xxhash.h"
+
+// Flat binary writer for save states. Every Write is a bounds check and a
+// memcpy into the caller's buffer. With a NULL buffer nothing is copied and
+// only the size is accumulated, which gives the exact size of a state.
+// With hashing enabled every Write also feeds the data to an XXH64 stream,
+// so a NULL buffer writer fingerprints a state in place without copying it.
+// Incremental writers emit only the dirty pages of arrays written with
+// WritePages, preceded by a bitmap of the pages that follow.
+class StateSerializer
+{
+public:
+    StateSerializer(u8* buffer, size_t capacity, bool incremental = false)
+    {
+        m_buffer = buffer;
+        m_capacity = capacity;
+        m_position = 0;
+        m_fail = false;
+        m_incremental = incremental;
+        m_hashing = false;
+    }
+
+    void Write(const void* data, size_t size)
+    {
+        if (m_hashing)
+            m_hash.Update(data, size);
+
+        if (m_buffer != NULL)
+        {
+            if (m_fail || (size > m_capacity - m_position))
+            {
+                m_fail = true;
+                return;
+            }
+
+            memcpy(m_buffer + m_position, data, size);
+        }
+
+        m_position += size;
+    }
+
+    void WritePages(const void* data, size_t size, DirtyPages& pages)
+    {
+        if (!m_incremental)
+        {
+            Write(data, size);
+            return;
+        }
+
+        const u8* src = static_cast<const u8*>(data);
+        u32 page_count = (u32)((size + GG_DIRTY_PAGE_SIZE - 1) >> GG_DIRTY_PAGE_SHIFT);
+
+        for (u32 i = 0; i < page_count; i += 8)
+        {
+            u8 bits = 0;
+            for (u32 j = i; (j < i + 8) && (j < page_count); j++)
+                bits |= (pages.IsDirty(j) ? 1 : 0) << (j - i);
+            Write(&bits, 1);
+        }
+
+        for (u32 i = 0; i < page_count; i++)
+        {
+            if (!pages.IsDirty(i))
+                continue;
+
+            size_t offset = (size_t)i << GG_DIRTY_PAGE_SHIFT;
+            size_t page_size = size - offset;
+            if (page_size > GG_DIRTY_PAGE_SIZE)
+                page_size = GG_DIRTY_PAGE_SIZE;
+            Write(src + offset, page_size);
+        }
+    }
+
+    size_t GetSize() const
+    {
+        return m_position;
+    }
+
+    bool IsIncremental() const
+    {
+        return m_incremental;
+    }
+
+    bool HasFailed() const
+    {
+        return m_fail;
+    }
+
+    void EnableHash(bool enabled)
+    {
+        m_hashing = enabled;
+        m_hash.Reset();
+    }
+
+    bool IsHashing() const
+    {
+        return m_hashing;
+    }
+
+    // Returns the hash of everything written since the last call
+    u64 TakeHash()
+    {
+        u64 hash = m_hash.Digest();
+        m_hash.Reset();
+        return hash;
+    }
+
+private:
+    u8* m_buffer;
+    size_t m_capacity;
+    size_t m_position;
+    bool m_fail;
+    bool m_incremental;
+    bool m_hashing;
+    XXH64Stream m_hash;
+};
+
+// Flat binary reader for save states. Reading past the end zero fills the
+// destination and flags the reader as failed. Arrays read with ReadPages
+// are marked dirty wherever their contents were replaced.
+class StateDeserializer
+{
+public:
+    StateDeserializer(const u8* buffer, size_t size, bool incremental = false)
+    {
+        m_buffer = buffer;
+        m_size = size;
+        m_position = 0;
+        m_fail = false;
+        m_incremental = incremental;
+    }
+
+    void Read(void* data, size_t size)
+    {
+        if (m_fail || (size > m_size - m_position))
+        {
+            memset(data, 0, size);
+            m_fail = true;
+            return;
+        }
+
+        memcpy(data, m_buffer + m_position, size);
+        m_position += size;
+    }
+
+    void ReadPages(void* data, size_t size, DirtyPages& pages)
+    {
+        ReadPages(data, size, size, pages);
+    }
+
+    // Reads an array that was saved with stored_size bytes. Only the first
+    // size bytes are kept, the rest of the stored array is skipped.
+    void ReadPages(void* data, size_t size, size_t stored_size, DirtyPages& pages)
+    {
+        if (size > stored_size)
+            size = stored_size;
+
+        if (!m_incremental)
+        {
+            Read(data, size);
+            Skip(stored_size - size);
+            pages.MarkAll();
+            return;
+        }
+
+        u8* dst = static_cast<u8*>(data);
+        u32 page_count = (u32)((stored_size + GG_DIRTY_PAGE_SIZE - 1) >> GG_DIRTY_PAGE_SHIFT);
+        u32 bitmap_size = (page_count + 7) >> 3;
+
+        if (m_fail || (bitmap_size > m_size - m_position))
+        {
+            m_fail = true;
+            return;
+        }
+
+        const u8* bitmap = m_buffer + m_position;
+        m_position += bitmap_size;
+
+        for (u32 i = 0; i < page_count; i++)
+        {
+            if (!(bitmap[i >> 3] & (1 << (i & 7))))
+                continue;
+
+            size_t offset = (size_t)i << GG_DIRTY_PAGE_SHIFT;
+            size_t page_size = stored_size - offset;
+            if (page_size > GG_DIRTY_PAGE_SIZE)
+                page_size = GG_DIRTY_PAGE_SIZE;
+            size_t keep_size = (offset < size) ? size - offset : 0;
+            if (keep_size > page_size)
+                keep_size = page_size;
+
+            if (keep_size > 0)
+            {
+                Read(dst + offset, keep_size);
+                pages.Mark((u32)offset);
+            }
+
+            Skip(page_size - keep_size);
+        }
+    }
+
+    void Skip(size_t size)
+    {
+        if (m_fail || (size > m_size - m_position))
+        {
+            m_fail = true;
+            return;
+        }
+
+        m_position += size;
+    }
+
+    void Seek(size_t position)
+    {
+        if (position > m_size)
+        {
+            m_fail = true;
+            return;
+        }
+
+        m_position = position;
+    }
+
+    size_t GetPosition() const
+    {
+        return m_position;
+    }
+
+    size_t GetSize() const
+    {
+        return m_size;
+    }
+
+    bool IsIncremental() const
+    {
+        return m_incremental;
+    }
+
+    bool HasFailed() const
+    {
+        return m_fail;
+    }
+
+private:
+    const u8* m_buffer;
+    size_t m_size;
+    size_t m_position;
+    bool m_fail;
+    bool m_incremental;
+};
+
+#endif /* STATE_SERIALIZER_H */
@@ -40,6 +40,36 @@ struct GG_Runtime_Info
     int width_scale;
 };
 
+enum GG_Perf_Subsystem
+{
+    GG_PERF_CPU = 0,
+    GG_PERF_VIDEO,
+    GG_PERF_AUDIO,
+    GG_PERF_CDROM,
+    GG_PERF_SUBSYSTEM_COUNT
+};
+
+// Hot-path counters for one emulated frame, only collected when the core
+// is built with GG_ENABLE_PERF_COUNTERS. Host times of the clocked
+// subsystems are sampled and scaled, CPU time is the remainder of the frame.
+struct GG_Perf_Counters
+{
+    u32 frame;
+    u64 instructions;
+    u64 master_cycles;
+    u64 clock_hardware_calls;
+    u64 clock_hardware_slow_steps;
+    u64 vram_dma_words;
+    u64 satb_dma_words;
+    u64 psg_sync_calls;
+    u64 psg_sync_cycles;
+    u64 cd_sector_reads;
+    u64 cd_cache_hits;
+    u64 cd_cache_misses;
+    u64 frame_host_ns;
+    u64 host_ns[GG_PERF_SUBSYSTEM_COUNT];
+};
+
 enum GG_Console_Type
 {
     GG_CONSOLE_AUTO = 0,
@@ -110,6 +140,48 @@ enum GG_Controllers
     GG_CONTROLLER_5 = 4
 };
 
+enum GG_Audio_Stem
+{
+    GG_AUDIO_STEM_PSG_1 = 0,
+    GG_AUDIO_STEM_PSG_2,
+    GG_AUDIO_STEM_PSG_3,
+    GG_AUDIO_STEM_PSG_4,
+    GG_AUDIO_STEM_PSG_5,
+    GG_AUDIO_STEM_PSG_6,
+    GG_AUDIO_STEM_ADPCM,
+    GG_AUDIO_STEM_CDROM,
+    GG_AUDIO_STEM_COUNT
+};
+
+enum GG_SaveState_Chunk
+{
+    GG_SAVESTATE_CHUNK_CLOCK = 0,
+    GG_SAVESTATE_CHUNK_MEMORY,
+    GG_SAVESTATE_CHUNK_HUC6202,
+    GG_SAVESTATE_CHUNK_HUC6260,
+    GG_SAVESTATE_CHUNK_HUC6270_1,
+    GG_SAVESTATE_CHUNK_HUC6270_2,
+    GG_SAVESTATE_CHUNK_HUC6280,
+    GG_SAVESTATE_CHUNK_AUDIO,
+    GG_SAVESTATE_CHUNK_INPUT,
+    GG_SAVESTATE_CHUNK_CDROM,
+    GG_SAVESTATE_CHUNK_SCSI,
+    GG_SAVESTATE_CHUNK_CDROM_AUDIO,
+    GG_SAVESTATE_CHUNK_ADPCM,
+    GG_SAVESTATE_CHUNK_RANDOM,
+    GG_SAVESTATE_CHUNK_SCREENSHOT,
+    GG_SAVESTATE_CHUNK_HEADER,
+    GG_SAVESTATE_CHUNK_COUNT
+};
+
+// Fingerprint of a core state, with one hash per component indexed by
+// GG_SaveState_Chunk. Components missing from the state hash to 0.
+struct GG_State_Hash
+{
+    u64 total;
+    u64 components[GG_SAVESTATE_CHUNK_COUNT];
+};
+
 struct GG_SaveState_Header
 {
     u32 magic;
@@ -21,6 +21,7 @@
 #include "common.h"
 #include "log.h"
 #include <cstring>
+#include <cctype>
 
 VgmRecorder::VgmRecorder()
 {
@@ -29,6 +30,11 @@ VgmRecorder::VgmRecorder()
     m_total_samples = 0;
     m_clock_rate = 0;
     m_huc6280_used = false;
+    m_flush_quit = false;
+    m_compressed = false;
+    m_compressor = NULL;
+    m_data_crc = 0;
+    m_data_size = 0;
 }
 
 VgmRecorder::~VgmRecorder()
@@ -47,13 +53,55 @@ void VgmRecorder::Start(const char* file_path, int clock_rate, const VgmMetadata
     m_file_path = file_path;
     m_metadata = metadata;
     m_clock_rate = clock_rate;
-    m_recording = true;
     m_pending_wait = 0;
     m_total_samples = 0;
     m_huc6280_used = false;
+    m_data_size = 0;
+
+    size_t length = m_file_path.length();
+    m_compressed = (length > 4) &&
+        (m_file_path[length - 4] == '.') &&
+        (tolower(m_file_path[length - 3]) == 'v') &&
+        (tolower(m_file_path[length - 2]) == 'g') &&
+        (tolower(m_file_path[length - 1]) == 'z');
+
+    m_file.open(m_file_path.c_str(), std::ios::binary | std::ios::trunc);
+
+    if (!m_file.is_open())
+    {
+        Log("VGM: Unable to open %s", file_path);
+        return;
+    }
+
+    // Reserve room for the header, it is written on Stop once sizes are known
+    u8 header[VGM_RECORDER_HEADER_SIZE];
+    memset(header, 0, VGM_RECORDER_HEADER_SIZE);
+    m_data_crc = (u32)mz_crc32(MZ_CRC32_INIT, header, VGM_RECORDER_HEADER_SIZE);
+
+    if (m_compressed)
+    {
+        // The .vgz file is a single gzip stream. The VGM header goes first in
+        // a stored block, so it can be rewritten in place, followed by the
+        // deflated blocks of the command stream
+        WriteGzipHeader(header);
+
+        tdefl_compressor* compressor = tdefl_compressor_alloc();
+        tdefl_init(compressor, PutCompressedData, this, tdefl_create_comp_flags_from_zip_params(MZ_DEFAULT_LEVEL, -MZ_DEFAULT_WINDOW_BITS, MZ_DEFAULT_STRATEGY));
+        m_compressor = compressor;
+    }
+    else
+    {
+        m_file.write(reinterpret_cast<const char*>(header), VGM_RECORDER_HEADER_SIZE);
+    }
+
     m_command_buffer.clear();
-    
-    Log("VGM: Start recording, clock_rate=%d (0x%08X)", clock_rate, clock_rate);
+    m_command_buffer.reserve(VGM_RECORDER_BUFFER_SIZE + 16);
+    m_flush_queue.clear();
+    m_flush_quit = false;
+    m_flush_thread = std::thread(&VgmRecorder::FlushThread, this);
+    m_recording = true;
+
+    Log("VGM: Start recording, clock_rate=%d (0x%08X)%s", clock_rate, clock_rate, m_compressed ? ", compressed" : "");
 }
 
 void VgmRecorder::Stop()
@@ -69,101 +117,209 @@ void VgmRecorder::Stop()
     std::vector<u8> gd3_tag;
     BuildGD3Tag(gd3_tag, m_metadata);
 
-    std::ofstream file(m_file_path.c_str(), std::ios::binary);
-    if (file.is_open())
+    u32 gd3_offset = VGM_RECORDER_HEADER_SIZE + m_data_size + (u32)m_command_buffer.size();
+    m_command_buffer.insert(m_command_buffer.end(), gd3_tag.begin(), gd3_tag.end());
+    Flush();
+
     {
-        u8 header[256];
-        memset(header, 0, 256);
-
-        // File identification "Vgm " (0x56 0x67 0x6d 0x20)
-        header[0x00] = 0x56;
-        header[0x01] = 0x67;
-        header[0x02] = 0x6d;
-        header[0x03] = 0x20;
-
-        // EOF offset (file length - 4)
-        u32 gd3_offset = 256 + (u32)m_command_buffer.size();
-        u32 eof_offset = gd3_offset + (u32)gd3_tag.size() - 4;
-        header[0x04] = (eof_offset >> 0) & 0xFF;
-        header[0x05] = (eof_offset >> 8) & 0xFF;
-        header[0x06] = (eof_offset >> 16) & 0xFF;
-        header[0x07] = (eof_offset >> 24) & 0xFF;
-
-        // Version number (1.61 = 0x00000161)
-        header[0x08] = 0x61;
-        header[0x09] = 0x01;
-        header[0x0A] = 0x00;
-        header[0x0B] = 0x00;
-
-        // SN76489 clock (not used, set to 0)
-        header[0x0C] = 0x00;
-        header[0x0D] = 0x00;
-        header[0x0E] = 0x00;
-        header[0x0F] = 0x00;
-
-        // GD3 offset (relative from 0x14)
-        u32 gd3_relative_offset = gd3_offset - 0x14;
-        header[0x14] = (gd3_relative_offset >> 0) & 0xFF;
-        header[0x15] = (gd3_relative_offset >> 8) & 0xFF;
-        header[0x16] = (gd3_relative_offset >> 16) & 0xFF;
-        header[0x17] = (gd3_relative_offset >> 24) & 0xFF;
-
-        // Total # samples
-        header[0x18] = (m_total_samples >> 0) & 0xFF;
-        header[0x19] = (m_total_samples >> 8) & 0xFF;
-        header[0x1A] = (m_total_samples >> 16) & 0xFF;
-        header[0x1B] = (m_total_samples >> 24) & 0xFF;
-
-        // Loop offset (0 = no loop)
-        header[0x1C] = 0x00;
-        header[0x1D] = 0x00;
-        header[0x1E] = 0x00;
-        header[0x1F] = 0x00;
-
-        // Loop # samples (0 = no loop)
-        header[0x20] = 0x00;
-        header[0x21] = 0x00;
-        header[0x22] = 0x00;
-        header[0x23] = 0x00;
-
-        // Rate (60Hz for NTSC)
-        u32 rate = 60;
-        header[0x24] = (rate >> 0) & 0xFF;
-        header[0x25] = (rate >> 8) & 0xFF;
-        header[0x26] = (rate >> 16) & 0xFF;
-        header[0x27] = (rate >> 24) & 0xFF;
-
-        // VGM data offset (relative from 0x34)
-        // Data starts at 0x100 (256 bytes), so offset from 0x34 is 0x100 - 0x34 = 0xCC
-        header[0x34] = 0xCC;
-        header[0x35] = 0x00;
-        header[0x36] = 0x00;
-        header[0x37] = 0x00;
-
-        // HuC6280 clock (offset 0xA4)
-        u32 huc6280_clock = m_clock_rate;
-        header[0xA4] = (huc6280_clock >> 0) & 0xFF;
-        header[0xA5] = (huc6280_clock >> 8) & 0xFF;
-        header[0xA6] = (huc6280_clock >> 16) & 0xFF;
-        header[0xA7] = (huc6280_clock >> 24) & 0xFF;
-        
-        Log("VGM: Stop recording, clock_rate=%d (0x%08X), total_samples=%d", m_clock_rate, m_clock_rate, m_total_samples);
-        Log("VGM: Header bytes at 0xA4: %02X %02X %02X %02X", header[0xA4], header[0xA5], header[0xA6], header[0xA7]);
-
-        // Write header
-        file.write(reinterpret_cast<const char*>(header), 256);
-
-        // Write command buffer
-        file.write(reinterpret_cast<const char*>(&m_command_buffer[0]), m_command_buffer.size());
-
-        // Write GD3 tag
-        file.write(reinterpret_cast<const char*>(&gd3_tag[0]), gd3_tag.size());
-
-        file.close();
+        std::lock_guard<std::mutex> lock(m_flush_mutex);
+        m_flush_quit = true;
     }
 
+    m_flush_condition.notify_all();
+
+    if (m_flush_thread.joinable())
+        m_flush_thread.join();
+
+    if (m_compressed)
+    {
+        tdefl_compressor* compressor = (tdefl_compressor*)m_compressor;
+        tdefl_compress_buffer(compressor, NULL, 0, TDEFL_FINISH);
+        tdefl_compressor_free(compressor);
+        m_compressor = NULL;
+    }
+
+    WriteHeader(gd3_offset, gd3_offset + (u32)gd3_tag.size() - 4);
+
+    m_file.close();
     m_recording = false;
     m_command_buffer.clear();
+    m_free_buffers.clear();
+}
+
+void VgmRecorder::WriteHeader(u32 gd3_offset, u32 eof_offset)
+{
+    u8 header[VGM_RECORDER_HEADER_SIZE];
+    memset(header, 0, VGM_RECORDER_HEADER_SIZE);
+
+    // File identification "Vgm " (0x56 0x67 0x6d 0x20)
+    header[0x00] = 0x56;
+    header[0x01] = 0x67;
+    header[0x02] = 0x6d;
+    header[0x03] = 0x20;
+
+    // EOF offset (file length - 4)
+    write_u32_le(header + 0x04, eof_offset);
+
+    // Version number (1.61 = 0x00000161)
+    write_u32_le(header + 0x08, 0x00000161);
+
+    // SN76489 clock (not used, set to 0)
+    write_u32_le(header + 0x0C, 0);
+
+    // GD3 offset (relative from 0x14)
+    write_u32_le(header + 0x14, gd3_offset - 0x14);
+
+    // Total # samples
+    write_u32_le(header + 0x18, (u32)m_total_samples);
+
+    // Loop offset (0 = no loop)
+    write_u32_le(header + 0x1C, 0);
+
+    // Loop # samples (0 = no loop)
+    write_u32_le(header + 0x20, 0);
+
+    // Rate (60Hz for NTSC)
+    write_u32_le(header + 0x24, 60);
+
+    // VGM data offset (relative from 0x34)
+    // Data starts at 0x100 (256 bytes), so offset from 0x34 is 0x100 - 0x34 = 0xCC
+    write_u32_le(header + 0x34, 0xCC);
+
+    // HuC6280 clock (offset 0xA4)
+    write_u32_le(header + 0xA4, (u32)m_clock_rate);
+
+    Log("VGM: Stop recording, clock_rate=%d (0x%08X), total_samples=%d", m_clock_rate, m_clock_rate, m_total_samples);
+
+    if (m_compressed)
+    {
+        u8 trailer[8];
+        write_u32_le(trailer, GzipCrc(header));
+        write_u32_le(trailer + 4, VGM_RECORDER_HEADER_SIZE + m_data_size);
+        m_file.write(reinterpret_cast<const char*>(trailer), 8);
+
+        m_file.seekp(0, std::ios::beg);
+        WriteGzipHeader(header);
+    }
+    else
+    {
+        m_file.seekp(0, std::ios::beg);
+        m_file.write(reinterpret_cast<const char*>(header), VGM_RECORDER_HEADER_SIZE);
+    }
+}
+
+void VgmRecorder::WriteGzipHeader(const u8* header)
+{
+    // gzip header and a non final stored deflate block with the VGM header
+    u8 start[10 + 5 + VGM_RECORDER_HEADER_SIZE] = { 0x1F, 0x8B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF };
+    u8* block = start + 10;
+
+    block[0] = 0x00;
+    write_u16_le(block + 1, VGM_RECORDER_HEADER_SIZE);
+    write_u16_le(block + 3, (u16)~VGM_RECORDER_HEADER_SIZE);
+    memcpy(block + 5, header, VGM_RECORDER_HEADER_SIZE);
+
+    m_file.write(reinterpret_cast<const char*>(start), sizeof(start));
+}
+
+// The running crc covers the placeholder header, which is all zeros, and
+// the data. CRC32 is affine, so for messages of the same length
+// crc(a ^ b ^ c) = crc(a) ^ crc(b) ^ crc(c). With a = placeholder + data,
+// b = header + zeros and c = placeholder + zeros, a ^ b ^ c is the final
+// header followed by the data.
+u32 VgmRecorder::GzipCrc(const u8* header)
+{
+    u8 zeros[VGM_RECORDER_HEADER_SIZE];
+    memset(zeros, 0, sizeof(zeros));
+
+    u32 header_crc = (u32)mz_crc32(MZ_CRC32_INIT, header, VGM_RECORDER_HEADER_SIZE);
+    u32 zeros_crc = (u32)mz_crc32(MZ_CRC32_INIT, zeros, VGM_RECORDER_HEADER_SIZE);
+
+    for (u32 remaining = m_data_size; remaining > 0; )
+    {
+        u32 count = MIN(remaining, (u32)VGM_RECORDER_HEADER_SIZE);
+        header_crc = (u32)mz_crc32(header_crc, zeros, count);
+        zeros_crc = (u32)mz_crc32(zeros_crc, zeros, count);
+        remaining -= count;
+    }
+
+    return m_data_crc ^ header_crc ^ zeros_crc;
+}
+
+// Hands the command buffer to the worker without waiting for it, so the
+// emulation thread never blocks on compression or disk writes
+void VgmRecorder::Flush()
+{
+    if (m_command_buffer.empty())
+        return;
+
+    m_data_size += (u32)m_command_buffer.size();
+
+    {
+        std::lock_guard<std::mutex> lock(m_flush_mutex);
+        m_flush_queue.push_back(std::vector<u8>());
+        m_flush_queue.back().swap(m_command_buffer);
+
+        if (!m_free_buffers.empty())
+        {
+            m_command_buffer.swap(m_free_buffers.back());
+            m_free_buffers.pop_back();
+        }
+    }
+
+    m_command_buffer.clear();
+    m_command_buffer.reserve(VGM_RECORDER_BUFFER_SIZE + 16);
+    m_flush_condition.notify_all();
+}
+
+void VgmRecorder::FlushThread()
+{
+    std::vector<u8> buffer;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_flush_mutex);
+
+            if (!buffer.empty())
+            {
+                buffer.clear();
+                m_free_buffers.push_back(std::vector<u8>());
+                m_free_buffers.back().swap(buffer);
+            }
+
+            m_flush_condition.wait(lock, [this] { return !m_flush_queue.empty() || m_flush_quit; });
+
+            if (m_flush_queue.empty())
+                break;
+
+            buffer.swap(m_flush_queue.front());
+            m_flush_queue.pop_front();
+        }
+
+        WriteBlock(buffer.data(), buffer.size());
+    }
+}
+
+void VgmRecorder::WriteBlock(const u8* data, size_t size)
+{
+    if (size == 0)
+        return;
+
+    if (m_compressed)
+    {
+        m_data_crc = (u32)mz_crc32(m_data_crc, data, size);
+        tdefl_compress_buffer((tdefl_compressor*)m_compressor, data, size, TDEFL_NO_FLUSH);
+    }
+    else
+        m_file.write(reinterpret_cast<const char*>(data), size);
+}
+
+int VgmRecorder::PutCompressedData(const void* data, int size, void* user)
+{
+    VgmRecorder* recorder = (VgmRecorder*)user;
+    recorder->m_file.write(reinterpret_cast<const char*>(data), size);
+    return 1;
 }
 
 void VgmRecorder::WriteHuC6280(u16 address, u8 data)
@@ -189,24 +345,6 @@ void VgmRecorder::WriteHuC6280(u16 address, u8 data)
     }
 }
 
-void VgmRecorder::WriteCommand(u8 command)
-{
-    m_command_buffer.push_back(command);
-}
-
-void VgmRecorder::WriteCommand(u8 command, u8 data)
-{
-    m_command_buffer.push_back(command);
-    m_command_buffer.push_back(data);
-}
-
-void VgmRecorder::WriteCommand(u8 command, u8 data1, u8 data2)
-{
-    m_command_buffer.push_back(command);
-    m_command_buffer.push_back(data1);
-    m_command_buffer.push_back(data2);
-}
-
 void VgmRecorder::WriteWait(int samples)
 {
     if (samples <= 0)
@@ -235,17 +373,13 @@ void VgmRecorder::WriteWait(int samples)
         else if (samples <= 65535)
         {
             // 0x61 nn nn - Wait n samples
-            WriteCommand(0x61);
-            m_command_buffer.push_back(samples & 0xFF);
-            m_command_buffer.push_back((samples >> 8) & 0xFF);
+            WriteCommand(0x61, samples & 0xFF, (samples >> 8) & 0xFF);
             samples = 0;
         }
         else
         {
             // Write maximum wait and continue
-            WriteCommand(0x61);
-            m_command_buffer.push_back(0xFF);
-            m_command_buffer.push_back(0xFF);
+            WriteCommand(0x61, 0xFF, 0xFF);
             samples -= 65535;
         }
     }
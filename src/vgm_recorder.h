@@ -22,8 +22,15 @@
 
 #include "types.h"
 #include <vector>
+#include <deque>
 #include <string>
 #include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#define VGM_RECORDER_BUFFER_SIZE 0x10000
+#define VGM_RECORDER_HEADER_SIZE 256
 
 struct VgmMetadata
 {
@@ -47,6 +54,13 @@ public:
    
 
 private:
+    void Flush();
+    void FlushThread();
+    void WriteBlock(const u8* data, size_t size);
+    void WriteHeader(u32 gd3_offset, u32 eof_offset);
+    void WriteGzipHeader(const u8* header);
+    u32 GzipCrc(const u8* header);
+    static int PutCompressedData(const void* data, int size, void* user);
     void WriteCommand(u8 command);
     void WriteCommand(u8 command, u8 data);
     void WriteCommand(u8 command, u8 data1, u8 data2);
@@ -62,12 +76,50 @@ private:
     std::string m_file_path;
     VgmMetadata m_metadata;
     std::vector<u8> m_command_buffer;
+    std::deque<std::vector<u8> > m_flush_queue;
+    std::vector<std::vector<u8> > m_free_buffers;
+    std::ofstream m_file;
+    std::mutex m_flush_mutex;
+    std::condition_variable m_flush_condition;
+    std::thread m_flush_thread;
+    bool m_flush_quit;
+    bool m_compressed;
+    void* m_compressor;
+    u32 m_data_crc;
+    u32 m_data_size;
     int m_pending_wait;
     int m_total_samples;
     int m_clock_rate;
     bool m_huc6280_used;
 };
 
+inline void VgmRecorder::WriteCommand(u8 command)
+{
+    m_command_buffer.push_back(command);
+
+    if (m_command_buffer.size() >= VGM_RECORDER_BUFFER_SIZE)
+        Flush();
+}
+
+inline void VgmRecorder::WriteCommand(u8 command, u8 data)
+{
+    m_command_buffer.push_back(command);
+    m_command_buffer.push_back(data);
+
+    if (m_command_buffer.size() >= VGM_RECORDER_BUFFER_SIZE)
+        Flush();
+}
+
+inline void VgmRecorder::WriteCommand(u8 command, u8 data1, u8 data2)
+{
+    m_command_buffer.push_back(command);
+    m_command_buffer.push_back(data1);
+    m_command_buffer.push_back(data2);
+
+    if (m_command_buffer.size() >= VGM_RECORDER_BUFFER_SIZE)
+        Flush();
+}
+
 inline void VgmRecorder::UpdateTiming()
 {
     if (!m_recording)
@@ -0,0 +1,228 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef XXHASH_H
+#define XXHASH_H
+
+#include <string.h>
+#include "types.h"
+#include "defines.h"
+
+// Self-contained XXH64, used to fingerprint frames and emulator state. The
+// output matches the reference implementation on little and big endian hosts.
+
+#define XXH64_PRIME_1 0x9E3779B185EBCA87ULL
+#define XXH64_PRIME_2 0xC2B2AE3D27D4EB4FULL
+#define XXH64_PRIME_3 0x165667B19E3779F9ULL
+#define XXH64_PRIME_4 0x85EBCA77C2B2AE63ULL
+#define XXH64_PRIME_5 0x27D4EB2F165667C5ULL
+
+static INLINE u64 XXH64Rotl(u64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static INLINE u64 XXH64Read64(const u8* p)
+{
+    return (u64)p[0] | ((u64)p[1] << 8) | ((u64)p[2] << 16) | ((u64)p[3] << 24) |
+           ((u64)p[4] << 32) | ((u64)p[5] << 40) | ((u64)p[6] << 48) | ((u64)p[7] << 56);
+}
+
+static INLINE u32 XXH64Read32(const u8* p)
+{
+    return (u32)p[0] | ((u32)p[1] << 8) | ((u32)p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static INLINE u64 XXH64Round(u64 acc, u64 input)
+{
+    acc += input * XXH64_PRIME_2;
+    acc = XXH64Rotl(acc, 31);
+    return acc * XXH64_PRIME_1;
+}
+
+static INLINE u64 XXH64MergeRound(u64 acc, u64 value)
+{
+    acc ^= XXH64Round(0, value);
+    return (acc * XXH64_PRIME_1) + XXH64_PRIME_4;
+}
+
+// Mixes in the last bytes, fewer than 32, and avalanches the result
+static inline u64 XXH64Finalize(u64 hash, const u8* p, size_t size)
+{
+    const u8* end = p + size;
+
+    while ((p + 8) <= end)
+    {
+        hash ^= XXH64Round(0, XXH64Read64(p));
+        hash = (XXH64Rotl(hash, 27) * XXH64_PRIME_1) + XXH64_PRIME_4;
+        p += 8;
+    }
+
+    if ((p + 4) <= end)
+    {
+        hash ^= (u64)XXH64Read32(p) * XXH64_PRIME_1;
+        hash = (XXH64Rotl(hash, 23) * XXH64_PRIME_2) + XXH64_PRIME_3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        hash ^= (*p) * XXH64_PRIME_5;
+        hash = XXH64Rotl(hash, 11) * XXH64_PRIME_1;
+        p++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= XXH64_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= XXH64_PRIME_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+static inline u64 CalculateXXH64(const void* data, size_t size, u64 seed = 0)
+{
+    const u8* p = (const u8*)data;
+    const u8* end = p + size;
+    u64 hash;
+
+    if (size >= 32)
+    {
+        const u8* limit = end - 32;
+        u64 v1 = seed + XXH64_PRIME_1 + XXH64_PRIME_2;
+        u64 v2 = seed + XXH64_PRIME_2;
+        u64 v3 = seed;
+        u64 v4 = seed - XXH64_PRIME_1;
+
+        do
+        {
+            v1 = XXH64Round(v1, XXH64Read64(p));
+            v2 = XXH64Round(v2, XXH64Read64(p + 8));
+            v3 = XXH64Round(v3, XXH64Read64(p + 16));
+            v4 = XXH64Round(v4, XXH64Read64(p + 24));
+            p += 32;
+        }
+        while (p <= limit);
+
+        hash = XXH64Rotl(v1, 1) + XXH64Rotl(v2, 7) + XXH64Rotl(v3, 12) + XXH64Rotl(v4, 18);
+        hash = XXH64MergeRound(hash, v1);
+        hash = XXH64MergeRound(hash, v2);
+        hash = XXH64MergeRound(hash, v3);
+        hash = XXH64MergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + XXH64_PRIME_5;
+    }
+
+    return XXH64Finalize(hash + (u64)size, p, (size_t)(end - p));
+}
+
+// Streaming XXH64 for data that arrives in pieces, gives the same result
+// as CalculateXXH64 over the concatenation of all the updates.
+class XXH64Stream
+{
+public:
+    XXH64Stream()
+    {
+        Reset();
+    }
+
+    void Reset(u64 seed = 0)
+    {
+        m_v[0] = seed + XXH64_PRIME_1 + XXH64_PRIME_2;
+        m_v[1] = seed + XXH64_PRIME_2;
+        m_v[2] = seed;
+        m_v[3] = seed - XXH64_PRIME_1;
+        m_seed = seed;
+        m_total = 0;
+        m_buffered = 0;
+    }
+
+    void Update(const void* data, size_t size)
+    {
+        const u8* p = (const u8*)data;
+        const u8* end = p + size;
+        m_total += size;
+
+        if ((m_buffered + size) < 32)
+        {
+            memcpy(m_buffer + m_buffered, p, size);
+            m_buffered += (u32)size;
+            return;
+        }
+
+        if (m_buffered > 0)
+        {
+            u32 fill = 32 - m_buffered;
+            memcpy(m_buffer + m_buffered, p, fill);
+            Consume(m_buffer);
+            p += fill;
+            m_buffered = 0;
+        }
+
+        while ((p + 32) <= end)
+        {
+            Consume(p);
+            p += 32;
+        }
+
+        m_buffered = (u32)(end - p);
+        memcpy(m_buffer, p, m_buffered);
+    }
+
+    u64 Digest() const
+    {
+        u64 hash;
+
+        if (m_total >= 32)
+        {
+            hash = XXH64Rotl(m_v[0], 1) + XXH64Rotl(m_v[1], 7) + XXH64Rotl(m_v[2], 12) + XXH64Rotl(m_v[3], 18);
+            hash = XXH64MergeRound(hash, m_v[0]);
+            hash = XXH64MergeRound(hash, m_v[1]);
+            hash = XXH64MergeRound(hash, m_v[2]);
+            hash = XXH64MergeRound(hash, m_v[3]);
+        }
+        else
+        {
+            hash = m_seed + XXH64_PRIME_5;
+        }
+
+        return XXH64Finalize(hash + m_total, m_buffer, m_buffered);
+    }
+
+private:
+    INLINE void Consume(const u8* p)
+    {
+        m_v[0] = XXH64Round(m_v[0], XXH64Read64(p));
+        m_v[1] = XXH64Round(m_v[1], XXH64Read64(p + 8));
+        m_v[2] = XXH64Round(m_v[2], XXH64Read64(p + 16));
+        m_v[3] = XXH64Round(m_v[3], XXH64Read64(p + 24));
+    }
+
+private:
+    u64 m_v[4];
+    u64 m_seed;
+    u64 m_total;
+    u8 m_buffer[32];
+    u32 m_buffered;
+};
+
+#endif /* XXHASH_H */
@@ -17,13 +17,23 @@
  *
  */
 
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
 #include <vector>
-#include <algorithm>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
 #include "../src/geargrafx.h"
-#include "RSJparser.tcc"
 
 bool g_mcp_stdio_mode = false;
 
+// Runs the SingleStepTests CPU vectors in XX.json, one opcode file per job.
+// Each worker thread owns a core and parses its files with a small
+// streaming reader that runs every test as soon as it is read, instead of
+// building a document tree first.
+
 int excluded_tests[] = {
     0x02, 0x03, 0x0B, 0x13, 0x1B, 0x22, 0x23, 0x2B, 0x33, 0x3B,
     0x42, 0x43, 0x44, 0x4B, 0x53, 0x54, 0x5B, 0x5C, 0x62, 0x63,
@@ -32,27 +42,96 @@ int excluded_tests[] = {
     0xE2, 0xE3, 0xEB, 0xF3, 0xF4, 0xFB, 0xFC,
 };
 
-bool run_file(const char* filename);
-bool run_test(RSJresource& test);
+struct Test_Ram
+{
+    u16 address;
+    u8 value;
+};
+
+struct Test_State
+{
+    int pc;
+    int s;
+    int a;
+    int x;
+    int y;
+    int p;
+    std::vector<Test_Ram> ram;
+};
 
-GeargrafxCore* core = NULL;
-HuC6280* cpu = NULL;
-Memory* memory = NULL;
+struct Test_Vector
+{
+    std::string name;
+    Test_State initial;
+    Test_State final;
+    int cycles;
+};
+
+struct Test_File
+{
+    int opcode;
+    bool found;
+    bool passed;
+    int count;
+    std::string report;
+};
+
+struct Test_Worker
+{
+    GeargrafxCore* core;
+    HuC6280* cpu;
+    Memory* memory;
+    std::string* report;
+};
+
+class Json_Reader
+{
+public:
+    Json_Reader(const char* data, size_t size) : m_p(data), m_end(data + size) { }
+    bool Consume(char c);
+    bool Peek(char c);
+    bool ReadInt(int& value);
+    bool ReadString(std::string& value);
+    bool ReadKey(std::string& key);
+    bool SkipValue();
+
+private:
+    void SkipWhitespace();
+
+private:
+    const char* m_p;
+    const char* m_end;
+};
+
+static std::vector<int> opcodes;
+static std::vector<Test_File> results;
+static std::atomic<int> next_file(0);
+static bool check_cycles = true;
+static std::string test_dir = ".";
+
+static bool parse_options(int argc, char* argv[], int& threads);
+static void run_worker(void);
+static void run_file(Test_Worker& worker, Test_File& file);
+static bool read_file(const std::string& path, std::vector<char>& data);
+static bool read_test(Json_Reader& reader, Test_Vector& test);
+static bool read_state(Json_Reader& reader, Test_State& state);
+static bool run_test(Test_Worker& worker, const Test_Vector& test);
+static void report(Test_Worker& worker, const char* format, ...);
+static std::string opcode_name(int opcode);
 
 int main(int argc, char* argv[])
 {
-    UNUSED(argc);
-    UNUSED(argv);
+    int threads = (int)std::thread::hardware_concurrency();
 
-    int ret = 0;
+    if (!parse_options(argc, argv, threads))
+    {
+        fprintf(stderr, "Usage: %s [-j threads] [--no-cycles] [dir]\n", argv[0]);
+        return 1;
+    }
 
-    core = new GeargrafxCore();
-    core->Init(NULL);
-    cpu = core->GetHuC6280();
-    memory = core->GetMemory();
+    if (threads < 1)
+        threads = 1;
 
-    char file_number[4];
-    char file_name[10];
     int exclude_count = sizeof(excluded_tests) / sizeof(int);
 
     Log("Excluding %d tests...", exclude_count);
@@ -71,149 +150,497 @@ int main(int argc, char* argv[])
         }
 
         if (excluded)
+            Log("Excluding %02X: %s", i, opcode_name(i).c_str());
+        else
+            opcodes.push_back(i);
+    }
+
+    results.resize(opcodes.size());
+
+    Log("Running %d opcode files on %d threads%s...", (int)opcodes.size(), threads,
+        check_cycles ? "" : ", skipping cycle counts");
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+        workers.push_back(std::thread(run_worker));
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(end - start).count();
+
+    int ret = 0;
+    int total = 0;
+    int failed_files = 0;
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Test_File& file = results[i];
+        std::string name = opcode_name(file.opcode);
+
+        if (!file.found)
         {
-            Log("Excluding %02X: %s", i, k_huc6280_opcode_names[i].name);
+            Log("%02x.json not found", file.opcode);
             continue;
         }
 
-        Log("-> Testing %02X: %s", i, k_huc6280_opcode_names[i].name);
-
-        snprintf(file_number, 4, "%02x", i);
-        snprintf(file_name, 10, "%s.json", file_number);
+        total += file.count;
 
-        if (!run_file(file_name))
+        if (file.passed)
+            Log("-> %02X: %s, %d tests passed", file.opcode, name.c_str(), file.count);
+        else
         {
+            Log("-> %02X: %s FAILED", file.opcode, name.c_str());
+            printf("%s", file.report.c_str());
+            failed_files++;
             ret = 1;
-            break;
         }
     }
 
-    SafeDelete(core);
+    Log("%d tests run in %.2f s, %d files failed", total, elapsed, failed_files);
 
     return ret;
 }
 
-bool run_file(const char* filename)
+static bool parse_options(int argc, char* argv[], int& threads)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-j") == 0) && (i + 1 < argc))
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-cycles") == 0)
+            check_cycles = false;
+        else if (argv[i][0] != '-')
+            test_dir = argv[i];
+        else
+            return false;
+    }
+
+    return true;
+}
+
+static void run_worker(void)
 {
-    std::ifstream json_fstream (filename);
+    Test_Worker worker;
+    worker.core = new GeargrafxCore();
+    worker.core->Init(NULL);
+    worker.cpu = worker.core->GetHuC6280();
+    worker.memory = worker.core->GetMemory();
 
-    if (!json_fstream.is_open())
+    for (;;)
     {
-        Log("%s not found", filename);
-        return true;
+        int index = next_file.fetch_add(1);
+
+        if (index >= (int)opcodes.size())
+            break;
+
+        Test_File& file = results[index];
+        file.opcode = opcodes[index];
+        worker.report = &file.report;
+        run_file(worker, file);
     }
 
-    RSJresource json_file(json_fstream);
+    SafeDelete(worker.core);
+}
 
-    int i = 0;
-    bool failed = false;
+static void run_file(Test_Worker& worker, Test_File& file)
+{
+    char file_name[16];
+    snprintf(file_name, sizeof(file_name), "%02x.json", file.opcode);
 
-    for (auto it=json_file.as_array().begin(); it!=json_file.as_array().end(); ++it)
+    std::vector<char> data;
+
+    file.found = read_file(test_dir + "/" + file_name, data);
+    file.passed = true;
+    file.count = 0;
+
+    if (!file.found)
+        return;
+
+    Json_Reader reader(data.data(), data.size());
+    Test_Vector test;
+
+    if (!reader.Consume('['))
     {
-        RSJresource test = (*it);
+        report(worker, "%s: not a test array\n", file_name);
+        file.passed = false;
+        return;
+    }
 
-        if (!run_test(test))
+    bool first = true;
+
+    while (!reader.Consume(']'))
+    {
+        if ((!first && !reader.Consume(',')) || !read_test(reader, test))
         {
-            Log("%s: test %d failed - %s", filename, i, test["name"].as_str().c_str());
-            std::cout << test.as_str() << std::endl;
-            failed = true;
-            break;
+            report(worker, "%s: parse error after test %d\n", file_name, file.count);
+            file.passed = false;
+            return;
+        }
+
+        first = false;
+
+        if (!run_test(worker, test))
+        {
+            report(worker, "%s: test %d failed - %s\n", file_name, file.count, test.name.c_str());
+            file.passed = false;
+            return;
         }
 
-        i++;
+        file.count++;
     }
+}
 
-    //if (!failed)
-    //    Log("%s: %d tests passed", filename, i);
+static bool read_file(const std::string& path, std::vector<char>& data)
+{
+    FILE* file = fopen(path.c_str(), "rb");
 
-    return !failed;
+    if (!IsValidPointer(file))
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    data.resize(size > 0 ? (size_t)size : 0);
+    size_t read = data.empty() ? 0 : fread(data.data(), 1, data.size(), file);
+    fclose(file);
+
+    return read == data.size();
 }
 
-bool run_test(RSJresource& test)
+static bool read_test(Json_Reader& reader, Test_Vector& test)
 {
-    bool failed = false;
+    std::string key;
 
-    cpu->GetState()->PC->SetValue(test["initial"]["pc"].as<int>());
-    cpu->GetState()->S->SetValue(test["initial"]["s"].as<int>());
-    cpu->GetState()->A->SetValue(test["initial"]["a"].as<int>());
-    cpu->GetState()->X->SetValue(test["initial"]["x"].as<int>());
-    cpu->GetState()->Y->SetValue(test["initial"]["y"].as<int>());
-    cpu->GetState()->P->SetValue(test["initial"]["p"].as<int>());
+    test.name.clear();
+    test.cycles = -1;
 
-    for (auto it=test["initial"]["ram"].as_array().begin(); it!=test["initial"]["ram"].as_array().end(); ++it)
+    if (!reader.Consume('{'))
+        return false;
+
+    while (!reader.Consume('}'))
     {
-        memory->Write((*it)[0].as<int>(), (*it)[1].as<int>());
+        if (!reader.ReadKey(key))
+            return false;
+
+        bool ok;
+
+        if (key == "name")
+            ok = reader.ReadString(test.name);
+        else if (key == "initial")
+            ok = read_state(reader, test.initial);
+        else if (key == "final")
+            ok = read_state(reader, test.final);
+        else if (key == "cycles")
+        {
+            // Only the number of bus cycles is checked
+            ok = reader.Consume('[');
+            test.cycles = 0;
+
+            while (ok && !reader.Consume(']'))
+            {
+                ok = ((test.cycles == 0) || reader.Consume(',')) && reader.SkipValue();
+                test.cycles++;
+            }
+        }
+        else
+            ok = reader.SkipValue();
+
+        if (!ok || (!reader.Peek('}') && !reader.Consume(',')))
+            return false;
     }
 
-    cpu->RunInstruction();
+    return true;
+}
+
+static bool read_state(Json_Reader& reader, Test_State& state)
+{
+    std::string key;
 
-#if 0
-    unsigned int cycles = cpu->Tick();
+    state.ram.clear();
 
-    unsigned int expected_cycles = test["cycles"].as_array().size();
+    if (!reader.Consume('{'))
+        return false;
 
-    if (cycles != expected_cycles)
+    while (!reader.Consume('}'))
     {
-        Log("Cycles failed, expected: %d got: %d", expected_cycles, cycles);
-        failed = true;
+        if (!reader.ReadKey(key))
+            return false;
+
+        bool ok;
+
+        if (key == "pc")
+            ok = reader.ReadInt(state.pc);
+        else if (key == "s")
+            ok = reader.ReadInt(state.s);
+        else if (key == "a")
+            ok = reader.ReadInt(state.a);
+        else if (key == "x")
+            ok = reader.ReadInt(state.x);
+        else if (key == "y")
+            ok = reader.ReadInt(state.y);
+        else if (key == "p")
+            ok = reader.ReadInt(state.p);
+        else if (key == "ram")
+        {
+            ok = reader.Consume('[');
+
+            while (ok && !reader.Consume(']'))
+            {
+                int address = 0;
+                int value = 0;
+
+                ok = (state.ram.empty() || reader.Consume(',')) &&
+                     reader.Consume('[') && reader.ReadInt(address) && reader.Consume(',') &&
+                     reader.ReadInt(value) && reader.Consume(']');
+
+                Test_Ram ram = { (u16)address, (u8)value };
+                state.ram.push_back(ram);
+            }
+        }
+        else
+            ok = reader.SkipValue();
+
+        if (!ok || (!reader.Peek('}') && !reader.Consume(',')))
+            return false;
     }
-#endif
 
-    u16 pc = cpu->GetState()->PC->GetValue();
-    u8 s = cpu->GetState()->S->GetValue();
-    u8 a = cpu->GetState()->A->GetValue();
-    u8 x = cpu->GetState()->X->GetValue();
-    u8 y = cpu->GetState()->Y->GetValue();
-    u8 p = cpu->GetState()->P->GetValue();
+    return true;
+}
+
+static bool run_test(Test_Worker& worker, const Test_Vector& test)
+{
+    bool failed = false;
+    HuC6280* cpu = worker.cpu;
+    Memory* memory = worker.memory;
+    HuC6280::HuC6280_State* state = cpu->GetState();
+
+    state->PC->SetValue(test.initial.pc);
+    state->S->SetValue(test.initial.s);
+    state->A->SetValue(test.initial.a);
+    state->X->SetValue(test.initial.x);
+    state->Y->SetValue(test.initial.y);
+    state->P->SetValue(test.initial.p);
+
+    for (size_t i = 0; i < test.initial.ram.size(); i++)
+        memory->Write(test.initial.ram[i].address, test.initial.ram[i].value);
+
+    u32 master_cycles = cpu->RunInstruction();
 
-    if (pc != test["final"]["pc"].as<int>())
+    if (check_cycles && (test.cycles >= 0))
     {
-        Log("PC failed, expected: %04X got: %04X", test["final"]["pc"].as<int>(), pc);
+        int cycles = (int)(master_cycles / k_huc6280_speed_divisor[*state->SPEED]);
+
+        if (cycles != test.cycles)
+        {
+            report(worker, "Cycles failed, expected: %d got: %d\n", test.cycles, cycles);
+            failed = true;
+        }
+    }
+
+    u16 pc = state->PC->GetValue();
+    u8 s = state->S->GetValue();
+    u8 a = state->A->GetValue();
+    u8 x = state->X->GetValue();
+    u8 y = state->Y->GetValue();
+    u8 p = state->P->GetValue();
+
+    if (pc != test.final.pc)
+    {
+        report(worker, "PC failed, expected: %04X got: %04X\n", test.final.pc, pc);
         failed = true;
     }
 
-    if (s != test["final"]["s"].as<int>())
+    if (s != test.final.s)
     {
-        Log("S failed, expected: %02X got: %02X", test["final"]["s"].as<int>(), s);
+        report(worker, "S failed, expected: %02X got: %02X\n", test.final.s, s);
         failed = true;
     }
 
-    if (a != test["final"]["a"].as<int>())
+    if (a != test.final.a)
     {
-        Log("A failed, expected: %02X got: %02X", test["final"]["a"].as<int>(), a);
+        report(worker, "A failed, expected: %02X got: %02X\n", test.final.a, a);
         failed = true;
     }
 
-    if (x != test["final"]["x"].as<int>())
+    if (x != test.final.x)
     {
-        Log("X failed, expected: %02X got: %02X", test["final"]["x"].as<int>(), x);
+        report(worker, "X failed, expected: %02X got: %02X\n", test.final.x, x);
         failed = true;
     }
 
-    if (y != test["final"]["y"].as<int>())
+    if (y != test.final.y)
     {
-        Log("Y failed, expected: %02X got: %02X", test["final"]["y"].as<int>(), y);
+        report(worker, "Y failed, expected: %02X got: %02X\n", test.final.y, y);
         failed = true;
     }
 
-    if (p != test["final"]["p"].as<int>())
+    if (p != test.final.p)
     {
-        Log("P failed, expected: %02X got: %02X", test["final"]["p"].as<int>(), p);
+        report(worker, "P failed, expected: %02X got: %02X\n", test.final.p, p);
         failed = true;
     }
 
-    for (auto it=test["final"]["ram"].as_array().begin(); it!=test["final"]["ram"].as_array().end(); ++it)
+    for (size_t i = 0; i < test.final.ram.size(); i++)
     {
-        u16 address = (*it)[0].as<int>();
+        u16 address = test.final.ram[i].address;
         u8 value = memory->Read(address);
-        u8 expected = (*it)[1].as<int>();
+        u8 expected = test.final.ram[i].value;
 
         if (value != expected)
         {
-            Log("RAM failed at %04X, expected: %02X got: %02X", address, expected, value);
+            report(worker, "RAM failed at %04X, expected: %02X got: %02X\n", address, expected, value);
             failed = true;
         }
     }
 
     return !failed;
-}
\ No newline at end of file
+}
+
+// Failures are collected per file and printed in opcode order once every
+// worker is done, so the output doesn't depend on thread timing
+static void report(Test_Worker& worker, const char* format, ...)
+{
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    worker.report->append(buffer);
+}
+
+// Opcode names carry {x} markers for the disassembler colors
+static std::string opcode_name(int opcode)
+{
+    std::string name;
+    const char* p = k_huc6280_opcode_names[opcode].name[GG_Disassembler_Syntax_Geargrafx];
+
+    while (*p)
+    {
+        if ((p[0] == '{') && (p[1] != 0) && (p[2] == '}'))
+            p += 3;
+        else
+            name += *p++;
+    }
+
+    return name;
+}
+
+void Json_Reader::SkipWhitespace()
+{
+    while ((m_p < m_end) && ((*m_p == ' ') || (*m_p == '\n') || (*m_p == '\r') || (*m_p == '\t')))
+        m_p++;
+}
+
+bool Json_Reader::Peek(char c)
+{
+    SkipWhitespace();
+    return (m_p < m_end) && (*m_p == c);
+}
+
+bool Json_Reader::Consume(char c)
+{
+    if (!Peek(c))
+        return false;
+
+    m_p++;
+    return true;
+}
+
+bool Json_Reader::ReadInt(int& value)
+{
+    SkipWhitespace();
+
+    bool negative = (m_p < m_end) && (*m_p == '-');
+    if (negative)
+        m_p++;
+
+    if ((m_p >= m_end) || (*m_p < '0') || (*m_p > '9'))
+        return false;
+
+    value = 0;
+    while ((m_p < m_end) && (*m_p >= '0') && (*m_p <= '9'))
+        value = (value * 10) + (*m_p++ - '0');
+
+    if (negative)
+        value = -value;
+
+    return true;
+}
+
+bool Json_Reader::ReadString(std::string& value)
+{
+    if (!Consume('"'))
+        return false;
+
+    value.clear();
+
+    while ((m_p < m_end) && (*m_p != '"'))
+    {
+        if ((*m_p == '\\') && (m_p + 1 < m_end))
+            m_p++;
+        value += *m_p++;
+    }
+
+    if (m_p >= m_end)
+        return false;
+
+    m_p++;
+    return true;
+}
+
+bool Json_Reader::ReadKey(std::string& key)
+{
+    return ReadString(key) && Consume(':');
+}
+
+bool Json_Reader::SkipValue()
+{
+    SkipWhitespace();
+
+    if (m_p >= m_end)
+        return false;
+
+    char c = *m_p;
+
+    if (c == '"')
+    {
+        std::string ignored;
+        return ReadString(ignored);
+    }
+
+    if ((c == '[') || (c == '{'))
+    {
+        char close = (c == '[') ? ']' : '}';
+        bool first = true;
+        m_p++;
+
+        while (!Consume(close))
+        {
+            std::string key;
+
+            if (!first && !Consume(','))
+                return false;
+
+            if ((c == '{') && !ReadKey(key))
+                return false;
+
+            if (!SkipValue())
+                return false;
+
+            first = false;
+        }
+
+        return true;
+    }
+
+    // Numbers, true, false and null
+    while ((m_p < m_end) && (*m_p != ',') && (*m_p != ']') && (*m_p != '}') &&
+           (*m_p != ' ') && (*m_p != '\n') && (*m_p != '\r') && (*m_p != '\t'))
+        m_p++;
+
+    return true;
+}
@@ -0,0 +1,1542 @@
+/*
+ * Geargrafx - PC Engine / TurboGrafx Emulator
+ * Copyright (C) 2024  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#include <stdlib.h>
+#include <vector>
+#include <thread>
+#include <sstream>
+#include "../src/geargrafx.h"
+#include "../src/cdrom_cuebin_image.h"
+#include "../src/cdrom_chd_image.h"
+#include "../src/media_file.h"
+#include "../platforms/shared/desktop/loop_detector.h"
+
+bool g_mcp_stdio_mode = false;
+
+// Runs many cores on many threads and checks that every core produces the
+// same frames and audio as when the cores run one after another. Then
+// records input movies and checks that they replay on a fresh core, that
+// state hashes follow save states and forks, that speculative frames only
+// skip audio and video work, that save state files round-trip, that incremental states
+// restore a CD-ROM core, and that the offline renderer finds the loop of a
+// looping HES.
+
+// Minimal HuCard: fills a PSG waveform, then loops forever folding the
+// joypad buttons into a counter and writing it to the PSG frequency, VRAM
+// and the VCE palette
+static const u8 k_program[] = {
+    0x78,                   // SEI
+    0xD4,                   // CSH
+    0xA9, 0xFF, 0x53, 0x01, // LDA #$FF, TAM #$01
+    0xA9, 0xF8, 0x53, 0x02, // LDA #$F8, TAM #$02
+    0x03, 0x05,             // ST0 #$05
+    0x13, 0xC0,             // ST1 #$C0
+    0x23, 0x00,             // ST2 #$00
+    0x9C, 0x00, 0x08,       // STZ $0800
+    0xA9, 0xFF,             // LDA #$FF
+    0x8D, 0x01, 0x08,       // STA $0801
+    0x8D, 0x05, 0x08,       // STA $0805
+    0x9C, 0x04, 0x08,       // STZ $0804
+    0xA2, 0x20,             // LDX #$20
+    0x8A,                   // TXA
+    0x29, 0x1F,             // AND #$1F
+    0x8D, 0x06, 0x08,       // STA $0806
+    0xCA,                   // DEX
+    0xD0, 0xF7,             // BNE -9
+    0xA9, 0x9F,             // LDA #$9F
+    0x8D, 0x04, 0x08,       // STA $0804
+    0x9C, 0x00, 0x10,       // STZ $1000
+    0xAD, 0x00, 0x10,       // LDA $1000
+    0x29, 0x0F,             // AND #$0F
+    0x4D, 0x00, 0x20,       // EOR $2000
+    0x8D, 0x00, 0x20,       // STA $2000
+    0xEE, 0x00, 0x20,       // INC $2000
+    0xAD, 0x00, 0x20,       // LDA $2000
+    0x8D, 0x02, 0x08,       // STA $0802
+    0x03, 0x00,             // ST0 #$00
+    0x8D, 0x02, 0x00,       // STA $0002
+    0x23, 0x00,             // ST2 #$00
+    0x03, 0x02,             // ST0 #$02
+    0x8D, 0x02, 0x00,       // STA $0002
+    0x8D, 0x03, 0x00,       // STA $0003
+    0x8D, 0x04, 0x04,       // STA $0404
+    0x8D, 0x05, 0x04,       // STA $0405
+    0x80, 0xD3              // BRA -45
+};
+
+// Minimal System Card for a data-only CD: loops forever writing a counter
+// to WRAM, two CD RAM banks, VRAM (spread over the whole VRAM) and ADPCM
+static const u8 k_cdrom_program[] = {
+    0x78,                   // SEI
+    0xD4,                   // CSH
+    0xA9, 0xFF, 0x53, 0x01, // LDA #$FF, TAM #$01
+    0xA9, 0xF8, 0x53, 0x02, // LDA #$F8, TAM #$02
+    0xA9, 0x80, 0x53, 0x04, // LDA #$80, TAM #$04
+    0xA9, 0x83, 0x53, 0x08, // LDA #$83, TAM #$08
+    0x03, 0x05,             // ST0 #$05
+    0x13, 0xC0,             // ST1 #$C0
+    0x23, 0x00,             // ST2 #$00
+    0x9C, 0x08, 0x18,       // STZ $1808
+    0xA9, 0x40,             // LDA #$40
+    0x8D, 0x09, 0x18,       // STA $1809
+    0xA9, 0x03,             // LDA #$03
+    0x8D, 0x0D, 0x18,       // STA $180D
+    0xEE, 0x00, 0x20,       // INC $2000
+    0xAD, 0x00, 0x20,       // LDA $2000
+    0xAA,                   // TAX
+    0x9D, 0x00, 0x40,       // STA $4000,X
+    0x9D, 0x00, 0x61,       // STA $6100,X
+    0x03, 0x00,             // ST0 #$00
+    0x8D, 0x02, 0x00,       // STA $0002
+    0x8D, 0x03, 0x00,       // STA $0003
+    0x03, 0x02,             // ST0 #$02
+    0x8D, 0x02, 0x00,       // STA $0002
+    0x8D, 0x03, 0x00,       // STA $0003
+    0x8D, 0x0A, 0x18,       // STA $180A
+    0x80, 0xDE              // BRA -34
+};
+
+// Minimal HES-like player: 50 intro frames with their own frequencies,
+// then a 100 frame loop stepping the PSG frequency once per VBlank. The
+// silent variant turns the channel off after the intro instead.
+static const u8 k_loop_program[] = {
+    0x78,                   // SEI
+    0xD4,                   // CSH
+    0xA9, 0xFF, 0x53, 0x01, // LDA #$FF, TAM #$01
+    0xA9, 0xF8, 0x53, 0x02, // LDA #$F8, TAM #$02
+    0x03, 0x05,             // ST0 #$05
+    0x13, 0xC8,             // ST1 #$C8
+    0x23, 0x00,             // ST2 #$00
+    0x03, 0x0A,             // ST0 #$0A
+    0x13, 0x02,             // ST1 #$02
+    0x23, 0x02,             // ST2 #$02
+    0x03, 0x0B,             // ST0 #$0B
+    0x13, 0x1F,             // ST1 #$1F
+    0x23, 0x03,             // ST2 #$03
+    0x03, 0x0C,             // ST0 #$0C
+    0x13, 0x02,             // ST1 #$02
+    0x23, 0x0F,             // ST2 #$0F
+    0x03, 0x0D,             // ST0 #$0D
+    0x13, 0xEF,             // ST1 #$EF
+    0x23, 0x00,             // ST2 #$00
+    0x03, 0x0E,             // ST0 #$0E
+    0x13, 0x04,             // ST1 #$04
+    0x23, 0x00,             // ST2 #$00
+    0x9C, 0x00, 0x08,       // STZ $0800
+    0xA9, 0xFF,             // LDA #$FF
+    0x8D, 0x01, 0x08,       // STA $0801
+    0x8D, 0x05, 0x08,       // STA $0805
+    0x9C, 0x04, 0x08,       // STZ $0804
+    0xA2, 0x20,             // LDX #$20
+    0x8A,                   // TXA
+    0x29, 0x1F,             // AND #$1F
+    0x8D, 0x06, 0x08,       // STA $0806
+    0xCA,                   // DEX
+    0xD0, 0xF7,             // BNE -9
+    0xA9, 0x9F,             // LDA #$9F
+    0x8D, 0x04, 0x08,       // STA $0804
+    0x9C, 0x00, 0x20,       // STZ $2000
+    0xA9, 0x32,             // LDA #50
+    0x8D, 0x01, 0x20,       // STA $2001
+    0xAD, 0x00, 0x00,       // LDA $0000
+    0x29, 0x20,             // AND #$20
+    0xF0, 0xF9,             // BEQ -7
+    0xAD, 0x01, 0x20,       // LDA $2001
+    0xF0, 0x0B,             // BEQ +11
+    0xCE, 0x01, 0x20,       // DEC $2001
+    0x09, 0x80,             // ORA #$80
+    0x8D, 0x02, 0x08,       // STA $0802
+    0x4C, 0x54, 0xE0,       // JMP $E054
+    0xEE, 0x00, 0x20,       // INC $2000
+    0xAD, 0x00, 0x20,       // LDA $2000
+    0xC9, 0x64,             // CMP #100
+    0xD0, 0x03,             // BNE +3
+    0x9C, 0x00, 0x20,       // STZ $2000
+    0xAD, 0x00, 0x20,       // LDA $2000
+    0x8D, 0x02, 0x08,       // STA $0802
+    0x4C, 0x54, 0xE0        // JMP $E054
+};
+
+static const u8 k_loop_program_silent_end[] = {
+    0x9C, 0x04, 0x08,       // STZ $0804
+    0x4C, 0x54, 0xE0        // JMP $E054
+};
+
+#define LOOP_PROGRAM_SILENT_END_OFFSET 0x6B
+#define LOOP_PROGRAM_INTRO_FRAMES 50
+#define LOOP_PROGRAM_LOOP_FRAMES 100
+
+struct Stress_Job
+{
+    int index;
+    int frames;
+    GeargrafxCore* core;
+    u64 hash;
+};
+
+static std::vector<u8> rom;
+static std::vector<u8> start_state;
+
+static void build_rom(void);
+static void build_loop_rom(std::vector<u8>& loop_rom, bool silent_end);
+static void build_loop_rom(std::vector<u8>& loop_rom, bool silent_end)
+{
+    loop_rom.assign(0x2000, 0xFF);
+    memcpy(loop_rom.data(), k_loop_program, sizeof(k_loop_program));
+
+    if (silent_end)
+        memcpy(loop_rom.data() + LOOP_PROGRAM_SILENT_END_OFFSET, k_loop_program_silent_end, sizeof(k_loop_program_silent_end));
+
+    for (int i = 0x1FF6; i < 0x2000; i += 2)
+    {
+        loop_rom[i] = 0x00;
+        loop_rom[i + 1] = 0xE0;
+    }
+}
+
+static u64 hash_data(u64 hash, const u8* data, size_t size);
+static GeargrafxCore* create_core(void);
+static void run_job(Stress_Job* job);
+static bool run_pass(const char* name, std::vector<Stress_Job>& jobs, bool threaded, const std::vector<u64>* expected);
+static bool run_batch_pass(int instances, int frames, const std::vector<u64>& expected);
+static bool run_movie_pass(InputMovie::Start start, int frames);
+static bool run_state_hash_pass(GeargrafxCore* parent);
+static bool run_speculative_pass(int frames);
+static bool run_savestate_file_pass(GeargrafxCore* parent);
+static bool load_state_file(GeargrafxCore* parent, const char* path, const u8* data, size_t size);
+static void log_state_hash_diff(const char* name, const GG_State_Hash& a, const GG_State_Hash& b);
+static bool run_loop_detector_pass(bool silent_end);
+static bool run_incremental_state_pass(void);
+static GeargrafxCore* create_cdrom_core(void);
+static bool run_cuebin_mapping_pass(void);
+static bool run_chd_cache_pass(void);
+
+int main(int argc, char* argv[])
+{
+    int instances = (int)std::thread::hardware_concurrency();
+    int frames = 300;
+
+    if (argc > 1)
+        instances = atoi(argv[1]);
+    if (argc > 2)
+        frames = atoi(argv[2]);
+    if (instances < 2)
+        instances = 2;
+
+    Log("Running %d cores for %d frames", instances, frames);
+
+    build_rom();
+
+    GeargrafxCore* parent = create_core();
+
+    if (!IsValidPointer(parent))
+        return 1;
+
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+
+    for (int i = 0; i < 60; i++)
+    {
+        int sample_count = 0;
+        parent->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+    }
+
+    size_t size = parent->GetSaveStateSize();
+    start_state.resize(size);
+    parent->SaveState(start_state.data(), size);
+
+    std::vector<Stress_Job> jobs(instances);
+    for (int i = 0; i < instances; i++)
+    {
+        jobs[i].index = i;
+        jobs[i].frames = frames;
+    }
+
+    bool ok = true;
+    std::vector<u64> expected;
+
+    for (int i = 0; i < instances; i++)
+        jobs[i].core = create_core();
+    ok &= run_pass("sequential", jobs, false, NULL);
+    for (int i = 0; i < instances; i++)
+    {
+        expected.push_back(jobs[i].hash);
+        SafeDelete(jobs[i].core);
+    }
+
+    for (int i = 0; i < instances; i++)
+        jobs[i].core = create_core();
+    ok &= run_pass("threaded", jobs, true, &expected);
+    for (int i = 0; i < instances; i++)
+        SafeDelete(jobs[i].core);
+
+    for (int i = 0; i < instances; i++)
+        jobs[i].core = parent->Fork();
+    ok &= run_pass("threaded forks", jobs, true, &expected);
+    for (int i = 0; i < instances; i++)
+        SafeDelete(jobs[i].core);
+
+    ok &= run_batch_pass(instances, frames, expected);
+    ok &= run_movie_pass(InputMovie::START_POWER_ON, frames);
+    ok &= run_movie_pass(InputMovie::START_SAVESTATE, frames);
+    ok &= run_state_hash_pass(parent);
+    ok &= run_speculative_pass(frames);
+    ok &= run_savestate_file_pass(parent);
+    ok &= run_loop_detector_pass(false);
+    ok &= run_loop_detector_pass(true);
+    ok &= run_incremental_state_pass();
+    ok &= run_cuebin_mapping_pass();
+    ok &= run_chd_cache_pass();
+
+    SafeDelete(parent);
+
+    Log(ok ? "All passes match" : "FAILED: passes don't match");
+
+    return ok ? 0 : 1;
+}
+
+static void build_rom(void)
+{
+    rom.assign(0x2000, 0xFF);
+    memcpy(rom.data(), k_program, sizeof(k_program));
+
+    // All vectors point to $E000
+    for (int i = 0x1FF6; i < 0x2000; i += 2)
+    {
+        rom[i] = 0x00;
+        rom[i + 1] = 0xE0;
+    }
+}
+
+static u64 hash_data(u64 hash, const u8* data, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static GeargrafxCore* create_core(void)
+{
+    GeargrafxCore* core = new GeargrafxCore();
+    core->Init(NULL);
+
+    if (!core->LoadHuCardFromBuffer(rom.data(), (int)rom.size(), "stress.pce"))
+    {
+        Log("FAILED: unable to load test HuCard");
+        SafeDelete(core);
+    }
+
+    return core;
+}
+
+static void run_job(Stress_Job* job)
+{
+    GeargrafxCore* core = job->core;
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+
+    core->LoadState(start_state.data(), start_state.size());
+
+    // Each core runs its own number of frames first so no two cores are
+    // in the same state
+    for (int i = 0; i < job->index; i++)
+    {
+        int sample_count = 0;
+        core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+    }
+
+    u64 hash = 0xCBF29CE484222325ULL;
+
+    for (int i = 0; i < job->frames; i++)
+    {
+        if ((i % 16) == (job->index % 16))
+            core->KeyPressed(GG_CONTROLLER_1, GG_KEY_RUN);
+        else
+            core->KeyReleased(GG_CONTROLLER_1, GG_KEY_RUN);
+
+        int sample_count = 0;
+        core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+
+        GG_Runtime_Info runtime;
+        core->GetRuntimeInfo(runtime);
+
+        hash = hash_data(hash, frame_buffer.data(), runtime.screen_width * runtime.screen_height * 4);
+        hash = hash_data(hash, reinterpret_cast<const u8*>(sample_buffer.data()), sample_count * sizeof(s16));
+    }
+
+    job->hash = hash;
+}
+
+static bool run_pass(const char* name, std::vector<Stress_Job>& jobs, bool threaded, const std::vector<u64>* expected)
+{
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (!IsValidPointer(jobs[i].core))
+        {
+            Log("FAILED %s: unable to create core %d", name, (int)i);
+            return false;
+        }
+    }
+
+    if (threaded)
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < jobs.size(); i++)
+            threads.push_back(std::thread(run_job, &jobs[i]));
+        for (size_t i = 0; i < threads.size(); i++)
+            threads[i].join();
+    }
+    else
+    {
+        for (size_t i = 0; i < jobs.size(); i++)
+            run_job(&jobs[i]);
+    }
+
+    bool ok = true;
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (IsValidPointer(expected) && ((*expected)[i] != jobs[i].hash))
+        {
+            Log("FAILED %s: core %d hash %016llX, expected %016llX", name, (int)i, (unsigned long long)jobs[i].hash, (unsigned long long)(*expected)[i]);
+            ok = false;
+        }
+    }
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+// Same jobs through GeargrafxBatch. Each env plays its warm-up frames on
+// its own core, keeps the result as its snapshot and then all envs step
+// together from there.
+static bool run_batch_pass(int instances, int frames, const std::vector<u64>& expected)
+{
+    GeargrafxBatch batch;
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+
+    if (!batch.Init(instances, 4) || !batch.LoadHuCardFromBuffer(rom.data(), (int)rom.size(), "stress.pce"))
+    {
+        Log("FAILED batch: unable to create batch");
+        return false;
+    }
+
+    for (int i = 0; i < instances; i++)
+    {
+        GeargrafxCore* core = batch.GetCore(i);
+        core->LoadState(start_state.data(), start_state.size());
+
+        for (int f = 0; f < i; f++)
+        {
+            int sample_count = 0;
+            core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+        }
+
+        // Run a frame past the snapshot so the reset is actually tested
+        batch.SaveSnapshot(i);
+        int sample_count = 0;
+        core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+
+        if (!batch.ResetToSnapshot(i))
+        {
+            Log("FAILED batch: unable to reset env %d", i);
+            return false;
+        }
+    }
+
+    std::vector<u64> hashes(instances, 0xCBF29CE484222325ULL);
+
+    for (int f = 0; f < frames; f++)
+    {
+        for (int i = 0; i < instances; i++)
+            batch.SetInput(i, GG_CONTROLLER_1, ((f % 16) == (i % 16)) ? GG_KEY_RUN : GG_KEY_NONE);
+
+        batch.Step();
+
+        for (int i = 0; i < instances; i++)
+        {
+            GG_Runtime_Info& runtime = batch.GetRuntimeInfo()[i];
+            hashes[i] = hash_data(hashes[i], batch.GetFrame(i), runtime.screen_width * runtime.screen_height * 4);
+            hashes[i] = hash_data(hashes[i], reinterpret_cast<const u8*>(batch.GetSamples(i)), batch.GetSampleCounts()[i] * sizeof(s16));
+        }
+    }
+
+    bool ok = true;
+
+    for (int i = 0; i < instances; i++)
+    {
+        if (hashes[i] != expected[i])
+        {
+            Log("FAILED batch: env %d hash %016llX, expected %016llX", i, (unsigned long long)hashes[i], (unsigned long long)expected[i]);
+            ok = false;
+        }
+    }
+
+    if (batch.SaveSnapshot(0, instances))
+    {
+        Log("FAILED batch: snapshot from env %d saved", instances);
+        ok = false;
+    }
+
+    // Connecting the MB128 grows the state past the snapshot slots. The
+    // other snapshots must survive the slots being reallocated.
+    if (instances > 1)
+    {
+        int last = instances - 1;
+        u64 before = batch.GetCore(last)->HashState();
+        batch.SaveSnapshot(last);
+        batch.GetCore(0)->EnableMB128(GG_MB128_ENABLED);
+
+        if (!batch.SaveSnapshot(0) || !batch.ResetToSnapshot(0) || !batch.GetCore(0)->GetInput()->GetMB128()->IsConnected())
+        {
+            Log("FAILED batch: unable to snapshot env 0 with the MB128 connected");
+            ok = false;
+        }
+
+        batch.Step();
+
+        if (!batch.ResetToSnapshot(last) || (batch.GetCore(last)->HashState() != before))
+        {
+            Log("FAILED batch: env %d snapshot lost when the snapshots grew", last);
+            ok = false;
+        }
+    }
+
+    if (ok)
+        Log("Pass batch: OK");
+
+    return ok;
+}
+
+// Records a movie with changing input on every port, saves it, and replays
+// it on another core with a different random seed
+static bool run_movie_pass(InputMovie::Start start, int frames)
+{
+    const char* name = (start == InputMovie::START_POWER_ON) ? "movie power on" : "movie save state";
+    const char* path = "geargrafx-stress.ggm";
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+    std::vector<GG_Input_Frame> recorded;
+    InputMovie::Frame_Hash hash;
+    GG_State_Hash recorder_hash, player_hash;
+
+    GeargrafxCore* recorder = create_core();
+    GeargrafxCore* player = create_core();
+
+    if (!IsValidPointer(recorder) || !IsValidPointer(player))
+    {
+        Log("FAILED %s: unable to create cores", name);
+        SafeDelete(recorder);
+        SafeDelete(player);
+        return false;
+    }
+
+    recorder->LoadState(start_state.data(), start_state.size());
+    recorder->GetInput()->EnableTurboTap(true);
+
+    InputMovie movie;
+    bool ok = movie.StartRecording(recorder, start);
+
+    for (int f = 0; ok && (f < frames); f++)
+    {
+        for (int i = 0; i < GG_MAX_GAMEPADS; i++)
+        {
+            GG_Keys key = (GG_Keys)(1 << ((f / 8 + i) % 12));
+            if (((f / 4) + i) % 3)
+                recorder->KeyPressed((GG_Controllers)i, key);
+            else
+                recorder->KeyReleased((GG_Controllers)i, key);
+        }
+
+        recorder->GetInput()->SetMouseDelta((f % 7) - 3, (f % 5) - 2);
+
+        movie.Update();
+        recorded.push_back(*movie.GetFrame(f));
+
+        int sample_count = 0;
+        recorder->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+        InputMovie::HashFrame(recorder, frame_buffer.data(), sample_buffer.data(), sample_count, hash);
+        movie.SetFrameHash(f, hash);
+    }
+
+    recorder->HashState(&recorder_hash);
+    movie.Stop();
+    ok = ok && movie.Save(path);
+
+    InputMovie replay;
+    ok = ok && replay.Load(path);
+    remove(path);
+
+    if (ok && ((replay.GetFrameCount() != frames) || !replay.HasHashes()))
+    {
+        Log("FAILED %s: movie has %d frames", name, replay.GetFrameCount());
+        ok = false;
+    }
+
+    for (int f = 0; ok && (f < frames); f++)
+    {
+        if (memcmp(replay.GetFrame(f), &recorded[f], sizeof(GG_Input_Frame)) != 0)
+        {
+            Log("FAILED %s: input of frame %d doesn't round trip", name, f);
+            ok = false;
+        }
+    }
+
+    player->SetRandomSeed(0xDEADBEEF);
+    ok = ok && replay.StartPlayback(player);
+
+    while (ok && replay.Update())
+    {
+        int frame = replay.GetCurrentFrame() - 1;
+        int sample_count = 0;
+        player->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+        InputMovie::HashFrame(player, frame_buffer.data(), sample_buffer.data(), sample_count, hash);
+
+        if (memcmp(replay.GetFrameHash(frame), &hash, sizeof(hash)) != 0)
+        {
+            Log("FAILED %s: desync at frame %d", name, frame);
+            ok = false;
+        }
+
+        // Stopping the playback releases the buttons, so take the hash now
+        if (frame == (frames - 1))
+            player->HashState(&player_hash);
+    }
+
+    replay.Stop();
+
+    if (ok && (recorder_hash.total != player_hash.total))
+    {
+        log_state_hash_diff(name, recorder_hash, player_hash);
+        ok = false;
+    }
+
+    // Different input must end in a different state: replay with the
+    // buttons of the first pad inverted
+    GG_State_Hash altered_hash;
+    ok = ok && replay.StartPlayback(player);
+
+    while (ok && replay.Update())
+    {
+        int frame = replay.GetCurrentFrame() - 1;
+        GG_Input_Frame altered = *replay.GetFrame(frame);
+        altered.keys[0] ^= 0x0FFF;
+        player->GetInput()->ApplyFrameInput(altered);
+
+        int sample_count = 0;
+        player->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+
+        if (frame == (frames - 1))
+            player->HashState(&altered_hash);
+    }
+
+    replay.Stop();
+
+    if (ok && ((altered_hash.total == recorder_hash.total) ||
+        (altered_hash.components[GG_SAVESTATE_CHUNK_MEMORY] == recorder_hash.components[GG_SAVESTATE_CHUNK_MEMORY])))
+    {
+        Log("FAILED %s: different input ended in the same state", name);
+        ok = false;
+    }
+
+    // A core set up differently from the recording must refuse the movie
+    player->EnableMB128(GG_MB128_ENABLED);
+    if (ok && replay.StartPlayback(player))
+    {
+        Log("FAILED %s: movie played with the MB128 connected", name);
+        replay.Stop();
+        ok = false;
+    }
+
+    SafeDelete(recorder);
+    SafeDelete(player);
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+static bool run_state_hash_pass(GeargrafxCore* parent)
+{
+    const char* name = "state hash";
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+    GG_State_Hash parent_hash, hash;
+    bool ok = true;
+
+    parent->HashState(&parent_hash);
+
+    GeargrafxCore* fork = parent->Fork();
+    GeargrafxCore* loaded = create_core();
+
+    if (!IsValidPointer(fork) || !IsValidPointer(loaded))
+    {
+        Log("FAILED %s: unable to create cores", name);
+        SafeDelete(fork);
+        SafeDelete(loaded);
+        return false;
+    }
+
+    fork->HashState(&hash);
+    if (hash.total != parent_hash.total)
+    {
+        log_state_hash_diff("state hash fork", parent_hash, hash);
+        ok = false;
+    }
+
+    size_t size = parent->GetSaveStateSize();
+    std::vector<u8> state(size);
+    parent->SaveState(state.data(), size);
+    loaded->LoadState(state.data(), size);
+
+    loaded->HashState(&hash);
+    if (hash.total != parent_hash.total)
+    {
+        log_state_hash_diff("state hash load state", parent_hash, hash);
+        ok = false;
+    }
+
+    int sample_count = 0;
+    fork->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+
+    if (fork->HashState() == parent_hash.total)
+    {
+        Log("FAILED %s: hash didn't change after running a frame", name);
+        ok = false;
+    }
+
+    // The test program reads the joypad, so input must change the state
+    loaded->KeyPressed(GG_CONTROLLER_1, GG_KEY_RUN);
+    loaded->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+    loaded->KeyReleased(GG_CONTROLLER_1, GG_KEY_RUN);
+
+    loaded->HashState(&hash);
+    fork->HashState(&parent_hash);
+    if (hash.components[GG_SAVESTATE_CHUNK_MEMORY] == parent_hash.components[GG_SAVESTATE_CHUNK_MEMORY])
+    {
+        Log("FAILED %s: input didn't change the RAM", name);
+        ok = false;
+    }
+
+    // Branch the fork back to the parent reusing its transfer buffer
+    bool copied = fork->CopyStateFrom(parent);
+    parent->HashState(&parent_hash);
+    fork->HashState(&hash);
+    if (!copied || (hash.total != parent_hash.total))
+    {
+        log_state_hash_diff("state hash copy state", parent_hash, hash);
+        ok = false;
+    }
+
+    SafeDelete(fork);
+    SafeDelete(loaded);
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+// Runs the same frames and input from the start state with and without
+// speculative frames. Only the video state may differ, and a rendered
+// frame afterwards must match.
+static bool run_speculative_pass(int frames)
+{
+    const char* name = "speculative frames";
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<u8> speculative_frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+    bool ok = true;
+
+    GeargrafxCore* core = create_core();
+    GeargrafxCore* speculative = create_core();
+    GeargrafxCore* reference = create_core();
+
+    if (!IsValidPointer(core) || !IsValidPointer(speculative) || !IsValidPointer(reference))
+    {
+        Log("FAILED %s: unable to create cores", name);
+        SafeDelete(core);
+        SafeDelete(speculative);
+        SafeDelete(reference);
+        return false;
+    }
+
+    // In reference mode speculative frames run the plain way, audio included
+    reference->SetReferenceMode(true);
+
+    core->LoadState(start_state.data(), start_state.size());
+    speculative->LoadState(start_state.data(), start_state.size());
+    reference->LoadState(start_state.data(), start_state.size());
+
+    for (int i = 0; i < frames; i++)
+    {
+        if ((i % 8) < 3)
+        {
+            core->KeyPressed(GG_CONTROLLER_1, GG_KEY_RUN);
+            speculative->KeyPressed(GG_CONTROLLER_1, GG_KEY_RUN);
+            reference->KeyPressed(GG_CONTROLLER_1, GG_KEY_RUN);
+        }
+        else
+        {
+            core->KeyReleased(GG_CONTROLLER_1, GG_KEY_RUN);
+            speculative->KeyReleased(GG_CONTROLLER_1, GG_KEY_RUN);
+            reference->KeyReleased(GG_CONTROLLER_1, GG_KEY_RUN);
+        }
+
+        int sample_count = 0;
+        core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+        speculative->RunToVBlankSpeculative(NULL);
+        reference->RunToVBlankSpeculative(NULL);
+
+        GG_State_Hash hash, speculative_hash, reference_hash;
+        core->HashState(&hash);
+        speculative->HashState(&speculative_hash);
+        reference->HashState(&reference_hash);
+
+        if (hash.total != reference_hash.total)
+        {
+            log_state_hash_diff("speculative frames reference mode", hash, reference_hash);
+            ok = false;
+        }
+
+        for (int c = 0; c < GG_SAVESTATE_CHUNK_COUNT; c++)
+        {
+            if ((c == GG_SAVESTATE_CHUNK_HUC6260) || (c == GG_SAVESTATE_CHUNK_HUC6270_1) ||
+                (c == GG_SAVESTATE_CHUNK_HUC6270_2) || (c == GG_SAVESTATE_CHUNK_SCREENSHOT))
+                continue;
+
+            if (hash.components[c] != speculative_hash.components[c])
+            {
+                Log("FAILED %s: %s state diverged at frame %d", name, GeargrafxCore::GetStateComponentName(c), i);
+                ok = false;
+            }
+        }
+
+        if (!ok)
+            break;
+    }
+
+    int sample_count = 0;
+    core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+    speculative->RunToVBlankSpeculative(speculative_frame_buffer.data());
+
+    GG_Runtime_Info runtime;
+    core->GetRuntimeInfo(runtime);
+
+    if (memcmp(frame_buffer.data(), speculative_frame_buffer.data(), runtime.screen_width * runtime.screen_height * 4) != 0)
+    {
+        Log("FAILED %s: rendered frame after speculative frames doesn't match", name);
+        ok = false;
+    }
+
+    SafeDelete(core);
+    SafeDelete(speculative);
+    SafeDelete(reference);
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+// Encodes a state with a screenshot into the chunked container and checks
+// that it decodes back to the same bytes, that each chunk reads on its
+// own, that corrupt tables of contents are rejected, and that both a
+// chunked file and an old flat file load from disk
+static bool run_savestate_file_pass(GeargrafxCore* parent)
+{
+    const char* name = "save state file";
+    bool ok = true;
+
+    size_t size = parent->GetSaveStateSize(true);
+    std::vector<u8> state(size);
+    u32 chunk_sizes[GG_SAVESTATE_CHUNK_COUNT];
+    std::vector<u8> file;
+    std::vector<u8> decoded;
+
+    if (!parent->SaveState(state.data(), size, true, chunk_sizes) || !SaveStateFile::Encode(state.data(), chunk_sizes, file))
+    {
+        Log("FAILED %s: unable to encode state", name);
+        return false;
+    }
+
+    state.resize(size);
+
+    if (!SaveStateFile::Decode(file.data(), file.size(), decoded) || (decoded != state))
+    {
+        Log("FAILED %s: decoded state doesn't match", name);
+        ok = false;
+    }
+
+    std::istringstream stream(std::string(file.begin(), file.end()));
+    size_t offset = 0;
+
+    for (int i = 0; i < GG_SAVESTATE_CHUNK_COUNT; i++)
+    {
+        if (chunk_sizes[i] == 0)
+            continue;
+
+        std::vector<u8> chunk(chunk_sizes[i]);
+
+        if (!SaveStateFile::ReadChunk(stream, i, chunk.data(), chunk_sizes[i]) ||
+            (memcmp(chunk.data(), state.data() + offset, chunk_sizes[i]) != 0))
+        {
+            Log("FAILED %s: %s chunk doesn't match", name, GeargrafxCore::GetStateComponentName(i));
+            ok = false;
+        }
+
+        offset += chunk_sizes[i];
+    }
+
+    SaveStateFile::Chunk* toc = reinterpret_cast<SaveStateFile::Chunk*>(file.data() + sizeof(SaveStateFile::Header));
+
+    for (int test = 0; test < 3; test++)
+    {
+        std::vector<u8> corrupt(file);
+        SaveStateFile::Chunk* chunk = reinterpret_cast<SaveStateFile::Chunk*>(corrupt.data() + sizeof(SaveStateFile::Header));
+
+        if (test == 0)
+            chunk->raw_size = 0xFFFFFFF0;
+        else if (test == 1)
+            chunk->offset = (u32)corrupt.size();
+        else
+            corrupt.resize(toc->offset + (toc->size / 2));
+
+        std::istringstream corrupt_stream(std::string(corrupt.begin(), corrupt.end()));
+        std::vector<u8> buffer(chunk_sizes[toc->id]);
+
+        if (SaveStateFile::Decode(corrupt.data(), corrupt.size(), decoded) ||
+            SaveStateFile::ReadChunk(corrupt_stream, toc->id, buffer.data(), (u32)buffer.size()))
+        {
+            Log("FAILED %s: corrupt file %d accepted", name, test);
+            ok = false;
+        }
+    }
+
+    ok &= load_state_file(parent, "./stress_chunked.state", file.data(), file.size());
+    ok &= load_state_file(parent, "./stress_flat.state", state.data(), state.size());
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+static bool load_state_file(GeargrafxCore* parent, const char* path, const u8* data, size_t size)
+{
+    bool ok = true;
+    FILE* file = fopen(path, "wb");
+
+    if (IsValidPointer(file))
+    {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+
+    GeargrafxCore* loaded = create_core();
+    GG_SaveState_Header header;
+
+    if (!IsValidPointer(loaded) || !loaded->LoadState(path) || (loaded->HashState() != parent->HashState()))
+    {
+        Log("FAILED save state file: unable to load %s", path);
+        ok = false;
+    }
+    else if (!loaded->GetSaveStateHeader(-1, path, &header) || (header.rom_crc != parent->GetMedia()->GetCRC()))
+    {
+        Log("FAILED save state file: unable to read the header of %s", path);
+        ok = false;
+    }
+
+    SafeDelete(loaded);
+    remove(path);
+
+    return ok;
+}
+
+static void log_state_hash_diff(const char* name, const GG_State_Hash& a, const GG_State_Hash& b)
+{
+    for (int i = 0; i < GG_SAVESTATE_CHUNK_COUNT; i++)
+    {
+        if (a.components[i] != b.components[i])
+            Log("FAILED %s: %s state diverged", name, GeargrafxCore::GetStateComponentName(i));
+    }
+}
+
+// Plays the looping player and checks the loop found by the offline
+// renderer, and that a song ending in silence stops on the silence
+static bool run_loop_detector_pass(bool silent_end)
+{
+    const char* name = silent_end ? "loop detector silence" : "loop detector";
+    const int window = 60;
+    const int max_frames = 2000;
+    std::vector<u8> loop_rom;
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+
+    build_loop_rom(loop_rom, silent_end);
+
+    GeargrafxCore* core = new GeargrafxCore();
+    core->Init(NULL);
+
+    if (!core->LoadHuCardFromBuffer(loop_rom.data(), (int)loop_rom.size(), "loop.hes"))
+    {
+        Log("FAILED %s: unable to load test HES", name);
+        SafeDelete(core);
+        return false;
+    }
+
+    LoopDetector detector(window, window / 2);
+    LoopDetector::Result result = LoopDetector::RESULT_NONE;
+    int frame = 0;
+
+    for (; (frame < max_frames) && (result == LoopDetector::RESULT_NONE); frame++)
+    {
+        int sample_count = 0;
+        core->RunToVBlank(NULL, sample_buffer.data(), &sample_count, NULL, false);
+        result = detector.Update(core->GetAudio()->GetPSG(), sample_buffer.data(), sample_count);
+    }
+
+    SafeDelete(core);
+
+    bool ok = true;
+    int start = silent_end ? detector.GetSilenceStart() : detector.GetLoopStart();
+
+    if (result != (silent_end ? LoopDetector::RESULT_SILENCE : LoopDetector::RESULT_LOOP))
+    {
+        Log("FAILED %s: result %d after %d frames", name, (int)result, frame);
+        ok = false;
+    }
+    // The first frame sees a few short VBlanks before the VDC is set up, so
+    // the intro ends a little early, and the output takes a few frames to
+    // fade out after the channel is turned off
+    else if ((start < LOOP_PROGRAM_INTRO_FRAMES - 4) || (start > LOOP_PROGRAM_INTRO_FRAMES + 4))
+    {
+        Log("FAILED %s: starts at frame %d", name, start);
+        ok = false;
+    }
+    else if (!silent_end && (detector.GetLoopLength() != LOOP_PROGRAM_LOOP_FRAMES))
+    {
+        Log("FAILED %s: loop is %d frames long", name, detector.GetLoopLength());
+        ok = false;
+    }
+    else if (!silent_end && (detector.GetEndFrame(1, max_frames) != start + LOOP_PROGRAM_LOOP_FRAMES))
+    {
+        Log("FAILED %s: one loop ends at frame %d", name, detector.GetEndFrame(1, max_frames));
+        ok = false;
+    }
+    else if (detector.GetEndFrame(1000, max_frames) > max_frames)
+    {
+        Log("FAILED %s: end frame not clamped", name);
+        ok = false;
+    }
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+#define INCREMENTAL_CUE_PATH "./stress_incremental.cue"
+#define INCREMENTAL_BIN_PATH "stress_incremental.bin"
+
+static GeargrafxCore* create_cdrom_core(void)
+{
+    std::vector<u8> bios(GG_BIOS_SYSCARD_SIZE, 0xFF);
+    memcpy(bios.data(), k_cdrom_program, sizeof(k_cdrom_program));
+
+    for (int i = 0x1FF6; i < 0x2000; i += 2)
+    {
+        bios[i] = 0x00;
+        bios[i + 1] = 0xE0;
+    }
+
+    GeargrafxCore* core = new GeargrafxCore();
+    core->Init(NULL);
+
+    if (!core->LoadBiosFromBuffer(bios.data(), (int)bios.size(), true) || !core->LoadMedia(INCREMENTAL_CUE_PATH))
+    {
+        Log("FAILED: unable to load test CD-ROM");
+        SafeDelete(core);
+    }
+
+    return core;
+}
+
+// Takes a full state, lets the CD program dirty WRAM, CD RAM, VRAM and
+// ADPCM RAM, and checks that two chained incremental states loaded on top
+// of the full one leave a second core in the same state
+static bool run_incremental_state_pass(void)
+{
+    const char* name = "incremental state";
+    std::vector<u8> frame_buffer(2048 * 512 * 4);
+    std::vector<s16> sample_buffer(GG_AUDIO_BUFFER_SIZE * 2);
+    bool ok = true;
+
+    FILE* cue = fopen(INCREMENTAL_CUE_PATH, "w");
+    FILE* bin = fopen(INCREMENTAL_BIN_PATH, "wb");
+
+    if (IsValidPointer(cue))
+        fprintf(cue, "FILE \"%s\" BINARY\n  TRACK 01 MODE1/2048\n    INDEX 01 00:00:00\n", INCREMENTAL_BIN_PATH);
+
+    if (IsValidPointer(bin))
+    {
+        std::vector<u8> sectors(2048 * 150, 0);
+        fwrite(sectors.data(), 1, sectors.size(), bin);
+    }
+
+    if (IsValidPointer(cue))
+        fclose(cue);
+    if (IsValidPointer(bin))
+        fclose(bin);
+
+    GeargrafxCore* core = create_cdrom_core();
+    GeargrafxCore* restored = create_cdrom_core();
+
+    if (!IsValidPointer(core) || !IsValidPointer(restored))
+    {
+        Log("FAILED %s: unable to create cores", name);
+        SafeDelete(core);
+        SafeDelete(restored);
+        remove(INCREMENTAL_CUE_PATH);
+        remove(INCREMENTAL_BIN_PATH);
+        return false;
+    }
+
+    for (int i = 0; i < 10; i++)
+    {
+        int sample_count = 0;
+        core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+    }
+
+    size_t full_size = core->GetSaveStateSize();
+    std::vector<u8> full_state(full_size);
+    core->SaveState(full_state.data(), full_size);
+    core->ClearDirtyPages();
+
+    restored->LoadState(full_state.data(), full_size);
+
+    for (int step = 0; step < 2; step++)
+    {
+        for (int i = 0; i < 10; i++)
+        {
+            int sample_count = 0;
+            core->RunToVBlank(frame_buffer.data(), sample_buffer.data(), &sample_count);
+        }
+
+        if ((core->GetMemory()->GetDirtyPageCount() == 0) ||
+            (core->GetHuC6270_1()->GetVRAMDirtyPages()->GetDirtyCount() == 0) ||
+            (core->GetAdpcm()->GetRAMDirtyPages()->GetDirtyCount() == 0))
+        {
+            Log("FAILED %s: writes didn't mark RAM, VRAM and ADPCM pages dirty", name);
+            ok = false;
+        }
+
+        size_t size = 0;
+        core->SaveStateIncremental(NULL, size);
+        std::vector<u8> state(size);
+
+        if (!core->SaveStateIncremental(state.data(), size) || (size >= full_size))
+        {
+            Log("FAILED %s: incremental state of %d bytes, full state is %d bytes", name, (int)size, (int)full_size);
+            ok = false;
+        }
+
+        if (core->GetDirtyPageCount() != 0)
+        {
+            Log("FAILED %s: dirty pages not cleared after saving", name);
+            ok = false;
+        }
+
+        if (!restored->LoadStateIncremental(state.data(), size))
+        {
+            Log("FAILED %s: unable to load incremental state %d", name, step);
+            ok = false;
+        }
+
+        GG_State_Hash hash, restored_hash;
+        core->HashState(&hash);
+        restored->HashState(&restored_hash);
+
+        if (hash.total != restored_hash.total)
+        {
+            log_state_hash_diff("incremental state", hash, restored_hash);
+            ok = false;
+        }
+    }
+
+    SafeDelete(core);
+    SafeDelete(restored);
+    remove(INCREMENTAL_CUE_PATH);
+    remove(INCREMENTAL_BIN_PATH);
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+#define MAPPING_CUE_PATH "./stress_mapping.cue"
+#define MAPPING_BIN_PATH "stress_mapping.bin"
+#define MAPPING_WAV_PATH "stress_mapping.wav"
+
+static void write_le(std::vector<u8>& data, u32 value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        data.push_back((u8)(value >> (i * 8)));
+}
+
+// Loads the same CUE/BIN/WAV image memory mapped, preloaded and mapped, and
+// through small chunks, and checks that every sector and every run of
+// samples reads the same
+static bool run_cuebin_mapping_pass(void)
+{
+    const char* name = "cue/bin mapping";
+    bool ok = true;
+
+    std::vector<u8> bin(2352 * 250);
+    std::vector<u8> wav;
+    u32 seed = 0x12345678;
+
+    for (size_t i = 0; i < bin.size(); i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        bin[i] = (u8)(seed >> 16);
+    }
+
+    u32 wav_data_size = 2352 * 50;
+    wav.insert(wav.end(), "RIFF", "RIFF" + 4);
+    write_le(wav, 36 + wav_data_size, 4);
+    wav.insert(wav.end(), "WAVEfmt ", "WAVEfmt " + 8);
+    write_le(wav, 16, 4);
+    write_le(wav, 1, 2);
+    write_le(wav, 2, 2);
+    write_le(wav, 44100, 4);
+    write_le(wav, 44100 * 4, 4);
+    write_le(wav, 4, 2);
+    write_le(wav, 16, 2);
+    wav.insert(wav.end(), "data", "data" + 4);
+    write_le(wav, wav_data_size, 4);
+
+    for (u32 i = 0; i < wav_data_size; i++)
+        wav.push_back(bin[(i * 7) % bin.size()]);
+
+    FILE* cue = fopen(MAPPING_CUE_PATH, "w");
+    FILE* bin_file = fopen(MAPPING_BIN_PATH, "wb");
+    FILE* wav_file = fopen(MAPPING_WAV_PATH, "wb");
+
+    if (IsValidPointer(cue))
+    {
+        fprintf(cue, "FILE \"%s\" BINARY\n  TRACK 01 MODE1/2352\n    INDEX 01 00:00:00\n", MAPPING_BIN_PATH);
+        fprintf(cue, "  TRACK 02 AUDIO\n    INDEX 01 00:02:00\n");
+        fprintf(cue, "FILE \"%s\" WAVE\n  TRACK 03 AUDIO\n    INDEX 01 00:00:00\n", MAPPING_WAV_PATH);
+        fclose(cue);
+    }
+    if (IsValidPointer(bin_file))
+    {
+        fwrite(bin.data(), 1, bin.size(), bin_file);
+        fclose(bin_file);
+    }
+    if (IsValidPointer(wav_file))
+    {
+        fwrite(wav.data(), 1, wav.size(), wav_file);
+        fclose(wav_file);
+    }
+
+#if defined(GG_ENABLE_CDROM_CUEBIN_MMAP)
+    MediaFile* file = MediaFile::OpenFile(MAPPING_BIN_PATH);
+    u64 mapped_size = 0;
+    const u8* mapped = IsValidPointer(file) ? file->Map(&mapped_size) : NULL;
+
+    if (!IsValidPointer(mapped) || (mapped_size != bin.size()) || (memcmp(mapped, bin.data(), bin.size()) != 0))
+    {
+        Log("FAILED %s: the native file backend doesn't map files", name);
+        ok = false;
+    }
+
+    SafeDelete(file);
+#endif
+
+    GG_CdRomCueBinLoadOptions mapped_options = GG_CdRomCueBinDefaultLoadOptions();
+    mapped_options.memory_map = true;
+    GG_CdRomCueBinLoadOptions chunked_options = GG_CdRomCueBinDefaultLoadOptions();
+    chunked_options.memory_map = false;
+    chunked_options.chunk_size = 2352 * 3;
+
+    CdRomCueBinImage mapped_image, preloaded_image, chunked_image;
+    mapped_image.Init();
+    preloaded_image.Init();
+    chunked_image.Init();
+    mapped_image.SetLoadOptions(mapped_options);
+    preloaded_image.SetLoadOptions(mapped_options);
+    chunked_image.SetLoadOptions(chunked_options);
+
+    if (!mapped_image.LoadFromFile(MAPPING_CUE_PATH, false) || !preloaded_image.LoadFromFile(MAPPING_CUE_PATH, true) ||
+        !chunked_image.LoadFromFile(MAPPING_CUE_PATH, false) || (chunked_image.GetTOC()->tracks.size() != 3))
+    {
+        Log("FAILED %s: unable to load the test image", name);
+        ok = false;
+    }
+
+    CdRomCueBinImage* images[2] = { &mapped_image, &preloaded_image };
+    std::vector<CdRomImage::Track>& tracks = chunked_image.GetTOC()->tracks;
+
+    for (size_t t = 0; ok && (t < tracks.size()); t++)
+    {
+        const CdRomImage::Track& track = tracks[t];
+
+        for (u32 lba = track.start_lba; ok && (lba < (track.start_lba + track.sector_count)); lba++)
+        {
+            u8 expected[2352];
+            u8 data[2352];
+            bool audio = (track.type == GG_CDROM_AUDIO_TRACK);
+            // Odd offsets and lengths cross chunk and page boundaries
+            u32 offset = audio ? ((lba * 6) % 2000) : 0;
+            u32 count = audio ? (2352 - offset) / 2 : 0;
+
+            memset(expected, 0, sizeof(expected));
+            bool expected_ok = audio ? chunked_image.ReadSamples(lba, offset, (s16*)expected, count) : chunked_image.ReadSector(lba, expected);
+
+            for (int i = 0; i < 2; i++)
+            {
+                memset(data, 0, sizeof(data));
+                bool read_ok = audio ? images[i]->ReadSamples(lba, offset, (s16*)data, count) : images[i]->ReadSector(lba, data);
+
+                if (!expected_ok || !read_ok || (memcmp(expected, data, sizeof(data)) != 0))
+                {
+                    Log("FAILED %s: %s read of LBA %u in track %d doesn't match the chunked read", name, (i == 0) ? "mapped" : "preloaded", lba, (int)t + 1);
+                    ok = false;
+                }
+            }
+        }
+    }
+
+    if (ok && ((mapped_image.GetCRC() != chunked_image.GetCRC()) || (preloaded_image.GetCRC() != chunked_image.GetCRC())))
+    {
+        Log("FAILED %s: CRC differs between mapped and chunked images", name);
+        ok = false;
+    }
+
+    mapped_image.Reset();
+    preloaded_image.Reset();
+    chunked_image.Reset();
+    remove(MAPPING_CUE_PATH);
+    remove(MAPPING_BIN_PATH);
+    remove(MAPPING_WAV_PATH);
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}
+
+#define CHD_CACHE_PATH "stress_cache.chd"
+#define CHD_CACHE_SECTORS_PER_HUNK 4
+#define CHD_CACHE_HUNK_BYTES (CHD_CACHE_SECTORS_PER_HUNK * 2448)
+
+static void write_be(std::vector<u8>& data, size_t offset, u64 value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        data[offset + i] = (u8)(value >> ((bytes - 1 - i) * 8));
+}
+
+// Writes an uncompressed version 5 CHD with a data track and an audio
+// track. Hunk i is stored at block i + 1, block 0 holds the header, the
+// map and the track metadata.
+static bool write_test_chd(const char* path, u32 data_frames, u32 audio_frames)
+{
+    u32 hunk_count = (data_frames + audio_frames) / CHD_CACHE_SECTORS_PER_HUNK;
+    std::vector<u8> chd((size_t)(hunk_count + 1) * CHD_CACHE_HUNK_BYTES, 0);
+    char tracks[2][128];
+
+    snprintf(tracks[0], sizeof(tracks[0]), CDROM_TRACK_METADATA2_FORMAT, 1, "MODE1_RAW", "NONE", (int)data_frames, 0, "MODE1", "RW", 0);
+    snprintf(tracks[1], sizeof(tracks[1]), CDROM_TRACK_METADATA2_FORMAT, 2, "AUDIO", "NONE", (int)audio_frames, 0, "MODE1", "RW", 0);
+
+    memcpy(chd.data(), "MComprHD", 8);
+    write_be(chd, 8, CHD_V5_HEADER_SIZE, 4);
+    write_be(chd, 12, 5, 4);
+    write_be(chd, 32, (u64)hunk_count * CHD_CACHE_HUNK_BYTES, 8);
+    write_be(chd, 40, CHD_V5_HEADER_SIZE, 8);
+    write_be(chd, 56, CHD_CACHE_HUNK_BYTES, 4);
+    write_be(chd, 60, 2448, 4);
+
+    for (u32 i = 0; i < hunk_count; i++)
+        write_be(chd, CHD_V5_HEADER_SIZE + (i * 4), i + 1, 4);
+
+    size_t meta_offset = CHD_V5_HEADER_SIZE + (hunk_count * 4);
+    write_be(chd, 48, meta_offset, 8);
+
+    for (int t = 0; t < 2; t++)
+    {
+        size_t length = strlen(tracks[t]) + 1;
+        size_t next = meta_offset + 16 + length;
+
+        write_be(chd, meta_offset, CDROM_TRACK_METADATA2_TAG, 4);
+        write_be(chd, meta_offset + 4, length, 4);
+        write_be(chd, meta_offset + 8, (t == 0) ? next : 0, 8);
+        memcpy(&chd[meta_offset + 16], tracks[t], length);
+        meta_offset = next;
+    }
+
+    if (meta_offset > CHD_CACHE_HUNK_BYTES)
+        return false;
+
+    u32 seed = 0x9E3779B9;
+
+    for (size_t i = CHD_CACHE_HUNK_BYTES; i < chd.size(); i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        chd[i] = (u8)(seed >> 16);
+    }
+
+    FILE* file = fopen(path, "wb");
+
+    if (!IsValidPointer(file))
+        return false;
+
+    bool ok = (fwrite(chd.data(), 1, chd.size(), file) == chd.size());
+    fclose(file);
+
+    return ok;
+}
+
+// Reads a CHD through a hunk cache much smaller than the disc, forwards,
+// backwards and at random, so most reads come after the hunk was evicted,
+// and through the two preload paths. Every read must match the hunk read
+// straight from libchdr.
+static bool run_chd_cache_pass(void)
+{
+    const char* name = "chd cache";
+    const u32 data_frames = 400;
+    const u32 audio_frames = 200;
+    bool ok = write_test_chd(CHD_CACHE_PATH, data_frames, audio_frames);
+
+    chd_file* chd = NULL;
+
+    if (!ok || (chd_open(CHD_CACHE_PATH, CHD_OPEN_READ, NULL, &chd) != CHDERR_NONE))
+    {
+        Log("FAILED %s: unable to create the test CHD", name);
+        remove(CHD_CACHE_PATH);
+        return false;
+    }
+
+    GG_CdRomChdLoadOptions bounded_options = GG_CdRomChdDefaultLoadOptions();
+    bounded_options.cache_budget = GG_CDROM_CHD_MIN_CACHED_HUNKS * CHD_CACHE_HUNK_BYTES;
+    bounded_options.prefetch_hunks = 2;
+    GG_CdRomChdLoadOptions decode_options = GG_CdRomChdDefaultLoadOptions();
+    decode_options.precache_decode = true;
+    decode_options.precache_threads = 3;
+
+    CdRomChdImage bounded_image, precache_image, decode_image;
+    CdRomChdImage* images[3] = { &bounded_image, &precache_image, &decode_image };
+    const char* image_names[3] = { "bounded", "chd_precache", "decoded" };
+
+    bounded_image.Init();
+    precache_image.Init();
+    decode_image.Init();
+    bounded_image.SetLoadOptions(bounded_options);
+    decode_image.SetLoadOptions(decode_options);
+
+    if (!bounded_image.LoadFromFile(CHD_CACHE_PATH, false) || !precache_image.LoadFromFile(CHD_CACHE_PATH, true) ||
+        !decode_image.LoadFromFile(CHD_CACHE_PATH, true) || (bounded_image.GetTOC()->tracks.size() != 2))
+    {
+        Log("FAILED %s: unable to load the test CHD", name);
+        ok = false;
+    }
+
+    u32 sector_count = data_frames + audio_frames;
+    std::vector<u32> order;
+
+    for (u32 lba = 0; lba < sector_count; lba++)
+        order.push_back(lba);
+    for (u32 lba = sector_count; lba > 0; lba--)
+        order.push_back(lba - 1);
+
+    u32 seed = 1;
+
+    for (u32 i = 0; i < sector_count; i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        order.push_back((seed >> 8) % sector_count);
+    }
+
+    std::vector<u8> hunk(CHD_CACHE_HUNK_BYTES);
+
+    for (size_t i = 0; ok && (i < order.size()); i++)
+    {
+        u32 lba = order[i];
+        bool audio = (lba >= data_frames);
+        u32 hunk_index = lba / CHD_CACHE_SECTORS_PER_HUNK;
+        const u8* sector = &hunk[(lba % CHD_CACHE_SECTORS_PER_HUNK) * 2448];
+        u8 expected[2352];
+        u8 data[2352];
+        u32 offset = audio ? ((lba * 6) % 2000) : 0;
+        u32 count = audio ? (2352 - offset) / 2 : 0;
+        u32 size = audio ? count * 2 : 2048;
+
+        if (chd_read(chd, hunk_index, hunk.data()) != CHDERR_NONE)
+        {
+            Log("FAILED %s: libchdr can't read hunk %u", name, hunk_index);
+            ok = false;
+            break;
+        }
+
+        if (audio)
+        {
+            // CD-DA is stored big-endian and returned in host order
+            for (u32 b = 0; b < size; b += 2)
+            {
+                expected[b] = sector[offset + b + 1];
+                expected[b + 1] = sector[offset + b];
+            }
+        }
+        else
+            memcpy(expected, sector + 16, size);
+
+        for (int m = 0; m < 3; m++)
+        {
+            memset(data, 0, sizeof(data));
+            bool read_ok = audio ? images[m]->ReadSamples(lba, offset, (s16*)data, count) : images[m]->ReadSector(lba, data);
+
+            if (!read_ok || (memcmp(expected, data, size) != 0))
+            {
+                Log("FAILED %s: %s read of LBA %u doesn't match hunk %u", name, image_names[m], lba, hunk_index);
+                ok = false;
+            }
+        }
+    }
+
+    bounded_image.Reset();
+    precache_image.Reset();
+    decode_image.Reset();
+    chd_close(chd);
+    remove(CHD_CACHE_PATH);
+
+    if (ok)
+        Log("Pass %s: OK", name);
+
+    return ok;
+}